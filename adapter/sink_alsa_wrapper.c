@@ -173,6 +173,14 @@ int alsa_wrapper_write(sink_handle_t handle, char *buffer, int size)
     return size;
 }
 
+int alsa_wrapper_period_hint(sink_handle_t handle, int *period_size, int *buffer_size)
+{
+    struct alsa_wrapper *alsa = (struct alsa_wrapper *)handle;
+    *period_size = (int)(alsa->chunk_size * alsa->bits_per_frame / 8);
+    *buffer_size = (int)(alsa->buffer_size * alsa->bits_per_frame / 8);
+    return 0;
+}
+
 void alsa_wrapper_close(sink_handle_t handle)
 {
     OS_LOGD(TAG, "closing alsa");
@@ -29,6 +29,8 @@ int alsa_wrapper_write(sink_handle_t handle, char *buffer, int size);
 
 void alsa_wrapper_close(sink_handle_t handle);
 
+int alsa_wrapper_period_hint(sink_handle_t handle, int *period_size, int *buffer_size);
+
 #ifdef __cplusplus
 }
 #endif
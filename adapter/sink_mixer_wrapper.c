@@ -0,0 +1,547 @@
+// Copyright (c) 2019-2022 Qinglong<sysu.zqlong@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "osal/os_thread.h"
+#include "cutils/memory_helper.h"
+#include "cutils/log_helper.h"
+#include "cutils/list.h"
+#include "cutils/ringbuf.h"
+#include "sink_mixer_wrapper.h"
+
+#define TAG "[liteplayer]mixer"
+
+#define MIXER_GAIN_SHIFT        15
+#define MIXER_GAIN_UNITY        (1 << MIXER_GAIN_SHIFT)
+#define MIXER_RAMP_FRAMES       32  // gain is stepped once per 32 frames while ramping
+#define MIXER_STREAM_PERIODS    4   // stream ringbuf size in mixer periods
+#define MIXER_RESAMPLE_SHIFT    16
+
+#define DEFAULT_MIXER_DUCK_GAIN     0.25f
+#define DEFAULT_MIXER_ATTACK_MS     100
+#define DEFAULT_MIXER_RELEASE_MS    400
+
+struct sink_mixer {
+    struct sink_wrapper *downstream;
+    sink_handle_t out;
+    int samplerate;
+    int channels;
+    int period_frames;
+    float duck_gain;
+    int attack_ms;
+    int release_ms;
+    os_mutex lock;
+    os_cond cond;
+    os_thread tid;
+    bool exit;
+    struct listnode streams;
+    int32_t *acc;
+    int16_t *in;
+    int16_t *mix;
+};
+
+struct sink_mixer_stream {
+    struct listnode node;
+    struct sink_mixer *mixer;
+    bool ducks_others;
+    float gain;
+    float cur_gain;
+    bool opened;
+    bool primed;
+    ringbuf_handle rb;
+    int in_samplerate;
+    int in_channels;
+    int in_bits;
+    // write side conversion, touched by the player's sink thread only
+    int16_t *conv;
+    int conv_frames;
+    int16_t *resampled;
+    int resampled_frames;
+    uint32_t phase;
+    uint32_t step;
+    int16_t prev[2];
+};
+
+// acc[i] += in[i]*gain >> 15, gain in [0, MIXER_GAIN_UNITY]
+static void mixer_accumulate(int32_t *acc, const int16_t *in, int count, int gain)
+{
+    int i = 0;
+    if (gain >= MIXER_GAIN_UNITY) {
+#if defined(__SSE2__)
+        for (; i + 8 <= count; i += 8) {
+            __m128i x = _mm_loadu_si128((const __m128i *)&in[i]);
+            __m128i sign = _mm_srai_epi16(x, 15);
+            __m128i *dst = (__m128i *)&acc[i];
+            _mm_storeu_si128(dst, _mm_add_epi32(_mm_loadu_si128(dst), _mm_unpacklo_epi16(x, sign)));
+            _mm_storeu_si128(dst + 1, _mm_add_epi32(_mm_loadu_si128(dst + 1), _mm_unpackhi_epi16(x, sign)));
+        }
+#elif defined(__ARM_NEON)
+        for (; i + 8 <= count; i += 8) {
+            int16x8_t x = vld1q_s16(&in[i]);
+            vst1q_s32(&acc[i], vaddw_s16(vld1q_s32(&acc[i]), vget_low_s16(x)));
+            vst1q_s32(&acc[i + 4], vaddw_s16(vld1q_s32(&acc[i + 4]), vget_high_s16(x)));
+        }
+#endif
+        for (; i < count; i++)
+            acc[i] += in[i];
+        return;
+    }
+
+#if defined(__SSE2__)
+    // (x, x) pairs against (gain, 0) pairs: pmaddwd yields x*gain in 32 bits
+    __m128i g = _mm_set1_epi32(gain);
+    for (; i + 8 <= count; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *)&in[i]);
+        __m128i lo = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(x, x), g), MIXER_GAIN_SHIFT);
+        __m128i hi = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(x, x), g), MIXER_GAIN_SHIFT);
+        __m128i *dst = (__m128i *)&acc[i];
+        _mm_storeu_si128(dst, _mm_add_epi32(_mm_loadu_si128(dst), lo));
+        _mm_storeu_si128(dst + 1, _mm_add_epi32(_mm_loadu_si128(dst + 1), hi));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t x = vld1q_s16(&in[i]);
+        int32x4_t lo = vmull_n_s16(vget_low_s16(x), (int16_t)gain);
+        int32x4_t hi = vmull_n_s16(vget_high_s16(x), (int16_t)gain);
+        vst1q_s32(&acc[i], vsraq_n_s32(vld1q_s32(&acc[i]), lo, MIXER_GAIN_SHIFT));
+        vst1q_s32(&acc[i + 4], vsraq_n_s32(vld1q_s32(&acc[i + 4]), hi, MIXER_GAIN_SHIFT));
+    }
+#endif
+    for (; i < count; i++)
+        acc[i] += ((int32_t)in[i] * gain) >> MIXER_GAIN_SHIFT;
+}
+
+static void mixer_saturate(int16_t *out, const int32_t *acc, int count)
+{
+    int i = 0;
+#if defined(__SSE2__)
+    for (; i + 8 <= count; i += 8) {
+        __m128i lo = _mm_loadu_si128((const __m128i *)&acc[i]);
+        __m128i hi = _mm_loadu_si128((const __m128i *)&acc[i + 4]);
+        _mm_storeu_si128((__m128i *)&out[i], _mm_packs_epi32(lo, hi));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 8 <= count; i += 8)
+        vst1q_s16(&out[i], vcombine_s16(vqmovn_s32(vld1q_s32(&acc[i])), vqmovn_s32(vld1q_s32(&acc[i + 4]))));
+#endif
+    for (; i < count; i++) {
+        int32_t v = acc[i];
+        out[i] = v > INT16_MAX ? INT16_MAX : (v < INT16_MIN ? INT16_MIN : (int16_t)v);
+    }
+}
+
+static inline int16_t mixer_sample_s16(const char *in, int bits, int index)
+{
+    if (bits == 32)
+        return (int16_t)(((const int32_t *)in)[index] >> 16);
+    return ((const int16_t *)in)[index];
+}
+
+// Convert to s16 with the mixer's channel count
+static void mixer_convert(int16_t *out, int out_channels, const char *in, int in_channels, int bits, int frames)
+{
+    int f, c;
+    for (f = 0; f < frames; f++) {
+        int base = f*in_channels;
+        if (out_channels == 1) {
+            int32_t sum = 0;
+            for (c = 0; c < in_channels; c++)
+                sum += mixer_sample_s16(in, bits, base + c);
+            *out++ = (int16_t)(sum / in_channels);
+        } else {
+            int16_t left = mixer_sample_s16(in, bits, base);
+            *out++ = left;
+            *out++ = in_channels > 1 ? mixer_sample_s16(in, bits, base + 1) : left;
+        }
+    }
+}
+
+// Linear interpolation between the previous frame and the current one, phase is in Q16 relative
+// to the last frame of the previous write
+static int mixer_resample(struct sink_mixer_stream *stream, const int16_t *in, int frames, int16_t *out)
+{
+    int channels = stream->mixer->channels;
+    uint32_t pos = stream->phase;
+    int out_frames = 0;
+    int c;
+
+    while ((int)(pos >> MIXER_RESAMPLE_SHIFT) < frames) {
+        int index = (int)(pos >> MIXER_RESAMPLE_SHIFT);
+        // Q15 weight keeps the product of a full scale step within 32 bits
+        int32_t frac = (int32_t)(pos & ((1 << MIXER_RESAMPLE_SHIFT) - 1)) >> 1;
+        const int16_t *b = &in[index*channels];
+        const int16_t *a = index > 0 ? b - channels : stream->prev;
+        for (c = 0; c < channels; c++)
+            *out++ = (int16_t)(a[c] + (((b[c] - a[c]) * frac) >> (MIXER_RESAMPLE_SHIFT - 1)));
+        out_frames++;
+        pos += stream->step;
+    }
+    stream->phase = pos - ((uint32_t)frames << MIXER_RESAMPLE_SHIFT);
+    for (c = 0; c < channels; c++)
+        stream->prev[c] = in[(frames - 1)*channels + c];
+    return out_frames;
+}
+
+static void sink_mixer_stream_mix(struct sink_mixer *mixer, struct sink_mixer_stream *stream,
+                                  int frames, float target)
+{
+    int channels = mixer->channels;
+    int done = 0;
+    while (done < frames) {
+        int n = frames - done;
+        if (n > MIXER_RAMP_FRAMES)
+            n = MIXER_RAMP_FRAMES;
+        if (stream->cur_gain != target) {
+            int ms = target < stream->cur_gain ? mixer->attack_ms : mixer->release_ms;
+            float step = ms > 0 ? (float)n*1000/((float)ms*mixer->samplerate) : 1.0f;
+            if (target < stream->cur_gain)
+                stream->cur_gain = stream->cur_gain - step > target ? stream->cur_gain - step : target;
+            else
+                stream->cur_gain = stream->cur_gain + step < target ? stream->cur_gain + step : target;
+        }
+        int gain = (int)(stream->cur_gain*MIXER_GAIN_UNITY + 0.5f);
+        if (gain > 0)
+            mixer_accumulate(&mixer->acc[done*channels], &mixer->in[done*channels], n*channels, gain);
+        done += n;
+    }
+}
+
+static void *sink_mixer_thread(void *arg)
+{
+    struct sink_mixer *mixer = (struct sink_mixer *)arg;
+    int frame_size = mixer->channels*sizeof(int16_t);
+    int period_size = mixer->period_frames*frame_size;
+    struct listnode *item;
+
+    os_mutex_lock(mixer->lock);
+    while (!mixer->exit) {
+        bool active = false, ducking = false;
+        list_for_each(item, &mixer->streams) {
+            struct sink_mixer_stream *stream = listnode_to_item(item, struct sink_mixer_stream, node);
+            if (stream->opened) {
+                active = true;
+                if (stream->ducks_others)
+                    ducking = true;
+            }
+        }
+        if (!active) {
+            // Downstream sink is kept open while idle, nothing is written until a stream opens
+            os_cond_wait(mixer->cond, mixer->lock);
+            continue;
+        }
+
+        memset(mixer->acc, 0, mixer->period_frames*mixer->channels*sizeof(int32_t));
+        list_for_each(item, &mixer->streams) {
+            struct sink_mixer_stream *stream = listnode_to_item(item, struct sink_mixer_stream, node);
+            if (!stream->opened)
+                continue;
+            int filled = rb_bytes_filled(stream->rb);
+            if (!stream->primed) {
+                // Wait for a full period to avoid starting a stream with a gap
+                if (filled < period_size && !rb_is_done_write(stream->rb))
+                    continue;
+                stream->primed = true;
+            }
+            int frames = filled/frame_size;
+            if (frames > mixer->period_frames)
+                frames = mixer->period_frames;
+            if (frames <= 0)
+                continue;
+            frames = rb_read(stream->rb, (char *)mixer->in, frames*frame_size, 0)/frame_size;
+            float target = stream->gain;
+            if (ducking && !stream->ducks_others)
+                target *= mixer->duck_gain;
+            if (frames > 0)
+                sink_mixer_stream_mix(mixer, stream, frames, target);
+        }
+        os_cond_broadcast(mixer->cond);
+        os_mutex_unlock(mixer->lock);
+
+        mixer_saturate(mixer->mix, mixer->acc, mixer->period_frames*mixer->channels);
+        int offset = 0;
+        while (offset < period_size) {
+            int ret = mixer->downstream->write(mixer->out, (char *)mixer->mix + offset, period_size - offset);
+            if (ret <= 0) {
+                OS_LOGE(TAG, "Failed to write downstream sink, drop period");
+                os_thread_sleep_msec(mixer->period_frames*1000/mixer->samplerate);
+                break;
+            }
+            offset += ret;
+        }
+
+        os_mutex_lock(mixer->lock);
+    }
+    os_mutex_unlock(mixer->lock);
+    return NULL;
+}
+
+void *sink_mixer_wrapper_create(struct sink_wrapper *downstream, int samplerate, int channels, int period_ms)
+{
+    if (downstream == NULL || samplerate <= 0 || (channels != 1 && channels != 2) || period_ms <= 0)
+        return NULL;
+
+    struct sink_mixer *mixer = (struct sink_mixer *)OS_CALLOC(1, sizeof(struct sink_mixer));
+    if (mixer == NULL)
+        return NULL;
+    mixer->downstream = downstream;
+    mixer->samplerate = samplerate;
+    mixer->channels = channels;
+    mixer->period_frames = samplerate*period_ms/1000;
+    mixer->duck_gain = DEFAULT_MIXER_DUCK_GAIN;
+    mixer->attack_ms = DEFAULT_MIXER_ATTACK_MS;
+    mixer->release_ms = DEFAULT_MIXER_RELEASE_MS;
+    list_init(&mixer->streams);
+
+    int samples = mixer->period_frames*channels;
+    mixer->acc = (int32_t *)OS_MALLOC(samples*sizeof(int32_t));
+    mixer->in = (int16_t *)OS_MALLOC(samples*sizeof(int16_t));
+    mixer->mix = (int16_t *)OS_MALLOC(samples*sizeof(int16_t));
+    mixer->lock = os_mutex_create();
+    mixer->cond = os_cond_create();
+    if (mixer->acc == NULL || mixer->in == NULL || mixer->mix == NULL ||
+        mixer->lock == NULL || mixer->cond == NULL)
+        goto fail_create;
+
+    OS_LOGD(TAG, "Opening downstream %s: samplerate=%d, channels=%d, period=%d frames",
+            downstream->name(), samplerate, channels, mixer->period_frames);
+    mixer->out = downstream->open(samplerate, channels, 16, downstream->priv_data);
+    if (mixer->out == NULL) {
+        OS_LOGE(TAG, "Failed to open downstream sink");
+        goto fail_create;
+    }
+
+    struct os_thread_attr attr = {
+        .name = "ael-mixer",
+        .priority = OS_THREAD_PRIO_REALTIME,
+        .stacksize = 8192,
+        .joinable = true,
+    };
+    mixer->tid = os_thread_create(&attr, sink_mixer_thread, mixer);
+    if (mixer->tid == NULL) {
+        OS_LOGE(TAG, "Failed to create mixer thread");
+        goto fail_create;
+    }
+    return mixer;
+
+fail_create:
+    if (mixer->out != NULL)
+        downstream->close(mixer->out);
+    if (mixer->lock != NULL)
+        os_mutex_destroy(mixer->lock);
+    if (mixer->cond != NULL)
+        os_cond_destroy(mixer->cond);
+    OS_FREE(mixer->acc);
+    OS_FREE(mixer->in);
+    OS_FREE(mixer->mix);
+    OS_FREE(mixer);
+    return NULL;
+}
+
+void sink_mixer_wrapper_destroy(void *priv)
+{
+    struct sink_mixer *mixer = (struct sink_mixer *)priv;
+    struct listnode *item, *tmp;
+    if (mixer == NULL)
+        return;
+
+    os_mutex_lock(mixer->lock);
+    mixer->exit = true;
+    list_for_each(item, &mixer->streams) {
+        struct sink_mixer_stream *stream = listnode_to_item(item, struct sink_mixer_stream, node);
+        rb_abort(stream->rb);
+    }
+    os_cond_broadcast(mixer->cond);
+    os_mutex_unlock(mixer->lock);
+    os_thread_join(mixer->tid, NULL);
+
+    list_for_each_safe(item, tmp, &mixer->streams) {
+        struct sink_mixer_stream *stream = listnode_to_item(item, struct sink_mixer_stream, node);
+        OS_LOGW(TAG, "Stream(%p) not destroyed before mixer", stream);
+        list_remove(item);
+        stream->mixer = NULL;
+    }
+    mixer->downstream->close(mixer->out);
+    os_mutex_destroy(mixer->lock);
+    os_cond_destroy(mixer->cond);
+    OS_FREE(mixer->acc);
+    OS_FREE(mixer->in);
+    OS_FREE(mixer->mix);
+    OS_FREE(mixer);
+}
+
+void sink_mixer_wrapper_set_ducking(void *priv, float duck_gain, int attack_ms, int release_ms)
+{
+    struct sink_mixer *mixer = (struct sink_mixer *)priv;
+    os_mutex_lock(mixer->lock);
+    mixer->duck_gain = duck_gain < 0.0f ? 0.0f : (duck_gain > 1.0f ? 1.0f : duck_gain);
+    mixer->attack_ms = attack_ms;
+    mixer->release_ms = release_ms;
+    os_mutex_unlock(mixer->lock);
+}
+
+void *sink_mixer_wrapper_stream_create(void *priv, bool ducks_others)
+{
+    struct sink_mixer *mixer = (struct sink_mixer *)priv;
+    struct sink_mixer_stream *stream =
+        (struct sink_mixer_stream *)OS_CALLOC(1, sizeof(struct sink_mixer_stream));
+    if (stream == NULL)
+        return NULL;
+    stream->mixer = mixer;
+    stream->ducks_others = ducks_others;
+    stream->gain = 1.0f;
+    stream->cur_gain = 1.0f;
+    stream->rb = rb_create(MIXER_STREAM_PERIODS*mixer->period_frames*mixer->channels*sizeof(int16_t));
+    if (stream->rb == NULL) {
+        OS_FREE(stream);
+        return NULL;
+    }
+
+    os_mutex_lock(mixer->lock);
+    list_add_tail(&mixer->streams, &stream->node);
+    os_mutex_unlock(mixer->lock);
+    return stream;
+}
+
+void sink_mixer_wrapper_stream_destroy(void *priv)
+{
+    struct sink_mixer_stream *stream = (struct sink_mixer_stream *)priv;
+    if (stream == NULL)
+        return;
+    if (stream->mixer != NULL) {
+        os_mutex_lock(stream->mixer->lock);
+        list_remove(&stream->node);
+        os_mutex_unlock(stream->mixer->lock);
+    }
+    rb_destroy(stream->rb);
+    OS_FREE(stream->conv);
+    OS_FREE(stream->resampled);
+    OS_FREE(stream);
+}
+
+void sink_mixer_wrapper_stream_set_gain(void *priv, float gain)
+{
+    struct sink_mixer_stream *stream = (struct sink_mixer_stream *)priv;
+    os_mutex_lock(stream->mixer->lock);
+    stream->gain = gain < 0.0f ? 0.0f : (gain > 1.0f ? 1.0f : gain);
+    os_mutex_unlock(stream->mixer->lock);
+}
+
+const char *sink_mixer_wrapper_name()
+{
+    return "mixer";
+}
+
+sink_handle_t sink_mixer_wrapper_open(int samplerate, int channels, int bits, void *priv_data)
+{
+    struct sink_mixer_stream *stream = (struct sink_mixer_stream *)priv_data;
+    OS_LOGD(TAG, "Opening stream(%p): samplerate=%d, channels=%d, bits=%d", stream, samplerate, channels, bits);
+    if (stream == NULL || stream->mixer == NULL)
+        return NULL;
+    if (samplerate <= 0 || channels <= 0 || (bits != 16 && bits != 32)) {
+        OS_LOGE(TAG, "Unsupported format: samplerate=%d, channels=%d, bits=%d", samplerate, channels, bits);
+        return NULL;
+    }
+
+    struct sink_mixer *mixer = stream->mixer;
+    os_mutex_lock(mixer->lock);
+    rb_reset(stream->rb);
+    stream->in_samplerate = samplerate;
+    stream->in_channels = channels;
+    stream->in_bits = bits;
+    stream->step = (uint32_t)(((uint64_t)samplerate << MIXER_RESAMPLE_SHIFT)/mixer->samplerate);
+    stream->phase = 0;
+    stream->prev[0] = stream->prev[1] = 0;
+    stream->primed = false;
+    stream->opened = true;
+    os_cond_broadcast(mixer->cond);
+    os_mutex_unlock(mixer->lock);
+    return stream;
+}
+
+int sink_mixer_wrapper_write(sink_handle_t handle, char *buffer, int size)
+{
+    struct sink_mixer_stream *stream = (struct sink_mixer_stream *)handle;
+    struct sink_mixer *mixer = stream->mixer;
+    int frames = size/(stream->in_channels*stream->in_bits/8);
+    if (frames <= 0)
+        return size;
+
+    if (frames > stream->conv_frames) {
+        int16_t *conv = (int16_t *)OS_REALLOC(stream->conv, frames*mixer->channels*sizeof(int16_t));
+        if (conv == NULL)
+            return -1;
+        stream->conv = conv;
+        stream->conv_frames = frames;
+    }
+    mixer_convert(stream->conv, mixer->channels, buffer, stream->in_channels, stream->in_bits, frames);
+
+    int16_t *data = stream->conv;
+    if (stream->in_samplerate != mixer->samplerate) {
+        int out_frames = (int)((int64_t)frames*mixer->samplerate/stream->in_samplerate) + 2;
+        if (out_frames > stream->resampled_frames) {
+            int16_t *resampled = (int16_t *)OS_REALLOC(stream->resampled,
+                                                      out_frames*mixer->channels*sizeof(int16_t));
+            if (resampled == NULL)
+                return -1;
+            stream->resampled = resampled;
+            stream->resampled_frames = out_frames;
+        }
+        frames = mixer_resample(stream, stream->conv, frames, stream->resampled);
+        data = stream->resampled;
+    }
+
+    int bytes = frames*mixer->channels*sizeof(int16_t);
+    if (bytes > 0 && rb_write(stream->rb, (char *)data, bytes, 0) != bytes) {
+        OS_LOGE(TAG, "Stream(%p) aborted", stream);
+        return -1;
+    }
+    return size;
+}
+
+void sink_mixer_wrapper_close(sink_handle_t handle)
+{
+    struct sink_mixer_stream *stream = (struct sink_mixer_stream *)handle;
+    struct sink_mixer *mixer = stream->mixer;
+    unsigned long period_usec = (unsigned long)mixer->period_frames*1000000/mixer->samplerate;
+    int wait = MIXER_STREAM_PERIODS*2;
+
+    OS_LOGD(TAG, "Closing stream(%p)", stream);
+    os_mutex_lock(mixer->lock);
+    // Drain like a hardware sink does on close, bounded in case downstream stalls
+    rb_done_write(stream->rb);
+    while (rb_bytes_filled(stream->rb) > 0 && !mixer->exit && wait-- > 0)
+        os_cond_timedwait(mixer->cond, mixer->lock, period_usec*2);
+    stream->opened = false;
+    stream->primed = false;
+    os_mutex_unlock(mixer->lock);
+}
+
+int sink_mixer_wrapper_period_hint(sink_handle_t handle, int *period_size, int *buffer_size)
+{
+    struct sink_mixer_stream *stream = (struct sink_mixer_stream *)handle;
+    struct sink_mixer *mixer = stream->mixer;
+    int frames = (int)((int64_t)mixer->period_frames*stream->in_samplerate/mixer->samplerate);
+    *period_size = frames*stream->in_channels*stream->in_bits/8;
+    *buffer_size = *period_size*MIXER_STREAM_PERIODS;
+    return 0;
+}
@@ -0,0 +1,67 @@
+// Copyright (c) 2019-2022 Qinglong<sysu.zqlong@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _LITEPLAYER_ADAPTER_MIXER_WRAPPER_H_
+#define _LITEPLAYER_ADAPTER_MIXER_WRAPPER_H_
+
+#include <stdbool.h>
+#include "liteplayer_adapter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Software mixer sharing one downstream sink between several players.
+// The downstream sink is opened once with s16le at samplerate/channels and kept open, each
+// player registers a stream and uses the sink_mixer_wrapper ops as its sink. Streams are
+// converted to the mixer format on write, scaled by their gain and mixed with saturation.
+//
+// Usage: priv_data of the player's sink wrapper is the stream:
+//     void *mixer = sink_mixer_wrapper_create(&alsa_ops, 48000, 2, 10);
+//     struct sink_wrapper music_ops = {
+//         .priv_data = sink_mixer_wrapper_stream_create(mixer, false),
+//         .name = sink_mixer_wrapper_name,
+//         .open = sink_mixer_wrapper_open,
+//         ...
+//     };
+void *sink_mixer_wrapper_create(struct sink_wrapper *downstream, int samplerate, int channels, int period_ms);
+
+void sink_mixer_wrapper_destroy(void *mixer);
+
+// While any stream created with ducks_others is open, the other streams are attenuated
+// to duck_gain, ramping down in attack_ms and back up in release_ms after it is closed
+void sink_mixer_wrapper_set_ducking(void *mixer, float duck_gain, int attack_ms, int release_ms);
+
+void *sink_mixer_wrapper_stream_create(void *mixer, bool ducks_others);
+
+void sink_mixer_wrapper_stream_destroy(void *stream);
+
+// gain in [0.0, 1.0], ramped like ducking
+void sink_mixer_wrapper_stream_set_gain(void *stream, float gain);
+
+const char *sink_mixer_wrapper_name();
+
+sink_handle_t sink_mixer_wrapper_open(int samplerate, int channels, int bits, void *priv_data);
+
+int sink_mixer_wrapper_write(sink_handle_t handle, char *buffer, int size);
+
+void sink_mixer_wrapper_close(sink_handle_t handle);
+
+int sink_mixer_wrapper_period_hint(sink_handle_t handle, int *period_size, int *buffer_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _LITEPLAYER_ADAPTER_MIXER_WRAPPER_H_
@@ -0,0 +1,609 @@
+// Copyright (c) 2019-2022 Qinglong<sysu.zqlong@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/types.h>
+
+#include "osal/os_thread.h"
+#include "osal/os_time.h"
+#include "cutils/memory_helper.h"
+#include "cutils/log_helper.h"
+#include "cutils/list.h"
+#include "source_cache_wrapper.h"
+
+#define TAG "[liteplayer]cache"
+
+#define CACHE_INDEX_MAGIC    0x3143504c // "LPC1"
+#define CACHE_PATH_MAX       256
+#define CACHE_RANGES_GROW    8
+
+// Cached bytes [start, end) of the url
+struct cache_range {
+    long long start;
+    long long end;
+};
+
+// On-disk header of <key>.idx, followed by url and ranges
+struct cache_index_header {
+    unsigned int magic;
+    int url_len;
+    int range_count;
+    long long content_len;
+    unsigned long long last_used;
+};
+
+struct cache_entry {
+    struct listnode listnode;
+    unsigned long long key;
+    char *url;
+    long long content_len;      // 0 if unknown yet
+    struct cache_range *ranges; // sorted, never adjacent nor overlapping
+    int range_count;
+    int range_size;
+    long long cached_bytes;
+    unsigned long long last_used; // seconds
+    int refs;                   // opened handles, entry can't be evicted if > 0
+    bool dirty;                 // ranges changed since index saved
+};
+
+struct source_cache_priv {
+    struct source_wrapper upstream;
+    char *dir;
+    long long max_size;
+    long long total_bytes;
+    struct listnode entries;
+    os_mutex lock;
+};
+
+struct source_cache_handle {
+    struct source_cache_priv *cache;
+    struct cache_entry *entry;  // NULL to pass through upstream, see source_cache_wrapper_open
+    FILE *data;
+    source_handle_t upstream;
+    long long upstream_pos;
+    long long content_pos;
+};
+
+static unsigned long long cache_key(const char *url)
+{
+    // FNV-1a
+    unsigned long long hash = 0xcbf29ce484222325ULL;
+    while (*url != '\0') {
+        hash ^= (unsigned char)*url++;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static void cache_path(struct source_cache_priv *cache, unsigned long long key, const char *ext,
+                       char *path, int size)
+{
+    snprintf(path, size, "%s/%016llx.%s", cache->dir, key, ext);
+}
+
+static unsigned long long cache_now()
+{
+    return os_realtime_usec() / 1000000;
+}
+
+// Return end of the range containing pos, or pos if not cached
+static long long cache_range_lookup(struct cache_entry *entry, long long pos)
+{
+    int low = 0, high = entry->range_count;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (entry->ranges[mid].end <= pos)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if (low < entry->range_count && entry->ranges[low].start <= pos)
+        return entry->ranges[low].end;
+    return pos;
+}
+
+// Merge [start, end) into the ranges, return bytes newly cached or -1 if out of memory
+static long long cache_range_add(struct cache_entry *entry, long long start, long long end)
+{
+    struct cache_range *ranges = entry->ranges;
+    int first, last, i;
+    long long covered = 0;
+
+    // Ranges [first, last) touch the new one
+    for (first = 0; first < entry->range_count && ranges[first].end < start; first++);
+    for (last = first; last < entry->range_count && ranges[last].start <= end; last++)
+        covered += ranges[last].end - ranges[last].start;
+
+    if (first == last) {
+        if (entry->range_count == entry->range_size) {
+            int size = entry->range_size + CACHE_RANGES_GROW;
+            ranges = OS_REALLOC(entry->ranges, size * sizeof(struct cache_range));
+            if (ranges == NULL)
+                return -1;
+            entry->ranges = ranges;
+            entry->range_size = size;
+        }
+        memmove(&ranges[first + 1], &ranges[first], (entry->range_count - first) * sizeof(struct cache_range));
+        ranges[first].start = start;
+        ranges[first].end = end;
+        entry->range_count++;
+    } else {
+        if (ranges[first].start < start)
+            start = ranges[first].start;
+        if (ranges[last - 1].end > end)
+            end = ranges[last - 1].end;
+        ranges[first].start = start;
+        ranges[first].end = end;
+        for (i = last; i < entry->range_count; i++)
+            ranges[first + 1 + i - last] = ranges[i];
+        entry->range_count -= last - first - 1;
+    }
+
+    entry->cached_bytes += (end - start) - covered;
+    return (end - start) - covered;
+}
+
+static void cache_entry_free(struct cache_entry *entry)
+{
+    OS_FREE(entry->url);
+    OS_FREE(entry->ranges);
+    OS_FREE(entry);
+}
+
+static int cache_entry_save(struct source_cache_priv *cache, struct cache_entry *entry)
+{
+    char path[CACHE_PATH_MAX], temp[CACHE_PATH_MAX];
+    struct cache_index_header header = {
+        .magic = CACHE_INDEX_MAGIC,
+        .url_len = strlen(entry->url),
+        .range_count = entry->range_count,
+        .content_len = entry->content_len,
+        .last_used = entry->last_used,
+    };
+    int ret = -1;
+
+    cache_path(cache, entry->key, "idx", path, sizeof(path));
+    if (snprintf(temp, sizeof(temp), "%s.tmp", path) >= (int)sizeof(temp))
+        return -1;
+    FILE *file = fopen(temp, "wb");
+    if (file == NULL)
+        return -1;
+    if (fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(entry->url, header.url_len, 1, file) == 1 &&
+        (entry->range_count == 0 ||
+         fwrite(entry->ranges, sizeof(struct cache_range), entry->range_count, file) == (size_t)entry->range_count))
+        ret = 0;
+    if (fclose(file) != 0)
+        ret = -1;
+    // Replace the index at once, a torn index would map garbage
+    if (ret == 0 && rename(temp, path) == 0) {
+        entry->dirty = false;
+        return 0;
+    }
+    unlink(temp);
+    return -1;
+}
+
+static struct cache_entry *cache_entry_load(const char *path)
+{
+    struct cache_index_header header;
+    struct cache_entry *entry = NULL;
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return NULL;
+
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != CACHE_INDEX_MAGIC ||
+        header.url_len <= 0 || header.url_len >= CACHE_PATH_MAX * 8 || header.range_count < 0)
+        goto load_failed;
+
+    entry = OS_CALLOC(1, sizeof(struct cache_entry));
+    if (entry == NULL)
+        goto load_failed;
+    entry->url = OS_CALLOC(1, header.url_len + 1);
+    if (header.range_count > 0)
+        entry->ranges = OS_MALLOC(header.range_count * sizeof(struct cache_range));
+    if (entry->url == NULL || (header.range_count > 0 && entry->ranges == NULL))
+        goto load_failed;
+    if (fread(entry->url, header.url_len, 1, file) != 1 ||
+        fread(entry->ranges, sizeof(struct cache_range), header.range_count, file) != (size_t)header.range_count)
+        goto load_failed;
+
+    entry->key = cache_key(entry->url);
+    entry->content_len = header.content_len;
+    entry->range_count = header.range_count;
+    entry->range_size = header.range_count;
+    entry->last_used = header.last_used;
+    for (int i = 0; i < entry->range_count; i++)
+        entry->cached_bytes += entry->ranges[i].end - entry->ranges[i].start;
+    fclose(file);
+    return entry;
+
+load_failed:
+    OS_LOGW(TAG, "Drop invalid cache index: %s", path);
+    fclose(file);
+    if (entry != NULL)
+        cache_entry_free(entry);
+    return NULL;
+}
+
+// Must be called with cache locked, entry must have no handle
+static void cache_entry_remove(struct source_cache_priv *cache, struct cache_entry *entry)
+{
+    char path[CACHE_PATH_MAX];
+    cache_path(cache, entry->key, "idx", path, sizeof(path));
+    unlink(path);
+    cache_path(cache, entry->key, "dat", path, sizeof(path));
+    unlink(path);
+    cache->total_bytes -= entry->cached_bytes;
+    list_remove(&entry->listnode);
+    cache_entry_free(entry);
+}
+
+// Must be called with cache locked, evict least recently used urls until size bytes fit in
+static bool cache_evict(struct source_cache_priv *cache, long long size)
+{
+    while (cache->total_bytes + size > cache->max_size) {
+        struct cache_entry *victim = NULL;
+        struct listnode *item;
+        list_for_each(item, &cache->entries) {
+            struct cache_entry *entry = listnode_to_item(item, struct cache_entry, listnode);
+            if (entry->refs == 0 && (victim == NULL || entry->last_used < victim->last_used))
+                victim = entry;
+        }
+        if (victim == NULL)
+            return false;
+        OS_LOGD(TAG, "Evict cached url: %s, size=%lld", victim->url, victim->cached_bytes);
+        cache_entry_remove(cache, victim);
+    }
+    return true;
+}
+
+static void cache_store(struct source_cache_handle *handle, const char *buffer, int size)
+{
+    struct source_cache_priv *cache = handle->cache;
+    struct cache_entry *entry = handle->entry;
+    bool stored = false;
+
+    os_mutex_lock(cache->lock);
+    stored = cache_evict(cache, size);
+    os_mutex_unlock(cache->lock);
+    if (!stored)
+        return;
+
+    // Publish the range only once data hits the file, other handles may read it right away
+    if (fseeko(handle->data, handle->content_pos, SEEK_SET) != 0 ||
+        fwrite(buffer, 1, size, handle->data) != (size_t)size ||
+        fflush(handle->data) != 0) {
+        OS_LOGE(TAG, "Failed to write cache file");
+        return;
+    }
+
+    os_mutex_lock(cache->lock);
+    long long added = cache_range_add(entry, handle->content_pos, handle->content_pos + size);
+    if (added > 0) {
+        cache->total_bytes += added;
+        entry->dirty = true;
+    }
+    os_mutex_unlock(cache->lock);
+}
+
+// Position upstream at content_pos, reuse the connection if it's there already
+static int cache_upstream_seek(struct source_cache_handle *handle, const char *url)
+{
+    struct source_wrapper *upstream = &handle->cache->upstream;
+
+    if (handle->upstream != NULL && handle->upstream_pos == handle->content_pos)
+        return 0;
+    if (handle->upstream != NULL && upstream->seek != NULL &&
+        upstream->seek(handle->upstream, (long)handle->content_pos) == 0) {
+        handle->upstream_pos = handle->content_pos;
+        return 0;
+    }
+    if (handle->upstream != NULL) {
+        upstream->close(handle->upstream);
+        handle->upstream = NULL;
+    }
+    handle->upstream = upstream->open(url, handle->content_pos, upstream->priv_data);
+    if (handle->upstream == NULL)
+        return -1;
+    handle->upstream_pos = handle->content_pos;
+    return 0;
+}
+
+void *source_cache_wrapper_create(struct source_wrapper *upstream, const char *cache_dir, long long cache_size)
+{
+    if (upstream == NULL || cache_dir == NULL || cache_size <= 0)
+        return NULL;
+
+    struct source_cache_priv *cache = OS_CALLOC(1, sizeof(struct source_cache_priv));
+    if (cache == NULL)
+        return NULL;
+
+    memcpy(&cache->upstream, upstream, sizeof(struct source_wrapper));
+    cache->max_size = cache_size;
+    cache->dir = OS_STRDUP(cache_dir);
+    cache->lock = os_mutex_create();
+    list_init(&cache->entries);
+    if (cache->dir == NULL || cache->lock == NULL) {
+        source_cache_wrapper_destroy(cache);
+        return NULL;
+    }
+
+    // Pick up what previous runs left
+    DIR *dir = opendir(cache_dir);
+    if (dir == NULL) {
+        OS_LOGE(TAG, "Failed to open cache dir: %s", cache_dir);
+        source_cache_wrapper_destroy(cache);
+        return NULL;
+    }
+    struct dirent *dirent;
+    char path[CACHE_PATH_MAX];
+    while ((dirent = readdir(dir)) != NULL) {
+        const char *ext = strrchr(dirent->d_name, '.');
+        if (ext == NULL || strcmp(ext, ".idx") != 0)
+            continue;
+        if (snprintf(path, sizeof(path), "%s/%s", cache_dir, dirent->d_name) >= (int)sizeof(path))
+            continue;
+        struct cache_entry *entry = cache_entry_load(path);
+        if (entry == NULL) {
+            unlink(path);
+            continue;
+        }
+        list_add_tail(&cache->entries, &entry->listnode);
+        cache->total_bytes += entry->cached_bytes;
+    }
+    closedir(dir);
+
+    cache_evict(cache, 0);
+    OS_LOGD(TAG, "Cache dir: %s, size=%lld/%lld", cache_dir, cache->total_bytes, cache->max_size);
+    return cache;
+}
+
+void source_cache_wrapper_destroy(void *priv_data)
+{
+    struct source_cache_priv *cache = (struct source_cache_priv *)priv_data;
+    struct listnode *item, *tmp;
+
+    if (cache == NULL)
+        return;
+
+    list_for_each_safe(item, tmp, &cache->entries) {
+        struct cache_entry *entry = listnode_to_item(item, struct cache_entry, listnode);
+        if (entry->dirty)
+            cache_entry_save(cache, entry);
+        list_remove(item);
+        cache_entry_free(entry);
+    }
+    if (cache->lock != NULL)
+        os_mutex_destroy(cache->lock);
+    OS_FREE(cache->dir);
+    OS_FREE(cache);
+}
+
+// Must be called with cache locked, return NULL if url collides with another one in use
+static struct cache_entry *cache_entry_get(struct source_cache_priv *cache, const char *url)
+{
+    unsigned long long key = cache_key(url);
+    struct listnode *item;
+
+    list_for_each(item, &cache->entries) {
+        struct cache_entry *entry = listnode_to_item(item, struct cache_entry, listnode);
+        if (entry->key != key)
+            continue;
+        if (strcmp(entry->url, url) == 0)
+            return entry;
+        if (entry->refs > 0)
+            return NULL;
+        cache_entry_remove(cache, entry);
+        break;
+    }
+
+    struct cache_entry *entry = OS_CALLOC(1, sizeof(struct cache_entry));
+    if (entry == NULL)
+        return NULL;
+    entry->url = OS_STRDUP(url);
+    if (entry->url == NULL) {
+        OS_FREE(entry);
+        return NULL;
+    }
+    entry->key = key;
+    list_add_tail(&cache->entries, &entry->listnode);
+    return entry;
+}
+
+source_handle_t source_cache_wrapper_open(const char *url, long long content_pos, void *priv_data)
+{
+    struct source_cache_priv *cache = (struct source_cache_priv *)priv_data;
+    struct source_cache_handle *handle = OS_CALLOC(1, sizeof(struct source_cache_handle));
+    char path[CACHE_PATH_MAX];
+    long long cached_end = 0;
+
+    if (handle == NULL)
+        return NULL;
+    handle->cache = cache;
+    handle->content_pos = content_pos;
+
+    os_mutex_lock(cache->lock);
+    handle->entry = cache_entry_get(cache, url);
+    if (handle->entry != NULL) {
+        handle->entry->refs++;
+        handle->entry->last_used = cache_now();
+        cached_end = cache_range_lookup(handle->entry, content_pos);
+    }
+    os_mutex_unlock(cache->lock);
+
+    if (handle->entry != NULL) {
+        cache_path(cache, handle->entry->key, "dat", path, sizeof(path));
+        handle->data = fopen(path, "r+b");
+        if (handle->data == NULL)
+            handle->data = fopen(path, "w+b");
+        if (handle->data == NULL)
+            OS_LOGW(TAG, "Failed to open cache file: %s", path);
+    }
+
+    // Data file lost or url not cacheable, plain upstream
+    if (handle->data == NULL && handle->entry != NULL) {
+        os_mutex_lock(cache->lock);
+        handle->entry->refs--;
+        os_mutex_unlock(cache->lock);
+        handle->entry = NULL;
+    }
+
+    OS_LOGD(TAG, "Opening url:%s, content_pos:%d, cached:%d", url, (int)content_pos,
+            (int)(cached_end - content_pos));
+
+    // Connect upstream now unless it can be served from cache, content_len is known from then on
+    if (handle->entry == NULL || handle->entry->content_len <= 0 || cached_end <= content_pos) {
+        if (cache_upstream_seek(handle, url) != 0) {
+            OS_LOGE(TAG, "Failed to open upstream url:%s", url);
+            source_cache_wrapper_close(handle);
+            return NULL;
+        }
+        long long content_len = cache->upstream.content_len(handle->upstream);
+        if (handle->entry != NULL && content_len > 0) {
+            os_mutex_lock(cache->lock);
+            handle->entry->content_len = content_len;
+            os_mutex_unlock(cache->lock);
+        }
+    }
+    return handle;
+}
+
+int source_cache_wrapper_read(source_handle_t handle, char *buffer, int size)
+{
+    struct source_cache_handle *priv = (struct source_cache_handle *)handle;
+    struct source_cache_priv *cache = priv->cache;
+    struct cache_entry *entry = priv->entry;
+    long long cached_end, content_len;
+    int bytes_read;
+
+    if (entry == NULL) {
+        bytes_read = cache->upstream.read(priv->upstream, buffer, size);
+        if (bytes_read > 0)
+            priv->content_pos += bytes_read;
+        return bytes_read;
+    }
+
+    os_mutex_lock(cache->lock);
+    content_len = entry->content_len;
+    cached_end = cache_range_lookup(entry, priv->content_pos);
+    os_mutex_unlock(cache->lock);
+
+    if (content_len > 0 && priv->content_pos >= content_len) {
+        OS_LOGD(TAG, "cache read done: %d/%d", (int)priv->content_pos, (int)content_len);
+        return 0;
+    }
+
+    if (cached_end > priv->content_pos) {
+        if (size > cached_end - priv->content_pos)
+            size = (int)(cached_end - priv->content_pos);
+        if (fseeko(priv->data, priv->content_pos, SEEK_SET) == 0) {
+            bytes_read = fread(buffer, 1, size, priv->data);
+            if (bytes_read > 0) {
+                priv->content_pos += bytes_read;
+                return bytes_read;
+            }
+        }
+        OS_LOGW(TAG, "Failed to read cache file, fallback to upstream");
+    }
+
+    if (cache_upstream_seek(priv, entry->url) != 0)
+        return -1;
+    bytes_read = cache->upstream.read(priv->upstream, buffer, size);
+    if (bytes_read < 0)
+        return bytes_read;
+    if (content_len <= 0) {
+        // Length is known by upstream after the first response, or at eof at last
+        content_len = cache->upstream.content_len(priv->upstream);
+        if (content_len <= 0 && bytes_read == 0)
+            content_len = priv->content_pos;
+        if (content_len > 0) {
+            os_mutex_lock(cache->lock);
+            entry->content_len = content_len;
+            os_mutex_unlock(cache->lock);
+        }
+    }
+    if (bytes_read == 0)
+        return 0;
+
+    if (cached_end <= priv->content_pos)
+        cache_store(priv, buffer, bytes_read);
+    priv->upstream_pos += bytes_read;
+    priv->content_pos += bytes_read;
+    return bytes_read;
+}
+
+long long source_cache_wrapper_content_pos(source_handle_t handle)
+{
+    struct source_cache_handle *priv = (struct source_cache_handle *)handle;
+    return priv->content_pos;
+}
+
+long long source_cache_wrapper_content_len(source_handle_t handle)
+{
+    struct source_cache_handle *priv = (struct source_cache_handle *)handle;
+    long long content_len = 0;
+
+    if (priv->entry != NULL) {
+        os_mutex_lock(priv->cache->lock);
+        content_len = priv->entry->content_len;
+        os_mutex_unlock(priv->cache->lock);
+    }
+    if (content_len <= 0 && priv->upstream != NULL)
+        content_len = priv->cache->upstream.content_len(priv->upstream);
+    return content_len;
+}
+
+int source_cache_wrapper_seek(source_handle_t handle, long offset)
+{
+    struct source_cache_handle *priv = (struct source_cache_handle *)handle;
+
+    OS_LOGD(TAG, "Seeking cache, content_pos=%ld", offset);
+    if (priv->entry == NULL) {
+        int ret = priv->cache->upstream.seek(priv->upstream, offset);
+        if (ret == 0)
+            priv->content_pos = offset;
+        return ret;
+    }
+    // Upstream follows on the next read if the position isn't cached
+    priv->content_pos = offset;
+    return 0;
+}
+
+void source_cache_wrapper_close(source_handle_t handle)
+{
+    struct source_cache_handle *priv = (struct source_cache_handle *)handle;
+    struct source_cache_priv *cache = priv->cache;
+
+    OS_LOGD(TAG, "Closing cache");
+    if (priv->upstream != NULL)
+        cache->upstream.close(priv->upstream);
+    if (priv->data != NULL)
+        fclose(priv->data);
+    if (priv->entry != NULL) {
+        os_mutex_lock(cache->lock);
+        priv->entry->refs--;
+        priv->entry->last_used = cache_now();
+        priv->entry->dirty = true;
+        if (priv->entry->content_len > 0 || priv->entry->range_count > 0)
+            cache_entry_save(cache, priv->entry);
+        os_mutex_unlock(cache->lock);
+    }
+    OS_FREE(priv);
+}
@@ -0,0 +1,57 @@
+// Copyright (c) 2019-2022 Qinglong<sysu.zqlong@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _LITEPLAYER_ADAPTER_CACHE_WRAPPER_H_
+#define _LITEPLAYER_ADAPTER_CACHE_WRAPPER_H_
+
+#include "liteplayer_adapter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Progressive download cache in front of another source wrapper, typically http.
+// Fetched bytes are written to a sparse file per url under cache_dir along with the map of
+// cached ranges, reads and seeks are served from it and only the gaps are requested from
+// upstream. Least recently used urls are evicted to keep the cache under cache_size bytes.
+// Content is assumed to never change for a given url.
+//
+// Usage: priv_data of the registered wrapper is the cache, url_protocol is upstream's:
+//     struct source_wrapper cache_ops = {
+//         .priv_data = source_cache_wrapper_create(&http_ops, "/data/cache", 64*1024*1024),
+//         .url_protocol = httpclient_wrapper_url_protocol,
+//         .open = source_cache_wrapper_open,
+//         ...
+//     };
+void *source_cache_wrapper_create(struct source_wrapper *upstream, const char *cache_dir, long long cache_size);
+
+void source_cache_wrapper_destroy(void *cache);
+
+source_handle_t source_cache_wrapper_open(const char *url, long long content_pos, void *priv_data);
+
+int source_cache_wrapper_read(source_handle_t handle, char *buffer, int size);
+
+long long source_cache_wrapper_content_pos(source_handle_t handle);
+
+long long source_cache_wrapper_content_len(source_handle_t handle);
+
+int source_cache_wrapper_seek(source_handle_t handle, long offset);
+
+void source_cache_wrapper_close(source_handle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _LITEPLAYER_ADAPTER_CACHE_WRAPPER_H_
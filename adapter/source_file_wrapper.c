@@ -72,6 +72,18 @@ int file_wrapper_read(source_handle_t handle, char *buffer, int size)
     return bytes_read;
 }
 
+int file_wrapper_read_at(source_handle_t handle, long long offset, char *buffer, int size)
+{
+    struct file_priv *priv = (struct file_priv *)handle;
+    if (offset < 0 || fseek(priv->file, (long)offset, SEEK_SET) != 0)
+        return -1;
+    size_t bytes_read = fread(buffer, 1, size, priv->file);
+    // Restore position for the sequential reader
+    if (fseek(priv->file, priv->content_pos, SEEK_SET) != 0)
+        return -1;
+    return bytes_read;
+}
+
 long long file_wrapper_content_pos(source_handle_t handle)
 {
     struct file_priv *priv = (struct file_priv *)handle;
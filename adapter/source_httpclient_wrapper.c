@@ -14,8 +14,10 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 
 #include "osal/os_thread.h"
+#include "osal/os_time.h"
 #include "cutils/memory_helper.h"
 #include "cutils/log_helper.h"
 #include "httpclient/httpclient.h"
@@ -27,35 +29,276 @@
 #define HTTPCLIENT_RETRY_COUNT        5
 #define HTTPCLIENT_RETRY_INTERVAL     3000
 
+// Idle keep-alive connections and tls sessions, keyed by origin ("scheme://host[:port]"),
+// shared by all handles so that seeks, reopens and hls segments skip tcp/tls setup
+#define HTTPCLIENT_POOL_SIZE          4
+#define HTTPCLIENT_POOL_IDLE_TIMEOUT  15000 // msec
+#define HTTPCLIENT_ORIGIN_MAX_LEN     128
+// Seeking with less than this left in the response reads it out to keep the connection
+#define HTTPCLIENT_DRAIN_MAX          (16*1024)
+
+struct httpclient_pool_entry {
+    char                 origin[HTTPCLIENT_ORIGIN_MAX_LEN];
+    httpclient_t         client;    // idle connection if client.socket >= 0
+    void                *session;   // tls session to resume, NULL for http
+    unsigned long long   last_used; // msec
+};
+
+static struct {
+    os_mutex                     lock;
+    struct httpclient_pool_entry entries[HTTPCLIENT_POOL_SIZE];
+} g_httpclient_pool;
+
 struct httpclient_priv {
     const char          *url;
+    char                 origin[HTTPCLIENT_ORIGIN_MAX_LEN];
     char                 header_buf[HTTPCLIENT_HEADER_BUFFER_SIZE];
     httpclient_t         client;
     httpclient_data_t    client_data;
     long long            content_pos;
     long long            content_len;
+    long long            range_end; // last byte of a bounded range request, 0 if open-ended
     int                  retrieve_len;
     bool                 first_request;
     bool                 first_response;
+    bool                 keep_alive;
+    bool                 reused;
     int                  retrycount;
 };
 
-static int httpclient_wrapper_connect(source_handle_t handle)
+static unsigned long long httpclient_pool_now()
 {
-    struct httpclient_priv *priv = (struct httpclient_priv *)handle;
-    HTTPCLIENT_RESULT ret = HTTPCLIENT_OK;
+    return os_monotonic_usec() / 1000;
+}
 
-    memset(&priv->client, 0, sizeof(httpclient_t));
+static os_mutex httpclient_pool_lock()
+{
+    if (g_httpclient_pool.lock == NULL) {
+        os_mutex lock = os_mutex_create();
+        if (lock != NULL && !__sync_bool_compare_and_swap(&g_httpclient_pool.lock, NULL, lock))
+            os_mutex_destroy(lock);
+    }
+    return g_httpclient_pool.lock;
+}
+
+static void httpclient_pool_close_entry(struct httpclient_pool_entry *entry, bool keep_session)
+{
+    if (entry->client.socket >= 0)
+        httpclient_close(&entry->client);
+    entry->client.socket = -1;
+    if (!keep_session) {
+        httpclient_free_session(entry->session);
+        entry->session = NULL;
+    }
+    if (entry->session == NULL)
+        entry->origin[0] = '\0';
+}
+
+// Must be called with pool locked
+static struct httpclient_pool_entry *httpclient_pool_find(const char *origin, bool create)
+{
+    struct httpclient_pool_entry *entry, *found = NULL, *empty = NULL, *oldest = NULL;
+    unsigned long long now = httpclient_pool_now();
+    int i;
+
+    for (i = 0; i < HTTPCLIENT_POOL_SIZE; i++) {
+        entry = &g_httpclient_pool.entries[i];
+        if (entry->origin[0] != '\0' && entry->client.socket >= 0 &&
+            now - entry->last_used > HTTPCLIENT_POOL_IDLE_TIMEOUT)
+            httpclient_pool_close_entry(entry, true);
+
+        if (entry->origin[0] == '\0') {
+            if (empty == NULL)
+                empty = entry;
+        } else if (strcmp(entry->origin, origin) == 0) {
+            found = entry;
+        } else if (oldest == NULL || entry->last_used < oldest->last_used) {
+            oldest = entry;
+        }
+    }
+
+    if (found != NULL || !create)
+        return found;
+    if (empty == NULL) {
+        empty = oldest;
+        httpclient_pool_close_entry(empty, false);
+    }
+    memset(empty, 0, sizeof(struct httpclient_pool_entry));
+    snprintf(empty->origin, sizeof(empty->origin), "%s", origin);
+    empty->client.socket = -1;
+    empty->last_used = now;
+    return empty;
+}
+
+static bool httpclient_pool_take(const char *origin, httpclient_t *client)
+{
+    struct httpclient_pool_entry *entry;
+    os_mutex lock = httpclient_pool_lock();
+    bool taken = false;
+
+    if (lock == NULL || origin[0] == '\0')
+        return false;
+
+    os_mutex_lock(lock);
+    entry = httpclient_pool_find(origin, false);
+    if (entry != NULL && entry->client.socket >= 0) {
+        if (httpclient_is_alive(&entry->client)) {
+            memcpy(client, &entry->client, sizeof(httpclient_t));
+            taken = true;
+        } else {
+            httpclient_close(&entry->client);
+        }
+        entry->client.socket = -1;
+        if (entry->session == NULL)
+            entry->origin[0] = '\0';
+    }
+    os_mutex_unlock(lock);
+    return taken;
+}
+
+static bool httpclient_pool_put(const char *origin, httpclient_t *client)
+{
+    struct httpclient_pool_entry *entry;
+    os_mutex lock = httpclient_pool_lock();
+    bool put = false;
+
+    if (lock == NULL || origin[0] == '\0')
+        return false;
+
+    os_mutex_lock(lock);
+    entry = httpclient_pool_find(origin, true);
+    if (entry->client.socket < 0) {
+        memcpy(&entry->client, client, sizeof(httpclient_t));
+        entry->client.header = NULL;
+        entry->client.session = NULL;
+        entry->last_used = httpclient_pool_now();
+        put = true;
+    }
+    os_mutex_unlock(lock);
+    return put;
+}
+
+static void *httpclient_pool_take_session(const char *origin)
+{
+    struct httpclient_pool_entry *entry;
+    os_mutex lock = httpclient_pool_lock();
+    void *session = NULL;
+
+    if (lock == NULL || origin[0] == '\0')
+        return NULL;
+
+    os_mutex_lock(lock);
+    entry = httpclient_pool_find(origin, false);
+    if (entry != NULL) {
+        session = entry->session;
+        entry->session = NULL;
+        if (entry->client.socket < 0)
+            entry->origin[0] = '\0';
+    }
+    os_mutex_unlock(lock);
+    return session;
+}
+
+static void httpclient_pool_put_session(const char *origin, void *session)
+{
+    struct httpclient_pool_entry *entry;
+    os_mutex lock = httpclient_pool_lock();
+
+    if (session == NULL)
+        return;
+    if (lock == NULL || origin[0] == '\0') {
+        httpclient_free_session(session);
+        return;
+    }
+
+    os_mutex_lock(lock);
+    entry = httpclient_pool_find(origin, true);
+    httpclient_free_session(entry->session);
+    entry->session = session;
+    entry->last_used = httpclient_pool_now();
+    os_mutex_unlock(lock);
+}
+
+void httpclient_wrapper_pool_clear()
+{
+    os_mutex lock = httpclient_pool_lock();
+    int i;
+
+    if (lock == NULL)
+        return;
+
+    os_mutex_lock(lock);
+    for (i = 0; i < HTTPCLIENT_POOL_SIZE; i++) {
+        if (g_httpclient_pool.entries[i].origin[0] != '\0')
+            httpclient_pool_close_entry(&g_httpclient_pool.entries[i], false);
+    }
+    os_mutex_unlock(lock);
+}
+
+static void httpclient_wrapper_parse_origin(const char *url, char *origin, size_t size)
+{
+    const char *host = strstr(url, "://");
+    size_t len;
+
+    origin[0] = '\0';
+    if (host == NULL)
+        return;
+    host += strlen("://");
+    len = (host - url) + strcspn(host, "/?#");
+    if (len < size) {
+        memcpy(origin, url, len);
+        origin[len] = '\0';
+    }
+}
+
+static void httpclient_wrapper_reset_request(struct httpclient_priv *priv)
+{
     memset(&priv->client_data, 0, sizeof(httpclient_data_t));
     memset(&priv->header_buf[0], 0, sizeof(priv->header_buf));
-    priv->client.socket = -1;
+    priv->client.header = NULL;
     priv->retrieve_len = -1;
     priv->content_len = 0;
     priv->first_request = false;
     priv->first_response = false;
+    priv->keep_alive = true;
+}
+
+// Connection can carry a new request: nothing sent yet, or the whole response has been read
+static bool httpclient_wrapper_reusable(struct httpclient_priv *priv)
+{
+    httpclient_data_t *client_data = &priv->client_data;
+
+    if (priv->client.socket < 0 || priv->client.redirect_times > 0)
+        return false;
+    if (!priv->first_request)
+        return true;
+    return priv->first_response && priv->keep_alive &&
+           !client_data->is_chunked &&
+           client_data->response_content_len >= 0 && client_data->retrieve_len == 0;
+}
+
+static int httpclient_wrapper_connect(source_handle_t handle, bool allow_reuse)
+{
+    struct httpclient_priv *priv = (struct httpclient_priv *)handle;
+    HTTPCLIENT_RESULT ret = HTTPCLIENT_OK;
+
+    httpclient_wrapper_reset_request(priv);
+    priv->reused = false;
+
+    if (allow_reuse && httpclient_pool_take(priv->origin, &priv->client)) {
+        OS_LOGD(TAG, "Reuse keep-alive connection to %s", priv->origin);
+        priv->reused = true;
+        return HTTPCLIENT_OK;
+    }
+
+    memset(&priv->client, 0, sizeof(httpclient_t));
+    priv->client.socket = -1;
 
 reconnect:
+    priv->client.session = httpclient_pool_take_session(priv->origin);
     ret = httpclient_connect(&priv->client, (char *)priv->url);
+    httpclient_free_session(priv->client.session);
+    priv->client.session = NULL;
     if (ret != HTTPCLIENT_OK) {
         OS_LOGE(TAG, "httpclient_connect failed, ret=%d, retry=%d", ret, priv->retrycount);
         if (priv->retrycount++ < HTTPCLIENT_RETRY_COUNT) {
@@ -63,6 +306,8 @@ reconnect:
             goto reconnect;
         }
         httpclient_close(&priv->client);
+    } else {
+        httpclient_pool_put_session(priv->origin, httpclient_get_session(&priv->client));
     }
 
     return ret;
@@ -89,6 +334,61 @@ static int httpclient_wrapper_parse_content_length(char *header_buf, long long *
     return ret;
 }
 
+static bool httpclient_wrapper_connection_close(char *header_buf)
+{
+    int val_pos = 0, val_len = 0;
+    int ret = httpclient_get_response_header_value(header_buf, "Connection", &val_pos, &val_len);
+    return ret == 0 && val_len == strlen("close") && strncasecmp(header_buf+val_pos, "close", val_len) == 0;
+}
+
+// Read out the rest of a small response, so the connection can be reused for the next request
+static void httpclient_wrapper_drain(struct httpclient_priv *priv)
+{
+    httpclient_t *client = &priv->client;
+    httpclient_data_t *client_data = &priv->client_data;
+    char buffer[512];
+    int resp_len;
+
+    if (client->socket < 0 || !priv->first_response || !priv->keep_alive ||
+        client_data->is_chunked || client_data->response_content_len < 0 ||
+        priv->content_len - priv->content_pos > HTTPCLIENT_DRAIN_MAX)
+        return;
+
+    client_data->response_buf     = buffer;
+    client_data->response_buf_len = sizeof(buffer);
+    while (client_data->retrieve_len > 0) {
+        if (httpclient_recv_response(client, client_data) < 0) {
+            priv->keep_alive = false;
+            return;
+        }
+        resp_len = priv->retrieve_len - client_data->retrieve_len;
+        priv->retrieve_len = client_data->retrieve_len;
+        if (resp_len <= 0) {
+            priv->keep_alive = false;
+            return;
+        }
+        priv->content_pos += resp_len;
+    }
+}
+
+// Server may ignore the range and send the whole content, or another range, with 200
+static bool httpclient_wrapper_range_matched(struct httpclient_priv *priv, long long offset)
+{
+    int val_pos = 0, val_len = 0;
+    char header_content[64] = {0};
+    long long range_start = -1;
+
+    if (httpclient_get_response_code(&priv->client) != 206)
+        return false;
+    if (httpclient_get_response_header_value(priv->header_buf, "Content-Range", &val_pos, &val_len) != 0 ||
+        val_len >= (int)sizeof(header_content))
+        return false;
+    memcpy(header_content, priv->header_buf+val_pos, val_len);
+    if (sscanf(header_content, "bytes %lld-", &range_start) != 1)
+        return false;
+    return range_start == offset;
+}
+
 const char *httpclient_wrapper_url_protocol()
 {
     return "http";
@@ -102,8 +402,9 @@ source_handle_t httpclient_wrapper_open(const char *url, long long content_pos,
 
     priv->url = OS_STRDUP(url);
     priv->content_pos = content_pos;
+    httpclient_wrapper_parse_origin(url, priv->origin, sizeof(priv->origin));
     OS_LOGD(TAG, "Connecting url:%s, content_pos:%d", url, (int)content_pos);
-    if (httpclient_wrapper_connect(priv) != HTTPCLIENT_OK) {
+    if (httpclient_wrapper_connect(priv, true) != HTTPCLIENT_OK) {
         OS_FREE(priv->url);
         OS_FREE(priv);
         return NULL;
@@ -127,7 +428,12 @@ contiune_read:
     client_data->response_buf_len = size;
 
     if (!priv->first_request) {
-        if (priv->content_pos > 0) {
+        if (priv->range_end > 0) {
+            char tmp_buf[64] = {0};
+            snprintf(tmp_buf, sizeof(tmp_buf), "Range: bytes=%lld-%lld\r\n", priv->content_pos, priv->range_end);
+            OS_LOGV(TAG, "Set http range: %s", tmp_buf);
+            httpclient_set_custom_header(client, tmp_buf);
+        } else if (priv->content_pos > 0) {
             char tmp_buf[64] = {0};
             snprintf(tmp_buf, sizeof(tmp_buf), "Range: bytes=%ld-\r\n", (long)priv->content_pos);
             OS_LOGV(TAG, "Set http range: %s", tmp_buf);
@@ -135,7 +441,10 @@ contiune_read:
         }
 
         ret = httpclient_send_request(client, url, HTTPCLIENT_GET, client_data);
-        if (ret < 0) {
+        if (ret < 0 && priv->reused) {
+            OS_LOGD(TAG, "Keep-alive connection lost, reconnecting");
+            goto reconnect;
+        } else if (ret < 0) {
             OS_LOGE(TAG, "httpclient_send_request failed, ret=%d, retry=%d", ret, priv->retrycount);
             if (priv->retrycount++ >= HTTPCLIENT_RETRY_COUNT)
                 return -1;
@@ -152,7 +461,10 @@ contiune_read:
     }
 
     ret = httpclient_recv_response(client, client_data);
-    if (ret < 0) {
+    if (ret < 0 && priv->reused && !priv->first_response) {
+        OS_LOGD(TAG, "Keep-alive connection lost, reconnecting");
+        goto reconnect;
+    } else if (ret < 0) {
         OS_LOGE(TAG, "httpclient_recv_response failed, ret=%d, retry=%d", ret, priv->retrycount);
         if (priv->retrycount++ >= HTTPCLIENT_RETRY_COUNT)
             return -1;
@@ -164,6 +476,7 @@ contiune_read:
         if (ret != 0)
             priv->content_len = client_data->response_content_len;
         priv->content_len += priv->content_pos;
+        priv->keep_alive = !httpclient_wrapper_connection_close(client_data->header_buf);
         OS_LOGD(TAG, "content_pos=%d, response_content_len=%d, content_len=%d",
                  (int)priv->content_pos, (int)client_data->response_content_len, (int)priv->content_len);
         priv->first_response = true;
@@ -191,7 +504,7 @@ contiune_read:
 
 reconnect:
     httpclient_wrapper_disconnect(priv);
-    ret = httpclient_wrapper_connect(priv);
+    ret = httpclient_wrapper_connect(priv, false);
     if (ret != HTTPCLIENT_OK) {
         OS_LOGE(TAG, "httpclient reconnect failed, ret=%d", ret);
         return ret;
@@ -201,6 +514,52 @@ reconnect:
     return -1;
 }
 
+int httpclient_wrapper_read_at(source_handle_t handle, long long offset, char *buffer, int size)
+{
+    struct httpclient_priv *priv = (struct httpclient_priv *)handle;
+    struct httpclient_priv *ranged = NULL;
+    char tail[64];
+    int bytes_read = 0;
+    int ret = 0;
+
+    if (offset < 0)
+        return -1;
+    if (priv->content_len > 0 && offset + size > priv->content_len)
+        size = offset < priv->content_len ? (int)(priv->content_len - offset) : 0;
+    if (size <= 0)
+        return 0;
+
+    // Bounded range request on a pooled connection, the response being streamed by handle is untouched
+    ranged = httpclient_wrapper_open(priv->url, offset, NULL);
+    if (ranged == NULL)
+        return -1;
+    ranged->range_end = offset + size - 1;
+
+    while (bytes_read < size) {
+        int want = size - bytes_read;
+        // Response buffer keeps one byte for terminator, read the last bytes into tail
+        if (want < (int)sizeof(tail)) {
+            ret = httpclient_wrapper_read(ranged, tail, want + 1);
+            if (ret > 0)
+                memcpy(buffer + bytes_read, tail, ret);
+        } else {
+            ret = httpclient_wrapper_read(ranged, buffer + bytes_read, want);
+        }
+        if (bytes_read == 0 && ranged->first_response && !httpclient_wrapper_range_matched(ranged, offset)) {
+            OS_LOGE(TAG, "Range request at %lld is not honored, response code:%d",
+                    offset, httpclient_get_response_code(&ranged->client));
+            ret = -1;
+            break;
+        }
+        if (ret <= 0)
+            break;
+        bytes_read += ret;
+    }
+
+    httpclient_wrapper_close(ranged);
+    return bytes_read > 0 ? bytes_read : ret;
+}
+
 long long httpclient_wrapper_content_pos(source_handle_t handle)
 {
     struct httpclient_priv *priv = (struct httpclient_priv *)handle;
@@ -218,10 +577,19 @@ int httpclient_wrapper_seek(source_handle_t handle, long offset)
     struct httpclient_priv *priv = (struct httpclient_priv *)handle;
 
     OS_LOGD(TAG, "Seeking http client, content_pos=%ld", offset);
+    httpclient_wrapper_drain(priv);
+    if (httpclient_wrapper_reusable(priv)) {
+        // Send the range request on the same connection
+        httpclient_wrapper_reset_request(priv);
+        priv->reused = true;
+        priv->content_pos = offset;
+        return HTTPCLIENT_OK;
+    }
+
     priv->content_pos = offset;
     httpclient_wrapper_disconnect(priv);
     os_thread_sleep_msec(50);
-    return httpclient_wrapper_connect(priv);
+    return httpclient_wrapper_connect(priv, true);
 }
 
 void httpclient_wrapper_close(source_handle_t handle)
@@ -229,7 +597,8 @@ void httpclient_wrapper_close(source_handle_t handle)
     struct httpclient_priv *priv = (struct httpclient_priv *)handle;
 
     OS_LOGD(TAG, "Closing http client");
-    httpclient_close(&priv->client);
+    if (!httpclient_wrapper_reusable(priv) || !httpclient_pool_put(priv->origin, &priv->client))
+        httpclient_close(&priv->client);
     OS_FREE(priv->url);
     OS_FREE(priv);
     OS_LOGV(TAG, "Closed http client");
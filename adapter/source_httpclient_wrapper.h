@@ -27,6 +27,9 @@ source_handle_t httpclient_wrapper_open(const char *url, long long content_pos,
 
 int httpclient_wrapper_read(source_handle_t handle, char *buffer, int size);
 
+// Positional read with a bounded range request, on a pooled keep-alive connection if any
+int httpclient_wrapper_read_at(source_handle_t handle, long long offset, char *buffer, int size);
+
 long long httpclient_wrapper_content_pos(source_handle_t handle);
 
 long long httpclient_wrapper_content_len(source_handle_t handle);
@@ -35,6 +38,9 @@ int httpclient_wrapper_seek(source_handle_t handle, long offset);
 
 void httpclient_wrapper_close(source_handle_t handle);
 
+// Close the idle keep-alive connections and drop the tls sessions kept for reuse
+void httpclient_wrapper_pool_clear();
+
 #ifdef __cplusplus
 }
 #endif
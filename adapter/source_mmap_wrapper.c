@@ -0,0 +1,181 @@
+// Copyright (c) 2019-2022 Qinglong<sysu.zqlong@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cutils/memory_helper.h"
+#include "cutils/log_helper.h"
+#include "source_mmap_wrapper.h"
+
+#define TAG "[liteplayer]mmap"
+
+// Ask kernel to prefetch this much data ahead of content_pos
+#define MMAP_READAHEAD_SIZE (256*1024)
+
+struct mmap_priv {
+    int fd;
+    char *content_base;
+    long content_pos;
+    long content_len;
+    long advise_end;
+};
+
+static void mmap_wrapper_advise(struct mmap_priv *priv)
+{
+    long page_size = sysconf(_SC_PAGESIZE);
+    long start = (priv->content_pos/page_size)*page_size;
+    long end = priv->content_pos + MMAP_READAHEAD_SIZE;
+    if (end > priv->content_len)
+        end = priv->content_len;
+    if (end > start)
+        madvise(priv->content_base + start, end - start, MADV_WILLNEED);
+    priv->advise_end = end;
+}
+
+const char *mmap_wrapper_url_protocol()
+{
+    return "file";
+}
+
+source_handle_t mmap_wrapper_open(const char *url, long long content_pos, void *priv_data)
+{
+    struct mmap_priv *priv = OS_CALLOC(1, sizeof(struct mmap_priv));
+    struct stat st;
+
+    if (priv == NULL)
+        return NULL;
+
+    OS_LOGD(TAG, "Opening file:%s, content_pos:%d", url, (int)content_pos);
+
+    priv->fd = open(url, O_RDONLY);
+    if (priv->fd < 0) {
+        OS_LOGE(TAG, "Failed to open file:%s", url);
+        OS_FREE(priv);
+        return NULL;
+    }
+    if (fstat(priv->fd, &st) != 0) {
+        OS_LOGE(TAG, "Failed to stat file:%s", url);
+        goto open_fail;
+    }
+
+    priv->content_len = (long)st.st_size;
+    priv->content_pos = (long)content_pos;
+    if (priv->content_pos > priv->content_len)
+        priv->content_pos = priv->content_len;
+
+    if (priv->content_len > 0) {
+        void *addr = mmap(NULL, priv->content_len, PROT_READ, MAP_PRIVATE, priv->fd, 0);
+        if (addr == MAP_FAILED) {
+            OS_LOGE(TAG, "Failed to mmap file:%s", url);
+            goto open_fail;
+        }
+        priv->content_base = (char *)addr;
+        madvise(priv->content_base, priv->content_len, MADV_SEQUENTIAL);
+        mmap_wrapper_advise(priv);
+    }
+    return priv;
+
+open_fail:
+    close(priv->fd);
+    OS_FREE(priv);
+    return NULL;
+}
+
+int mmap_wrapper_read(source_handle_t handle, char *buffer, int size)
+{
+    struct mmap_priv *priv = (struct mmap_priv *)handle;
+    if (priv->content_pos + size > priv->content_len)
+        size = priv->content_len - priv->content_pos;
+    if (size <= 0) {
+        OS_LOGD(TAG, "file read done: %d/%d", (int)priv->content_pos, (int)priv->content_len);
+        return 0;
+    }
+    if (priv->content_pos + size > priv->advise_end - MMAP_READAHEAD_SIZE/2)
+        mmap_wrapper_advise(priv);
+    memcpy(buffer, priv->content_base + priv->content_pos, size);
+    priv->content_pos += size;
+    return size;
+}
+
+int mmap_wrapper_peek(source_handle_t handle, const char **buffer, int size)
+{
+    struct mmap_priv *priv = (struct mmap_priv *)handle;
+    if (priv->content_pos + size > priv->content_len)
+        size = priv->content_len - priv->content_pos;
+    if (size <= 0) {
+        OS_LOGD(TAG, "file read done: %d/%d", (int)priv->content_pos, (int)priv->content_len);
+        return 0;
+    }
+    if (priv->content_pos + size > priv->advise_end - MMAP_READAHEAD_SIZE/2)
+        mmap_wrapper_advise(priv);
+    *buffer = priv->content_base + priv->content_pos;
+    return size;
+}
+
+void mmap_wrapper_consume(source_handle_t handle, int size)
+{
+    struct mmap_priv *priv = (struct mmap_priv *)handle;
+    priv->content_pos += size;
+}
+
+int mmap_wrapper_read_at(source_handle_t handle, long long offset, char *buffer, int size)
+{
+    struct mmap_priv *priv = (struct mmap_priv *)handle;
+    if (offset < 0)
+        return -1;
+    if (offset + size > priv->content_len)
+        size = offset < priv->content_len ? (int)(priv->content_len - offset) : 0;
+    if (size > 0)
+        memcpy(buffer, priv->content_base + offset, size);
+    return size;
+}
+
+long long mmap_wrapper_content_pos(source_handle_t handle)
+{
+    struct mmap_priv *priv = (struct mmap_priv *)handle;
+    return priv->content_pos;
+}
+
+long long mmap_wrapper_content_len(source_handle_t handle)
+{
+    struct mmap_priv *priv = (struct mmap_priv *)handle;
+    return priv->content_len;
+}
+
+int mmap_wrapper_seek(source_handle_t handle, long offset)
+{
+    struct mmap_priv *priv = (struct mmap_priv *)handle;
+    OS_LOGD(TAG, "Seeking file:%d, offset:%ld", priv->fd, offset);
+    if (offset < 0 || offset > priv->content_len)
+        return -1;
+    priv->content_pos = offset;
+    if (priv->content_base != NULL)
+        mmap_wrapper_advise(priv);
+    return 0;
+}
+
+void mmap_wrapper_close(source_handle_t handle)
+{
+    struct mmap_priv *priv = (struct mmap_priv *)handle;
+    OS_LOGD(TAG, "Closing file:%d", priv->fd);
+    if (priv->content_base != NULL)
+        munmap(priv->content_base, priv->content_len);
+    close(priv->fd);
+    OS_FREE(priv);
+}
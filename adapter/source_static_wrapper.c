@@ -70,6 +70,37 @@ int static_wrapper_read(source_handle_t handle, char *buffer, int size)
     return size;
 }
 
+int static_wrapper_peek(source_handle_t handle, const char **buffer, int size)
+{
+    struct static_priv *priv = (struct static_priv *)handle;
+    if (priv->content_offset + size > priv->content_length)
+        size = priv->content_length - priv->content_offset;
+    if (size <= 0) {
+        OS_LOGD(TAG, "static read done: %d/%d", (int)priv->content_offset, (int)priv->content_length);
+        return 0;
+    }
+    *buffer = priv->content_base + priv->content_offset;
+    return size;
+}
+
+void static_wrapper_consume(source_handle_t handle, int size)
+{
+    struct static_priv *priv = (struct static_priv *)handle;
+    priv->content_offset += size;
+}
+
+int static_wrapper_read_at(source_handle_t handle, long long offset, char *buffer, int size)
+{
+    struct static_priv *priv = (struct static_priv *)handle;
+    if (offset < 0)
+        return -1;
+    if (offset + size > priv->content_length)
+        size = offset < priv->content_length ? (int)(priv->content_length - offset) : 0;
+    if (size > 0)
+        memcpy(buffer, priv->content_base + offset, size);
+    return size;
+}
+
 long long static_wrapper_content_pos(source_handle_t handle)
 {
     struct static_priv *priv = (struct static_priv *)handle;
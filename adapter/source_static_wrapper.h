@@ -27,6 +27,8 @@ source_handle_t static_wrapper_open(const char *url, long long content_pos, void
 
 int static_wrapper_read(source_handle_t handle, char *buffer, int size);
 
+int static_wrapper_read_at(source_handle_t handle, long long offset, char *buffer, int size);
+
 long long static_wrapper_content_pos(source_handle_t handle);
 
 long long static_wrapper_content_len(source_handle_t handle);
@@ -35,6 +37,11 @@ int static_wrapper_seek(source_handle_t handle, long offset);
 
 void static_wrapper_close(source_handle_t handle);
 
+// Data is borrowed from static memory, valid until consumed
+int static_wrapper_peek(source_handle_t handle, const char **buffer, int size);
+
+void static_wrapper_consume(source_handle_t handle, int size);
+
 #ifdef __cplusplus
 }
 #endif
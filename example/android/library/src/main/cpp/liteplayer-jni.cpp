@@ -264,6 +264,7 @@ static jlong Liteplayer_native_create(JNIEnv* env, jobject thiz, jobject weak_th
             .content_len = file_wrapper_content_len,
             .seek = file_wrapper_seek,
             .close = file_wrapper_close,
+            .read_at = file_wrapper_read_at,
     };
     liteplayer_register_source_wrapper(player->mPlayerhandle, &file_ops);
     // Register http adapter
@@ -278,6 +279,7 @@ static jlong Liteplayer_native_create(JNIEnv* env, jobject thiz, jobject weak_th
             .content_len = httpclient_wrapper_content_len,
             .seek = httpclient_wrapper_seek,
             .close = httpclient_wrapper_close,
+            .read_at = httpclient_wrapper_read_at,
     };
     liteplayer_register_source_wrapper(player->mPlayerhandle, &http_ops);
 
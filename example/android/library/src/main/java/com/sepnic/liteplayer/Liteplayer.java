@@ -36,6 +36,7 @@ public class Liteplayer {
     public static final int LITEPLAYER_NEARLYCOMPLETED = 0x06;
     public static final int LITEPLAYER_COMPLETED       = 0x07;
     public static final int LITEPLAYER_STOPPED         = 0x08;
+    public static final int LITEPLAYER_BUFFERING       = 0x09;
     public static final int LITEPLAYER_ERROR           = 0xFF;
 
     private final static String TAG = "LitelayerJava";
@@ -120,6 +121,10 @@ public class Liteplayer {
                         mOnStoppedListener.onStopped(mLiteplayer);
                     break;
 
+                case LITEPLAYER_BUFFERING:
+                    Log.i(TAG, "-->LITEPLAYER_BUFFERING: " + msg.arg1);
+                    break;
+
                 case LITEPLAYER_ERROR:
                     Log.e(TAG, "-->LITEPLAYER_ERROR: (" + msg.arg1 + "," + msg.arg2 + ")");
                     if (mOnErrorListener != null)
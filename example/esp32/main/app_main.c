@@ -79,6 +79,10 @@ static int liteplayer_demo_state_listener(enum liteplayer_state state, int errco
     case LITEPLAYER_STOPPED:
         OS_LOGD(TAG, "-->LITEPLAYER_STOPPED");
         break;
+    case LITEPLAYER_BUFFERING:
+        OS_LOGD(TAG, "-->LITEPLAYER_BUFFERING: %d", errcode);
+        state_sync = false;
+        break;
     case LITEPLAYER_ERROR:
         OS_LOGE(TAG, "-->LITEPLAYER_ERROR: %d", errcode);
         break;
@@ -125,6 +129,7 @@ static void *liteplayer_demo_thread(void *arg)
         .content_len = httpclient_wrapper_content_len,
         .seek = httpclient_wrapper_seek,
         .close = httpclient_wrapper_close,
+        .read_at = httpclient_wrapper_read_at,
     };
     liteplayer_register_source_wrapper(player, &http_ops);
 
@@ -21,7 +21,7 @@
 #include "cutils/log_helper.h"
 #include "liteplayer_main.h"
 #include "source_httpclient_wrapper.h"
-#include "source_file_wrapper.h"
+#include "source_mmap_wrapper.h"
 #if defined(HAVE_LINUX_ALSA_ENABLED)
 #include "sink_alsa_wrapper.h"
 #elif defined(HAVE_PORT_AUDIO_ENABLED)
@@ -63,6 +63,10 @@ static int basic_demo_state_listener(enum liteplayer_state state, int errcode, v
     case LITEPLAYER_STOPPED:
         OS_LOGD(TAG, "-->LITEPLAYER_STOPPED");
         break;
+    case LITEPLAYER_BUFFERING:
+        OS_LOGD(TAG, "-->LITEPLAYER_BUFFERING: %d", errcode);
+        state_sync = false;
+        break;
     case LITEPLAYER_ERROR:
         OS_LOGE(TAG, "-->LITEPLAYER_ERROR: %d", errcode);
         break;
@@ -94,6 +98,7 @@ static int basic_demo(const char *url)
         .open = alsa_wrapper_open,
         .write = alsa_wrapper_write,
         .close = alsa_wrapper_close,
+        .period_hint = alsa_wrapper_period_hint,
     };
 #elif defined(HAVE_PORT_AUDIO_ENABLED)
     struct sink_wrapper sink_ops = {
@@ -118,13 +123,16 @@ static int basic_demo(const char *url)
         .async_mode = false,
         .buffer_size = 2*1024,
         .priv_data = NULL,
-        .url_protocol = file_wrapper_url_protocol,
-        .open = file_wrapper_open,
-        .read = file_wrapper_read,
-        .content_pos = file_wrapper_content_pos,
-        .content_len = file_wrapper_content_len,
-        .seek = file_wrapper_seek,
-        .close = file_wrapper_close,
+        .url_protocol = mmap_wrapper_url_protocol,
+        .open = mmap_wrapper_open,
+        .read = mmap_wrapper_read,
+        .content_pos = mmap_wrapper_content_pos,
+        .content_len = mmap_wrapper_content_len,
+        .seek = mmap_wrapper_seek,
+        .close = mmap_wrapper_close,
+        .peek = mmap_wrapper_peek,
+        .consume = mmap_wrapper_consume,
+        .read_at = mmap_wrapper_read_at,
     };
     liteplayer_register_source_wrapper(player, &file_ops);
 
@@ -139,6 +147,7 @@ static int basic_demo(const char *url)
         .content_len = httpclient_wrapper_content_len,
         .seek = httpclient_wrapper_seek,
         .close = httpclient_wrapper_close,
+        .read_at = httpclient_wrapper_read_at,
     };
     liteplayer_register_source_wrapper(player, &http_ops);
 
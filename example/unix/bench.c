@@ -0,0 +1,414 @@
+// Copyright (c) 2019-2022 Qinglong<sysu.zqlong@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "osal/os_thread.h"
+#include "osal/os_time.h"
+#include "cutils/memory_helper.h"
+#include "cutils/log_helper.h"
+#include "liteplayer_main.h"
+#include "source_static_wrapper.h"
+
+#define TAG "liteplayer_bench"
+
+#define DEFAULT_BENCH_ITERATIONS 3
+
+// Every allocation made by liteplayer goes through os_malloc & co, on linux
+// we wrap these symbols at link time to count them (see CMakeLists.txt)
+static volatile unsigned long g_alloc_count = 0;
+static volatile unsigned long g_free_count = 0;
+
+#if defined(LITEPLAYER_BENCH_WRAP_MALLOC)
+// os_xxx may be renamed by osal namespace, expand it before pasting
+#define BENCH_REAL(func) SYSUTILS_OSAL_STATCC1(__real_, , func)
+#define BENCH_WRAP(func) SYSUTILS_OSAL_STATCC1(__wrap_, , func)
+
+void *BENCH_REAL(os_malloc)(unsigned int size);
+void *BENCH_REAL(os_calloc)(unsigned int n, unsigned int size);
+void *BENCH_REAL(os_realloc)(void *ptr, unsigned int size);
+void BENCH_REAL(os_free)(void *ptr);
+char *BENCH_REAL(os_strdup)(const char *str);
+
+void *BENCH_WRAP(os_malloc)(unsigned int size)
+{
+    __sync_fetch_and_add(&g_alloc_count, 1);
+    return BENCH_REAL(os_malloc)(size);
+}
+
+void *BENCH_WRAP(os_calloc)(unsigned int n, unsigned int size)
+{
+    __sync_fetch_and_add(&g_alloc_count, 1);
+    return BENCH_REAL(os_calloc)(n, size);
+}
+
+void *BENCH_WRAP(os_realloc)(void *ptr, unsigned int size)
+{
+    __sync_fetch_and_add(&g_alloc_count, 1);
+    return BENCH_REAL(os_realloc)(ptr, size);
+}
+
+void BENCH_WRAP(os_free)(void *ptr)
+{
+    if (ptr != NULL)
+        __sync_fetch_and_add(&g_free_count, 1);
+    BENCH_REAL(os_free)(ptr);
+}
+
+char *BENCH_WRAP(os_strdup)(const char *str)
+{
+    __sync_fetch_and_add(&g_alloc_count, 1);
+    return BENCH_REAL(os_strdup)(str);
+}
+#endif
+
+struct bench_priv {
+    os_mutex lock;
+    os_cond cond;
+    enum liteplayer_state state;
+    unsigned long long complete_us;
+};
+
+struct bench_sink {
+    int samplerate;
+    int channels;
+    int bits;
+    long long bytes;
+};
+
+struct bench_result {
+    const char *codec;
+    int samplerate;
+    int channels;
+    int bits;
+    long long frames;
+    unsigned long long best_us;
+    unsigned long long total_us;
+    unsigned long allocs;
+    unsigned long frees;
+};
+
+static struct bench_sink g_bench_sink;
+static bool g_bench_decode = false; // liteplayer_decode() instead of a player
+
+static struct source_wrapper g_static_ops = {
+    .async_mode = false,
+    .buffer_size = 16*1024,
+    .priv_data = NULL,
+    .url_protocol = static_wrapper_url_protocol,
+    .open = static_wrapper_open,
+    .read = static_wrapper_read,
+    .content_pos = static_wrapper_content_pos,
+    .content_len = static_wrapper_content_len,
+    .seek = static_wrapper_seek,
+    .close = static_wrapper_close,
+    .peek = static_wrapper_peek,
+    .consume = static_wrapper_consume,
+    .read_at = static_wrapper_read_at,
+};
+
+static const char *null_wrapper_name()
+{
+    return "null";
+}
+
+static sink_handle_t null_wrapper_open(int samplerate, int channels, int bits, void *priv_data)
+{
+    struct bench_sink *sink = (struct bench_sink *)priv_data;
+    sink->samplerate = samplerate;
+    sink->channels = channels;
+    sink->bits = bits;
+    sink->bytes = 0;
+    return sink;
+}
+
+static int null_wrapper_write(sink_handle_t handle, char *buffer, int size)
+{
+    struct bench_sink *sink = (struct bench_sink *)handle;
+    sink->bytes += size;
+    return size;
+}
+
+static void null_wrapper_close(sink_handle_t handle)
+{
+}
+
+static int bench_state_listener(enum liteplayer_state state, int errcode, void *priv)
+{
+    struct bench_priv *bench = (struct bench_priv *)priv;
+
+    if (state == LITEPLAYER_NEARLYCOMPLETED || state == LITEPLAYER_SEEKCOMPLETED || state == LITEPLAYER_BUFFERING)
+        return 0;
+
+    os_mutex_lock(bench->lock);
+    if (state == LITEPLAYER_COMPLETED)
+        bench->complete_us = os_monotonic_usec();
+    if (state == LITEPLAYER_ERROR)
+        OS_LOGE(TAG, "-->LITEPLAYER_ERROR: %d", errcode);
+    bench->state = state;
+    os_cond_signal(bench->cond);
+    os_mutex_unlock(bench->lock);
+    return 0;
+}
+
+static const char *bench_codec_name(const char *filename, const char *data, long size)
+{
+    if (size >= 8 && memcmp(&data[4], "ftyp", 4) == 0)
+        return "m4a";
+    if (size >= 4 && memcmp(data, "RIFF", 4) == 0)
+        return "wav";
+    if (strstr(filename, "aac") != NULL)
+        return "aac";
+    return "mp3";
+}
+
+static char *bench_load_file(const char *filename, long *size)
+{
+    FILE *file = fopen(filename, "rb");
+    char *data = NULL;
+
+    if (file == NULL) {
+        OS_LOGE(TAG, "Failed to open file:%s", filename);
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (*size > 0)
+        data = malloc(*size);
+    if (data != NULL && fread(data, 1, *size, file) != (size_t)*size) {
+        OS_LOGE(TAG, "Failed to read file:%s", filename);
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    return data;
+}
+
+static int bench_run_once(const char *url, struct bench_priv *bench, unsigned long long *elapsed_us)
+{
+    int ret = -1;
+    liteplayer_handle_t player = liteplayer_create();
+    if (player == NULL)
+        return ret;
+
+    bench->state = LITEPLAYER_IDLE;
+    bench->complete_us = 0;
+    liteplayer_register_state_listener(player, bench_state_listener, (void *)bench);
+
+    struct sink_wrapper sink_ops = {
+        .priv_data = &g_bench_sink,
+        .name = null_wrapper_name,
+        .open = null_wrapper_open,
+        .write = null_wrapper_write,
+        .close = null_wrapper_close,
+    };
+    liteplayer_register_sink_wrapper(player, &sink_ops);
+
+    liteplayer_register_source_wrapper(player, &g_static_ops);
+
+    if (liteplayer_set_data_source(player, url) != 0) {
+        OS_LOGE(TAG, "Failed to set data source");
+        goto bench_done;
+    }
+
+    // Time from prepare, so the extractor and decoder init cost is accounted
+    unsigned long long start_us = os_monotonic_usec();
+    if (liteplayer_prepare(player) != 0) {
+        OS_LOGE(TAG, "Failed to prepare player");
+        goto bench_done;
+    }
+    if (liteplayer_start(player) != 0) {
+        OS_LOGE(TAG, "Failed to start player");
+        goto bench_done;
+    }
+
+    os_mutex_lock(bench->lock);
+    while (bench->state != LITEPLAYER_COMPLETED && bench->state != LITEPLAYER_ERROR)
+        os_cond_wait(bench->cond, bench->lock);
+    os_mutex_unlock(bench->lock);
+
+    if (bench->state == LITEPLAYER_COMPLETED) {
+        *elapsed_us = bench->complete_us - start_us;
+        ret = 0;
+    }
+
+    liteplayer_stop(player);
+
+bench_done:
+    liteplayer_reset(player);
+    liteplayer_destroy(player);
+    return ret;
+}
+
+static int bench_pcm_write(char *buffer, int size, void *priv)
+{
+    return size;
+}
+
+static int bench_decode_once(const char *url, unsigned long long *elapsed_us)
+{
+    struct liteplayer_decode_cfg cfg = {
+        .source_wrapper = &g_static_ops,
+        .pcm_write = bench_pcm_write,
+    };
+    struct liteplayer_decode_result result;
+
+    unsigned long long start_us = os_monotonic_usec();
+    if (liteplayer_decode(url, &cfg, &result) != 0) {
+        OS_LOGE(TAG, "Failed to decode");
+        return -1;
+    }
+    *elapsed_us = os_monotonic_usec() - start_us;
+
+    g_bench_sink.samplerate = result.samplerate;
+    g_bench_sink.channels = result.channels;
+    g_bench_sink.bits = result.bits;
+    g_bench_sink.bytes = result.pcm_bytes;
+    return 0;
+}
+
+static int bench_file(const char *filename, int iterations)
+{
+    struct bench_result result;
+    char url[128];
+    long size = 0;
+    char *data = bench_load_file(filename, &size);
+    if (data == NULL)
+        return -1;
+
+    const char *basename = strrchr(filename, '/');
+    basename = basename != NULL ? basename + 1 : filename;
+    // static wrapper only parses base and length, the trailing file name is
+    // kept so that the parser can still tell aac from mp3 by url
+    snprintf(url, sizeof(url), "static://base=0x%llx&length=0x%x&file=%s",
+             (unsigned long long)(unsigned long)data, (unsigned int)size, basename);
+
+    struct bench_priv bench = {
+        .lock = os_mutex_create(),
+        .cond = os_cond_create(),
+        .state = LITEPLAYER_IDLE,
+    };
+
+    memset(&result, 0x0, sizeof(result));
+    result.codec = bench_codec_name(filename, data, size);
+    unsigned long alloc_base = g_alloc_count, free_base = g_free_count;
+
+    int ret = 0;
+    for (int i = 0; i < iterations; i++) {
+        unsigned long long elapsed_us = 0;
+        if (g_bench_decode)
+            ret = bench_decode_once(url, &elapsed_us);
+        else
+            ret = bench_run_once(url, &bench, &elapsed_us);
+        if (ret != 0)
+            break;
+        if (result.best_us == 0 || elapsed_us < result.best_us)
+            result.best_us = elapsed_us;
+        result.total_us += elapsed_us;
+    }
+
+    os_cond_destroy(bench.cond);
+    os_mutex_destroy(bench.lock);
+    free(data);
+
+    if (ret != 0) {
+        fprintf(stderr, "%-24s %-4s FAILED\n", basename, result.codec);
+        return -1;
+    }
+
+    result.samplerate = g_bench_sink.samplerate;
+    result.channels = g_bench_sink.channels;
+    result.bits = g_bench_sink.bits;
+    if (result.channels > 0 && result.bits > 0)
+        result.frames = g_bench_sink.bytes / (result.channels * result.bits / 8);
+    result.allocs = (g_alloc_count - alloc_base) / iterations;
+    result.frees = (g_free_count - free_base) / iterations;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    long peak_rss_kb = usage.ru_maxrss / 1024;
+#else
+    long peak_rss_kb = usage.ru_maxrss;
+#endif
+
+    double audio_sec = result.samplerate > 0 ? (double)result.frames / result.samplerate : 0;
+    double rtf = audio_sec > 0 ? (result.best_us / 1000000.0) / audio_sec : 0;
+    double ns_per_frame = result.frames > 0 ? (result.best_us * 1000.0) / result.frames : 0;
+
+    fprintf(stderr, "%-24s %-4s %6d %2d %2d %9.2f %9.2f %9.5f %10.2f %8lu %8lu %8ld\n",
+           basename, result.codec, result.samplerate, result.channels, result.bits,
+           audio_sec, result.best_us / 1000.0, rtf, ns_per_frame,
+           result.allocs, result.frees, peak_rss_kb);
+    fprintf(stderr, "%-24s      avg wall %.2f ms over %d iteration(s)\n",
+           "", result.total_us / 1000.0 / iterations, iterations);
+    fflush(stderr);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = DEFAULT_BENCH_ITERATIONS;
+    int opt, failed = 0;
+
+    while ((opt = getopt(argc, argv, "n:d")) != -1) {
+        switch (opt) {
+        case 'n':
+            iterations = atoi(optarg);
+            break;
+        case 'd':
+            g_bench_decode = true;
+            break;
+        default:
+            goto usage;
+        }
+    }
+    if (optind >= argc || iterations <= 0)
+        goto usage;
+
+    fprintf(stderr, "%-24s %-4s %6s %2s %2s %9s %9s %9s %10s %8s %8s %8s\n",
+           "file", "type", "rate", "ch", "bt", "audio(s)", "wall(ms)", "rtf",
+           "ns/frame", "allocs", "frees", "rss(KB)");
+    fflush(stderr);
+
+    for (int i = optind; i < argc; i++) {
+        // Run each file in its own process, so that peak RSS is per file
+        pid_t pid = fork();
+        if (pid == 0) {
+            exit(bench_file(argv[i], iterations) == 0 ? 0 : 1);
+        } else if (pid > 0) {
+            int status = 0;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                failed++;
+        } else {
+            OS_LOGE(TAG, "Failed to fork");
+            failed++;
+        }
+    }
+    return failed == 0 ? 0 : -1;
+
+usage:
+    OS_LOGW(TAG, "Usage: %s [-n iterations] [-d] file [file...]", argv[0]);
+    return -1;
+}
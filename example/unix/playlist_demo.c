@@ -120,6 +120,10 @@ static int playlist_demo_state_callback(enum liteplayer_state state, int errcode
     case LITEPLAYER_STOPPED:
         OS_LOGI(TAG, "-->LITEPLAYER_STOPPED");
         break;
+    case LITEPLAYER_BUFFERING:
+        OS_LOGI(TAG, "-->LITEPLAYER_BUFFERING: %d", errcode);
+        state_sync = false;
+        break;
     case LITEPLAYER_ERROR:
         OS_LOGE(TAG, "-->LITEPLAYER_ERROR: %d", errcode);
         break;
@@ -154,6 +158,7 @@ static void *playlist_demo_thread(void *arg)
         .open = alsa_wrapper_open,
         .write = alsa_wrapper_write,
         .close = alsa_wrapper_close,
+        .period_hint = alsa_wrapper_period_hint,
     };
 #elif defined(HAVE_PORT_AUDIO_ENABLED)
     struct sink_wrapper sink_ops = {
@@ -185,6 +190,7 @@ static void *playlist_demo_thread(void *arg)
         .content_len = file_wrapper_content_len,
         .seek = file_wrapper_seek,
         .close = file_wrapper_close,
+        .read_at = file_wrapper_read_at,
     };
     listplayer_register_source_wrapper(demo->player_handle, &file_ops);
 
@@ -199,6 +205,7 @@ static void *playlist_demo_thread(void *arg)
         .content_len = httpclient_wrapper_content_len,
         .seek = httpclient_wrapper_seek,
         .close = httpclient_wrapper_close,
+        .read_at = httpclient_wrapper_read_at,
     };
     listplayer_register_source_wrapper(demo->player_handle, &http_ops);
 
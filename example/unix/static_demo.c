@@ -554,6 +554,10 @@ static int static_demo_state_listener(enum liteplayer_state state, int errcode,
     case LITEPLAYER_STOPPED:
         OS_LOGD(TAG, "-->LITEPLAYER_STOPPED");
         break;
+    case LITEPLAYER_BUFFERING:
+        OS_LOGD(TAG, "-->LITEPLAYER_BUFFERING: %d", errcode);
+        state_sync = false;
+        break;
     case LITEPLAYER_ERROR:
         OS_LOGE(TAG, "-->LITEPLAYER_ERROR: %d", errcode);
         break;
@@ -585,6 +589,7 @@ static int static_demo(const char *url)
         .open = alsa_wrapper_open,
         .write = alsa_wrapper_write,
         .close = alsa_wrapper_close,
+        .period_hint = alsa_wrapper_period_hint,
     };
 #elif defined(HAVE_PORT_AUDIO_ENABLED)
     struct sink_wrapper sink_ops = {
@@ -616,6 +621,9 @@ static int static_demo(const char *url)
         .content_len = static_wrapper_content_len,
         .seek = static_wrapper_seek,
         .close = static_wrapper_close,
+        .peek = static_wrapper_peek,
+        .consume = static_wrapper_consume,
+        .read_at = static_wrapper_read_at,
     };
     liteplayer_register_source_wrapper(player, &static_ops);
 
@@ -68,6 +68,10 @@ static int tts_demo_state_listener(enum liteplayer_state state, int errcode, voi
     case LITEPLAYER_STOPPED:
         OS_LOGD(TAG, "-->LITEPLAYER_STOPPED");
         break;
+    case LITEPLAYER_BUFFERING:
+        OS_LOGD(TAG, "-->LITEPLAYER_BUFFERING: %d", errcode);
+        state_sync = false;
+        break;
     case LITEPLAYER_ERROR:
         OS_LOGE(TAG, "-->LITEPLAYER_ERROR: %d", errcode);
         break;
@@ -129,6 +133,7 @@ static int tts_demo(const char *url)
         .open = alsa_wrapper_open,
         .write = alsa_wrapper_write,
         .close = alsa_wrapper_close,
+        .period_hint = alsa_wrapper_period_hint,
     };
 #elif defined(HAVE_PORT_AUDIO_ENABLED)
     struct sink_wrapper sink_ops = {
@@ -35,14 +35,21 @@ struct source_wrapper {
     long long       (*content_len)(source_handle_t handle);
     int             (*seek)(source_handle_t handle, long offset);
     void            (*close)(source_handle_t handle);
+    int             (*peek)(source_handle_t handle, const char **buffer, int size);//optional, borrow data in place, 0<=ret<size means eof
+    void            (*consume)(source_handle_t handle, int size);//required with peek, release borrowed data
+    int             (*read_at)(source_handle_t handle, long long offset, char *buffer, int size);//optional, positional read, content_pos is unchanged, 0<=ret<size means eof
 };
 
+// bits passed to sink_wrapper.open for 32-bit float pcm, only with liteplayer_set_sink_format()
+#define LITEPLAYER_SINK_BITS_FLOAT  ( -32 )
+
 struct sink_wrapper {
     void            *priv_data;
     const char *    (*name)(); // "alsa", "wave", "opensles", "audiotrack"
     sink_handle_t   (*open)(int samplerate, int channels, int bits, void *priv_data);
     int             (*write)(sink_handle_t handle, char *buffer, int size);//return actual written size
     void            (*close)(sink_handle_t handle);
+    int             (*period_hint)(sink_handle_t handle, int *period_size, int *buffer_size);//optional, sizes in bytes, return 0 if valid
 };
 
 #ifdef __cplusplus
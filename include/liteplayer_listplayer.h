@@ -28,11 +28,13 @@ extern "C" {
 #define DEFAULT_LISTPLAYER_CFG() {\
     .playlist_url_suffix = DEFAULT_PLAYLIST_FILE_SUFFIX,\
     .playlist_url_max    = DEFAULT_PLAYLIST_URL_MAX,\
+    .gapless             = false,\
 }
 
 struct listplayer_cfg {
     const char *playlist_url_suffix;
     int         playlist_url_max;
+    bool        gapless; // prepare next url while playing, and keep sink open across tracks
 };
 
 typedef struct listplayer *listplayer_handle_t;
@@ -43,6 +45,8 @@ int listplayer_register_source_wrapper(listplayer_handle_t handle, struct source
 
 int listplayer_register_sink_wrapper(listplayer_handle_t handle, struct sink_wrapper *wrapper);
 
+int listplayer_set_sink_format(listplayer_handle_t handle, int samplerate, int channels, int bits);
+
 int listplayer_register_state_listener(listplayer_handle_t handle, liteplayer_state_cb listener, void *listener_priv);
 
 int listplayer_set_data_source(listplayer_handle_t handle, const char *url);
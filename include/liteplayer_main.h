@@ -31,19 +31,65 @@ enum liteplayer_state {
     LITEPLAYER_NEARLYCOMPLETED = 0x06,
     LITEPLAYER_COMPLETED       = 0x07,
     LITEPLAYER_STOPPED         = 0x08,
+    LITEPLAYER_BUFFERING       = 0x09, // not a state of player, reported while started, errcode is 1 when
+                                       // decoder runs out of data and waits for prebuffering, 0 when it goes on
     LITEPLAYER_ERROR           = 0xFF,
 };
 
 typedef int (*liteplayer_state_cb)(enum liteplayer_state state, int errcode, void *priv);
 
+#define LITEPLAYER_STATS_TIME_BUCKETS  12 // histogram[i] counts durations < (64us << i), the last one counts the rest
+#define LITEPLAYER_STATS_FILL_BUCKETS  10 // histogram[i] counts ringbuf filled in [i*10%, (i+1)*10%]
+
+struct liteplayer_stage_stats {
+    unsigned long       count;
+    unsigned long long  bytes;
+    unsigned long long  total_usec; // bytes/s = bytes*1000000/total_usec
+    unsigned long       max_usec;
+    unsigned long       histogram[LITEPLAYER_STATS_TIME_BUCKETS];
+};
+
+struct liteplayer_stats {
+    struct liteplayer_stage_stats source_read;     // source_wrapper.read
+    struct liteplayer_stage_stats decoder_process; // per frame, excluding time blocked on input and output
+    struct liteplayer_stage_stats sink_write;      // sink_wrapper.write, blocking time
+    int                 ringbuf_size;              // source->decoder ringbuf, sampled per decoded frame
+    int                 ringbuf_filled;
+    int                 ringbuf_filled_min;
+    unsigned long       ringbuf_histogram[LITEPLAYER_STATS_FILL_BUCKETS];
+    unsigned long       underruns;                 // decoder starved of input
+    int                 first_audio_msec;          // from prepare to first pcm written to sink, -1 if not yet
+};
+
 typedef struct liteplayer *liteplayer_handle_t;
 
+// Run decoder, source reads and parser of players created afterwards as cooperative jobs on a
+// shared pool of worker threads, instead of threads of their own. workers <= 0 sizes the pool to
+// the online cpu cores. A sink write blocking for long holds a worker, so prefer sinks that
+// block no longer than a period. Deinit after all players are destroyed
+int liteplayer_workpool_init(int workers);
+
+void liteplayer_workpool_deinit();
+
 liteplayer_handle_t liteplayer_create();
 
 int liteplayer_register_source_wrapper(liteplayer_handle_t handle, struct source_wrapper *wrapper);
 
 int liteplayer_register_sink_wrapper(liteplayer_handle_t handle, struct sink_wrapper *wrapper);
 
+// Keep the sink opened with a fixed format, decoded pcm is resampled and converted to it.
+// bits: 16, 24 (in 4 bytes), 32 or LITEPLAYER_SINK_BITS_FLOAT; samplerate 0 opens the sink
+// with the decoder's format, which is the default. Only allowed in idle state
+int liteplayer_set_sink_format(liteplayer_handle_t handle, int samplerate, int channels, int bits);
+
+// Buffers of every track (source/sink buffers, decoder memory) are kept in a per-player pool
+// across reset and set_data_source, so they are allocated once instead of every track.
+// Allocate count buffers of size bytes ahead of time, e.g. before the heap gets fragmented
+int liteplayer_reserve_buffers(liteplayer_handle_t handle, int size, int count);
+
+// Free the buffers kept for next track, buffers of the current track are freed when it's reset
+void liteplayer_trim_buffers(liteplayer_handle_t handle);
+
 int liteplayer_register_state_listener(liteplayer_handle_t handle, liteplayer_state_cb listener, void *listener_priv);
 
 int liteplayer_set_data_source(liteplayer_handle_t handle, const char *url);
@@ -68,8 +114,41 @@ int liteplayer_get_position(liteplayer_handle_t handle, int *msec);
 
 int liteplayer_get_duration(liteplayer_handle_t handle, int *msec);
 
+int liteplayer_get_stats(liteplayer_handle_t handle, struct liteplayer_stats *stats);
+
 void liteplayer_destroy(liteplayer_handle_t handle);
 
+// Output of liteplayer_decode(), the first one set is used:
+//   pcm_write:  called with converted pcm, return bytes consumed, <= 0 aborts decoding
+//   pcm_buffer: filled with pcm, decoding stops once it's full and result is truncated
+//   wav_path:   wave file written with pcm, bits 24 is not supported
+struct liteplayer_decode_cfg {
+    struct source_wrapper *source_wrapper; // optional, local file is read by default
+    int                 samplerate;        // output format as liteplayer_set_sink_format(),
+    int                 channels;          // samplerate 0 keeps the decoder's format
+    int                 bits;
+    int               (*pcm_write)(char *buffer, int size, void *priv);
+    void               *pcm_priv;
+    char               *pcm_buffer;
+    int                 pcm_buffer_size;
+    const char         *wav_path;
+};
+
+struct liteplayer_decode_result {
+    int                 samplerate;        // format of pcm written, 0 if nothing is decoded
+    int                 channels;
+    int                 bits;
+    long long           pcm_bytes;
+    int                 duration_ms;       // of pcm written
+    bool                truncated;         // pcm_buffer is full before end of stream
+};
+
+// Decode url to pcm as fast as the cpu allows, blocking until done. Source, parser and
+// decoder are the ones of a player, gapless trimming included, without the state machine
+// and the sink. Calls in different threads decode in parallel, on the workpool if
+// liteplayer_workpool_init() is called
+int liteplayer_decode(const char *url, struct liteplayer_decode_cfg *cfg, struct liteplayer_decode_result *result);
+
 #ifdef __cplusplus
 }
 #endif
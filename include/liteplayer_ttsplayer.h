@@ -39,6 +39,8 @@ ttsplayer_handle_t ttsplayer_create(struct ttsplayer_cfg *cfg);
 
 int ttsplayer_register_sink_wrapper(ttsplayer_handle_t handle, struct sink_wrapper *wrapper);
 
+int ttsplayer_set_sink_format(ttsplayer_handle_t handle, int samplerate, int channels, int bits);
+
 int ttsplayer_register_state_listener(ttsplayer_handle_t handle, liteplayer_state_cb listener, void *listener_priv);
 
 int ttsplayer_prepare_async(ttsplayer_handle_t handle);
@@ -32,7 +32,7 @@ static esp_err_t aac_decoder_destroy(audio_element_handle_t self)
     OS_LOGV(TAG, "Destroy aac decoder");
     if (decoder->handle != NULL)
         aac_wrapper_deinit(decoder);
-    audio_free(decoder);
+    bufpool_put(decoder->bufpool, decoder);
     return ESP_OK;
 }
 
@@ -66,6 +66,7 @@ static esp_err_t aac_decoder_close(audio_element_handle_t self)
         memset(&decoder->buf_out, 0x0, sizeof(decoder->buf_out));
         decoder->handle = NULL;
         decoder->parsed_header = false;
+        decoder->frame_offset = 0;
 
         audio_element_info_t info = {0};
         audio_element_getinfo(self, &info);
@@ -133,6 +134,7 @@ static esp_err_t aac_decoder_seek(audio_element_handle_t self, long long offset)
     memset(&decoder->buf_in, 0x0, sizeof(decoder->buf_in));
     memset(&decoder->buf_out, 0x0, sizeof(decoder->buf_out));
     decoder->seek_mode = true;
+    decoder->frame_offset = (long)offset;
     return ESP_OK;
 }
 
@@ -140,8 +142,10 @@ audio_element_handle_t aac_decoder_init(struct aac_decoder_cfg *config)
 {
     OS_LOGV(TAG, "Init aac decoder");
 
-    aac_decoder_handle_t decoder = audio_calloc(1, sizeof(struct aac_decoder));
+    aac_decoder_handle_t decoder = bufpool_get(config->bufpool, sizeof(struct aac_decoder));
     AUDIO_MEM_CHECK(TAG, decoder, return NULL);
+    memset(decoder, 0x0, sizeof(struct aac_decoder));
+    decoder->bufpool = config->bufpool;
 
     audio_element_cfg_t cfg = DEFAULT_AUDIO_ELEMENT_CONFIG();
     cfg.destroy = aac_decoder_destroy;
@@ -166,6 +170,6 @@ audio_element_handle_t aac_decoder_init(struct aac_decoder_cfg *config)
     return el;
 
 aac_init_error:
-    audio_free(decoder);
+    bufpool_put(decoder->bufpool, decoder);
     return NULL;
 }
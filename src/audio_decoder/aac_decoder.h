@@ -19,6 +19,7 @@
 
 #include "osal/os_thread.h"
 #include "esp_adf/audio_element.h"
+#include "cutils/bufpool.h"
 #include "audio_extractor/aac_extractor.h"
 
 #ifdef __cplusplus
@@ -49,6 +50,7 @@ struct aac_decoder_cfg {
     int   task_stack;     /*!< Task stack size */
     int   task_prio;      /*!< Task priority (based on freeRTOS priority) */
     struct aac_info *aac_info;
+    bufpool_handle bufpool; // optional, decoder memory is taken from it and returned on destroy
 };
 
 #define AAC_DECODER_TASK_STACK          (4 * 1024)
@@ -64,6 +66,7 @@ struct aac_buf_in {
     int   bytes_want;
     int   bytes_read;
     bool  eof;
+    const char *borrowed; // m4a sample borrowed from source in place, NULL if read into data
 };
 
 struct aac_buf_out {
@@ -78,8 +81,10 @@ struct aac_decoder {
     struct aac_buf_in       buf_in;
     struct aac_buf_out      buf_out;
     struct aac_info        *aac_info;
+    bufpool_handle          bufpool;
     bool                    parsed_header;
     bool                    seek_mode;
+    long                    frame_offset;   // offset of next frame, relative to the first frame
 };
 
 typedef struct aac_decoder *aac_decoder_handle_t;
@@ -30,6 +30,49 @@ struct pvaac_wrapper {
     void *pvaac_buffer;
 };
 
+// Mono is kept for plain AAC only, the decoder always outputs stereo once SBR/PS is
+// applied. Channels reported to sink never change, so they are kept after seek
+static int pvaac_wrapper_channels(audio_element_handle_t el, bool parsed_header, int channels, int object_type)
+{
+    if (parsed_header) {
+        audio_element_info_t info = {0};
+        audio_element_getinfo(el, &info);
+        return info.channels;
+    }
+    if (channels != 1)
+        return 2;
+#if defined(LITEPLAYER_CONFIG_AAC_PLUS)
+    return (object_type == MP4AUDIO_SBR || object_type == MP4AUDIO_PS) ? 2 : 1;
+#else
+    // SBR/PS are not applied, only AAC core is decoded
+    (void)object_type;
+    return 1;
+#endif
+}
+
+// SBR/PS signaled implicitly is found when decoding the first frame,
+// switch to stereo and drop the frame if mono was desired
+static bool pvaac_wrapper_check_mono(struct pvaac_wrapper *wrap, bool parsed_header)
+{
+    tPVMP4AudioDecoderExternal *config = &wrap->pvaac_config;
+    if (config->desiredChannels != 1 ||
+        (config->aacPlusUpsamplingFactor != 2 && config->extendedAudioObjectType != MP4AUDIO_PS))
+        return true;
+    if (parsed_header) {
+        OS_LOGE(TAG, "SBR/PS found after mono output started");
+        return true;
+    }
+    OS_LOGD(TAG, "SBR/PS found, output stereo instead of mono");
+    config->desiredChannels = 2;
+    return false;
+}
+
+static int pvaac_wrapper_output_bytes(struct pvaac_wrapper *wrap)
+{
+    tPVMP4AudioDecoderExternal *config = &wrap->pvaac_config;
+    return config->frameLength * config->aacPlusUpsamplingFactor * sizeof(short) * config->desiredChannels;
+}
+
 static int aac_adts_read(aac_decoder_handle_t decoder)
 {
     char *data = decoder->buf_in.data;
@@ -71,6 +114,23 @@ fill_data:
         return ret;
     }
 
+    if (decoder->seek_mode) {
+        // Seek offset may be estimated, drop bytes ahead of the next ADTS header,
+        // unconsumed bytes are always kept at the end of input buffer
+        int sync_offset = aac_find_sync_offset(decoder->buf_in.data, decoder->buf_in.bytes_read);
+        int bytes_skip = sync_offset >= 0 ? sync_offset : decoder->buf_in.bytes_read - (AAC_ADTS_HEADER_SIZE - 1);
+        if (bytes_skip > 0) {
+            int bytes_keep = decoder->buf_in.bytes_read - bytes_skip;
+            OS_LOGD(TAG, "SEEK_MODE: Skip %d bytes to sync", bytes_skip);
+            memmove(&decoder->buf_in.data[AAC_DECODER_INPUT_BUFFER_SIZE - bytes_keep],
+                    &decoder->buf_in.data[bytes_skip], bytes_keep);
+            decoder->buf_in.bytes_read = bytes_keep;
+            decoder->frame_offset += bytes_skip;
+            goto fill_data;
+        }
+        decoder->seek_mode = false;
+    }
+
     wrap->pvaac_config.pInputBuffer = (unsigned char *)(decoder->buf_in.data);
     wrap->pvaac_config.inputBufferCurrentLength = decoder->buf_in.bytes_read;
     wrap->pvaac_config.inputBufferMaxLength = 0;
@@ -92,9 +152,13 @@ fill_data:
         goto fill_data;
     }
 
+    aac_frame_index_append(decoder->aac_info->frame_index, decoder->frame_offset,
+                           wrap->pvaac_config.inputBufferUsedLength);
+    decoder->frame_offset += wrap->pvaac_config.inputBufferUsedLength;
     decoder->buf_in.bytes_read -= wrap->pvaac_config.inputBufferUsedLength;
-    decoder->buf_out.bytes_remain =
-        wrap->pvaac_config.frameLength * sizeof(short) * wrap->pvaac_config.desiredChannels;
+    if (!pvaac_wrapper_check_mono(wrap, decoder->parsed_header))
+        goto fill_data;
+    decoder->buf_out.bytes_remain = pvaac_wrapper_output_bytes(wrap);
 
     if (!decoder->parsed_header) {
         audio_element_info_t info = {0};
@@ -122,12 +186,11 @@ int aac_wrapper_init(aac_decoder_handle_t decoder)
 #if defined(LITEPLAYER_CONFIG_AAC_PLUS)
     wrap->pvaac_config.aacPlusEnabled = 1;
 #endif
-    // The software decoder doesn't properly support mono output on
-    // AACplus files. Always output stereo.
-    wrap->pvaac_config.desiredChannels = 2;
+    wrap->pvaac_config.desiredChannels =
+        pvaac_wrapper_channels(decoder->el, decoder->parsed_header, decoder->aac_info->channels, MP4AUDIO_AAC_LC);
 
     uint32_t memRequirements = PVMP4AudioDecoderGetMemRequirements();
-    wrap->pvaac_buffer = audio_malloc(memRequirements);
+    wrap->pvaac_buffer = bufpool_get(decoder->bufpool, memRequirements);
     if (wrap->pvaac_buffer == NULL) {
         OS_LOGE(TAG, "Failed to allocate memory for pvaac decoder");
         audio_free(wrap);
@@ -135,7 +198,7 @@ int aac_wrapper_init(aac_decoder_handle_t decoder)
     }
     if (PVMP4AudioDecoderInitLibrary(&wrap->pvaac_config, wrap->pvaac_buffer) != MP4AUDEC_SUCCESS) {
         OS_LOGE(TAG, "Failed to init library for pvaac decoder");
-        audio_free(wrap->pvaac_buffer);
+        bufpool_put(decoder->bufpool, wrap->pvaac_buffer);
         audio_free(wrap);
         return -1;
     }
@@ -149,7 +212,7 @@ void aac_wrapper_deinit(aac_decoder_handle_t decoder)
     struct pvaac_wrapper *wrap = (struct pvaac_wrapper *)decoder->handle;
     if (wrap == NULL) return;
 
-    audio_free(wrap->pvaac_buffer);
+    bufpool_put(decoder->bufpool, wrap->pvaac_buffer);
     audio_free(wrap);
 }
 
@@ -164,10 +227,21 @@ static int m4a_mdat_read(m4a_decoder_handle_t decoder)
         in->eof = true;
         return AEL_IO_DONE;
     }
-    in->bytes_want = decoder->m4a_info->stsz_samplesize[stsz_current];
+    in->bytes_want = m4a_get_sample_size(decoder->m4a_info, stsz_current);
+    if (in->bytes_want <= 0 || in->bytes_want > (int)sizeof(in->data)) {
+        OS_LOGE(TAG, "Invalid sample size: %d", in->bytes_want);
+        return AEL_IO_FAIL;
+    }
     in->bytes_read = 0;
 
-    ret = audio_element_input_chunk(decoder->el, in->data, in->bytes_want);
+    if (audio_element_input_peekable(decoder->el)) {
+        // Decode the sample in place, consumed after decoding
+        ret = audio_element_input_peek(decoder->el, &in->borrowed, in->bytes_want);
+        if (ret != in->bytes_want)
+            in->borrowed = NULL;
+    } else {
+        ret = audio_element_input_chunk(decoder->el, in->data, in->bytes_want);
+    }
     if (ret == in->bytes_want) {
         in->bytes_read += ret;
         goto read_done;
@@ -193,6 +267,7 @@ int m4a_wrapper_run(m4a_decoder_handle_t decoder)
     int ret = 0;
     struct pvaac_wrapper *wrap = (struct pvaac_wrapper *)decoder->handle;
 
+read_sample:
     ret = m4a_mdat_read(decoder);
     if (ret != AEL_IO_OK) {
         if (decoder->buf_in.eof) {
@@ -202,7 +277,8 @@ int m4a_wrapper_run(m4a_decoder_handle_t decoder)
         return ret;
     }
 
-    wrap->pvaac_config.pInputBuffer = (unsigned char *)(decoder->buf_in.data);
+    wrap->pvaac_config.pInputBuffer = (unsigned char *)(decoder->buf_in.borrowed != NULL ?
+                                                        decoder->buf_in.borrowed : decoder->buf_in.data);
     wrap->pvaac_config.inputBufferCurrentLength = decoder->buf_in.bytes_read;
     wrap->pvaac_config.inputBufferMaxLength = 0;
     wrap->pvaac_config.inputBufferUsedLength = 0;
@@ -211,13 +287,18 @@ int m4a_wrapper_run(m4a_decoder_handle_t decoder)
     wrap->pvaac_config.pOutputBuffer_plus = &(wrap->pvaac_config.pOutputBuffer[2048]);
     wrap->pvaac_config.repositionFlag = false;
     ret = PVMP4AudioDecodeFrame(&wrap->pvaac_config, wrap->pvaac_buffer);
+    if (decoder->buf_in.borrowed != NULL) {
+        audio_element_input_consume(decoder->el, decoder->buf_in.bytes_read);
+        decoder->buf_in.borrowed = NULL;
+    }
     if (ret != MP4AUDEC_SUCCESS) {
         OS_LOGE(TAG, "AACDecode error[%d]", ret);
         return AEL_PROCESS_FAIL;
     }
 
-    decoder->buf_out.bytes_remain =
-        wrap->pvaac_config.frameLength * sizeof(short) * wrap->pvaac_config.desiredChannels;
+    if (!pvaac_wrapper_check_mono(wrap, decoder->parsed_header))
+        goto read_sample;
+    decoder->buf_out.bytes_remain = pvaac_wrapper_output_bytes(wrap);
 
     if (!decoder->parsed_header) {
         audio_element_info_t info = {0};
@@ -245,12 +326,12 @@ int m4a_wrapper_init(m4a_decoder_handle_t decoder)
 #if defined(LITEPLAYER_CONFIG_AAC_PLUS)
     wrap->pvaac_config.aacPlusEnabled = 1;
 #endif
-    // The software decoder doesn't properly support mono output on
-    // AACplus files. Always output stereo.
-    wrap->pvaac_config.desiredChannels = 2;
+    wrap->pvaac_config.desiredChannels =
+        pvaac_wrapper_channels(decoder->el, decoder->parsed_header,
+                               decoder->m4a_info->asc.channels, decoder->m4a_info->asc.object_type);
 
     uint32_t memRequirements = PVMP4AudioDecoderGetMemRequirements();
-    wrap->pvaac_buffer = audio_malloc(memRequirements);
+    wrap->pvaac_buffer = bufpool_get(decoder->bufpool, memRequirements);
     if (wrap->pvaac_buffer == NULL) {
         OS_LOGE(TAG, "Failed to allocate memory for pvaac decoder");
         audio_free(wrap);
@@ -258,7 +339,7 @@ int m4a_wrapper_init(m4a_decoder_handle_t decoder)
     }
     if (PVMP4AudioDecoderInitLibrary(&wrap->pvaac_config, wrap->pvaac_buffer) != MP4AUDEC_SUCCESS) {
         OS_LOGE(TAG, "Failed to init library for pvaac decoder");
-        audio_free(wrap->pvaac_buffer);
+        bufpool_put(decoder->bufpool, wrap->pvaac_buffer);
         audio_free(wrap);
         return -1;
     }
@@ -267,7 +348,7 @@ int m4a_wrapper_init(m4a_decoder_handle_t decoder)
     wrap->pvaac_config.inputBufferMaxLength = 0;
     if (PVMP4AudioDecoderConfig(&wrap->pvaac_config, wrap->pvaac_buffer) != MP4AUDEC_SUCCESS) {
         OS_LOGE(TAG, "Failed to decode asc config");
-        audio_free(wrap->pvaac_buffer);
+        bufpool_put(decoder->bufpool, wrap->pvaac_buffer);
         audio_free(wrap);
         return -1;
     }
@@ -281,6 +362,6 @@ void m4a_wrapper_deinit(m4a_decoder_handle_t decoder)
     struct pvaac_wrapper *wrap = (struct pvaac_wrapper *)decoder->handle;
     if (wrap == NULL) return;
 
-    audio_free(wrap->pvaac_buffer);
+    bufpool_put(decoder->bufpool, wrap->pvaac_buffer);
     audio_free(wrap);
 }
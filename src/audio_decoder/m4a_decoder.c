@@ -31,7 +31,7 @@ static esp_err_t m4a_decoder_destroy(audio_element_handle_t self)
     OS_LOGV(TAG, "Destroy m4a decoder");
     if (decoder->handle != NULL)
         m4a_wrapper_deinit(decoder);
-    audio_free(decoder);
+    bufpool_put(decoder->bufpool, decoder);
     return ESP_OK;
 }
 
@@ -138,8 +138,10 @@ audio_element_handle_t m4a_decoder_init(struct m4a_decoder_cfg *config)
 {
     OS_LOGV(TAG, "Init m4a decoder");
 
-    m4a_decoder_handle_t decoder = audio_calloc(1, sizeof(struct m4a_decoder));
+    m4a_decoder_handle_t decoder = bufpool_get(config->bufpool, sizeof(struct m4a_decoder));
     AUDIO_MEM_CHECK(TAG, decoder, return NULL);
+    memset(decoder, 0x0, sizeof(struct m4a_decoder));
+    decoder->bufpool = config->bufpool;
 
     audio_element_cfg_t cfg = DEFAULT_AUDIO_ELEMENT_CONFIG();
     cfg.destroy = m4a_decoder_destroy;
@@ -164,6 +166,6 @@ audio_element_handle_t m4a_decoder_init(struct m4a_decoder_cfg *config)
     return el;
 
 m4a_init_error:
-    audio_free(decoder);
+    bufpool_put(decoder->bufpool, decoder);
     return NULL;
 }
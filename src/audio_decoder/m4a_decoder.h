@@ -29,6 +29,7 @@ struct m4a_decoder_cfg {
     int   task_stack;     /*!< Task stack size */
     int   task_prio;      /*!< Task priority (based on freeRTOS priority) */
     struct m4a_info *m4a_info;
+    bufpool_handle bufpool; // optional, decoder memory is taken from it and returned on destroy
 };
 
 #define DEFAULT_M4A_DECODER_CONFIG() {\
@@ -42,6 +43,7 @@ struct m4a_decoder {
     struct aac_buf_in       buf_in;
     struct aac_buf_out      buf_out;
     struct m4a_info        *m4a_info;
+    bufpool_handle          bufpool;
     bool                    parsed_header;
 };
 
@@ -30,7 +30,7 @@ static esp_err_t mp3_decoder_destroy(audio_element_handle_t self)
     OS_LOGV(TAG, "Destroy mp3 decoder");
     if (decoder->handle != NULL)
         mp3_wrapper_deinit(decoder);
-    audio_free(decoder);
+    bufpool_put(decoder->bufpool, decoder);
     return ESP_OK;
 }
 
@@ -64,6 +64,7 @@ static esp_err_t mp3_decoder_close(audio_element_handle_t self)
         memset(&decoder->buf_out, 0x0, sizeof(decoder->buf_out));
         decoder->handle = NULL;
         decoder->parsed_header = false;
+        decoder->frame_offset = 0;
 
         audio_element_info_t info = {0};
         audio_element_getinfo(self, &info);
@@ -131,6 +132,7 @@ static int mp3_decoder_seek(audio_element_handle_t self, long long offset)
     memset(&decoder->buf_in, 0x0, sizeof(decoder->buf_in));
     memset(&decoder->buf_out, 0x0, sizeof(decoder->buf_out));
     decoder->seek_mode = true;
+    decoder->frame_offset = (long)offset;
     return ESP_OK;
 }
 
@@ -138,8 +140,10 @@ audio_element_handle_t mp3_decoder_init(struct mp3_decoder_cfg *config)
 {
     OS_LOGV(TAG, "Init mp3 decoder");
 
-    mp3_decoder_handle_t decoder = audio_calloc(1, sizeof(struct mp3_decoder));
+    mp3_decoder_handle_t decoder = bufpool_get(config->bufpool, sizeof(struct mp3_decoder));
     AUDIO_MEM_CHECK(TAG, decoder, return NULL);
+    memset(decoder, 0x0, sizeof(struct mp3_decoder));
+    decoder->bufpool = config->bufpool;
 
     audio_element_cfg_t cfg = DEFAULT_AUDIO_ELEMENT_CONFIG();
     cfg.destroy = mp3_decoder_destroy;
@@ -167,6 +171,6 @@ audio_element_handle_t mp3_decoder_init(struct mp3_decoder_cfg *config)
     return el;
 
 mp3_init_error:
-    audio_free(decoder);
+    bufpool_put(decoder->bufpool, decoder);
     return NULL;
 }
@@ -17,6 +17,7 @@
 
 #include "osal/os_thread.h"
 #include "esp_adf/audio_element.h"
+#include "cutils/bufpool.h"
 #include "audio_extractor/mp3_extractor.h"
 
 #ifdef __cplusplus
@@ -36,6 +37,7 @@ struct mp3_decoder_cfg {
     int   task_stack;     /*!< Task stack size */
     int   task_prio;      /*!< Task priority (based on freeRTOS priority) */
     struct mp3_info *mp3_info;
+    bufpool_handle bufpool; // optional, decoder memory is taken from it and returned on destroy
 };
 
 #define MP3_DECODER_TASK_STACK          (4 * 1024)
@@ -51,6 +53,7 @@ struct mp3_buf_in {
     int  bytes_want;     // bytes that want to read
     int  bytes_read;     // bytes that have read
     bool eof;            // if end of stream
+    const char *borrowed; // frame borrowed from source in place, NULL if read into data
 };
 
 struct mp3_buf_out {
@@ -65,8 +68,10 @@ struct mp3_decoder {
     struct mp3_buf_in       buf_in;
     struct mp3_buf_out      buf_out;
     struct mp3_info        *mp3_info;
+    bufpool_handle          bufpool;
     bool                    parsed_header;
     bool                    seek_mode;
+    long                    frame_offset;   // offset of next frame, relative to the first frame
 };
 
 typedef struct mp3_decoder *mp3_decoder_handle_t;
@@ -144,6 +144,36 @@ finish:
     return found ? 0 : -1;
 }
 
+// Borrow the whole frame from source, consumed after decoding
+static int mp3_data_peek(mp3_decoder_handle_t decoder)
+{
+    struct pvmp3_wrapper *wrap = (struct pvmp3_wrapper *)(decoder->handle);
+    struct mp3_buf_in *in = &decoder->buf_in;
+    const char *frame = NULL;
+
+    int ret = audio_element_input_peek(decoder->el, &frame, 4);
+    if (ret == 4) {
+        wrap->frame_size = mp3_frame_size((char *)frame);
+        if (wrap->frame_size <= 0 || wrap->frame_size > MP3_DECODER_INPUT_BUFFER_SIZE) {
+            OS_LOGW(TAG, "MP3 demux dummy data, AEL_IO_DONE");
+            return AEL_IO_DONE;
+        }
+        ret = audio_element_input_peek(decoder->el, &frame, wrap->frame_size);
+        if (ret == wrap->frame_size) {
+            in->borrowed = frame;
+            in->bytes_read = wrap->frame_size;
+            in->bytes_want = 0;
+            return AEL_IO_OK;
+        }
+    }
+
+    if (ret >= 0 || ret == AEL_IO_DONE || ret == AEL_IO_ABORT) {
+        in->eof = true;
+        return AEL_IO_DONE;
+    }
+    return ret == AEL_IO_TIMEOUT ? AEL_IO_TIMEOUT : AEL_IO_FAIL;
+}
+
 static int mp3_data_read(mp3_decoder_handle_t decoder)
 {
     struct pvmp3_wrapper *wrap = (struct pvmp3_wrapper *)(decoder->handle);
@@ -180,6 +210,7 @@ static int mp3_data_read(mp3_decoder_handle_t decoder)
         OS_LOGV(TAG, "SEEK_MODE: Found sync offset: %d/%d, frame_size=%d",
                 info->frame_start_offset, wrap->bytes_seek, info->frame_size);
 
+        decoder->frame_offset += info->frame_start_offset;
         wrap->bytes_seek -= info->frame_start_offset;
         if (wrap->bytes_seek > 0)
             memmove(wrap->seek_buffer, &wrap->seek_buffer[info->frame_start_offset], wrap->bytes_seek);
@@ -241,6 +272,9 @@ static int mp3_data_read(mp3_decoder_handle_t decoder)
         return AEL_IO_OK;
     }
 
+    if (in->bytes_want == 0 && audio_element_input_peekable(decoder->el))
+        return mp3_data_peek(decoder);
+
     if (in->bytes_want > 0) {
         if (wrap->new_frame) {
             OS_LOGD(TAG, "Remain %d/4 bytes header needed to read", in->bytes_want);
@@ -317,14 +351,22 @@ int mp3_wrapper_run(mp3_decoder_handle_t decoder)
         return ret;
     }
 
+    mp3_frame_index_append(decoder->mp3_info->frame_index, decoder->frame_offset, decoder->buf_in.bytes_read);
+    decoder->frame_offset += decoder->buf_in.bytes_read;
+
     wrap->pvmp3_config.inputBufferCurrentLength = decoder->buf_in.bytes_read;
     wrap->pvmp3_config.inputBufferMaxLength = MP3_DECODER_INPUT_BUFFER_SIZE;
     wrap->pvmp3_config.inputBufferUsedLength = 0;
-    wrap->pvmp3_config.pInputBuffer = (uint8 *)decoder->buf_in.data;
+    wrap->pvmp3_config.pInputBuffer = (uint8 *)(decoder->buf_in.borrowed != NULL ?
+                                                decoder->buf_in.borrowed : decoder->buf_in.data);
     wrap->pvmp3_config.pOutputBuffer = (int16 *)decoder->buf_out.data;
     wrap->pvmp3_config.outputFrameSize = MP3_DECODER_OUTPUT_BUFFER_SIZE / sizeof(int16_t);
     wrap->pvmp3_config.crcEnabled = false;
     ERROR_CODE decoderErr = pvmp3_framedecoder(&wrap->pvmp3_config, wrap->pvmp3_buffer);
+    if (decoder->buf_in.borrowed != NULL) {
+        audio_element_input_consume(decoder->el, decoder->buf_in.bytes_read);
+        decoder->buf_in.borrowed = NULL;
+    }
     if (decoderErr != NO_DECODING_ERROR) {
         OS_LOGE(TAG, "PVMP3Decoder encountered error: %d", decoderErr);
         return AEL_PROCESS_FAIL;
@@ -359,7 +401,7 @@ int mp3_wrapper_init(mp3_decoder_handle_t decoder)
     }
 
     uint32_t memRequirements = pvmp3_decoderMemRequirements();
-    wrap->pvmp3_buffer = audio_malloc(memRequirements);
+    wrap->pvmp3_buffer = bufpool_get(decoder->bufpool, memRequirements);
     if (wrap->pvmp3_buffer == NULL) {
         OS_LOGE(TAG, "Failed to allocate memory for pvmp3 decoder");
         audio_free(wrap);
@@ -376,6 +418,6 @@ void mp3_wrapper_deinit(mp3_decoder_handle_t decoder)
     struct pvmp3_wrapper *wrap = (struct pvmp3_wrapper *)decoder->handle;
     if (wrap == NULL) return;
 
-    audio_free(wrap->pvmp3_buffer);
+    bufpool_put(decoder->bufpool, wrap->pvmp3_buffer);
     audio_free(wrap);
 }
@@ -56,6 +56,7 @@ struct wav_decoder {
     bool                    filled_header;
     bool                    read_timeout;
     struct wav_info        *wav_info;
+    bufpool_handle          bufpool;
     int                     sink_bits;
     drwav_uint64            prefered_frames;
 };
@@ -224,9 +225,9 @@ static int drwav_run(wav_decoder_handle_t decoder)
             if (decoder->sink_bits > decoder->drwav.bitsPerSample) {
                 int prefered_outsize = decoder->prefered_frames*decoder->sink_bits*info.channels/8;
                 if (prefered_outsize > decoder->buf_out.size) {
-                    audio_free(decoder->buf_out.data);
+                    bufpool_put(decoder->bufpool, decoder->buf_out.data);
                     decoder->buf_out.size = prefered_outsize;
-                    decoder->buf_out.data = audio_malloc(decoder->buf_out.size);
+                    decoder->buf_out.data = bufpool_get(decoder->bufpool, decoder->buf_out.size);
                     if (decoder->buf_out.data == NULL)
                         return AEL_PROCESS_FAIL;
                 }
@@ -273,9 +274,9 @@ static esp_err_t wav_decoder_destroy(audio_element_handle_t self)
 {
     wav_decoder_handle_t decoder = (wav_decoder_handle_t)audio_element_getdata(self);
     OS_LOGV(TAG, "Destroy wav decoder");
-    audio_free(decoder->buf_in.data);
-    audio_free(decoder->buf_out.data);
-    audio_free(decoder);
+    bufpool_put(decoder->bufpool, decoder->buf_in.data);
+    bufpool_put(decoder->bufpool, decoder->buf_out.data);
+    bufpool_put(decoder->bufpool, decoder);
     return ESP_OK;
 }
 
@@ -392,15 +393,17 @@ audio_element_handle_t wav_decoder_init(struct wav_decoder_cfg *config)
         cfg.task_stack = WAV_DECODER_TASK_STACK;
     cfg.tag = "wav_decoder";
 
-    wav_decoder_handle_t decoder = audio_calloc(1, sizeof(struct wav_decoder));
+    wav_decoder_handle_t decoder = bufpool_get(config->bufpool, sizeof(struct wav_decoder));
     if (decoder == NULL)
         return NULL;
+    memset(decoder, 0x0, sizeof(struct wav_decoder));
+    decoder->bufpool = config->bufpool;
 
     decoder->prefered_frames = config->wav_info->sampleRate*WAV_DECODER_PREFERED_PEROID_MS/1000;
     decoder->buf_in.size = decoder->prefered_frames * config->wav_info->blockAlign;
     decoder->buf_out.size = decoder->prefered_frames * config->wav_info->blockAlign;
-    decoder->buf_in.data = audio_malloc(decoder->buf_in.size);
-    decoder->buf_out.data = audio_malloc(decoder->buf_out.size);
+    decoder->buf_in.data = bufpool_get(decoder->bufpool, decoder->buf_in.size);
+    decoder->buf_out.data = bufpool_get(decoder->bufpool, decoder->buf_out.size);
     AUDIO_MEM_CHECK(TAG, decoder->buf_in.data && decoder->buf_out.data, goto wav_init_error);
 
     audio_element_handle_t el = audio_element_init(&cfg);
@@ -418,10 +421,8 @@ audio_element_handle_t wav_decoder_init(struct wav_decoder_cfg *config)
     return el;
 
 wav_init_error:
-    if (decoder->buf_in.data)
-        audio_free(decoder->buf_in.data);
-    if (decoder->buf_out.data)
-        audio_free(decoder->buf_out.data);
-    audio_free(decoder);
+    bufpool_put(decoder->bufpool, decoder->buf_in.data);
+    bufpool_put(decoder->bufpool, decoder->buf_out.data);
+    bufpool_put(decoder->bufpool, decoder);
     return NULL;
 }
@@ -17,6 +17,7 @@
 
 #include "osal/os_thread.h"
 #include "esp_adf/audio_element.h"
+#include "cutils/bufpool.h"
 #include "audio_extractor/wav_extractor.h"
 
 #ifdef __cplusplus
@@ -30,6 +31,7 @@ struct wav_decoder_cfg {
     int task_stack;     /*!< Task stack size */
     int task_prio;      /*!< Task priority (based on freeRTOS priority) */
     struct wav_info *wav_info;
+    bufpool_handle bufpool; // optional, decoder memory is taken from it and returned on destroy
 };
 
 #define WAV_DECODER_TASK_PRIO           (OS_THREAD_PRIO_NORMAL)
@@ -285,14 +285,58 @@ int aac_parse_adts_frame(char *buf, int buf_size, struct aac_info *info)
     return 0;
 }
 
+int aac_find_sync_offset(char *buf, int buf_size)
+{
+    struct aac_info temp;
+    int pos = 0;
+
+    while (pos + AAC_ADTS_HEADER_SIZE <= buf_size) {
+        int sync_offset = aac_find_adts_syncword(&buf[pos], buf_size - pos);
+        if (sync_offset < 0)
+            break;
+        pos += sync_offset;
+        // Layer is always 0 in ADTS header, skip mp3-like syncwords quietly
+        if (pos + AAC_ADTS_HEADER_SIZE <= buf_size && (buf[pos+1] & 0x06) == 0 &&
+            aac_parse_adts_frame(&buf[pos], AAC_ADTS_HEADER_SIZE, &temp) == 0)
+            return pos;
+        pos++;
+    }
+    return -1;
+}
+
 static void aac_dump_info(struct aac_info *info)
 {
     OS_LOGD(TAG, "AAC INFO:");
     OS_LOGD(TAG, "  >channels          : %d", info->channels);
     OS_LOGD(TAG, "  >sample_rate       : %d", info->sample_rate);
+    OS_LOGD(TAG, "  >bit_rate          : %d", info->bit_rate);
     OS_LOGD(TAG, "  >frame_start_offset: %d", info->frame_start_offset);
 }
 
+// Estimate bit rate by the frames following the first one in buffer
+static void aac_estimate_bit_rate(char *buf, int buf_size, struct aac_info *info)
+{
+    struct aac_info temp;
+    long long bytes = 0;
+    int frames = 0;
+    int pos = 0;
+
+    while (pos + AAC_ADTS_HEADER_SIZE <= buf_size) {
+        if ((buf[pos] & 0xFF) != 0xFF || (buf[pos+1] & 0xF0) != 0xF0 ||
+            aac_parse_adts_frame(&buf[pos], AAC_ADTS_HEADER_SIZE, &temp) != 0 ||
+            temp.frame_size <= ADTS_HEADER_BYTES || pos + temp.frame_size > buf_size)
+            break;
+        bytes += temp.frame_size;
+        frames++;
+        pos += temp.frame_size;
+    }
+    if (frames == 0) {
+        bytes = info->frame_size;
+        frames = 1;
+    }
+    info->bit_rate = (int)(bytes*8*info->sample_rate/((long long)frames*AAC_FRAME_SAMPLES));
+}
+
 int aac_extractor(aac_fetch_cb fetch_cb, void *fetch_priv, struct aac_info *info)
 {
     int frame_start_offset = 0;
@@ -300,6 +344,9 @@ int aac_extractor(aac_fetch_cb fetch_cb, void *fetch_priv, struct aac_info *info
     bool found = false;
     char buf[DEFAULT_AAC_PARSER_BUFFER_SIZE];
     int buf_size = sizeof(buf);
+    char *frame = NULL;
+    int last_position = 0;
+    int sync_offset = 0;
 
     buf_size = fetch_cb(buf, buf_size, 0, fetch_priv);
     if (buf_size < 9) {
@@ -321,6 +368,7 @@ int aac_extractor(aac_fetch_cb fetch_cb, void *fetch_priv, struct aac_info *info
     if (frame_start_offset + 9 <= buf_size) {
         int ret = aac_parse_adts_frame(&buf[frame_start_offset], 9, info);
         if (ret == 0) {
+            frame = &buf[frame_start_offset];
             found = true;
             goto finish;
         }
@@ -336,9 +384,6 @@ int aac_extractor(aac_fetch_cb fetch_cb, void *fetch_priv, struct aac_info *info
         }
     }
 
-    int last_position = 0;
-    int sync_offset = 0;
-
 find_syncword:
     if (last_position + 9 > buf_size) {
         OS_LOGE(TAG, "Not enough data[%d] to parse", buf_size);
@@ -350,6 +395,7 @@ find_syncword:
         last_position += sync_offset;
         int ret = aac_parse_adts_frame(&buf[last_position], 9, info);
         if (ret == 0) {
+            frame = &buf[last_position];
             found = true;
             goto finish;
         } else {
@@ -364,8 +410,152 @@ find_syncword:
 
 finish:
     if (found) {
-        info->frame_start_offset = frame_start_offset;
+        info->frame_start_offset = frame_start_offset + last_position;
+        aac_estimate_bit_rate(frame, buf_size - (int)(frame - buf), info);
+        info->frame_index = aac_frame_index_create();
+        if (info->frame_index == NULL)
+            OS_LOGW(TAG, "Failed to create frame index, seeking will be less accurate");
         aac_dump_info(info);
     }
     return found ? 0 : -1;
 }
+
+int aac_get_duration(struct aac_info *info, long stream_bytes)
+{
+    if (info == NULL || info->bit_rate <= 0 || stream_bytes <= 0)
+        return -1;
+    return (int)((long long)stream_bytes*8*1000/info->bit_rate);
+}
+
+// Nearest position at or before frame: an indexed frame, or the end of indexed range
+static int aac_frame_index_lookup(struct aac_frame_index *index, int frame, int *base_frame, long *base_offset,
+                                  int *next_frame, long *next_offset)
+{
+    int ret = -1;
+
+    os_mutex_lock(index->lock);
+    if (index->frames > 0) {
+        if (frame < index->frames) {
+            int k = frame/index->interval;
+            *base_frame = k*index->interval;
+            *base_offset = index->offsets[k];
+            if (k + 1 < index->count) {
+                *next_frame = *base_frame + index->interval;
+                *next_offset = index->offsets[k+1];
+            } else {
+                *next_frame = index->frames;
+                *next_offset = index->end_offset;
+            }
+        } else {
+            *base_frame = *next_frame = index->frames;
+            *base_offset = *next_offset = index->end_offset;
+        }
+        ret = 0;
+    }
+    os_mutex_unlock(index->lock);
+    return ret;
+}
+
+// Walk ADTS headers from a known frame to the wanted one, indexing the frames passed
+static int aac_frame_walk(struct aac_info *info, aac_fetch_cb fetch_cb, void *fetch_priv,
+                          int frame, long offset, int target_frame, long *target_offset)
+{
+    char header[AAC_ADTS_HEADER_SIZE];
+    struct aac_info temp;
+
+    while (frame < target_frame) {
+        if (fetch_cb(header, sizeof(header), offset, fetch_priv) != sizeof(header) ||
+            aac_parse_adts_frame(header, sizeof(header), &temp) != 0 ||
+            temp.frame_size <= ADTS_HEADER_BYTES) {
+            OS_LOGE(TAG, "Failed to walk to frame %d, stopped at frame %d", target_frame, frame);
+            return -1;
+        }
+        aac_frame_index_append(info->frame_index, offset, temp.frame_size);
+        offset += temp.frame_size;
+        frame++;
+    }
+    *target_offset = offset;
+    return 0;
+}
+
+int aac_get_seek_offset(int seek_ms, struct aac_info *info, aac_fetch_cb fetch_cb, void *fetch_priv, long *offset)
+{
+    if (seek_ms < 0 || info == NULL || offset == NULL || info->sample_rate <= 0)
+        return -1;
+
+    int frame = (int)((long long)seek_ms*info->sample_rate/1000/AAC_FRAME_SAMPLES);
+    long frame_bytes = (long)((long long)info->bit_rate*AAC_FRAME_SAMPLES/8/info->sample_rate);
+    int base_frame = 0, next_frame = 0;
+    long base_offset = 0, next_offset = 0;
+
+    if (info->frame_index != NULL)
+        aac_frame_index_lookup(info->frame_index, frame, &base_frame, &base_offset, &next_frame, &next_offset);
+
+    if (fetch_cb != NULL &&
+        aac_frame_walk(info, fetch_cb, fetch_priv, base_frame, base_offset, frame, offset) == 0) {
+        OS_LOGD(TAG, "Seek by frame walk: frame=%d, base=%d, offset=%ld", frame, base_frame, *offset);
+        return 0;
+    }
+
+    // Frames walked may have been indexed
+    if (fetch_cb != NULL && info->frame_index != NULL)
+        aac_frame_index_lookup(info->frame_index, frame, &base_frame, &base_offset, &next_frame, &next_offset);
+    if (frame < next_frame) {
+        // Exact when interval is 1, otherwise interpolate between the two nearest frames
+        *offset = base_offset + (long)((long long)(next_offset - base_offset)*(frame - base_frame)/(next_frame - base_frame));
+        OS_LOGD(TAG, "Seek by frame index: frame=%d, offset=%ld", frame, *offset);
+    } else {
+        // Past the indexed range, decoder resyncs to the next ADTS header
+        if (base_frame > 0)
+            frame_bytes = base_offset/base_frame;
+        *offset = base_offset + (long)(frame - base_frame)*frame_bytes;
+        OS_LOGD(TAG, "Seek by bit rate: frame=%d, offset=%ld", frame, *offset);
+    }
+    return 0;
+}
+
+struct aac_frame_index *aac_frame_index_create(void)
+{
+    struct aac_frame_index *index = audio_calloc(1, sizeof(struct aac_frame_index));
+    if (index == NULL)
+        return NULL;
+    index->lock = os_mutex_create();
+    if (index->lock == NULL) {
+        audio_free(index);
+        return NULL;
+    }
+    index->interval = 1;
+    return index;
+}
+
+void aac_frame_index_destroy(struct aac_frame_index *index)
+{
+    if (index == NULL)
+        return;
+    os_mutex_destroy(index->lock);
+    audio_free(index);
+}
+
+void aac_frame_index_append(struct aac_frame_index *index, long offset, int frame_size)
+{
+    if (index == NULL || frame_size <= 0)
+        return;
+
+    os_mutex_lock(index->lock);
+    // Decoder and seeking scan may index the same frames, and frames that don't
+    // continue the indexed range (e.g. after seeking past it) are ignored
+    if (offset == index->end_offset) {
+        if (index->frames == index->count*index->interval) {
+            if (index->count == AAC_FRAME_INDEX_ENTRIES) {
+                for (int i = 0; i < AAC_FRAME_INDEX_ENTRIES/2; i++)
+                    index->offsets[i] = index->offsets[2*i];
+                index->count = AAC_FRAME_INDEX_ENTRIES/2;
+                index->interval *= 2;
+            }
+            index->offsets[index->count++] = (unsigned int)offset;
+        }
+        index->frames++;
+        index->end_offset += frame_size;
+    }
+    os_mutex_unlock(index->lock);
+}
@@ -15,24 +15,66 @@
 #ifndef _AAC_EXTRACTOR_H_
 #define _AAC_EXTRACTOR_H_
 
+#include "osal/os_thread.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define AAC_ADTS_HEADER_SIZE       (9) // enough to parse a header with CRC
+#define AAC_FRAME_SAMPLES          (1024)
+#define AAC_FRAME_INDEX_ENTRIES    (1024)
+
 // Return the data size obtained
-typedef int (*aac_fetch_cb)(char *buf, int wanted_size, long offset, void *fetch_priv);
+typedef int (*aac_fetch_cb)(char *buf, int wanted_size, long long offset, void *fetch_priv);
 
 struct aac_info {
     int channels;
     int sample_rate;
     int frame_size;
     int frame_start_offset;
+    int bit_rate;               // bps, averaged over the frames read by extractor
+    struct aac_frame_index *frame_index;
+};
+
+/*
+ * ADTS frame offsets relative to the first frame, appended by decoder while
+ * decoding and by aac_get_seek_offset() when seeking past the indexed range.
+ * One entry every `interval` frames, when the table is full every other entry
+ * is dropped and interval is doubled, so memory stays bounded.
+ */
+struct aac_frame_index {
+    os_mutex lock;
+    int frames;                 // number of contiguous frames indexed from the first frame
+    long end_offset;            // offset of frame `frames`
+    int interval;
+    int count;
+    unsigned int offsets[AAC_FRAME_INDEX_ENTRIES];
 };
 
 int aac_parse_adts_frame(char *buf, int buf_size, struct aac_info *info);
 
+// Offset of the first valid ADTS header in buffer, -1 if not found
+int aac_find_sync_offset(char *buf, int buf_size);
+
 int aac_extractor(aac_fetch_cb fetch_cb, void *fetch_priv, struct aac_info *info);
 
+// Duration estimated from bit_rate, -1 if unknown
+int aac_get_duration(struct aac_info *info, long stream_bytes);
+
+// Offset of the frame at seek_ms, relative to the first frame. fetch_cb is optional, with it
+// frames not indexed yet are scanned header by header, offsets passed to it are relative to
+// the first frame too. If it's NULL or fails, offset is interpolated by index or estimated by
+// bit_rate past the indexed range
+int aac_get_seek_offset(int seek_ms, struct aac_info *info, aac_fetch_cb fetch_cb, void *fetch_priv, long *offset);
+
+struct aac_frame_index *aac_frame_index_create(void);
+
+void aac_frame_index_destroy(struct aac_frame_index *index);
+
+// Called by decoder for each frame decoded, offset is relative to the first frame
+void aac_frame_index_append(struct aac_frame_index *index, long offset, int frame_size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -16,7 +16,6 @@
 #include <stdbool.h>
 #include <string.h>
 
-#include "osal/os_thread.h"
 #include "cutils/log_helper.h"
 #include "esp_adf/audio_common.h"
 #include "audio_extractor/aac_extractor.h"
@@ -24,14 +23,8 @@
 
 #define TAG "[liteplayer]m4a_extractor"
 
-// FIXME: If low memory, please reduce STSZ_MAX_BUFFER
-//#define STSZ_MAX_BUFFER       (256*1024)
-
 #define STREAM_BUFFER_SIZE    (2048)
 
-#define M4A_PARSER_TASK_PRIO  (OS_THREAD_PRIO_HIGH)
-#define M4A_PARSER_TASK_STACK (6144)
-
 typedef enum aac_error {
     AAC_ERR_NONE          = -0x00,    /* no error */
     AAC_ERR_FAIL          = -0x01,    /* input buffer too small */
@@ -59,12 +52,21 @@ struct atom_box {
     void *data;
 };
 
+struct sample2chunk {
+    uint32_t first_chunk;
+    uint32_t samples_per_chunk;
+};
+
 struct atom_parser {
-    ringbuf_handle      rb;
+    m4a_fetch_cb        fetch_cb;
+    void               *fetch_priv;
     uint8_t             data[STREAM_BUFFER_SIZE];
-    uint32_t            offset;
+    long long           offset;         // file offset of the next byte to parse
     struct atom_box    *atom;
+    uint8_t             atom_name[4];   // name of the atom being handled
     struct m4a_info    *m4a_info;
+    struct sample2chunk *stsc;
+    uint32_t            stsc_entries;
 };
 typedef struct atom_parser *atom_parser_handle_t;
 
@@ -90,37 +92,41 @@ static inline void datain(uint8_t *buf_out, uint8_t *buf_in, uint32_t size)
     }
 }
 
-static int32_t atom_rb_read(atom_parser_handle_t handle, int32_t wanted_size)
+// Fetch wanted_size bytes at the current offset into handle->data
+static int32_t atom_read(atom_parser_handle_t handle, int32_t wanted_size)
 {
-    int32_t byte_read = 0;
+    int32_t bytes_read = 0;
 
-    while (wanted_size > STREAM_BUFFER_SIZE) {
-        byte_read = rb_read(handle->rb, (char *)handle->data, STREAM_BUFFER_SIZE, AUDIO_MAX_DELAY);
-        if (byte_read < 0) {
-            OS_LOGE(TAG, "Failed to read rb, ret=%d", byte_read);
-            return byte_read;
-        } else {
-            handle->offset += byte_read;
-            wanted_size -= byte_read;
-        }
+    if (wanted_size < 0 || wanted_size > STREAM_BUFFER_SIZE) {
+        OS_LOGE(TAG, "Invalid read size %d at offset[%lld]", wanted_size, handle->offset);
+        return AAC_ERR_FAIL;
     }
 
-    if (wanted_size != 0) {
-        byte_read = rb_read_chunk(handle->rb, (char *)handle->data, wanted_size, AUDIO_MAX_DELAY);
-        if (byte_read < 0) {
-            OS_LOGE(TAG, "Failed to read rb, ret=%d", byte_read);
-            return byte_read;
-        } else {
-            handle->offset += byte_read;
+    while (bytes_read < wanted_size) {
+        int ret = handle->fetch_cb((char *)&handle->data[bytes_read], wanted_size - bytes_read,
+                                   handle->offset + bytes_read, handle->fetch_priv);
+        if (ret <= 0) {
+            OS_LOGE(TAG, "Failed to fetch %d bytes at offset[%lld], ret=%d",
+                    wanted_size - bytes_read, handle->offset + bytes_read, ret);
+            return ret < 0 ? ret : AAC_ERR_EOF;
         }
+        bytes_read += ret;
     }
 
+    handle->offset += wanted_size;
+    return 0;
+}
+
+// Skip payload that isn't needed, nothing is fetched until the next atom_read
+static int32_t atom_skip(atom_parser_handle_t handle, long long skip_size)
+{
+    handle->offset += skip_size;
     return 0;
 }
 
 static AAC_ERR_T dummyin(atom_parser_handle_t handle, uint32_t atom_size)
 {
-    return atom_rb_read(handle, atom_size);
+    return atom_skip(handle, atom_size);
 }
 
 static AAC_ERR_T mdhdin(atom_parser_handle_t handle, uint32_t atom_size)
@@ -129,7 +135,7 @@ static AAC_ERR_T mdhdin(atom_parser_handle_t handle, uint32_t atom_size)
     struct m4a_info *m4a_info = handle->m4a_info;
 
     uint16_t wanted_byte = 6*sizeof(uint32_t);
-    int32_t ret = atom_rb_read(handle, wanted_byte);
+    int32_t ret = atom_read(handle, wanted_byte);
     AUDIO_ERR_CHECK(TAG, ret == 0, return ret);
 
     // version/flags
@@ -149,7 +155,7 @@ static AAC_ERR_T mdhdin(atom_parser_handle_t handle, uint32_t atom_size)
     u16in(buf); buf += 2;
 
     if (atom_size > wanted_byte)
-        return atom_rb_read(handle, atom_size-wanted_byte);
+        return atom_skip(handle, atom_size-wanted_byte);
     else
         return AAC_ERR_NONE;
 }
@@ -159,7 +165,7 @@ static AAC_ERR_T hdlr1in(atom_parser_handle_t handle, uint32_t atom_size)
     uint8_t *buf = handle->data;
     uint16_t wanted_byte = 6*sizeof(uint32_t);
 
-    int32_t ret = atom_rb_read(handle, wanted_byte);
+    int32_t ret = atom_read(handle, wanted_byte);
     AUDIO_ERR_CHECK(TAG, ret == 0, return ret);
 
     // version/flags
@@ -181,7 +187,7 @@ static AAC_ERR_T hdlr1in(atom_parser_handle_t handle, uint32_t atom_size)
     u32in(buf); buf += 4;
 
     if (atom_size > wanted_byte)
-        return atom_rb_read(handle, atom_size-wanted_byte);
+        return atom_skip(handle, atom_size-wanted_byte);
     else
         return AAC_ERR_NONE;
 }
@@ -191,7 +197,7 @@ static AAC_ERR_T stsdin(atom_parser_handle_t handle, uint32_t atom_size)
     uint8_t *buf = handle->data;
     uint16_t wanted_byte = 2*sizeof(uint32_t);
 
-    int32_t ret = atom_rb_read(handle, wanted_byte);
+    int32_t ret = atom_read(handle, wanted_byte);
     AUDIO_ERR_CHECK(TAG, ret == 0, return ret);
 
     // version/flags
@@ -211,7 +217,7 @@ static AAC_ERR_T mp4ain(atom_parser_handle_t handle, uint32_t atom_size)
     struct m4a_info *m4a_info = handle->m4a_info;
 
     uint16_t wanted_byte = 7*sizeof(uint32_t);
-    int32_t ret = atom_rb_read(handle, wanted_byte);
+    int32_t ret = atom_read(handle, wanted_byte);
     AUDIO_ERR_CHECK(TAG, ret == 0, return ret);
 
     // Reserved (6 bytes)
@@ -278,7 +284,7 @@ static AAC_ERR_T esdsin(atom_parser_handle_t handle, uint32_t atom_size)
     uint8_t *buf = handle->data;
     struct m4a_info *m4a_info = handle->m4a_info;
 
-    int32_t ret = atom_rb_read(handle, atom_size);
+    int32_t ret = atom_read(handle, atom_size);
     AUDIO_ERR_CHECK(TAG, ret == 0, return ret);
 
     // version/flags
@@ -343,201 +349,280 @@ static AAC_ERR_T esdsin(atom_parser_handle_t handle, uint32_t atom_size)
     return AAC_ERR_NONE;
 }
 
-static AAC_ERR_T sttsin(atom_parser_handle_t handle, uint32_t atom_size)
+static struct m4a_sample_table *m4a_sample_table_get(atom_parser_handle_t handle)
 {
     struct m4a_info *m4a_info = handle->m4a_info;
+    if (m4a_info->sample_table == NULL)
+        m4a_info->sample_table = audio_calloc(1, sizeof(struct m4a_sample_table));
+    return m4a_info->sample_table;
+}
+
+static AAC_ERR_T sttsin(atom_parser_handle_t handle, uint32_t atom_size)
+{
+    struct m4a_sample_table *table = m4a_sample_table_get(handle);
     uint16_t wanted_byte = 2*sizeof(uint32_t);
-    uint32_t remain_byte = atom_size - wanted_byte;
     uint8_t *buf = handle->data;
-    int32_t ret = atom_rb_read(handle, wanted_byte);
+    if (table == NULL)
+        return AAC_ERR_NOMEM;
+    if (atom_size < wanted_byte)
+        return AAC_ERR_FAIL;
+
+    int32_t ret = atom_read(handle, wanted_byte);
     AUDIO_ERR_CHECK(TAG, ret == 0, return ret);
 
     // version/flags
     u32in(buf); buf += 4;
 
-    m4a_info->stts_time2sample_entries = u32in(buf); buf += 4;
-    m4a_info->stts_time2sample =
-        audio_calloc(m4a_info->stts_time2sample_entries, sizeof(struct time2sample));
-    if (m4a_info->stts_time2sample == NULL) {
-        return AAC_ERR_NOMEM;
+    uint32_t entries = u32in(buf); buf += 4;
+    if (entries > (atom_size - wanted_byte)/8) {
+        OS_LOGE(TAG, "stts error, invalid entries=%u", entries);
+        return AAC_ERR_FAIL;
     }
+    uint32_t remain_byte = atom_size - wanted_byte - entries*8;
 
-    for (uint32_t cnt = 0; cnt < m4a_info->stts_time2sample_entries; cnt++) {
-        wanted_byte = 2*sizeof(uint32_t);
-        remain_byte -= wanted_byte;
-        ret = atom_rb_read(handle, wanted_byte);
+    table->stts = audio_calloc(entries, sizeof(struct time2sample));
+    if (table->stts == NULL)
+        return AAC_ERR_NOMEM;
+    table->stts_entries = entries;
+
+    // Keep the running sample index and timestamp, so time->sample is a binary search
+    uint32_t sample_index = 0;
+    uint64_t sample_time = 0;
+    for (uint32_t cnt = 0; cnt < entries; ) {
+        uint32_t batch = entries - cnt;
+        if (batch > STREAM_BUFFER_SIZE/8)
+            batch = STREAM_BUFFER_SIZE/8;
+        ret = atom_read(handle, batch*8);
         AUDIO_ERR_CHECK(TAG, ret == 0, return ret);
 
         buf = handle->data;
-        m4a_info->stts_time2sample[cnt].sample_count = u32in(buf); buf += 4;
-        m4a_info->stts_time2sample[cnt].sample_duration = u32in(buf); buf += 4;
-
-        OS_LOGV(TAG, "stts_time2sample[%d]: sample_count/sample_duration: %u:%u",
-                cnt,
-                m4a_info->stts_time2sample[cnt].sample_count,
-                m4a_info->stts_time2sample[cnt].sample_duration);
+        for (uint32_t i = 0; i < batch; i++, cnt++) {
+            uint32_t sample_count = u32in(buf); buf += 4;
+            uint32_t sample_duration = u32in(buf); buf += 4;
+            table->stts[cnt].sample_index = sample_index;
+            table->stts[cnt].sample_duration = sample_duration;
+            table->stts[cnt].sample_time = sample_time;
+            sample_index += sample_count;
+            sample_time += (uint64_t)sample_count*sample_duration;
+            OS_LOGV(TAG, "stts[%u]: sample_count/sample_duration: %u:%u", cnt, sample_count, sample_duration);
+        }
     }
-    return atom_rb_read(handle, remain_byte);
+    return atom_skip(handle, remain_byte);
 }
 
 static AAC_ERR_T stscin(atom_parser_handle_t handle, uint32_t atom_size)
 {
-    struct m4a_info *m4a_info = handle->m4a_info;
     uint16_t wanted_byte = 2*sizeof(uint32_t);
-    uint32_t remain_byte = atom_size - wanted_byte;
     uint8_t *buf = handle->data;
-    int32_t ret = atom_rb_read(handle, wanted_byte);
+    if (atom_size < wanted_byte)
+        return AAC_ERR_FAIL;
+
+    int32_t ret = atom_read(handle, wanted_byte);
     AUDIO_ERR_CHECK(TAG, ret == 0, return ret);
 
     // version/flags
     u32in(buf); buf += 4;
 
-    m4a_info->stsc_sample2chunk_entries = u32in(buf); buf += 4;
-    m4a_info->stsc_sample2chunk =
-        audio_calloc(m4a_info->stsc_sample2chunk_entries, sizeof(struct sample2chunk));
-    if (m4a_info->stsc_sample2chunk == NULL) {
-        return AAC_ERR_NOMEM;
+    uint32_t entries = u32in(buf); buf += 4;
+    if (entries == 0 || entries > (atom_size - wanted_byte)/12) {
+        OS_LOGE(TAG, "stsc error, invalid entries=%u", entries);
+        return AAC_ERR_FAIL;
     }
+    uint32_t remain_byte = atom_size - wanted_byte - entries*12;
 
-    for (uint32_t cnt = 0; cnt < m4a_info->stsc_sample2chunk_entries; cnt++) {
-        wanted_byte = 3*sizeof(uint32_t);
-        remain_byte -= wanted_byte;
-        ret = atom_rb_read(handle, wanted_byte);
+    // Only needed until stco is parsed, freed by m4a_extractor
+    handle->stsc = audio_calloc(entries, sizeof(struct sample2chunk));
+    if (handle->stsc == NULL)
+        return AAC_ERR_NOMEM;
+    handle->stsc_entries = entries;
+
+    for (uint32_t cnt = 0; cnt < entries; ) {
+        uint32_t batch = entries - cnt;
+        if (batch > STREAM_BUFFER_SIZE/12)
+            batch = STREAM_BUFFER_SIZE/12;
+        ret = atom_read(handle, batch*12);
         AUDIO_ERR_CHECK(TAG, ret == 0, return ret);
 
         buf = handle->data;
-        m4a_info->stsc_sample2chunk[cnt].first_chunk = u32in(buf); buf += 4;
-        m4a_info->stsc_sample2chunk[cnt].samples_per_chunk = u32in(buf); buf += 4;
-        m4a_info->stsc_sample2chunk[cnt].sample_description_index = u32in(buf); buf += 4;
+        for (uint32_t i = 0; i < batch; i++, cnt++) {
+            handle->stsc[cnt].first_chunk = u32in(buf); buf += 4;
+            handle->stsc[cnt].samples_per_chunk = u32in(buf); buf += 4;
+            // sample description index
+            u32in(buf); buf += 4;
+            OS_LOGV(TAG, "stsc[%u]: first_chunk/samples_per_chunk: %u:%u",
+                    cnt, handle->stsc[cnt].first_chunk, handle->stsc[cnt].samples_per_chunk);
+        }
+    }
+    return atom_skip(handle, remain_byte);
+}
+
+static int m4a_put_sample_size(struct m4a_sample_table *table, uint32_t *capacity,
+                               uint32_t sample_index, uint32_t sample_size, uint32_t *prev_size)
+{
+    if (table->sizes_len + 5 > *capacity) {
+        uint32_t new_capacity = *capacity + *capacity/2 + 16;
+        uint8_t *sizes = audio_realloc(table->sizes, new_capacity);
+        if (sizes == NULL)
+            return -1;
+        table->sizes = sizes;
+        *capacity = new_capacity;
+    }
 
-        OS_LOGV(TAG, "stsc_sample2chunk[%d]: first_chunk/samples_per_chunk/sample_description_index: %u:%u:%u",
-                cnt,
-                m4a_info->stsc_sample2chunk[cnt].first_chunk,
-                m4a_info->stsc_sample2chunk[cnt].samples_per_chunk,
-                m4a_info->stsc_sample2chunk[cnt].sample_description_index);
+    if (sample_index % M4A_SAMPLE_BLOCK_SIZE == 0) {
+        table->size_block[sample_index/M4A_SAMPLE_BLOCK_SIZE] = table->sizes_len;
+        *prev_size = 0;
     }
-    return atom_rb_read(handle, remain_byte);
+
+    // zigzag varint of the delta to the previous sample
+    int32_t delta = (int32_t)(sample_size - *prev_size);
+    uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+    do {
+        uint8_t byte = zigzag & 0x7F;
+        zigzag >>= 7;
+        if (zigzag != 0)
+            byte |= 0x80;
+        table->sizes[table->sizes_len++] = byte;
+    } while (zigzag != 0);
+
+    *prev_size = sample_size;
+    return 0;
 }
 
 static AAC_ERR_T stszin(atom_parser_handle_t handle, uint32_t atom_size)
 {
     struct m4a_info *m4a_info = handle->m4a_info;
+    struct m4a_sample_table *table = m4a_sample_table_get(handle);
     uint16_t wanted_byte = 3*sizeof(uint32_t);
-    uint32_t remain_byte = atom_size - wanted_byte;
     uint8_t *buf = handle->data;
-    int32_t ret = atom_rb_read(handle, wanted_byte);
+    if (table == NULL)
+        return AAC_ERR_NOMEM;
+    if (atom_size < wanted_byte)
+        return AAC_ERR_FAIL;
+
+    int32_t ret = atom_read(handle, wanted_byte);
     AUDIO_ERR_CHECK(TAG, ret == 0, return ret);
 
     // version/flags
     u32in(buf); buf += 4;
     // Sample size
-    u32in(buf); buf += 4;
+    table->constant_size = u32in(buf); buf += 4;
     // Number of entries
-    m4a_info->stsz_samplesize_entries = u32in(buf);  buf += 4;
-
-    /**
-    * To save memeory, we assuem all frame size is 16bit width(not bigger than 0xFFFF)
-    * So the moment we got frame count(stszsize), we'll check how many memory is needed
-    * to store stsz header. And return fail if bigger than default buffer.
-    */
-#if defined(STSZ_MAX_BUFFER) && (STSZ_MAX_BUFFER > 0)
-    if (m4a_info->stsz_samplesize_entries*sizeof(int16_t) > STSZ_MAX_BUFFER) {
-        OS_LOGE(TAG, "Large STSZ(%u), out of memory", (uint32_t)(m4a_info->stsz_samplesize_entries*sizeof(int16_t)));
-        return AAC_ERR_NOMEM;
+    table->sample_count = u32in(buf); buf += 4;
+    m4a_info->stsz_samplesize_entries = table->sample_count;
+
+    if (table->constant_size != 0) {
+        m4a_info->stsz_samplesize_max = table->constant_size;
+        return atom_skip(handle, atom_size - wanted_byte);
     }
-#endif
-    m4a_info->stsz_samplesize = audio_calloc(m4a_info->stsz_samplesize_entries, sizeof(uint16_t));
-    if (m4a_info->stsz_samplesize == NULL) {
-        return AAC_ERR_NOMEM;
+
+    uint32_t entries = table->sample_count;
+    if (entries > (atom_size - wanted_byte)/4) {
+        OS_LOGE(TAG, "stsz error, invalid entries=%u", entries);
+        return AAC_ERR_FAIL;
     }
+    uint32_t remain_byte = atom_size - wanted_byte - entries*4;
 
-    uint32_t sample_size = 0;
-    for (int32_t cnt = 0; cnt < m4a_info->stsz_samplesize_entries; cnt++) {
-        remain_byte -= 4;
-        ret = atom_rb_read(handle, sizeof(uint32_t));
+    table->size_block = audio_calloc(entries/M4A_SAMPLE_BLOCK_SIZE + 1, sizeof(uint32_t));
+    if (table->size_block == NULL)
+        return AAC_ERR_NOMEM;
+    // AAC frame sizes mostly differ by less than 64 bytes, so one byte per sample is the common case
+    uint32_t capacity = entries + entries/4 + 16;
+    table->sizes = audio_malloc(capacity);
+    if (table->sizes == NULL)
+        return AAC_ERR_NOMEM;
+
+    uint32_t prev_size = 0;
+    for (uint32_t cnt = 0; cnt < entries; ) {
+        uint32_t batch = entries - cnt;
+        if (batch > STREAM_BUFFER_SIZE/4)
+            batch = STREAM_BUFFER_SIZE/4;
+        ret = atom_read(handle, batch*4);
         AUDIO_ERR_CHECK(TAG, ret == 0, return ret);
 
         buf = handle->data;
-        sample_size = u32in(buf);
-        if (m4a_info->stsz_samplesize_max < sample_size) {
-            if (sample_size > 0xFFFF) {
-                OS_LOGE(TAG, "Large samplesize(%u), out of max size of short", sample_size);
-                return AAC_ERR_FAIL;
-            }
-            m4a_info->stsz_samplesize_max = sample_size;
+        for (uint32_t i = 0; i < batch; i++, cnt++) {
+            uint32_t sample_size = u32in(buf); buf += 4;
+            if (m4a_info->stsz_samplesize_max < sample_size)
+                m4a_info->stsz_samplesize_max = sample_size;
+            if (m4a_put_sample_size(table, &capacity, cnt, sample_size, &prev_size) != 0)
+                return AAC_ERR_NOMEM;
         }
-        m4a_info->stsz_samplesize[cnt] = sample_size & 0xFFFF;
     }
 
-    OS_LOGV(TAG, "STSZ max sample size: %u", m4a_info->stsz_samplesize_max);
-    if (m4a_info->stsz_samplesize_max > 0xFFFF) {
-        return AAC_ERR_UNSUPPORTED;
+    if (table->sizes_len < capacity) {
+        uint8_t *sizes = audio_realloc(table->sizes, table->sizes_len > 0 ? table->sizes_len : 1);
+        if (sizes != NULL)
+            table->sizes = sizes;
     }
 
-    return atom_rb_read(handle, remain_byte);;
+    OS_LOGV(TAG, "STSZ max sample size: %u, packed %u entries into %u bytes",
+            m4a_info->stsz_samplesize_max, entries, table->sizes_len);
+    return atom_skip(handle, remain_byte);
 }
 
 static AAC_ERR_T stcoin(atom_parser_handle_t handle, uint32_t atom_size)
 {
-    uint8_t *buf = handle->data;
     struct m4a_info *m4a_info = handle->m4a_info;
-    uint16_t wanted_byte = 3*sizeof(uint32_t);
-    uint32_t remain_byte = atom_size - wanted_byte;
+    struct m4a_sample_table *table = m4a_sample_table_get(handle);
+    bool co64 = memcmp(handle->atom_name, "co64", 4) == 0;
+    uint32_t entry_size = co64 ? 8 : 4;
+    uint16_t wanted_byte = 2*sizeof(uint32_t);
+    uint8_t *buf = handle->data;
+    if (table == NULL)
+        return AAC_ERR_NOMEM;
+    if (handle->stsc == NULL || atom_size < wanted_byte)
+        return AAC_ERR_FAIL;
 
-    int32_t ret = atom_rb_read(handle, wanted_byte);
+    int32_t ret = atom_read(handle, wanted_byte);
     AUDIO_ERR_CHECK(TAG, ret == 0, return ret);
 
     // version/flags
     u32in(buf); buf += 4;
 
     // Number of entries
-    m4a_info->stco_chunk2offset_entries = u32in(buf); buf += 4;
-    m4a_info->stco_chunk2offset =
-        audio_calloc(m4a_info->stco_chunk2offset_entries, sizeof(struct chunk2offset));
-    if (m4a_info->stco_chunk2offset == NULL) {
-        return AAC_ERR_NOMEM;
+    uint32_t entries = u32in(buf); buf += 4;
+    if (entries == 0 || entries > (atom_size - wanted_byte)/entry_size) {
+        OS_LOGE(TAG, "stco error, invalid entries=%u", entries);
+        return AAC_ERR_FAIL;
     }
+    uint32_t remain_byte = atom_size - wanted_byte - entries*entry_size;
 
-    // first chunk offset
-    uint32_t offset = u32in(buf); buf += 4;
-    uint32_t new_chunk = 1, old_chunk = 1;
-    uint32_t old_first = m4a_info->stsc_sample2chunk[0].first_chunk;
-    uint32_t new_first = m4a_info->stsc_sample2chunk[1].first_chunk;
-    uint32_t old_samples = m4a_info->stsc_sample2chunk[0].samples_per_chunk;
-    uint32_t new_samples = 0;
-    uint32_t idx = 0;
-    for (int32_t cnt = 1; cnt < m4a_info->stco_chunk2offset_entries; cnt++) {
-        for (; new_chunk < m4a_info->stsc_sample2chunk_entries; new_chunk++) {
-            if (new_chunk > old_chunk) {
-                old_first = m4a_info->stsc_sample2chunk[new_chunk-1].first_chunk;
-                old_samples = m4a_info->stsc_sample2chunk[new_chunk-1].samples_per_chunk;
-                new_first = m4a_info->stsc_sample2chunk[new_chunk].first_chunk;
-                old_chunk = new_chunk;
+    table->chunk_sample = audio_calloc(entries, sizeof(uint32_t));
+    table->chunk_offset = audio_calloc(entries, sizeof(uint64_t));
+    if (table->chunk_sample == NULL || table->chunk_offset == NULL)
+        return AAC_ERR_NOMEM;
+    table->chunk_count = entries;
+
+    // Map chunks to their first sample with stsc, chunk number is 1-based
+    uint32_t stsc_idx = 0;
+    uint32_t sample_index = 0;
+    uint32_t per_read = STREAM_BUFFER_SIZE/entry_size;
+    for (uint32_t cnt = 0; cnt < entries; ) {
+        uint32_t batch = entries - cnt;
+        if (batch > per_read)
+            batch = per_read;
+        ret = atom_read(handle, batch*entry_size);
+        AUDIO_ERR_CHECK(TAG, ret == 0, return ret);
+
+        buf = handle->data;
+        for (uint32_t i = 0; i < batch; i++, cnt++) {
+            if (co64) {
+                table->chunk_offset[cnt] = ((uint64_t)u32in(buf) << 32) | u32in(buf + 4);
+                buf += 8;
+            } else {
+                table->chunk_offset[cnt] = u32in(buf);
+                buf += 4;
             }
-            if (new_first > cnt)
-                break;
-            new_samples = (new_first - old_first) * old_samples;
+            while (stsc_idx + 1 < handle->stsc_entries && handle->stsc[stsc_idx+1].first_chunk <= cnt + 1)
+                stsc_idx++;
+            table->chunk_sample[cnt] = sample_index;
+            sample_index += handle->stsc[stsc_idx].samples_per_chunk;
         }
-        new_samples += (cnt - old_first) * old_samples;
-
-        m4a_info->stco_chunk2offset[idx].sample_index = new_samples;
-        m4a_info->stco_chunk2offset[idx].chunk_offset = offset;
-        idx++;
-        //OS_LOGV(TAG, "STCO: ChunkOffset[%u]: index/offset: %u/%u", idx, new_samples, offset);
-
-        new_samples -= (cnt - old_first) * old_samples;
-
-        remain_byte -= 4;
-        ret = atom_rb_read(handle, sizeof(uint32_t));
-        AUDIO_ERR_CHECK(TAG, ret == 0, return ret);
-        offset = u32in(handle->data);
     }
-    m4a_info->stco_chunk2offset[idx].sample_index = 0;
-    m4a_info->stco_chunk2offset[idx].chunk_offset = 0;
 
-    m4a_info->mdat_offset = m4a_info->stco_chunk2offset[0].chunk_offset;
+    m4a_info->mdat_offset = table->chunk_offset[0];
 
-    return atom_rb_read(handle, remain_byte);
+    return atom_skip(handle, remain_byte);
 }
 
 static AAC_ERR_T atom_parse(atom_parser_handle_t handle)
@@ -557,12 +642,12 @@ static AAC_ERR_T atom_parse(atom_parser_handle_t handle)
         OS_LOGE(TAG, "Invalid opcode, expect ATOM_NAME");
         return AAC_ERR_OPCODE;
     } else {
-        OS_LOGV(TAG, "Looking for '%s' at offset[%u]", (char *)handle->atom->data, handle->offset);
+        OS_LOGV(TAG, "Looking for '%s' at offset[%lld]", (char *)handle->atom->data, handle->offset);
     }
 
 _next_atom:
     buf = handle->data;
-    ret = atom_rb_read(handle, 8);
+    ret = atom_read(handle, 8);
     AUDIO_ERR_CHECK(TAG, ret == 0, return ret);
 
     uint8_t atom_name[4] = {0};
@@ -571,15 +656,18 @@ _next_atom:
     atom_size = u32in(buf); buf += 4;
     datain(atom_name, buf, 4); buf += 4;
 
-    OS_LOGV(TAG, "atom[%s], size[%u], offset[%u]", atom_name, atom_size, handle->offset);
-    if (memcmp(atom_name, handle->atom->data, sizeof(atom_name)) == 0) {
+    OS_LOGV(TAG, "atom[%s], size[%u], offset[%lld]", atom_name, atom_size, handle->offset);
+    if (atom_size < 8) {
+        OS_LOGE(TAG, "Invalid atom size %u at offset[%lld]", atom_size, handle->offset);
+        return AAC_ERR_FAIL;
+    }
+    if (memcmp(atom_name, handle->atom->data, sizeof(atom_name)) == 0 ||
+        (memcmp(handle->atom->data, "stco", 4) == 0 && memcmp(atom_name, "co64", 4) == 0)) {
         OS_LOGV(TAG, "----OK----");
+        memcpy(handle->atom_name, atom_name, sizeof(atom_name));
         goto atom_found;
     } else {
-        if (atom_size > 8) {
-            ret = atom_rb_read(handle, atom_size-8);
-            AUDIO_ERR_CHECK(TAG, ret == 0, return ret);
-        }
+        atom_skip(handle, atom_size-8);
         goto _next_atom;
     }
 
@@ -686,6 +774,7 @@ static int m4a_parse_asc(struct m4a_info *m4a_info)
         if (sample_rate_index < 12) {
             m4a_info->asc.samplerate = sample_rates[sample_rate_index];
             m4a_info->asc.channels = channels_num;
+            m4a_info->asc.object_type = (config >> 11) & 0x1f;
             return AAC_ERR_NONE;
         }
     }
@@ -708,254 +797,387 @@ static void m4a_dump_info(struct m4a_info *m4a_info)
     OS_LOGD(TAG, "  >ASC size             : %u", m4a_info->asc.size);
     OS_LOGD(TAG, "  >ASC sampling rate    : %u", m4a_info->asc.samplerate);
     OS_LOGD(TAG, "  >ASC channels         : %u", m4a_info->asc.channels);
-    OS_LOGD(TAG, "  >Sample timescale     : %u", m4a_info->stts_time2sample[0].sample_duration);
+    OS_LOGD(TAG, "  >ASC object type      : %u", m4a_info->asc.object_type);
     OS_LOGD(TAG, "  >Duration             : %.1f sec", (float)m4a_info->duration/m4a_info->time_scale);
-    OS_LOGD(TAG, "  >MDAT offset/size     : %u/%u", m4a_info->mdat_offset, m4a_info->mdat_size);
+    OS_LOGD(TAG, "  >MDAT offset/size     : %llu/%llu",
+            (unsigned long long)m4a_info->mdat_offset, (unsigned long long)m4a_info->mdat_size);
     OS_LOGD(TAG, "  >STSZ entries         : %u", m4a_info->stsz_samplesize_entries);
-    OS_LOGD(TAG, "  >STTS entries         : %u", m4a_info->stts_time2sample_entries);
-    OS_LOGD(TAG, "  >STSC entries         : %u", m4a_info->stsc_sample2chunk_entries);
-    OS_LOGD(TAG, "  >STCO entries         : %u", m4a_info->stco_chunk2offset_entries);
+    OS_LOGD(TAG, "  >Gapless priming/pad  : %u/%u", m4a_info->priming_samples, m4a_info->padding_samples);
+    if (m4a_info->sample_table != NULL) {
+        OS_LOGD(TAG, "  >STTS entries         : %u", m4a_info->sample_table->stts_entries);
+        OS_LOGD(TAG, "  >STCO entries         : %u", m4a_info->sample_table->chunk_count);
+        OS_LOGD(TAG, "  >Packed sizes         : %u bytes", m4a_info->sample_table->sizes_len);
+    }
 }
 
-static AAC_ERR_T m4a_check_header(atom_parser_handle_t handle)
+static int m4a_check_sample_table(struct m4a_info *m4a_info)
 {
+    struct m4a_sample_table *table = m4a_info->sample_table;
+    if (table == NULL || table->stts == NULL || table->chunk_sample == NULL ||
+        (table->constant_size == 0 && table->sizes == NULL)) {
+        OS_LOGE(TAG, "Incomplete sample table");
+        return AAC_ERR_FAIL;
+    }
+    return AAC_ERR_NONE;
+}
+
+// Find child atom in [start, end), return offset and size of its payload
+static int m4a_find_atom(atom_parser_handle_t handle, long long start, long long end, const char *name,
+                         long long *payload_offset, uint32_t *payload_size)
+{
+    handle->offset = start;
+    while (handle->offset + 8 <= end) {
+        if (atom_read(handle, 8) != 0)
+            return -1;
+        uint32_t atom_size = u32in(handle->data);
+        if (atom_size < 8 || handle->offset - 8 + (long long)atom_size > end)
+            return -1;
+        if (memcmp(&handle->data[4], name, 4) == 0) {
+            *payload_offset = handle->offset;
+            *payload_size = atom_size - 8;
+            return 0;
+        }
+        atom_skip(handle, atom_size - 8);
+    }
+    return -1;
+}
+
+// iTunes gapless info lives in moov.udta.meta.ilst.----, as the "iTunSMPB" string:
+// " 00000000 <priming> <padding> <valid samples> ..." in hex
+static void m4a_parse_itunsmpb(atom_parser_handle_t handle, long long moov_start, long long moov_end)
+{
+    struct m4a_info *m4a_info = handle->m4a_info;
+    long long offset = 0, item_offset = 0, ilst_end = 0;
+    uint32_t size = 0, item_size = 0;
+
+    if (m4a_find_atom(handle, moov_start, moov_end, "udta", &offset, &size) != 0 ||
+        m4a_find_atom(handle, offset, offset + size, "meta", &offset, &size) != 0 || size < 12)
+        return;
+    // meta is a full box in MP4, but not in QuickTime files
+    handle->offset = offset;
+    if (atom_read(handle, 8) != 0)
+        return;
+    if (memcmp(&handle->data[4], "hdlr", 4) != 0) {
+        offset += 4;
+        size -= 4;
+    }
+    if (m4a_find_atom(handle, offset, offset + size, "ilst", &offset, &size) != 0)
+        return;
+
+    ilst_end = offset + size;
+    while (m4a_find_atom(handle, offset, ilst_end, "----", &item_offset, &item_size) == 0) {
+        offset = item_offset + item_size;
+
+        long long name_offset = 0, data_offset = 0;
+        uint32_t name_size = 0, data_size = 0;
+        if (m4a_find_atom(handle, item_offset, offset, "name", &name_offset, &name_size) != 0 ||
+            name_size != 4 + 8)
+            continue;
+        handle->offset = name_offset;
+        if (atom_read(handle, name_size) != 0 || memcmp(&handle->data[4], "iTunSMPB", 8) != 0)
+            continue;
+        if (m4a_find_atom(handle, item_offset, offset, "data", &data_offset, &data_size) != 0 ||
+            data_size <= 8)
+            break;
+
+        // type and locale, then the string
+        uint32_t str_size = data_size - 8;
+        if (str_size > STREAM_BUFFER_SIZE - 1)
+            str_size = STREAM_BUFFER_SIZE - 1;
+        handle->offset = data_offset + 8;
+        if (atom_read(handle, str_size) != 0)
+            break;
+        handle->data[str_size] = '\0';
+
+        unsigned int zero = 0, priming = 0, padding = 0;
+        unsigned long long valid = 0;
+        if (sscanf((const char *)handle->data, " %x %x %x %llx", &zero, &priming, &padding, &valid) == 4) {
+            m4a_info->priming_samples = priming;
+            m4a_info->padding_samples = padding;
+            m4a_info->valid_samples = valid;
+        }
+        break;
+    }
+}
+
+static AAC_ERR_T m4a_find_moov(atom_parser_handle_t handle)
+{
+    struct m4a_info *m4a_info = handle->m4a_info;
     uint8_t *buf = handle->data;
-    uint32_t atom_size = 0;
     uint8_t atom_name[4] = {0};
-    uint16_t wanted_byte = 2*sizeof(uint32_t);
-    uint32_t offset = 0;
+    uint64_t atom_size = 0;
+    uint32_t header_size = 2*sizeof(uint32_t);
+    bool mdat_found = false;
     int32_t ret = 0;
 
-    handle->m4a_info->parsed_once = true;
-
-    ret = atom_rb_read(handle, wanted_byte);
+    ret = atom_read(handle, header_size);
     AUDIO_ERR_CHECK(TAG, ret == 0, return AAC_ERR_FAIL);
 
     atom_size = u32in(buf); buf += 4;
     datain(atom_name, buf, 4); buf += 4;
 
-    OS_LOGV(TAG, "atom[%s], size[%u], offset[%u]", atom_name, atom_size, handle->offset);
-    if (memcmp(atom_name, "ftyp", 4) != 0) {
+    OS_LOGV(TAG, "atom[%s], size[%llu], offset[%lld]", atom_name, (unsigned long long)atom_size, handle->offset);
+    if (memcmp(atom_name, "ftyp", 4) != 0 || atom_size < header_size) {
         OS_LOGE(TAG, "Not M4A audio");
         return AAC_ERR_UNSUPPORTED;
     }
 
 next_atom:
-    offset += atom_size;
-
-    if (atom_size > wanted_byte) {
-        ret = atom_rb_read(handle, atom_size-wanted_byte);
-        AUDIO_ERR_CHECK(TAG, ret == 0, return AAC_ERR_FAIL);
-    }
+    // Top level boxes are skipped by offset, mdat payload is never fetched
+    atom_skip(handle, (long long)(atom_size - header_size));
 
     buf = handle->data;
-    ret = atom_rb_read(handle, wanted_byte);
+    header_size = 2*sizeof(uint32_t);
+    ret = atom_read(handle, header_size);
     AUDIO_ERR_CHECK(TAG, ret == 0, return AAC_ERR_FAIL);
 
     atom_size = u32in(buf); buf += 4;
     datain(atom_name, buf, 4); buf += 4;
+    if (atom_size == 1) {
+        // 64-bit largesize follows the name
+        buf = handle->data;
+        ret = atom_read(handle, 2*sizeof(uint32_t));
+        AUDIO_ERR_CHECK(TAG, ret == 0, return AAC_ERR_FAIL);
+        atom_size = ((uint64_t)u32in(buf) << 32) | u32in(buf + 4);
+        header_size += 2*sizeof(uint32_t);
+    } else if (atom_size == 0 && memcmp(atom_name, "moov", 4) != 0) {
+        // box extends to the end of file, nothing behind it
+        OS_LOGE(TAG, "Failed to find moov, atom[%s] extends to end of file", atom_name);
+        return AAC_ERR_FAIL;
+    }
 
-    OS_LOGV(TAG, "atom[%s], size[%u], offset[%u]", atom_name, atom_size, handle->offset);
+    OS_LOGV(TAG, "atom[%s], size[%llu], offset[%lld]", atom_name, (unsigned long long)atom_size, handle->offset);
     if (memcmp(atom_name, "mdat", 4) == 0) {
-        OS_LOGV(TAG, "moov behide of mdat: mdat_offset=%u, mdat_size=%u", offset, atom_size);
-        handle->m4a_info->mdat_size = atom_size;
-        handle->m4a_info->mdat_offset = offset;
-        handle->m4a_info->moov_offset = handle->m4a_info->mdat_offset + handle->m4a_info->mdat_size;
-        handle->m4a_info->moov_tail = true;
-        rb_reset(handle->rb);
-        return AAC_ERR_AGAIN;
+        mdat_found = true;
+        m4a_info->mdat_offset = (uint64_t)(handle->offset - header_size);
+        m4a_info->mdat_size = atom_size;
     } else if (memcmp(atom_name, "moov", 4) == 0) {
-        OS_LOGV(TAG, "moov ahead of mdat");
-        handle->m4a_info->moov_tail = false;
-        return moovin(handle, 8);
-    } else {
-        goto next_atom;
+        m4a_info->moov_offset = (uint64_t)(handle->offset - header_size);
+        m4a_info->moov_tail = mdat_found;
+        OS_LOGV(TAG, "moov %s of mdat: moov_offset=%llu",
+                mdat_found ? "behind" : "ahead", (unsigned long long)m4a_info->moov_offset);
+        long long moov_start = handle->offset;
+        AAC_ERR_T err = moovin(handle, (uint32_t)(atom_size - header_size));
+        if (err == AAC_ERR_NONE && atom_size != 0)
+            m4a_parse_itunsmpb(handle, moov_start, moov_start + (long long)(atom_size - header_size));
+        return err;
     }
 
-    return AAC_ERR_FAIL;
+    if (atom_size < header_size) {
+        OS_LOGE(TAG, "Invalid atom size %llu at offset[%lld]", (unsigned long long)atom_size, handle->offset);
+        return AAC_ERR_FAIL;
+    }
+    goto next_atom;
 }
 
-int m4a_parse_header(ringbuf_handle rb, struct m4a_info *info)
+int m4a_extractor(m4a_fetch_cb fetch_cb, void *fetch_priv, struct m4a_info *info)
 {
-    static struct atom_box moov[] = {
-        {ATOM_NAME, "moov"},
-        {ATOM_DATA, moovin},
-        {0}
-    };
-
-    struct atom_parser parser = {
-        .rb = rb,
-        .offset = 0,
-        .atom = NULL,
-        .m4a_info = info,
-    };
+    atom_parser_handle_t parser = NULL;
     AAC_ERR_T err = AAC_ERR_FAIL;
 
-    if (info->parsed_once) {
-        if (info->moov_tail) {
-            parser.offset = info->moov_offset;
-        } else {
-            OS_LOGE(TAG, "Failed to check moov");
-            goto finish;
-        }
-    } else {
-        err = m4a_check_header(&parser);
-        if (err == AAC_ERR_AGAIN) {
-            OS_LOGV(TAG, "moov behide of mdat, please check again with new offset(%u)", info->moov_offset);
-        }
-        goto finish;
-    }
-
-    /* Start to parse moov header */
-    parser.atom = moov;
-    err = atom_parse(&parser);
-    AUDIO_ERR_CHECK(TAG, err == AAC_ERR_NONE, goto finish);
-
-finish:
+    // Keep the fetch scratch buffer off the caller stack
+    parser = audio_calloc(1, sizeof(struct atom_parser));
+    if (parser == NULL)
+        return AAC_ERR_NOMEM;
+    parser->fetch_cb = fetch_cb;
+    parser->fetch_priv = fetch_priv;
+    parser->offset = 0;
+    parser->m4a_info = info;
+
+    err = m4a_find_moov(parser);
+    if (err == AAC_ERR_NONE)
+        err = m4a_check_sample_table(info);
     if (err == AAC_ERR_NONE) {
         err = m4a_parse_asc(info);
         m4a_dump_info(info);
     }
 
-    rb_done_read(rb);
+    if (err != AAC_ERR_NONE) {
+        m4a_sample_table_destroy(info->sample_table);
+        info->sample_table = NULL;
+    }
+    if (parser->stsc != NULL)
+        audio_free(parser->stsc);
+    audio_free(parser);
     return err;
 }
 
-struct m4a_reader_priv {
-    struct m4a_info *info;
-    ringbuf_handle rb;
-    int ret;
+struct m4a_size_cursor {
+    uint32_t index;     // next sample to decode
+    uint32_t pos;       // its position in table->sizes
+    uint32_t size;      // size of the previous sample
 };
 
-static void *m4a_reader_parse_thread(void *arg)
+static uint32_t m4a_next_sample_size(struct m4a_sample_table *table, struct m4a_size_cursor *cursor)
 {
-    struct m4a_reader_priv *priv = (struct m4a_reader_priv *)arg;
-    priv->ret = m4a_parse_header(priv->rb, priv->info);
-    return NULL;
+    uint32_t zigzag = 0;
+    uint32_t shift = 0;
+    uint8_t byte;
+
+    if (cursor->index % M4A_SAMPLE_BLOCK_SIZE == 0)
+        cursor->size = 0;
+    do {
+        byte = table->sizes[cursor->pos++];
+        zigzag |= (uint32_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while ((byte & 0x80) && cursor->pos < table->sizes_len);
+
+    cursor->size += (uint32_t)((int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1));
+    cursor->index++;
+    return cursor->size;
 }
 
-int m4a_extractor(m4a_fetch_cb fetch_cb, void *fetch_priv, struct m4a_info *info)
+static void m4a_seek_size_cursor(struct m4a_sample_table *table, struct m4a_size_cursor *cursor, uint32_t sample_index)
 {
-    ringbuf_handle rb_atom = NULL;
-    os_thread tid = NULL;
-    char buffer[STREAM_BUFFER_SIZE];
-    int bytes_writen, bytes_read, offset = 0;
-    bool double_check = false;
+    if (sample_index < cursor->index || sample_index - cursor->index >= M4A_SAMPLE_BLOCK_SIZE) {
+        uint32_t block = sample_index/M4A_SAMPLE_BLOCK_SIZE;
+        cursor->index = block*M4A_SAMPLE_BLOCK_SIZE;
+        cursor->pos = table->size_block[block];
+        cursor->size = 0;
+    }
+    while (cursor->index < sample_index)
+        m4a_next_sample_size(table, cursor);
+}
 
-    rb_atom = rb_create(STREAM_BUFFER_SIZE);
-    if (rb_atom == NULL)
-        return AAC_ERR_FAIL;
+int m4a_get_sample_size(struct m4a_info *info, uint32_t sample_index)
+{
+    struct m4a_sample_table *table = info->sample_table;
+    if (table == NULL || sample_index >= table->sample_count)
+        return -1;
+    if (table->constant_size != 0)
+        return (int)table->constant_size;
 
-    struct m4a_reader_priv priv = {
-        .info = info,
-        .rb = rb_atom,
-        .ret = AAC_ERR_FAIL,
+    struct m4a_size_cursor cursor = {
+        .index = table->cursor_index,
+        .pos = table->cursor_pos,
+        .size = table->cursor_size,
     };
+    m4a_seek_size_cursor(table, &cursor, sample_index);
+    int size = (int)m4a_next_sample_size(table, &cursor);
+    table->cursor_index = cursor.index;
+    table->cursor_pos = cursor.pos;
+    table->cursor_size = cursor.size;
+    return size;
+}
 
-    struct os_thread_attr tattr = {
-        .name = "ael-m4a_extractor",
-        .priority = M4A_PARSER_TASK_PRIO,
-        .stacksize = M4A_PARSER_TASK_STACK,
-        .joinable = true,
-    };
+int m4a_get_seek_offset(int seek_ms, struct m4a_info *info, uint32_t *sample_index, uint64_t *sample_offset)
+{
+    if (seek_ms < 0 || info == NULL || sample_index == NULL || sample_offset == NULL)
+        return -1;
 
-m4a_parse:
-    tid = os_thread_create(&tattr, m4a_reader_parse_thread, &priv);
-    if (tid == NULL) {
-        OS_LOGE(TAG, "Failed to create task to parse m4a");
-        goto m4a_finish;
+    struct m4a_sample_table *table = info->sample_table;
+    if (table == NULL || table->stts_entries == 0 || table->chunk_count == 0 || table->sample_count == 0) {
+        OS_LOGE(TAG, "Failed to find seek offset, no sample table");
+        return -1;
     }
 
-    do {
-        bytes_read = fetch_cb(buffer, sizeof(buffer), offset, fetch_priv);
-        if (bytes_read <= 0)
-            break;
-
-        offset += bytes_read;
-        bytes_writen = 0;
+    // time -> sample, binary search the cumulative stts
+    uint64_t time = (uint64_t)seek_ms*info->time_scale/1000;
+    uint32_t lo = 0, hi = table->stts_entries - 1;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi + 1)/2;
+        if (table->stts[mid].sample_time <= time)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    struct time2sample *stts = &table->stts[lo];
+    uint64_t sample = stts->sample_index;
+    if (stts->sample_duration > 0)
+        sample += (time - stts->sample_time)/stts->sample_duration;
+    if (sample >= table->sample_count) {
+        OS_LOGE(TAG, "Failed to find seek offset, sample %llu out of range", (unsigned long long)sample);
+        return -1;
+    }
 
-        do {
-            bytes_writen = rb_write(rb_atom, &buffer[bytes_writen], bytes_read, AUDIO_MAX_DELAY);
-            if (bytes_writen > 0) {
-                bytes_read -= bytes_writen;
-            } else {
-                if (bytes_writen == RB_DONE) {
-                    OS_LOGV(TAG, "RB done write");
-                } else if(bytes_writen == RB_ABORT) {
-                    OS_LOGV(TAG, "RB abort write");
-                } else {
-                    OS_LOGW(TAG, "RB write fail, ret=%d", bytes_writen);
-                }
-                goto m4a_writen;
-            }
-        } while(bytes_read > 0);
-    } while (1);
-
-m4a_writen:
-    rb_done_write(rb_atom);
-    os_thread_join(tid, NULL);
-
-    if (!double_check) {
-        double_check = true;
-        if (priv.ret == AAC_ERR_AGAIN && info->parsed_once && info->moov_tail) {
-            rb_reset(rb_atom);
-            offset = info->moov_offset;
-            goto m4a_parse;
-        }
+    // sample -> chunk, binary search the chunk table
+    lo = 0;
+    hi = table->chunk_count - 1;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi + 1)/2;
+        if (table->chunk_sample[mid] <= sample)
+            lo = mid;
+        else
+            hi = mid - 1;
     }
 
-m4a_finish:
-    if (priv.ret != AAC_ERR_NONE) {
-        if (info->stsz_samplesize != NULL) {
-            audio_free(info->stsz_samplesize);
-            info->stsz_samplesize = NULL;
-        }
-        if (info->stts_time2sample != NULL) {
-            audio_free(info->stts_time2sample);
-            info->stts_time2sample = NULL;
-        }
-        if (info->stsc_sample2chunk != NULL) {
-            audio_free(info->stsc_sample2chunk);
-            info->stsc_sample2chunk = NULL;
-        }
-        if (info->stco_chunk2offset != NULL) {
-            audio_free(info->stco_chunk2offset);
-            info->stco_chunk2offset = NULL;
-        }
+    // chunk -> offset, add sizes of the samples ahead in this chunk
+    uint64_t offset = table->chunk_offset[lo];
+    uint32_t first = table->chunk_sample[lo];
+    if (table->constant_size != 0) {
+        offset += (uint64_t)(sample - first)*table->constant_size;
+    } else {
+        struct m4a_size_cursor cursor = {0};
+        m4a_seek_size_cursor(table, &cursor, first);
+        while (cursor.index < sample)
+            offset += m4a_next_sample_size(table, &cursor);
     }
-    rb_destroy(rb_atom);
-    return priv.ret;
+
+    OS_LOGD(TAG, "Found seek index/offset: %u/%llu", (uint32_t)sample, (unsigned long long)offset);
+    *sample_index = (uint32_t)sample;
+    *sample_offset = offset;
+    return 0;
 }
 
-int m4a_get_seek_offset(int seek_ms, struct m4a_info *info, uint32_t *sample_index, uint32_t *sample_offset)
+struct m4a_sample_table *m4a_sample_table_dup(struct m4a_sample_table *table)
 {
-    if (seek_ms < 0 || info == NULL || sample_index == NULL || sample_offset == NULL)
-        return -1;
-
-    bool seek_done = false;
-    uint32_t seek_offset = 0;
-    uint32_t seek_index = 0;
-    uint32_t samples = (seek_ms*(info->time_scale/1000))/info->stts_time2sample[0].sample_duration;
-
-    for (int32_t cnt = 0; cnt < info->stco_chunk2offset_entries-1; cnt++) {
-        if (samples >= info->stco_chunk2offset[cnt].sample_index &&
-            samples <  info->stco_chunk2offset[cnt+1].sample_index) {
-            seek_offset = info->stco_chunk2offset[cnt].chunk_offset;
-            seek_index = info->stco_chunk2offset[cnt].sample_index;
-            seek_done = true;
-            OS_LOGD(TAG, "Found seek index/offset: %u/%u", seek_index, seek_offset);
-            break;
-        }
+    if (table == NULL)
+        return NULL;
+
+    struct m4a_sample_table *dup = audio_calloc(1, sizeof(struct m4a_sample_table));
+    if (dup == NULL)
+        return NULL;
+    dup->sample_count = table->sample_count;
+    dup->constant_size = table->constant_size;
+    dup->sizes_len = table->sizes_len;
+    dup->chunk_count = table->chunk_count;
+    dup->stts_entries = table->stts_entries;
+
+    if (table->sizes != NULL) {
+        dup->sizes = audio_malloc(table->sizes_len > 0 ? table->sizes_len : 1);
+        dup->size_block = audio_calloc(table->sample_count/M4A_SAMPLE_BLOCK_SIZE + 1, sizeof(uint32_t));
+        if (dup->sizes == NULL || dup->size_block == NULL)
+            goto dup_fail;
+        memcpy(dup->sizes, table->sizes, table->sizes_len);
+        memcpy(dup->size_block, table->size_block,
+               (table->sample_count/M4A_SAMPLE_BLOCK_SIZE + 1)*sizeof(uint32_t));
     }
-
-    if (!seek_done || seek_offset < info->stco_chunk2offset[0].chunk_offset) {
-        OS_LOGE(TAG, "Failed to find seek offset");
-        return -1;
+    if (table->chunk_count > 0) {
+        dup->chunk_sample = audio_calloc(table->chunk_count, sizeof(uint32_t));
+        dup->chunk_offset = audio_calloc(table->chunk_count, sizeof(uint64_t));
+        if (dup->chunk_sample == NULL || dup->chunk_offset == NULL)
+            goto dup_fail;
+        memcpy(dup->chunk_sample, table->chunk_sample, table->chunk_count*sizeof(uint32_t));
+        memcpy(dup->chunk_offset, table->chunk_offset, table->chunk_count*sizeof(uint64_t));
+    }
+    if (table->stts_entries > 0) {
+        dup->stts = audio_calloc(table->stts_entries, sizeof(struct time2sample));
+        if (dup->stts == NULL)
+            goto dup_fail;
+        memcpy(dup->stts, table->stts, table->stts_entries*sizeof(struct time2sample));
     }
+    return dup;
 
-    *sample_index = seek_index;
-    *sample_offset = seek_offset;
-    return 0;
+dup_fail:
+    m4a_sample_table_destroy(dup);
+    return NULL;
+}
+
+void m4a_sample_table_destroy(struct m4a_sample_table *table)
+{
+    if (table == NULL)
+        return;
+    if (table->sizes != NULL)
+        audio_free(table->sizes);
+    if (table->size_block != NULL)
+        audio_free(table->size_block);
+    if (table->chunk_sample != NULL)
+        audio_free(table->chunk_sample);
+    if (table->chunk_offset != NULL)
+        audio_free(table->chunk_offset);
+    if (table->stts != NULL)
+        audio_free(table->stts);
+    audio_free(table);
 }
 
 int m4a_build_adts_header(uint8_t *adts_buf, uint32_t adts_size, uint8_t *asc_buf, uint32_t asc_size, uint32_t frame_size)
@@ -17,29 +17,50 @@
 
 #include <stdint.h>
 #include <stdbool.h>
-#include "cutils/ringbuf.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 // Return the data size obtained
-typedef int (*m4a_fetch_cb)(char *buf, int wanted_size, long offset, void *fetch_priv);
+typedef int (*m4a_fetch_cb)(char *buf, int wanted_size, long long offset, void *fetch_priv);
 
+#define M4A_SAMPLE_BLOCK_SIZE   (64)
+
+// stts entry with the running sample index and timestamp, for binary search
 struct time2sample {
-    uint32_t sample_count;
+    uint32_t sample_index;      // first sample of this entry
     uint32_t sample_duration;
+    uint64_t sample_time;       // timestamp of first sample, in time_scale units
 };
 
-struct sample2chunk {
-    uint32_t first_chunk;
-    uint32_t samples_per_chunk;
-    uint32_t sample_description_index;
-};
-
-struct chunk2offset {
-    uint32_t sample_index;
-    uint32_t chunk_offset;
+/*
+ * Packed sample table built from stts/stsz/stsc/stco(co64):
+ *   - sizes are zigzag varint deltas from the previous sample, restarted
+ *     every M4A_SAMPLE_BLOCK_SIZE samples so any sample is reachable by
+ *     decoding at most one block;
+ *   - chunks keep only their first sample and file offset, the offset of a
+ *     sample is its chunk offset plus the sizes before it in the chunk.
+ * Typical AAC tracks need a bit more than 1 byte per sample.
+ */
+struct m4a_sample_table {
+    uint32_t    sample_count;
+    uint32_t    constant_size;  // stsz default sample size, no size table if non-zero
+    uint8_t    *sizes;
+    uint32_t    sizes_len;
+    uint32_t   *size_block;     // position in sizes of every M4A_SAMPLE_BLOCK_SIZE samples
+
+    uint32_t    chunk_count;
+    uint32_t   *chunk_sample;   // first sample of each chunk
+    uint64_t   *chunk_offset;
+
+    uint32_t    stts_entries;
+    struct time2sample *stts;
+
+    // sequential read cursor, only used by m4a_get_sample_size
+    uint32_t    cursor_index;
+    uint32_t    cursor_pos;
+    uint32_t    cursor_size;
 };
 
 struct audio_specific_config {
@@ -47,6 +68,7 @@ struct audio_specific_config {
     uint8_t size;
     uint32_t samplerate;
     uint32_t channels;
+    uint8_t object_type;
 };
 
 struct m4a_info {
@@ -58,37 +80,37 @@ struct m4a_info {
     uint32_t    time_scale;
     uint32_t    duration;
 
-    // stsz box: samplesize table
+    // stsz box: samplesize entries, and index of the next sample to decode
     uint32_t    stsz_samplesize_entries;
     uint32_t    stsz_samplesize_index;
-    uint16_t   *stsz_samplesize; // need to free when resetting player
     uint32_t    stsz_samplesize_max;
 
-    // stts box: time2sample table
-    uint32_t    stts_time2sample_entries;
-    struct time2sample *stts_time2sample;
-
-    // stsc box: sample2chunk table
-    uint32_t    stsc_sample2chunk_entries;
-    struct sample2chunk *stsc_sample2chunk;
-
-    // stco box: chunk2offset table
-    uint32_t    stco_chunk2offset_entries;
-    struct chunk2offset *stco_chunk2offset;
+    // sample table, need to free when resetting player
+    struct m4a_sample_table *sample_table;
 
     // Audio Specific Config data:
     struct audio_specific_config asc;
 
-    bool        parsed_once;
+    // iTunSMPB gapless info, in time_scale units, valid_samples is 0 if unknown
+    uint32_t    priming_samples;
+    uint32_t    padding_samples;
+    uint64_t    valid_samples;
+
     bool        moov_tail;
-    uint32_t    moov_offset;
-    uint32_t    mdat_size;
-    uint32_t    mdat_offset;
+    uint64_t    moov_offset;
+    uint64_t    mdat_size;
+    uint64_t    mdat_offset;
 };
 
-int m4a_parse_header(ringbuf_handle rb, struct m4a_info *info);
+int m4a_get_seek_offset(int seek_ms, struct m4a_info *info, uint32_t *sample_index, uint64_t *sample_offset);
+
+// Return size of sample, or -1 if out of range. Sequential access is O(1).
+int m4a_get_sample_size(struct m4a_info *info, uint32_t sample_index);
+
+// Deep copy, the read cursor of the copy starts from the first sample
+struct m4a_sample_table *m4a_sample_table_dup(struct m4a_sample_table *table);
 
-int m4a_get_seek_offset(int seek_ms, struct m4a_info *info, uint32_t *sample_index, uint32_t *sample_offset);
+void m4a_sample_table_destroy(struct m4a_sample_table *table);
 
 int m4a_extractor(m4a_fetch_cb fetch_cb, void *fetch_priv, struct m4a_info *info);
 
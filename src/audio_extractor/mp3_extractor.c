@@ -24,6 +24,18 @@
 
 #define DEFAULT_MP3_PARSER_BUFFER_SIZE 2048
 
+#define MP3_XING_FLAG_FRAMES    0x0001
+#define MP3_XING_FLAG_BYTES     0x0002
+#define MP3_XING_FLAG_TOC       0x0004
+#define MP3_XING_FLAG_QUALITY   0x0008
+// LAME extension follows the Xing fields, delay/padding are 12 bits each
+#define MP3_LAME_DELAY_OFFSET   21
+#define MP3_LAME_TAG_SIZE       36
+// Delay of the synthesis filterbank, the decoder output lags the input by this
+#define MP3_DECODER_DELAY       529
+#define MP3_VBRI_OFFSET         (4 + 32)
+#define MP3_VBRI_HEADER_SIZE    26
+
 int mp3_find_syncword(char *buf, int size)
 {
     if (size < 2)
@@ -119,6 +131,12 @@ check_next_frame:
     info->sample_rate = sample_rate;
     info->bit_rate = bit_rate;
     info->frame_size = frame_size;
+    if (layer == 3)
+        info->frame_samples = 384;
+    else if (layer == 1 && ver != 3)
+        info->frame_samples = 576;
+    else
+        info->frame_samples = 1152;
 
     OS_LOGD(TAG, "channels=%d, sample_rate=%d, bit_rate=%d, frame_size=%d",
              info->channels, info->sample_rate, info->bit_rate, info->frame_size);
@@ -135,6 +153,113 @@ success:
     return 0;
 }
 
+static unsigned int mp3_read_be(const char *buf, int bytes)
+{
+    unsigned int val = 0;
+    for (int i = 0; i < bytes; i++)
+        val = (val << 8) | (buf[i] & 0xFF);
+    return val;
+}
+
+static int mp3_parse_xing(char *buf, int size, struct mp3_info *info)
+{
+    unsigned char ver = (buf[1] >> 3) & 0x03;
+    unsigned char sMode = (buf[3] >> 6) & 0x03;
+    int pos = 4;
+
+    // Xing/Info tag follows the side information of the first frame
+    if (ver == 3 /* V1 */)
+        pos += (sMode == 0x03) ? 17 : 32;
+    else
+        pos += (sMode == 0x03) ? 9 : 17;
+
+    if (pos + 8 > size)
+        return -1;
+    if (strncmp(&buf[pos], "Xing", 4) != 0 && strncmp(&buf[pos], "Info", 4) != 0)
+        return -1;
+
+    unsigned int flags = mp3_read_be(&buf[pos+4], 4);
+    pos += 8;
+    if (flags & MP3_XING_FLAG_FRAMES) {
+        if (pos + 4 > size)
+            return -1;
+        info->total_frames = (int)mp3_read_be(&buf[pos], 4);
+        pos += 4;
+    }
+    if (flags & MP3_XING_FLAG_BYTES) {
+        if (pos + 4 > size)
+            return -1;
+        info->total_bytes = (int)mp3_read_be(&buf[pos], 4);
+        pos += 4;
+    }
+    if (flags & MP3_XING_FLAG_TOC) {
+        if (pos + MP3_TOC_ENTRIES <= size) {
+            memcpy(info->toc, &buf[pos], MP3_TOC_ENTRIES);
+            info->has_toc = true;
+        }
+        pos += MP3_TOC_ENTRIES;
+    }
+    if (flags & MP3_XING_FLAG_QUALITY)
+        pos += 4;
+
+    if (pos + MP3_LAME_TAG_SIZE <= size &&
+        (strncmp(&buf[pos], "LAME", 4) == 0 || strncmp(&buf[pos], "Lavc", 4) == 0 ||
+         strncmp(&buf[pos], "Lavf", 4) == 0)) {
+        unsigned int val = mp3_read_be(&buf[pos + MP3_LAME_DELAY_OFFSET], 3);
+        info->encoder_delay = (int)(val >> 12);
+        info->encoder_padding = (int)(val & 0xFFF);
+        info->has_lame_tag = true;
+    }
+
+    OS_LOGD(TAG, "Found Xing/Info header: frames=%d, bytes=%d, toc=%d, delay=%d, padding=%d",
+            info->total_frames, info->total_bytes, info->has_toc, info->encoder_delay, info->encoder_padding);
+    return 0;
+}
+
+static int mp3_parse_vbri(char *buf, int size, struct mp3_info *info)
+{
+    char *vbri = &buf[MP3_VBRI_OFFSET];
+
+    if (MP3_VBRI_OFFSET + MP3_VBRI_HEADER_SIZE > size || strncmp(vbri, "VBRI", 4) != 0)
+        return -1;
+
+    int bytes = (int)mp3_read_be(&vbri[10], 4);
+    int frames = (int)mp3_read_be(&vbri[14], 4);
+    int entries = (int)mp3_read_be(&vbri[18], 2);
+    int scale = (int)mp3_read_be(&vbri[20], 2);
+    int entry_size = (int)mp3_read_be(&vbri[22], 2);
+    int entry_frames = (int)mp3_read_be(&vbri[24], 2);
+    char *table = &vbri[MP3_VBRI_HEADER_SIZE];
+
+    info->total_frames = frames;
+    info->total_bytes = bytes;
+    OS_LOGD(TAG, "Found VBRI header: frames=%d, bytes=%d, entries=%d", frames, bytes, entries);
+
+    if (entries <= 0 || entry_size < 1 || entry_size > 4 || entry_frames <= 0 || frames <= 0 || bytes <= 0 ||
+        MP3_VBRI_OFFSET + MP3_VBRI_HEADER_SIZE + entries*entry_size > size)
+        return 0;
+
+    // Convert the per-segment sizes to a Xing style TOC, so seeking has only one TOC to deal with
+    long long seg_start = 0;
+    int seg = 0;
+    for (int i = 0; i < MP3_TOC_ENTRIES; i++) {
+        long long frame = (long long)i*frames/MP3_TOC_ENTRIES;
+        while (seg < entries - 1 && frame >= (long long)(seg + 1)*entry_frames) {
+            seg_start += (long long)mp3_read_be(&table[seg*entry_size], entry_size)*scale;
+            seg++;
+        }
+        long long seg_bytes = (long long)mp3_read_be(&table[seg*entry_size], entry_size)*scale;
+        long long in_seg = frame - (long long)seg*entry_frames;
+        if (in_seg > entry_frames)
+            in_seg = entry_frames;
+        long long pos = seg_start + seg_bytes*in_seg/entry_frames;
+        long long val = pos*256/bytes;
+        info->toc[i] = (unsigned char)(val > 255 ? 255 : val);
+    }
+    info->has_toc = true;
+    return 0;
+}
+
 static void mp3_dump_info(struct mp3_info *info)
 {
     OS_LOGD(TAG, "MP3 INFO:");
@@ -143,6 +268,10 @@ static void mp3_dump_info(struct mp3_info *info)
     OS_LOGD(TAG, "  >bit_rate          : %d", info->bit_rate);
     OS_LOGD(TAG, "  >frame_size        : %d", info->frame_size);
     OS_LOGD(TAG, "  >frame_start_offset: %d", info->frame_start_offset);
+    OS_LOGD(TAG, "  >total_frames      : %d", info->total_frames);
+    OS_LOGD(TAG, "  >total_bytes       : %d", info->total_bytes);
+    OS_LOGD(TAG, "  >has_toc           : %d", info->has_toc);
+    OS_LOGD(TAG, "  >encoder delay/pad : %d/%d", info->encoder_delay, info->encoder_padding);
 }
 
 int mp3_extractor(mp3_fetch_cb fetch_cb, void *fetch_priv, struct mp3_info *info)
@@ -154,6 +283,7 @@ int mp3_extractor(mp3_fetch_cb fetch_cb, void *fetch_priv, struct mp3_info *info
     int buf_size = sizeof(buf);
     int last_position = 0;
     int sync_offset = 0;
+    char *frame = NULL;
 
     buf_size = fetch_cb(buf, buf_size, 0, fetch_priv);
     if (buf_size < 4) {
@@ -176,6 +306,7 @@ int mp3_extractor(mp3_fetch_cb fetch_cb, void *fetch_priv, struct mp3_info *info
         int remain_size = buf_size - frame_start_offset;
         int ret = mp3_parse_header(&buf[frame_start_offset], remain_size, info);
         if (ret == 0) {
+            frame = &buf[frame_start_offset];
             found = true;
             goto finish;
         }
@@ -202,6 +333,7 @@ find_syncword:
         last_position += sync_offset;
         int ret = mp3_parse_header(&buf[last_position], buf_size - last_position, info);
         if (ret == 0) {
+            frame = &buf[last_position];
             found = true;
             goto finish;
         } else {
@@ -217,7 +349,158 @@ find_syncword:
 finish:
     if (found) {
         info->frame_start_offset = frame_start_offset + last_position;
+        info->total_frames = 0;
+        info->total_bytes = 0;
+        info->has_toc = false;
+        info->has_lame_tag = false;
+        info->encoder_delay = 0;
+        info->encoder_padding = 0;
+        info->tag_frame_size = 0;
+
+        // Xing/Info/VBRI header lives in the first frame
+        int frame_avail = buf_size - (int)(frame - buf);
+        if (frame_avail < info->frame_size) {
+            frame = buf;
+            frame_avail = fetch_cb(buf, sizeof(buf), info->frame_start_offset, fetch_priv);
+        }
+        if (frame_avail >= 4 &&
+            (mp3_parse_xing(frame, frame_avail, info) == 0 || mp3_parse_vbri(frame, frame_avail, info) == 0))
+            info->tag_frame_size = info->frame_size;
+
+        info->frame_index = mp3_frame_index_create(info->tag_frame_size);
+        if (info->frame_index == NULL)
+            OS_LOGW(TAG, "Failed to create frame index, seeking will be less accurate");
         mp3_dump_info(info);
     }
     return found ? 0 : -1;
 }
+
+int mp3_get_duration(struct mp3_info *info)
+{
+    if (info == NULL || info->total_frames <= 0 || info->sample_rate <= 0)
+        return -1;
+    return (int)((long long)info->total_frames*info->frame_samples*1000/info->sample_rate);
+}
+
+int mp3_get_gapless_info(struct mp3_info *info, int *priming_samples, long long *valid_samples)
+{
+    if (info == NULL || !info->has_lame_tag || info->total_frames <= 0)
+        return -1;
+
+    long long valid = (long long)info->total_frames*info->frame_samples -
+            info->encoder_delay - info->encoder_padding;
+    if (valid <= 0)
+        return -1;
+
+    // The Xing/Info frame itself is decoded as a frame of silence
+    *priming_samples = info->frame_samples + info->encoder_delay + MP3_DECODER_DELAY;
+    *valid_samples = valid;
+    return 0;
+}
+
+static int mp3_frame_index_lookup(struct mp3_frame_index *index, int frame, long *offset)
+{
+    int ret = -1;
+
+    os_mutex_lock(index->lock);
+    if (frame < index->frames && index->count > 0) {
+        int k = frame/index->interval;
+        long f0 = (long)k*index->interval, f1;
+        long o0 = index->offsets[k], o1;
+        if (k + 1 < index->count) {
+            f1 = f0 + index->interval;
+            o1 = index->offsets[k+1];
+        } else {
+            f1 = index->frames;
+            o1 = index->end_offset;
+        }
+        // Exact when interval is 1, otherwise interpolate between the two nearest frames
+        *offset = o0 + (long)((long long)(o1 - o0)*(frame - f0)/(f1 - f0));
+        ret = 0;
+    }
+    os_mutex_unlock(index->lock);
+    return ret;
+}
+
+int mp3_get_seek_offset(int seek_ms, struct mp3_info *info, long stream_bytes, long *offset)
+{
+    if (seek_ms < 0 || info == NULL || offset == NULL || info->sample_rate <= 0 || info->frame_samples <= 0)
+        return -1;
+
+    long long bytes = info->total_bytes > 0 ? info->total_bytes : stream_bytes;
+    int duration = mp3_get_duration(info);
+    int frame = (int)((long long)seek_ms*info->sample_rate/1000/info->frame_samples);
+
+    if (info->frame_index != NULL && mp3_frame_index_lookup(info->frame_index, frame, offset) == 0) {
+        OS_LOGD(TAG, "Seek by frame index: frame=%d, offset=%ld", frame, *offset);
+        return 0;
+    }
+
+    if (info->has_toc && duration > 0 && bytes > 0) {
+        int a = (int)((long long)seek_ms*MP3_TOC_ENTRIES/duration);
+        if (a > MP3_TOC_ENTRIES - 1)
+            a = MP3_TOC_ENTRIES - 1;
+        int rem = (int)((long long)seek_ms*MP3_TOC_ENTRIES - (long long)a*duration);
+        int fa = info->toc[a];
+        int fb = (a < MP3_TOC_ENTRIES - 1) ? info->toc[a+1] : 256;
+        long long fx = (long long)fa*1000 + (long long)(fb - fa)*rem*1000/duration;
+        *offset = (long)(bytes*fx/(256*1000));
+        OS_LOGD(TAG, "Seek by toc: percent=%d, offset=%ld", a, *offset);
+        return 0;
+    }
+
+    if (duration > 0 && bytes > 0) {
+        *offset = (long)(bytes*seek_ms/duration);
+        return 0;
+    }
+
+    *offset = (long)((long long)info->bit_rate*seek_ms/8);
+    return 0;
+}
+
+struct mp3_frame_index *mp3_frame_index_create(int skip_bytes)
+{
+    struct mp3_frame_index *index = audio_calloc(1, sizeof(struct mp3_frame_index));
+    if (index == NULL)
+        return NULL;
+    index->lock = os_mutex_create();
+    if (index->lock == NULL) {
+        audio_free(index);
+        return NULL;
+    }
+    index->interval = 1;
+    // Appending starts at the first audio frame, so frame n of the index is audio frame n
+    index->end_offset = skip_bytes;
+    return index;
+}
+
+void mp3_frame_index_destroy(struct mp3_frame_index *index)
+{
+    if (index == NULL)
+        return;
+    os_mutex_destroy(index->lock);
+    audio_free(index);
+}
+
+void mp3_frame_index_append(struct mp3_frame_index *index, long offset, int frame_size)
+{
+    // Only the decoder appends, so end_offset is stable here without lock.
+    // Frames that don't continue the indexed range (e.g. after seeking
+    // forward past it) are ignored until decoding catches up again.
+    if (index == NULL || offset != index->end_offset || frame_size <= 0)
+        return;
+
+    os_mutex_lock(index->lock);
+    if (index->frames == index->count*index->interval) {
+        if (index->count == MP3_FRAME_INDEX_ENTRIES) {
+            for (int i = 0; i < MP3_FRAME_INDEX_ENTRIES/2; i++)
+                index->offsets[i] = index->offsets[2*i];
+            index->count = MP3_FRAME_INDEX_ENTRIES/2;
+            index->interval *= 2;
+        }
+        index->offsets[index->count++] = (unsigned int)offset;
+    }
+    index->frames++;
+    index->end_offset += frame_size;
+    os_mutex_unlock(index->lock);
+}
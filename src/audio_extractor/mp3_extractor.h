@@ -15,12 +15,18 @@
 #ifndef _MP3_EXTRACTOR_H_
 #define _MP3_EXTRACTOR_H_
 
+#include <stdbool.h>
+#include "osal/os_thread.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define MP3_TOC_ENTRIES            (100)
+#define MP3_FRAME_INDEX_ENTRIES    (1024)
+
 // Return the data size obtained
-typedef int (*mp3_fetch_cb)(char *buf, int wanted_size, long offset, void *fetch_priv);
+typedef int (*mp3_fetch_cb)(char *buf, int wanted_size, long long offset, void *fetch_priv);
 
 struct mp3_info {
     int channels;
@@ -28,6 +34,31 @@ struct mp3_info {
     int bit_rate;
     int frame_size;
     int frame_start_offset;
+    int frame_samples;          // pcm samples per channel in one frame
+    int total_frames;           // from Xing/Info/VBRI header, 0 if unknown
+    int total_bytes;            // from Xing/Info/VBRI header, 0 if unknown
+    bool has_toc;
+    unsigned char toc[MP3_TOC_ENTRIES]; // Xing style: toc[i]/256 is the byte fraction at i% of duration
+    bool has_lame_tag;
+    int encoder_delay;          // from LAME tag, samples added ahead of the audio by encoder
+    int encoder_padding;        // from LAME tag, samples appended to fill the last frame
+    int tag_frame_size;         // Xing/Info/VBRI frame ahead of the audio frames, 0 if none
+    struct mp3_frame_index *frame_index;
+};
+
+/*
+ * Frame offsets recorded while decoding, used by seeking when the stream has
+ * no TOC. Offsets are relative to the first frame, one entry every `interval`
+ * frames. When the table is full, every other entry is dropped and interval
+ * is doubled, so memory stays bounded for arbitrarily long streams.
+ */
+struct mp3_frame_index {
+    os_mutex lock;
+    int frames;                 // number of contiguous frames indexed from the first audio frame
+    long end_offset;            // offset of frame `frames`
+    int interval;
+    int count;
+    unsigned int offsets[MP3_FRAME_INDEX_ENTRIES];
 };
 
 int mp3_find_syncword(char *buf, int size);
@@ -36,6 +67,24 @@ int mp3_parse_header(char *buf, int buf_size, struct mp3_info *info);
 
 int mp3_extractor(mp3_fetch_cb fetch_cb, void *fetch_priv, struct mp3_info *info);
 
+// Duration from Xing/Info/VBRI header, -1 if unknown
+int mp3_get_duration(struct mp3_info *info);
+
+// Gapless info from LAME tag, in decoder output samples: samples to drop at
+// start, and samples to keep after them. Return -1 if unknown.
+int mp3_get_gapless_info(struct mp3_info *info, int *priming_samples, long long *valid_samples);
+
+// stream_bytes: bytes from the first frame to the end of stream, <= 0 if unknown
+int mp3_get_seek_offset(int seek_ms, struct mp3_info *info, long stream_bytes, long *offset);
+
+// skip_bytes: size of the Xing/Info/VBRI frame, it carries no audio and isn't indexed
+struct mp3_frame_index *mp3_frame_index_create(int skip_bytes);
+
+void mp3_frame_index_destroy(struct mp3_frame_index *index);
+
+// Called by decoder for each frame read, offset is relative to the first frame
+void mp3_frame_index_append(struct mp3_frame_index *index, long offset, int frame_size);
+
 #ifdef __cplusplus
 }
 #endif
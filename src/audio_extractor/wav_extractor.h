@@ -111,7 +111,7 @@ enum wav_format {
 #define WAV_MAX_CHANNEL_COUNT 8
 
 // Return the data size obtained
-typedef int (*wav_fetch_cb)(char *buf, int wanted_size, long offset, void *fetch_priv);
+typedef int (*wav_fetch_cb)(char *buf, int wanted_size, long long offset, void *fetch_priv);
 
 int wav_parse_header(char *buf, int buf_size, struct wav_info *info);
 
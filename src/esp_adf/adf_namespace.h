@@ -37,6 +37,7 @@
 #define audio_element_set_uri                       ADF_NAMESPACE(audio_element_set_uri)
 #define audio_element_get_uri                       ADF_NAMESPACE(audio_element_get_uri)
 #define audio_element_run                           ADF_NAMESPACE(audio_element_run)
+#define audio_element_set_workpool                  ADF_NAMESPACE(audio_element_set_workpool)
 #define audio_element_terminate                     ADF_NAMESPACE(audio_element_terminate)
 #define audio_element_stop                          ADF_NAMESPACE(audio_element_stop)
 #define audio_element_wait_for_stop_ms              ADF_NAMESPACE(audio_element_wait_for_stop_ms)
@@ -51,6 +52,7 @@
 #define audio_element_set_output_ringbuf            ADF_NAMESPACE(audio_element_set_output_ringbuf)
 #define audio_element_get_output_ringbuf            ADF_NAMESPACE(audio_element_get_output_ringbuf)
 #define audio_element_get_state                     ADF_NAMESPACE(audio_element_get_state)
+#define audio_element_is_finishing                  ADF_NAMESPACE(audio_element_is_finishing)
 #define audio_element_abort_input_ringbuf           ADF_NAMESPACE(audio_element_abort_input_ringbuf)
 #define audio_element_abort_output_ringbuf          ADF_NAMESPACE(audio_element_abort_output_ringbuf)
 #define audio_element_wait_for_buffer               ADF_NAMESPACE(audio_element_wait_for_buffer)
@@ -67,6 +69,9 @@
 #define audio_element_output                        ADF_NAMESPACE(audio_element_output)
 #define audio_element_input_chunk                   ADF_NAMESPACE(audio_element_input_chunk)
 #define audio_element_output_chunk                  ADF_NAMESPACE(audio_element_output_chunk)
+#define audio_element_input_peekable                ADF_NAMESPACE(audio_element_input_peekable)
+#define audio_element_input_peek                    ADF_NAMESPACE(audio_element_input_peek)
+#define audio_element_input_consume                 ADF_NAMESPACE(audio_element_input_consume)
 #define audio_element_set_read_cb                   ADF_NAMESPACE(audio_element_set_read_cb)
 #define audio_element_set_write_cb                  ADF_NAMESPACE(audio_element_set_write_cb)
 #define audio_element_get_event_queue               ADF_NAMESPACE(audio_element_get_event_queue)
@@ -88,6 +93,7 @@
 #define audio_event_iface_remove_listener           ADF_NAMESPACE(audio_event_iface_remove_listener)
 #define audio_event_iface_set_cmd_waiting_timeout   ADF_NAMESPACE(audio_event_iface_set_cmd_waiting_timeout)
 #define audio_event_iface_waiting_cmd_msg           ADF_NAMESPACE(audio_event_iface_waiting_cmd_msg)
+#define audio_event_iface_poll_cmd_msg              ADF_NAMESPACE(audio_event_iface_poll_cmd_msg)
 #define audio_event_iface_cmd                       ADF_NAMESPACE(audio_event_iface_cmd)
 #define audio_event_iface_sendout                   ADF_NAMESPACE(audio_event_iface_sendout)
 #define audio_event_iface_discard                   ADF_NAMESPACE(audio_event_iface_discard)
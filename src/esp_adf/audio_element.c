@@ -28,6 +28,7 @@
 #include <stdbool.h>
 #include <string.h>
 
+#include "osal/os_time.h"
 #include "cutils/log_helper.h"
 #include "esp_adf/queue.h"
 #include "esp_adf/audio_event_iface.h"
@@ -38,6 +39,9 @@
 
 #define DEFAULT_WAIT_TIMEOUT_MS (3000) // ms
 
+#define DEFAULT_JOB_POLL_USEC        (10*1000)  // recheck of a starved input in workpool mode
+#define DEFAULT_JOB_INPUT_READY_SIZE (4*1024)   // input needed to run a process step in workpool mode
+
 /**
  *  Audio Callback Abstract
  */
@@ -89,6 +93,9 @@ struct audio_element {
     events_type_t               events_type;
     audio_event_iface_handle_t  iface_event;
     audio_callback_t            callback_event;
+    process_stats_func          process_stats_cb;
+    void                        *process_stats_ctx;
+    unsigned long long          process_io_usec; // time blocked in input/output of current process
 
     int                         buf_size;
     char                        *buf;
@@ -106,6 +113,7 @@ struct audio_element {
     os_mutex                    state_lock;
     int                         state_event;
     bool                        buffer_reach_level;
+    bool                        input_buffering;
     int                         input_timeout_ms;
     int                         output_timeout_ms;
     int                         out_buf_size_expect;
@@ -113,8 +121,14 @@ struct audio_element {
     bool                        is_running;
     bool                        task_run;
     bool                        stopping;
+    bool                        finishing;
     long long                   offset;
 #define SEEK_COMPLETED          (-1)
+
+    /* Workpool mode */
+    workpool_handle             workpool;
+    workpool_job_handle         job;
+    unsigned long long          job_starved_usec; // since input starved, 0 if not
 };
 
 const static int TASK_CREATED_BIT       = (1 << 0);
@@ -159,7 +173,15 @@ static esp_err_t audio_element_cmd_send(audio_element_handle_t el, audio_element
         .cmd = cmd,
     };
     OS_LOGV(TAG, "[%s]evt internal cmd = %d", el->tag, msg.cmd);
-    return audio_event_iface_cmd(el->iface_event, &msg);
+    esp_err_t ret = audio_event_iface_cmd(el->iface_event, &msg);
+    if (ret == ESP_OK && el->workpool != NULL) {
+        // Job is parked while not running, or waiting for input
+        os_mutex_lock(el->state_lock);
+        if (el->job != NULL)
+            workpool_job_wake(el->job);
+        os_mutex_unlock(el->state_lock);
+    }
+    return ret;
 }
 
 static esp_err_t audio_element_msg_sendout(audio_element_handle_t el, audio_event_iface_msg_t *msg)
@@ -280,7 +302,9 @@ static esp_err_t audio_element_on_cmd(audio_event_iface_msg_t *msg, void *contex
                 || (el->state == AEL_STATE_STOPPED)) {
                 break;
             }
+            el->finishing = true;
             audio_element_process_close(el);
+            el->finishing = false;
             el->state = AEL_STATE_FINISHED;
             audio_event_iface_set_cmd_waiting_timeout(el->iface_event, AUDIO_MAX_DELAY);
             audio_element_report_status(el, AEL_STATUS_STATE_FINISHED);
@@ -359,7 +383,16 @@ static esp_err_t audio_element_process_running(audio_element_handle_t el)
     if (el->state < AEL_STATE_RUNNING || !el->is_running || !el->is_open) {
         return ESP_ERR_INVALID_STATE;
     }
-    process_len = el->process(el, el->buf, el->buf_size);
+    if (el->process_stats_cb != NULL) {
+        unsigned long long begin = os_monotonic_usec();
+        el->process_io_usec = 0;
+        process_len = el->process(el, el->buf, el->buf_size);
+        unsigned long long elapsed = os_monotonic_usec() - begin;
+        elapsed = elapsed > el->process_io_usec ? elapsed - el->process_io_usec : 0;
+        el->process_stats_cb(el, elapsed, process_len, el->process_stats_ctx);
+    } else {
+        process_len = el->process(el, el->buf, el->buf_size);
+    }
     if (process_len <= 0) {
         switch (process_len) {
             case AEL_IO_ABORT:
@@ -399,25 +432,32 @@ static esp_err_t audio_element_process_running(audio_element_handle_t el)
     return ESP_OK;
 }
 
-int audio_element_input(audio_element_handle_t el, char *buffer, int wanted_size)
+// Report AEL_STATUS_INPUT_BUFFERING before blocking on a starved input ringbuf
+static void audio_element_input_wait_begin(audio_element_handle_t el, int wanted_size)
 {
-    int in_len = 0;
-    if (el->read_type == IO_TYPE_CB) {
-        if (el->in.read_cb.read == NULL) {
-            OS_LOGE(TAG, "[%s] Read IO Type callback but callback not set", el->tag);
-            return ESP_FAIL;
-        }
-        in_len = el->in.read_cb.read(el, buffer, wanted_size, el->input_timeout_ms, el->in.read_cb.ctx);
-    } else if (el->read_type == IO_TYPE_RB) {
-        if (el->in.input_rb == NULL) {
-            OS_LOGE(TAG, "[%s] Read IO type ringbuf but ringbuf not set", el->tag);
-            return ESP_FAIL;
-        }
-        in_len = rb_read(el->in.input_rb, buffer, wanted_size, el->input_timeout_ms);
-    } else {
-        OS_LOGE(TAG, "[%s] Invalid read IO type", el->tag);
-        return ESP_FAIL;
+    ringbuf_handle rb = el->in.input_rb;
+    if (el->input_buffering || rb_is_done_write(rb))
+        return;
+    if (rb_bytes_filled(rb) < wanted_size || !rb_reach_threshold(rb)) {
+        el->input_buffering = true;
+        audio_element_report_status(el, AEL_STATUS_INPUT_BUFFERING);
+    }
+}
+
+static void audio_element_input_wait_end(audio_element_handle_t el, int in_len)
+{
+    ringbuf_handle rb = el->in.input_rb;
+    if (!el->input_buffering || in_len == AEL_IO_TIMEOUT)
+        return;
+    // A partial read drained the ring again, keep buffering until the watermark is back
+    if (rb_reach_threshold(rb) || rb_is_done_write(rb) || in_len <= 0) {
+        el->input_buffering = false;
+        audio_element_report_status(el, AEL_STATUS_INPUT_BUFFERED);
     }
+}
+
+static void audio_element_input_error(audio_element_handle_t el, int in_len)
+{
     if (in_len <= 0) {
         switch (in_len) {
             case AEL_IO_ABORT:
@@ -444,12 +484,40 @@ int audio_element_input(audio_element_handle_t el, char *buffer, int wanted_size
                 break;
         }
     }
+}
+
+int audio_element_input(audio_element_handle_t el, char *buffer, int wanted_size)
+{
+    int in_len = 0;
+    unsigned long long begin = el->process_stats_cb != NULL ? os_monotonic_usec() : 0;
+    if (el->read_type == IO_TYPE_CB) {
+        if (el->in.read_cb.read == NULL) {
+            OS_LOGE(TAG, "[%s] Read IO Type callback but callback not set", el->tag);
+            return ESP_FAIL;
+        }
+        in_len = el->in.read_cb.read(el, buffer, wanted_size, el->input_timeout_ms, el->in.read_cb.ctx);
+    } else if (el->read_type == IO_TYPE_RB) {
+        if (el->in.input_rb == NULL) {
+            OS_LOGE(TAG, "[%s] Read IO type ringbuf but ringbuf not set", el->tag);
+            return ESP_FAIL;
+        }
+        audio_element_input_wait_begin(el, wanted_size);
+        in_len = rb_read(el->in.input_rb, buffer, wanted_size, el->input_timeout_ms);
+        audio_element_input_wait_end(el, in_len);
+    } else {
+        OS_LOGE(TAG, "[%s] Invalid read IO type", el->tag);
+        return ESP_FAIL;
+    }
+    if (el->process_stats_cb != NULL)
+        el->process_io_usec += os_monotonic_usec() - begin;
+    audio_element_input_error(el, in_len);
     return in_len;
 }
 
 int audio_element_output(audio_element_handle_t el, char *buffer, int write_size)
 {
     int output_len = 0;
+    unsigned long long begin = el->process_stats_cb != NULL ? os_monotonic_usec() : 0;
     if (el->write_type == IO_TYPE_CB) {
         if (el->out.write_cb.write && write_size) {
             output_len = el->out.write_cb.write(el, buffer, write_size, el->output_timeout_ms, el->out.write_cb.ctx);
@@ -464,6 +532,8 @@ int audio_element_output(audio_element_handle_t el, char *buffer, int write_size
             }
         }
     }
+    if (el->process_stats_cb != NULL)
+        el->process_io_usec += os_monotonic_usec() - begin;
     if (output_len <= 0) {
         switch (output_len) {
             case AEL_IO_ABORT:
@@ -508,40 +578,42 @@ int audio_element_input_chunk(audio_element_handle_t el, char *buffer, int wante
             OS_LOGE(TAG, "[%s] Read IO type ringbuf but ringbuf not set", el->tag);
             return ESP_FAIL;
         }
+        audio_element_input_wait_begin(el, wanted_size);
         in_len = rb_read_chunk(el->in.input_rb, buffer, wanted_size, el->input_timeout_ms);
+        audio_element_input_wait_end(el, in_len);
     } else {
         OS_LOGE(TAG, "[%s] Invalid read IO type", el->tag);
         return ESP_FAIL;
     }
-    if (in_len <= 0) {
-        switch (in_len) {
-            case AEL_IO_ABORT:
-                OS_LOGW(TAG, "IN-[%s] AEL_IO_ABORT", el->tag);
-                audio_element_set_ringbuf_done(el);
-                //audio_element_abort_output_ringbuf(el);
-                audio_element_stop(el);
-                break;
-            case AEL_IO_DONE:
-            case AEL_IO_OK:
-                OS_LOGD(TAG, "IN-[%s] AEL_IO_DONE,%d", el->tag, in_len);
-                break;
-            case AEL_IO_FAIL:
-                OS_LOGE(TAG, "IN-[%s] AEL_STATUS_ERROR_INPUT", el->tag);
-                audio_element_report_status(el, AEL_STATUS_ERROR_INPUT);
-                audio_element_cmd_send(el, AEL_MSG_CMD_ERROR);
-                break;
-            case AEL_IO_TIMEOUT:
-                OS_LOGV(TAG, "IN-[%s] AEL_IO_TIMEOUT", el->tag);
-                break;
-            default:
-                OS_LOGE(TAG, "IN-[%s] Input return not support,ret:%d", el->tag, in_len);
-                audio_element_cmd_send(el, AEL_MSG_CMD_PAUSE);
-                break;
-        }
+    audio_element_input_error(el, in_len);
+    return in_len;
+}
+
+bool audio_element_input_peekable(audio_element_handle_t el)
+{
+    return el->read_type == IO_TYPE_CB && el->in.read_cb.peek != NULL && el->in.read_cb.consume != NULL;
+}
+
+int audio_element_input_peek(audio_element_handle_t el, const char **buffer, int wanted_size)
+{
+    if (!audio_element_input_peekable(el)) {
+        OS_LOGE(TAG, "[%s] Peek input but peek callback not set", el->tag);
+        return ESP_FAIL;
     }
+    unsigned long long begin = el->process_stats_cb != NULL ? os_monotonic_usec() : 0;
+    int in_len = el->in.read_cb.peek(el, buffer, wanted_size, el->input_timeout_ms, el->in.read_cb.ctx);
+    if (el->process_stats_cb != NULL)
+        el->process_io_usec += os_monotonic_usec() - begin;
+    audio_element_input_error(el, in_len);
     return in_len;
 }
 
+void audio_element_input_consume(audio_element_handle_t el, int size)
+{
+    if (audio_element_input_peekable(el) && size > 0)
+        el->in.read_cb.consume(el, size, el->in.read_cb.ctx);
+}
+
 int audio_element_output_chunk(audio_element_handle_t el, char *buffer, int write_size)
 {
     int output_len = 0;
@@ -589,9 +661,8 @@ int audio_element_output_chunk(audio_element_handle_t el, char *buffer, int writ
     return output_len;
 }
 
-static void *audio_element_task(void *pv)
+static void audio_element_task_enter(audio_element_handle_t el)
 {
-    audio_element_handle_t el = (audio_element_handle_t)pv;
     el->task_run = true;
     audio_element_set_state_event(el, TASK_CREATED_BIT);
     audio_element_force_set_state(el, AEL_STATE_INIT);
@@ -604,6 +675,22 @@ static void *audio_element_task(void *pv)
         });
     }
     audio_element_clear_state_event(el, STOPPED_BIT);
+}
+
+static void audio_element_task_leave(audio_element_handle_t el)
+{
+    audio_element_process_close(el);
+    if (el->buf) audio_free(el->buf);
+    el->buf = NULL;
+    OS_LOGV(TAG, "[%s] el task deleted,%p", el->tag, os_thread_self());
+    el->task_run = false;
+    audio_element_set_state_event(el, TASK_DESTROYED_BIT);
+}
+
+static void *audio_element_task(void *pv)
+{
+    audio_element_handle_t el = (audio_element_handle_t)pv;
+    audio_element_task_enter(el);
     while (el->task_run) {
         if (audio_event_iface_waiting_cmd_msg(el->iface_event) != ESP_OK) {
             audio_element_set_state_event(el, STOPPED_BIT);
@@ -613,15 +700,68 @@ static void *audio_element_task(void *pv)
             // continue;
         }
     }
-
-    audio_element_process_close(el);
-    if (el->buf) audio_free(el->buf);
-    OS_LOGV(TAG, "[%s] el task deleted,%p", el->tag, os_thread_self());
-    el->task_run = false;
-    audio_element_set_state_event(el, TASK_DESTROYED_BIT);
+    audio_element_task_leave(el);
     return NULL;
 }
 
+// Whether a process step can run without blocking on the input ringbuf. While starved,
+// report buffering and input timeout as a blocking read would do
+static bool audio_element_job_input_ready(audio_element_handle_t el)
+{
+    if (el->read_type != IO_TYPE_RB || el->in.input_rb == NULL)
+        return true;
+
+    ringbuf_handle rb = el->in.input_rb;
+    int ready_size = rb_get_size(rb)/2;
+    if (ready_size > DEFAULT_JOB_INPUT_READY_SIZE)
+        ready_size = DEFAULT_JOB_INPUT_READY_SIZE;
+    if (rb_is_done_write(rb) || (rb_reach_threshold(rb) && rb_bytes_filled(rb) >= ready_size)) {
+        el->job_starved_usec = 0;
+        return true;
+    }
+
+    unsigned long long now = os_monotonic_usec();
+    audio_element_input_wait_begin(el, ready_size);
+    if (el->job_starved_usec == 0) {
+        el->job_starved_usec = now;
+    } else if (now - el->job_starved_usec >= (unsigned long long)el->input_timeout_ms*1000) {
+        OS_LOGV(TAG, "[%s] ERROR_PROCESS, AEL_IO_TIMEOUT", el->tag);
+        audio_element_report_status(el, AEL_STATUS_ERROR_TIMEOUT);
+        el->job_starved_usec = now;
+    }
+    return false;
+}
+
+// audio_element_task on a workpool: handle pending commands and run one process step,
+// park while not running
+static long audio_element_job(void *pv)
+{
+    audio_element_handle_t el = (audio_element_handle_t)pv;
+    esp_err_t ret;
+    while (el->task_run && (ret = audio_event_iface_poll_cmd_msg(el->iface_event)) != ESP_ERR_TIMEOUT) {
+        if (ret != ESP_OK) {
+            audio_element_set_state_event(el, STOPPED_BIT);
+            el->task_run = false;
+        }
+    }
+    if (!el->task_run) {
+        // Element may be freed once TASK_DESTROYED_BIT is set
+        os_mutex_lock(el->state_lock);
+        el->job = NULL;
+        os_mutex_unlock(el->state_lock);
+        audio_element_task_leave(el);
+        return WORKPOOL_JOB_DONE;
+    }
+    if (el->state < AEL_STATE_RUNNING || !el->is_running || !el->is_open) {
+        el->job_starved_usec = 0;
+        return WORKPOOL_JOB_WAIT;
+    }
+    if (!audio_element_job_input_ready(el))
+        return DEFAULT_JOB_POLL_USEC;
+    audio_element_process_running(el);
+    return 0;
+}
+
 esp_err_t audio_element_reset_state(audio_element_handle_t el)
 {
     return audio_element_force_set_state(el, AEL_STATE_INIT);
@@ -632,6 +772,11 @@ audio_element_state_t audio_element_get_state(audio_element_handle_t el)
     return el->state;
 }
 
+bool audio_element_is_finishing(audio_element_handle_t el)
+{
+    return el->finishing;
+}
+
 mq_handle audio_element_get_event_queue(audio_element_handle_t el)
 {
     if (!el) {
@@ -701,6 +846,13 @@ esp_err_t audio_element_set_event_callback(audio_element_handle_t el, event_cb_f
     return ESP_OK;
 }
 
+esp_err_t audio_element_set_process_stats_callback(audio_element_handle_t el, process_stats_func cb_func, void *ctx)
+{
+    el->process_stats_cb = cb_func;
+    el->process_stats_ctx = ctx;
+    return ESP_OK;
+}
+
 esp_err_t audio_element_msg_set_listener(audio_element_handle_t el, audio_event_iface_handle_t listener)
 {
     return audio_event_iface_set_listener(el->iface_event, listener);
@@ -951,6 +1103,8 @@ esp_err_t audio_element_set_read_cb(audio_element_handle_t el, stream_callback_t
         el->in.read_cb.open = reader->open;
         el->in.read_cb.close = reader->close;
         el->in.read_cb.read = reader->read;
+        el->in.read_cb.peek = reader->peek;
+        el->in.read_cb.consume = reader->consume;
         el->in.read_cb.ctx = reader->ctx;
         el->read_type = IO_TYPE_CB;
         return ESP_OK;
@@ -1143,6 +1297,23 @@ esp_err_t audio_element_run(audio_element_handle_t el)
         return ESP_OK;
     }
     OS_LOGV(TAG, "[%s] Element starting...", el->tag);
+    if (el->workpool != NULL) {
+        workpool_job_handle job = workpool_job_create(el->workpool, audio_element_job, (void *)el);
+        if (job == NULL) {
+            OS_LOGE(TAG, "[%s] Error create element job", el->tag);
+            return ESP_FAIL;
+        }
+        audio_event_iface_discard(el->iface_event);
+        audio_element_clear_state_event(el, TASK_CREATED_BIT);
+        audio_element_task_enter(el);
+        os_mutex_lock(el->state_lock);
+        el->job = job;
+        os_mutex_unlock(el->state_lock);
+        // First step parks the job until a command comes
+        workpool_job_wake(job);
+        OS_LOGV(TAG, "[%s] Element job created", el->tag);
+        return el->task_run ? ESP_OK : ESP_FAIL;
+    }
     snprintf(task_name, 32, "ael-%s", el->tag);
     threadattr.name = task_name;
     threadattr.priority = el->task_prio;
@@ -1166,6 +1337,16 @@ esp_err_t audio_element_run(audio_element_handle_t el)
     return ret;
 }
 
+esp_err_t audio_element_set_workpool(audio_element_handle_t el, workpool_handle pool)
+{
+    if (el->task_run) {
+        OS_LOGE(TAG, "[%s] Can't change workpool while element task running", el->tag);
+        return ESP_FAIL;
+    }
+    el->workpool = pool;
+    return ESP_OK;
+}
+
 esp_err_t audio_element_terminate(audio_element_handle_t el)
 {
     if (!el->task_run) {
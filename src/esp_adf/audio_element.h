@@ -29,6 +29,7 @@
 
 #include "osal/os_thread.h"
 #include "cutils/ringbuf.h"
+#include "cutils/workpool.h"
 
 #include "esp_adf/queue.h"
 #include "esp_adf/audio_event_iface.h"
@@ -101,6 +102,7 @@ typedef enum {
     AEL_STATUS_STATE_FINISHED           = 15,
     AEL_STATUS_MOUNTED                  = 16,
     AEL_STATUS_UNMOUNTED                = 17,
+    AEL_STATUS_INPUT_BUFFERED           = 18, /*!< Input ringbuf refilled after AEL_STATUS_INPUT_BUFFERING */
 } audio_element_status_t;
 
 typedef struct audio_element *audio_element_handle_t;
@@ -138,12 +140,15 @@ typedef esp_err_t (*io_func)(audio_element_handle_t self);
 typedef esp_err_t (*seek_func)(audio_element_handle_t self, long long offset);
 typedef int (*process_func)(audio_element_handle_t self, char *el_buffer, int el_buf_len);
 typedef esp_err_t (*event_cb_func)(audio_element_handle_t el, audio_event_iface_msg_t *event, void *ctx);
+typedef void (*process_stats_func)(audio_element_handle_t el, unsigned long long process_usec, int process_len, void *ctx);
 
 typedef struct stream_callback {
     int  (*open)(audio_element_handle_t self, void *ctx);
     int  (*read)(audio_element_handle_t self, char *buffer, int len, int timeout_ms, void *ctx);
     int  (*write)(audio_element_handle_t self, char *buffer, int len, int timeout_ms, void *ctx);
     void (*close)(audio_element_handle_t self, void *ctx);
+    int  (*peek)(audio_element_handle_t self, const char **buffer, int len, int timeout_ms, void *ctx);
+    void (*consume)(audio_element_handle_t self, int len, void *ctx);
     void *ctx;
 } stream_callback_t;
 
@@ -310,6 +315,21 @@ char *audio_element_get_uri(audio_element_handle_t el);
  */
 esp_err_t audio_element_run(audio_element_handle_t el);
 
+/**
+ * @brief      Run Audio Element as cooperative job on a workpool instead of its own task.
+ *             Each job step handles pending commands and calls process once, the job is
+ *             parked while element isn't running and polls a starved input ringbuf.
+ *             Must be set before audio_element_run.
+ *
+ * @param[in]  el    The audio element handle
+ * @param[in]  pool  The workpool, NULL to run in own task
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL
+ */
+esp_err_t audio_element_set_workpool(audio_element_handle_t el, workpool_handle pool);
+
 /**
  * @brief      Terminate Audio Element.
  *             With this function, audio_element will exit the task function.
@@ -417,6 +437,20 @@ esp_err_t audio_element_msg_set_listener(audio_element_handle_t el, audio_event_
  */
 esp_err_t audio_element_set_event_callback(audio_element_handle_t el, event_cb_func cb_func, void *ctx);
 
+/**
+ * @brief      Set a callback called after each process, with the time spent in process
+ *             excluding the time blocked in element input and output.
+ *
+ * @param      el           The audio element handle
+ * @param      cb_func      The callback function, NULL to disable timing
+ * @param      ctx          Caller context
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_FAIL
+ */
+esp_err_t audio_element_set_process_stats_callback(audio_element_handle_t el, process_stats_func cb_func, void *ctx);
+
 /**
  * @brief      Remove listener out of el.
  *             No new events will be sent to the listener.
@@ -481,6 +515,17 @@ ringbuf_handle audio_element_get_output_ringbuf(audio_element_handle_t el);
  */
 audio_element_state_t audio_element_get_state(audio_element_handle_t el);
 
+/**
+ * @brief      Check if the Element is closing because all of its input is processed,
+ *             as opposed to stopped, paused or failed. Meant for close callbacks
+ *             that have pending output to drain.
+ *
+ * @param[in]  el    The audio element handle
+ *
+ * @return     true while closing on finish
+ */
+bool audio_element_is_finishing(audio_element_handle_t el);
+
 /**
  * @brief      If the element is requesting data from the input ringbuffer, this function forces it to abort.
  *
@@ -664,6 +709,37 @@ int audio_element_output(audio_element_handle_t el, char *buffer, int write_size
  */
 int audio_element_input_chunk(audio_element_handle_t el, char *buffer, int wanted_size);
 
+/**
+ * @brief      Check if Element input can be borrowed in place, only with read callback that supports peek.
+ *
+ * @param[in]  el            The audio element handle
+ *
+ * @return     true if audio_element_input_peek() is usable
+ */
+bool audio_element_input_peekable(audio_element_handle_t el);
+
+/**
+ * @brief      Borrow Element input without copying, the data is valid until audio_element_input_consume()
+ *             or any other input call. Don't mix with audio_element_input() before consuming.
+ *
+ * @param[in]  el            The audio element handle
+ * @param      buffer        Set to the borrowed data
+ * @param[in]  wanted_size   The wanted size
+ *
+ * @return
+ *        - > 0 number of bytes borrowed, less than wanted_size only at the end of stream
+ *        - <=0 audio_element_err_t
+ */
+int audio_element_input_peek(audio_element_handle_t el, const char **buffer, int wanted_size);
+
+/**
+ * @brief      Release input borrowed by audio_element_input_peek().
+ *
+ * @param[in]  el            The audio element handle
+ * @param[in]  size          Bytes to release, no more than borrowed
+ */
+void audio_element_input_consume(audio_element_handle_t el, int size);
+
 /**
  * @brief      Call this function to sendout Element output the whole chunk
  *             Depending on setup using ringbuffer or function callback, Element will invoke write to ringbuffer, or call write callback funtion.
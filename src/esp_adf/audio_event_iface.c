@@ -242,6 +242,18 @@ esp_err_t audio_event_iface_waiting_cmd_msg(audio_event_iface_handle_t evt)
     return ESP_OK;
 }
 
+esp_err_t audio_event_iface_poll_cmd_msg(audio_event_iface_handle_t evt)
+{
+    audio_event_iface_msg_t msg;
+    if (evt->internal_queue == NULL || mqueue_receive(evt->internal_queue, (char *)&msg, 0) != 0) {
+        return ESP_ERR_TIMEOUT;
+    }
+    if (evt->on_cmd && evt->on_cmd((void *)&msg, evt->context) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
 esp_err_t audio_event_iface_cmd(audio_event_iface_handle_t evt, audio_event_iface_msg_t *msg)
 {
     if (evt->internal_queue && (mqueue_send(evt->internal_queue, (char *)msg, 0) != 0)) {
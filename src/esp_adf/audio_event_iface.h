@@ -150,6 +150,18 @@ esp_err_t audio_event_iface_set_cmd_waiting_timeout(audio_event_iface_handle_t e
  */
 esp_err_t audio_event_iface_waiting_cmd_msg(audio_event_iface_handle_t evt);
 
+/**
+ * @brief      Handle one pending internal queue message without waiting
+ *
+ * @param      evt        The event
+ *
+ * @return
+ *     - ESP_OK, a message was handled
+ *     - ESP_ERR_TIMEOUT, no message pending
+ *     - ESP_FAIL
+ */
+esp_err_t audio_event_iface_poll_cmd_msg(audio_event_iface_handle_t evt);
+
 /**
  * @brief      Trigger an event for internal queue with a message
  *
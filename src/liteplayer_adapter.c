@@ -103,6 +103,18 @@ static int file_wrapper_read(source_handle_t handle, char *buffer, int size)
     return bytes_read;
 }
 
+static int file_wrapper_read_at(source_handle_t handle, long long offset, char *buffer, int size)
+{
+    struct file_wrapper_priv *priv = (struct file_wrapper_priv *)handle;
+    if (offset < 0 || fseek(priv->file, (long)offset, SEEK_SET) != 0)
+        return -1;
+    size_t bytes_read = fread(buffer, 1, size, priv->file);
+    // Restore position for the sequential reader
+    if (fseek(priv->file, priv->content_pos, SEEK_SET) != 0)
+        return -1;
+    return bytes_read;
+}
+
 static long long file_wrapper_content_pos(source_handle_t handle)
 {
     struct file_wrapper_priv *priv = (struct file_wrapper_priv *)handle;
@@ -324,6 +336,7 @@ liteplayer_adapter_handle_t liteplayer_adapter_init()
         .content_len = file_wrapper_content_len,
         .seek = file_wrapper_seek,
         .close = file_wrapper_close,
+        .read_at = file_wrapper_read_at,
     };
     add_source_wrapper((liteplayer_adapter_handle_t)priv, &file_wrapper);
 
@@ -24,6 +24,11 @@ extern "C" {
 // media parser definations, core feature
 #define DEFAULT_MEDIA_PARSER_TASK_PRIO           ( OS_THREAD_PRIO_HIGH )
 #define DEFAULT_MEDIA_PARSER_TASK_STACKSIZE      ( 1024*8 )
+// codec info of recently prepared urls, set to 0 to parse header every time
+#define DEFAULT_MEDIA_PARSER_CACHE_ENTRIES       ( 4 )
+// read-ahead block of sources with read_at(), extractors walk boxes with many small reads,
+// a http source sends one range request per block
+#define DEFAULT_MEDIA_PARSER_FETCH_SIZE          ( 1024*32 )
 
 // media decoder definations, core feature
 #define DEFAULT_MEDIA_DECODER_TASK_PRIO          ( OS_THREAD_PRIO_REALTIME )
@@ -32,6 +37,43 @@ extern "C" {
 // media source definations, core feature
 #define DEFAULT_MEDIA_SOURCE_TASK_PRIO           ( OS_THREAD_PRIO_HIGH )
 #define DEFAULT_MEDIA_SOURCE_TASK_STACKSIZE      ( 1024*6 )
+// source->decoder ringbuffer has exactly one writer and one reader,
+// set to 0 to fall back to the fully locked ringbuffer
+#define DEFAULT_MEDIA_SOURCE_RINGBUF_SPSC        ( 1 )
+// async source prebuffers before playback starts and after every underrun, watermark is derived
+// from source throughput against codec bitrate, set to 0 to play whatever has been buffered
+#define DEFAULT_MEDIA_SOURCE_BUFFERING           ( 1 )
+// bounds of the watermark, in milliseconds of media
+#define DEFAULT_MEDIA_SOURCE_BUFFERING_MIN_MS    ( 500 )
+#define DEFAULT_MEDIA_SOURCE_BUFFERING_MAX_MS    ( 10000 )
+// ringbuf grows up to this size for slow networks, and never shrinks below source_wrapper.buffer_size
+#define DEFAULT_MEDIA_SOURCE_BUFFERING_MAX_SIZE  ( 1024*512 )
+// bitrate assumed when parser doesn't know it, 128kbps
+#define DEFAULT_MEDIA_SOURCE_BYTES_PER_SEC       ( 16000 )
+// hls segments downloaded in parallel ahead of the one being played,
+// set to 0 to download segments one after another
+#define DEFAULT_M3U_PREFETCH_SEGMENTS            ( 2 )
+// buffer of each segment being downloaded, so the cache holds at most (prefetch+1)*size bytes,
+// sized for a whole segment (10s at 128kbps is 160KB) or prefetch stalls once it fills
+#define DEFAULT_M3U_SEGMENT_BUFFER_SIZE          ( 1024*192 )
+// workpool mode, source job rechecks a full ringbuf after this interval instead of blocking
+#define DEFAULT_MEDIA_SOURCE_JOB_POLL_MS         ( 10 )
+
+// buffers of every track are kept in a per-player pool across reset/set_data_source,
+// set to 0 to allocate and free them every track
+#define DEFAULT_LITEPLAYER_BUFPOOL               ( 1 )
+
+// media sink definations, core feature
+// upper bound of period size from sink_wrapper.period_hint, pcm is written to sink in whole periods
+#define DEFAULT_SINK_WRITE_BATCH_MAX             ( 1024*16 )
+// resampler of liteplayer_set_sink_format(), filter taps of each polyphase branch when upsampling,
+// scaled up by the ratio when downsampling
+#define DEFAULT_SINK_RESAMPLER_TAPS              ( 24 )
+
+// workpool mode of liteplayer_workpool_init(), decoder, source and parser of all players run
+// as jobs on shared workers, so the worker stack must fit the deepest of them
+#define DEFAULT_WORKPOOL_TASK_PRIO               ( OS_THREAD_PRIO_REALTIME )
+#define DEFAULT_WORKPOOL_TASK_STACKSIZE          ( 1024*16 )
 
 // playlist player definations, for playlist support
 #define DEFAULT_LISTPLAYER_TASK_PRIO             ( OS_THREAD_PRIO_HIGH )
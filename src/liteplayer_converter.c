@@ -0,0 +1,464 @@
+// Copyright (c) 2019-2022 Qinglong<sysu.zqlong@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "cutils/log_helper.h"
+#include "esp_adf/audio_common.h"
+#include "liteplayer_config.h"
+#include "liteplayer_converter.h"
+
+#define TAG "[liteplayer]converter"
+
+#define CONVERTER_MAX_CHANNELS      ( 8 )
+#define CONVERTER_MAX_PHASES        ( 1024 )
+#define CONVERTER_MAX_TAPS          ( 128 )
+#define CONVERTER_KAISER_BETA       ( 8.0 )
+#define CONVERTER_PASSBAND          ( 0.91 ) // of the lower nyquist frequency
+
+struct media_converter {
+    struct media_converter_info info;
+    int in_sample_size;
+    int out_sample_size;
+    bool passthrough;
+    bool resample;
+
+    // polyphase resampler, out/in rate is up/down, coef[phase][tap] is stored reversed
+    // so each output is a dot product with contiguous input
+    int up;
+    int down;
+    int taps;
+    float *coef;
+    float *history[CONVERTER_MAX_CHANNELS]; // planar, taps-1 frames of history then new frames
+    int position; // of next output, in 1/up input frames relative to the first new frame
+    int delay;    // filter group delay, in 1/up input frames, skipped at start and flushed at end
+
+    int frames_cap; // input frames that buffers can hold
+    float *in_float;
+    float *mixed;
+    float *resampled;
+    char *out;
+};
+
+static int converter_gcd(int a, int b)
+{
+    while (b != 0) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static double converter_bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    int k;
+    for (k = 1; k < 64 && term > sum*1e-12; k++) {
+        term *= (x/(2*k))*(x/(2*k));
+        sum += term;
+    }
+    return sum;
+}
+
+static int converter_resampler_init(struct media_converter *conv)
+{
+    int in_rate = conv->info.in_samplerate, out_rate = conv->info.out_samplerate;
+    int gcd = converter_gcd(in_rate, out_rate);
+    conv->up = out_rate/gcd;
+    conv->down = in_rate/gcd;
+    if (conv->up > CONVERTER_MAX_PHASES) {
+        OS_LOGE(TAG, "Unsupported resampling ratio %d/%d", out_rate, in_rate);
+        return -1;
+    }
+
+    // Windowed sinc, longer when downsampling as the cutoff drops below input nyquist
+    double ratio = (double)out_rate/in_rate;
+    int taps = DEFAULT_SINK_RESAMPLER_TAPS;
+    if (ratio < 1.0)
+        taps = (int)ceil(taps/ratio);
+    taps = (taps + 3)/4*4;
+    if (taps > CONVERTER_MAX_TAPS)
+        taps = CONVERTER_MAX_TAPS;
+    conv->taps = taps;
+
+    int length = conv->up*taps;
+    double *proto = audio_malloc(length*sizeof(double));
+    conv->coef = audio_malloc(length*sizeof(float));
+    if (proto == NULL || conv->coef == NULL) {
+        audio_free(proto);
+        return -1;
+    }
+
+    double fc = 0.5*CONVERTER_PASSBAND*(ratio < 1.0 ? ratio : 1.0)/conv->up;
+    double center = (length - 1)/2.0;
+    double i0_beta = converter_bessel_i0(CONVERTER_KAISER_BETA);
+    double sum = 0.0;
+    int m, p, j;
+    for (m = 0; m < length; m++) {
+        double t = m - center;
+        double sinc = t == 0.0 ? 2*fc : sin(2*M_PI*fc*t)/(M_PI*t);
+        double r = length > 1 ? 2.0*m/(length - 1) - 1.0 : 0.0;
+        proto[m] = sinc*converter_bessel_i0(CONVERTER_KAISER_BETA*sqrt(1.0 - r*r))/i0_beta;
+        sum += proto[m];
+    }
+    // Unity gain for each phase on average
+    for (p = 0; p < conv->up; p++) {
+        for (j = 0; j < taps; j++)
+            conv->coef[p*taps + j] = (float)(proto[p + (taps - 1 - j)*conv->up]*conv->up/sum);
+    }
+    audio_free(proto);
+    // Output at position p is centered on input p - delay, start there to keep pcm aligned
+    conv->delay = (int)center;
+    conv->position = conv->delay;
+
+    OS_LOGD(TAG, "Resampler: %d->%d, phases=%d, taps=%d", in_rate, out_rate, conv->up, taps);
+    return 0;
+}
+
+static void converter_to_float(float *out, const char *in, int bits, int samples)
+{
+    int i = 0;
+    switch (bits) {
+    case 16: {
+        const int16_t *src = (const int16_t *)in;
+#if defined(__SSE2__)
+        const __m128 scale = _mm_set1_ps(1.0f/32768);
+        for (; i + 8 <= samples; i += 8) {
+            __m128i x = _mm_loadu_si128((const __m128i *)&src[i]);
+            __m128i sign = _mm_srai_epi16(x, 15);
+            _mm_storeu_ps(&out[i], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(x, sign)), scale));
+            _mm_storeu_ps(&out[i + 4], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(x, sign)), scale));
+        }
+#elif defined(__ARM_NEON)
+        for (; i + 8 <= samples; i += 8) {
+            int16x8_t x = vld1q_s16(&src[i]);
+            vst1q_f32(&out[i], vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), 1.0f/32768));
+            vst1q_f32(&out[i + 4], vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), 1.0f/32768));
+        }
+#endif
+        for (; i < samples; i++)
+            out[i] = src[i]*(1.0f/32768);
+        break;
+    }
+    case 24: {
+        const int32_t *src = (const int32_t *)in;
+        for (; i < samples; i++)
+            out[i] = (float)(((int32_t)((uint32_t)src[i] << 8)) >> 8)*(1.0f/8388608);
+        break;
+    }
+    case 32: {
+        const int32_t *src = (const int32_t *)in;
+        for (; i < samples; i++)
+            out[i] = (float)src[i]*(1.0f/2147483648.0f);
+        break;
+    }
+    default:
+        memcpy(out, in, samples*sizeof(float));
+        break;
+    }
+}
+
+static void converter_from_float(char *out, const float *in, int bits, int samples)
+{
+    int i = 0;
+    switch (bits) {
+    case 16: {
+        int16_t *dst = (int16_t *)out;
+#if defined(__SSE2__)
+        // Clamp before converting, cvtps2dq turns overflow into INT32_MIN
+        const __m128 scale = _mm_set1_ps(32768.0f);
+        const __m128 hi = _mm_set1_ps(32767.0f), lo = _mm_set1_ps(-32768.0f);
+        for (; i + 8 <= samples; i += 8) {
+            __m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(&in[i]), scale), lo), hi);
+            __m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(&in[i + 4]), scale), lo), hi);
+            _mm_storeu_si128((__m128i *)&dst[i], _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        for (; i + 8 <= samples; i += 8) {
+            int32x4_t a = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(&in[i]), 32768.0f));
+            int32x4_t b = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(&in[i + 4]), 32768.0f));
+            vst1q_s16(&dst[i], vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+        }
+#endif
+        for (; i < samples; i++) {
+            float v = in[i]*32768.0f;
+            dst[i] = v >= 32767.0f ? INT16_MAX : (v <= -32768.0f ? INT16_MIN : (int16_t)lrintf(v));
+        }
+        break;
+    }
+    case 24: {
+        int32_t *dst = (int32_t *)out;
+        for (; i < samples; i++) {
+            float v = in[i]*8388608.0f;
+            dst[i] = v >= 8388607.0f ? 8388607 : (v <= -8388608.0f ? -8388608 : (int32_t)lrintf(v));
+        }
+        break;
+    }
+    case 32: {
+        int32_t *dst = (int32_t *)out;
+        for (; i < samples; i++) {
+            float v = in[i];
+            dst[i] = v >= 1.0f ? INT32_MAX : (v <= -1.0f ? INT32_MIN : (int32_t)lrintf(v*2147483648.0f));
+        }
+        break;
+    }
+    default:
+        memcpy(out, in, samples*sizeof(float));
+        break;
+    }
+}
+
+static void converter_mix_channels(float *out, int out_channels, const float *in, int in_channels, int frames)
+{
+    int f, c;
+    for (f = 0; f < frames; f++) {
+        if (out_channels == 1) {
+            float sum = 0.0f;
+            for (c = 0; c < in_channels; c++)
+                sum += in[c];
+            out[0] = sum/in_channels;
+        } else {
+            // Upmix repeats the input channels, downmix keeps the front ones
+            for (c = 0; c < out_channels; c++)
+                out[c] = in[c % in_channels];
+        }
+        in += in_channels;
+        out += out_channels;
+    }
+}
+
+static inline float converter_dot(const float *x, const float *coef, int taps)
+{
+    int i = 0;
+#if defined(__SSE2__)
+    __m128 acc = _mm_setzero_ps();
+    for (; i < taps; i += 4)
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(&x[i]), _mm_loadu_ps(&coef[i])));
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    return _mm_cvtss_f32(acc);
+#elif defined(__ARM_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (; i < taps; i += 4)
+        acc = vmlaq_f32(acc, vld1q_f32(&x[i]), vld1q_f32(&coef[i]));
+    float32x2_t sum = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    return vget_lane_f32(vpadd_f32(sum, sum), 0);
+#else
+    float acc = 0.0f;
+    for (; i < taps; i++)
+        acc += x[i]*coef[i];
+    return acc;
+#endif
+}
+
+static int converter_resample(struct media_converter *conv, const float *in, int frames, float *out)
+{
+    int channels = conv->info.out_channels;
+    int keep = conv->taps - 1;
+    int f, c, out_frames = 0;
+
+    for (c = 0; c < channels; c++) {
+        float *dst = conv->history[c] + keep;
+        for (f = 0; f < frames; f++)
+            dst[f] = in[f*channels + c];
+    }
+
+    while (conv->position/conv->up < frames) {
+        int index = conv->position/conv->up;
+        const float *coef = &conv->coef[(conv->position % conv->up)*conv->taps];
+        for (c = 0; c < channels; c++)
+            out[c] = converter_dot(conv->history[c] + index, coef, conv->taps);
+        out += channels;
+        out_frames++;
+        conv->position += conv->down;
+    }
+    conv->position -= frames*conv->up;
+
+    for (c = 0; c < channels; c++)
+        memmove(conv->history[c], conv->history[c] + frames, keep*sizeof(float));
+    return out_frames;
+}
+
+static int converter_reserve(struct media_converter *conv, int frames)
+{
+    if (frames <= conv->frames_cap)
+        return 0;
+
+    int in_ch = conv->info.in_channels, out_ch = conv->info.out_channels;
+    int out_frames = frames;
+    int c;
+    if (conv->resample)
+        out_frames = (int)((long long)frames*conv->up/conv->down) + 2;
+
+    float *in_float = audio_realloc(conv->in_float, frames*in_ch*sizeof(float));
+    if (in_float == NULL)
+        return -1;
+    conv->in_float = in_float;
+    float *mixed = audio_realloc(conv->mixed, frames*out_ch*sizeof(float));
+    if (mixed == NULL)
+        return -1;
+    conv->mixed = mixed;
+    char *out = audio_realloc(conv->out, out_frames*out_ch*conv->out_sample_size);
+    if (out == NULL)
+        return -1;
+    conv->out = out;
+    if (conv->resample) {
+        float *resampled = audio_realloc(conv->resampled, out_frames*out_ch*sizeof(float));
+        if (resampled == NULL)
+            return -1;
+        conv->resampled = resampled;
+        for (c = 0; c < out_ch; c++) {
+            float *history = audio_realloc(conv->history[c], (conv->taps - 1 + frames)*sizeof(float));
+            if (history == NULL)
+                return -1;
+            if (conv->frames_cap == 0)
+                memset(history, 0, (conv->taps - 1)*sizeof(float));
+            conv->history[c] = history;
+        }
+    }
+    conv->frames_cap = frames;
+    return 0;
+}
+
+static bool converter_bits_valid(int bits)
+{
+    return bits == 16 || bits == 24 || bits == 32 || bits == LITEPLAYER_SINK_BITS_FLOAT;
+}
+
+media_converter_handle_t media_converter_init(struct media_converter_info *info)
+{
+    if (info->in_samplerate <= 0 || info->out_samplerate <= 0 ||
+        info->in_channels <= 0 || info->in_channels > CONVERTER_MAX_CHANNELS ||
+        info->out_channels <= 0 || info->out_channels > CONVERTER_MAX_CHANNELS ||
+        !converter_bits_valid(info->in_bits) || !converter_bits_valid(info->out_bits)) {
+        OS_LOGE(TAG, "Invalid format: in:%d/%d/%d, out:%d/%d/%d",
+                info->in_samplerate, info->in_channels, info->in_bits,
+                info->out_samplerate, info->out_channels, info->out_bits);
+        return NULL;
+    }
+
+    struct media_converter *conv = audio_calloc(1, sizeof(struct media_converter));
+    if (conv == NULL)
+        return NULL;
+    memcpy(&conv->info, info, sizeof(conv->info));
+    conv->in_sample_size = media_converter_sample_size(info->in_bits);
+    conv->out_sample_size = media_converter_sample_size(info->out_bits);
+    conv->resample = info->in_samplerate != info->out_samplerate;
+    conv->passthrough = !conv->resample && info->in_channels == info->out_channels &&
+                        info->in_bits == info->out_bits;
+    if (conv->resample && converter_resampler_init(conv) != 0) {
+        media_converter_deinit(conv);
+        return NULL;
+    }
+
+    OS_LOGD(TAG, "Converter: in:%d/%d/%d, out:%d/%d/%d%s",
+            info->in_samplerate, info->in_channels, info->in_bits,
+            info->out_samplerate, info->out_channels, info->out_bits,
+            conv->passthrough ? ", passthrough" : "");
+    return conv;
+}
+
+int media_converter_process(media_converter_handle_t handle, char *in, int in_size, char **out)
+{
+    struct media_converter *conv = (struct media_converter *)handle;
+    if (conv->passthrough) {
+        *out = in;
+        return in_size;
+    }
+
+    int in_ch = conv->info.in_channels, out_ch = conv->info.out_channels;
+    int frames = in_size/(in_ch*conv->in_sample_size);
+    if (frames <= 0) {
+        *out = conv->out;
+        return 0;
+    }
+    if (converter_reserve(conv, frames) != 0) {
+        OS_LOGE(TAG, "Failed to allocate buffers for %d frames", frames);
+        return -1;
+    }
+
+    converter_to_float(conv->in_float, in, conv->info.in_bits, frames*in_ch);
+    float *pcm = conv->in_float;
+    if (in_ch != out_ch) {
+        converter_mix_channels(conv->mixed, out_ch, conv->in_float, in_ch, frames);
+        pcm = conv->mixed;
+    }
+    if (conv->resample) {
+        frames = converter_resample(conv, pcm, frames, conv->resampled);
+        pcm = conv->resampled;
+    }
+    converter_from_float(conv->out, pcm, conv->info.out_bits, frames*out_ch);
+
+    *out = conv->out;
+    return frames*out_ch*conv->out_sample_size;
+}
+
+int media_converter_flush(media_converter_handle_t handle, char **out)
+{
+    struct media_converter *conv = (struct media_converter *)handle;
+    *out = conv->out;
+    if (!conv->resample || conv->frames_cap == 0)
+        return 0;
+
+    // Outputs lag inputs by the filter delay, feed that much silence
+    int out_ch = conv->info.out_channels;
+    int frames = conv->taps/2;
+    if (converter_reserve(conv, frames) != 0) {
+        OS_LOGE(TAG, "Failed to allocate buffers for %d frames", frames);
+        return -1;
+    }
+    memset(conv->mixed, 0, frames*out_ch*sizeof(float));
+    frames = converter_resample(conv, conv->mixed, frames, conv->resampled);
+    converter_from_float(conv->out, conv->resampled, conv->info.out_bits, frames*out_ch);
+
+    *out = conv->out;
+    return frames*out_ch*conv->out_sample_size;
+}
+
+void media_converter_reset(media_converter_handle_t handle)
+{
+    struct media_converter *conv = (struct media_converter *)handle;
+    int c;
+    conv->position = conv->delay;
+    for (c = 0; c < conv->info.out_channels; c++) {
+        if (conv->history[c] != NULL)
+            memset(conv->history[c], 0, (conv->taps - 1)*sizeof(float));
+    }
+}
+
+void media_converter_deinit(media_converter_handle_t handle)
+{
+    struct media_converter *conv = (struct media_converter *)handle;
+    int c;
+    if (conv == NULL)
+        return;
+    for (c = 0; c < CONVERTER_MAX_CHANNELS; c++)
+        audio_free(conv->history[c]);
+    audio_free(conv->coef);
+    audio_free(conv->in_float);
+    audio_free(conv->mixed);
+    audio_free(conv->resampled);
+    audio_free(conv->out);
+    audio_free(conv);
+}
@@ -0,0 +1,60 @@
+// Copyright (c) 2019-2022 Qinglong<sysu.zqlong@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _LITEPLAYER_MEDIACONVERTER_H_
+#define _LITEPLAYER_MEDIACONVERTER_H_
+
+#include "liteplayer_adapter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// bits: 16, 24 (in 4 bytes, low aligned), 32 or LITEPLAYER_SINK_BITS_FLOAT
+struct media_converter_info {
+    int in_samplerate;
+    int in_channels;
+    int in_bits;
+    int out_samplerate;
+    int out_channels;
+    int out_bits;
+};
+
+typedef void *media_converter_handle_t;
+
+media_converter_handle_t media_converter_init(struct media_converter_info *info);
+
+// Convert whole frames of in_size bytes, return bytes of converted pcm pointed by *out,
+// which is valid until next call. Resampler keeps a few frames of history across calls
+int media_converter_process(media_converter_handle_t handle, char *in, int in_size, char **out);
+
+// At end of stream, push out the frames still held back by the resampler filter
+// (about taps/2 input frames), same return and *out as media_converter_process
+int media_converter_flush(media_converter_handle_t handle, char **out);
+
+// Drop resampler history, e.g. after seek
+void media_converter_reset(media_converter_handle_t handle);
+
+void media_converter_deinit(media_converter_handle_t handle);
+
+static inline int media_converter_sample_size(int bits)
+{
+    return (bits == LITEPLAYER_SINK_BITS_FLOAT || bits == 24) ? 4 : bits/8;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _LITEPLAYER_MEDIACONVERTER_H_
@@ -31,9 +31,24 @@
 
 #define DEFAULT_PLAYLIST_URL_LEN  128
 
+struct listplayer;
+
+struct listplayer_slot {
+    struct listplayer          *owner;
+    liteplayer_handle_t         player;
+};
+
+enum listplayer_next_state {
+    LISTPLAYER_NEXT_NONE = 0,
+    LISTPLAYER_NEXT_PREPARING,
+    LISTPLAYER_NEXT_PREPARED,
+};
+
 struct listplayer {
     struct listplayer_cfg       cfg;
     liteplayer_handle_t         player;
+    liteplayer_handle_t         next_player;   // gapless: prepares url following url_curr
+    struct listplayer_slot      slots[2];
     liteplayer_adapter_handle_t adapter;
     mlooper_handle              looper;
     os_mutex                    lock;
@@ -52,6 +67,21 @@ struct listplayer {
     bool                 has_inited;
     bool                 has_prepared;
     bool                 has_started;
+
+    // gapless playback, protected by lock
+    struct listnode            *next_url;
+    enum listplayer_next_state  next_state;
+    bool                        next_switch; // current player completed, switch once next prepared
+
+    // gapless sink, shared by both players, protected by sink_lock
+    os_mutex                    sink_lock;
+    struct sink_wrapper         sink_ops;
+    sink_handle_t               sink_handle;
+    int                         sink_samplerate;
+    int                         sink_channels;
+    int                         sink_bits;
+    int                         sink_users;
+    bool                        sink_hold;
 };
 
 struct url_node {
@@ -70,6 +100,9 @@ enum {
     PLAYER_DO_PREV,
     PLAYER_DO_STOP,
     PLAYER_DO_RESET,
+    PLAYER_DO_PRELOAD,
+    PLAYER_DO_SWITCH,
+    PLAYER_DO_CANCEL_NEXT,
 };
 
 static void playlist_clear(listplayer_handle_t handle)
@@ -195,13 +228,150 @@ resolve_done:
     return ret;
 }
 
+static sink_handle_t gapless_sink_open(int samplerate, int channels, int bits, void *priv_data)
+{
+    listplayer_handle_t handle = (listplayer_handle_t)priv_data;
+    sink_handle_t sink = NULL;
+
+    os_mutex_lock(handle->sink_lock);
+    if (handle->sink_handle != NULL &&
+        (handle->sink_samplerate != samplerate || handle->sink_channels != channels ||
+         handle->sink_bits != bits)) {
+        if (handle->sink_users > 0) {
+            OS_LOGE(TAG, "Sink is busy with another format, can't open");
+            goto open_done;
+        }
+        OS_LOGD(TAG, "Sink format changed, reopen sink");
+        handle->sink_ops.close(handle->sink_handle);
+        handle->sink_handle = NULL;
+    }
+
+    if (handle->sink_handle == NULL) {
+        handle->sink_handle = handle->sink_ops.open(samplerate, channels, bits, handle->sink_ops.priv_data);
+        if (handle->sink_handle == NULL)
+            goto open_done;
+        handle->sink_samplerate = samplerate;
+        handle->sink_channels = channels;
+        handle->sink_bits = bits;
+    } else {
+        OS_LOGD(TAG, "Reuse opened sink for gapless playback");
+    }
+    handle->sink_users++;
+    sink = (sink_handle_t)handle;
+
+open_done:
+    os_mutex_unlock(handle->sink_lock);
+    return sink;
+}
+
+static int gapless_sink_write(sink_handle_t sink, char *buffer, int size)
+{
+    listplayer_handle_t handle = (listplayer_handle_t)sink;
+    return handle->sink_ops.write(handle->sink_handle, buffer, size);
+}
+
+static int gapless_sink_period_hint(sink_handle_t sink, int *period_size, int *buffer_size)
+{
+    listplayer_handle_t handle = (listplayer_handle_t)sink;
+    if (handle->sink_ops.period_hint == NULL)
+        return -1;
+    return handle->sink_ops.period_hint(handle->sink_handle, period_size, buffer_size);
+}
+
+static void gapless_sink_close(sink_handle_t sink)
+{
+    listplayer_handle_t handle = (listplayer_handle_t)sink;
+    os_mutex_lock(handle->sink_lock);
+    handle->sink_users--;
+    if (handle->sink_users == 0 && !handle->sink_hold && handle->sink_handle != NULL) {
+        handle->sink_ops.close(handle->sink_handle);
+        handle->sink_handle = NULL;
+    }
+    os_mutex_unlock(handle->sink_lock);
+}
+
+// Hold keeps sink opened after the current player closes it, so the next player can reuse it.
+// Releasing the hold closes the sink if nobody is using it, unless keep_opened is set
+static void gapless_sink_hold(listplayer_handle_t handle, bool hold, bool keep_opened)
+{
+    if (handle->sink_lock == NULL)
+        return;
+    os_mutex_lock(handle->sink_lock);
+    handle->sink_hold = hold;
+    if (!hold && !keep_opened && handle->sink_users == 0 && handle->sink_handle != NULL) {
+        handle->sink_ops.close(handle->sink_handle);
+        handle->sink_handle = NULL;
+    }
+    os_mutex_unlock(handle->sink_lock);
+}
+
+static void listplayer_cancel_next(listplayer_handle_t handle)
+{
+    if (handle->next_player == NULL)
+        return;
+
+    os_mutex_lock(handle->lock);
+    handle->next_url = NULL;
+    handle->next_state = LISTPLAYER_NEXT_NONE;
+    handle->next_switch = false;
+    os_mutex_unlock(handle->lock);
+
+    liteplayer_reset(handle->next_player);
+    gapless_sink_hold(handle, false, false);
+}
+
+static void listplayer_next_state_callback(listplayer_handle_t handle, enum liteplayer_state state)
+{
+    switch (state) {
+    case LITEPLAYER_PREPARED:
+        if (handle->next_state == LISTPLAYER_NEXT_PREPARING && handle->next_url != NULL) {
+            handle->next_state = LISTPLAYER_NEXT_PREPARED;
+            if (handle->next_switch) {
+                struct message *msg = message_obtain(PLAYER_DO_SWITCH, 0, 0, handle);
+                if (msg != NULL)
+                    mlooper_post_message(handle->looper, msg);
+            }
+        }
+        break;
+
+    case LITEPLAYER_ERROR:
+        if (handle->next_state != LISTPLAYER_NEXT_NONE) {
+            OS_LOGW(TAG, "Failed to prepare next url, fallback to normal switching");
+            // Let normal switching (stop-reset-prepare) report the error of this url
+            if (handle->next_switch) {
+                struct message *msg = message_obtain(PLAYER_DO_STOP, 0, 0, handle);
+                if (msg != NULL)
+                    mlooper_post_message(handle->looper, msg);
+            }
+            handle->next_url = NULL;
+            handle->next_state = LISTPLAYER_NEXT_NONE;
+            handle->next_switch = false;
+            struct message *msg = message_obtain(PLAYER_DO_CANCEL_NEXT, 0, 0, handle);
+            if (msg != NULL)
+                mlooper_post_message(handle->looper, msg);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
 static int listplayer_state_callback(enum liteplayer_state state, int errcode, void *priv)
 {
-    listplayer_handle_t handle = (listplayer_handle_t)priv;
+    struct listplayer_slot *slot = (struct listplayer_slot *)priv;
+    listplayer_handle_t handle = slot->owner;
     bool state_sync = true;
 
     os_mutex_lock(handle->lock);
 
+    if (slot->player != handle->player) {
+        // State of the gapless next player isn't reported to listener
+        listplayer_next_state_callback(handle, state);
+        os_mutex_unlock(handle->lock);
+        return 0;
+    }
+
     switch (state) {
     case LITEPLAYER_INITED:
         if (handle->has_inited) {
@@ -249,12 +419,30 @@ static int listplayer_state_callback(enum liteplayer_state state, int errcode, v
     case LITEPLAYER_NEARLYCOMPLETED:
         if (handle->is_list || handle->is_looping) {
             state_sync = false;
+            if (handle->next_player != NULL && handle->next_state == LISTPLAYER_NEXT_NONE &&
+                handle->url_count > 0) {
+                struct message *msg = message_obtain(PLAYER_DO_PRELOAD, 0, 0, handle);
+                if (msg != NULL) {
+                    handle->next_state = LISTPLAYER_NEXT_PREPARING;
+                    handle->next_switch = false;
+                    gapless_sink_hold(handle, true, false);
+                    mlooper_post_message(handle->looper, msg);
+                }
+            }
         }
         break;
 
     case LITEPLAYER_COMPLETED:
         if (handle->is_list || handle->is_looping) {
-            struct message *msg = message_obtain(PLAYER_DO_STOP, 0, 0, handle);
+            struct message *msg = NULL;
+            if (handle->next_state == LISTPLAYER_NEXT_PREPARED) {
+                msg = message_obtain(PLAYER_DO_SWITCH, 0, 0, handle);
+            } else if (handle->next_state == LISTPLAYER_NEXT_PREPARING) {
+                handle->next_switch = true;
+                state_sync = false;
+            } else {
+                msg = message_obtain(PLAYER_DO_STOP, 0, 0, handle);
+            }
             if (msg != NULL) {
                 state_sync = false;
                 mlooper_post_message(handle->looper, msg);
@@ -271,6 +459,9 @@ static int listplayer_state_callback(enum liteplayer_state state, int errcode, v
         list_remove(curr);
         handle->url_count--;
 
+        if (handle->next_url == curr)
+            handle->next_url = NULL;
+
         struct url_node *node = listnode_to_item(curr, struct url_node, listnode);
         OS_LOGW(TAG, "Failed to play url: %s, remove this url from list", node->url);
         audio_free(node->url);
@@ -313,12 +504,16 @@ static int listplayer_state_callback(enum liteplayer_state state, int errcode, v
         }
         break;
 
+    case LITEPLAYER_BUFFERING:
+        break;
+
     default:
         state_sync = false;
         break;
     }
 
-    handle->state = state;
+    if (state != LITEPLAYER_BUFFERING)
+        handle->state = state;
 
     os_mutex_unlock(handle->lock);
 
@@ -366,6 +561,7 @@ static void listplayer_looper_handle(struct message *msg)
         break;
 
     case PLAYER_DO_NEXT: {
+        listplayer_cancel_next(handle);
         os_mutex_lock(handle->lock);
         if (handle->is_list) {
             if (handle->is_looping) {
@@ -383,6 +579,7 @@ static void listplayer_looper_handle(struct message *msg)
     }
 
     case PLAYER_DO_PREV: {
+        listplayer_cancel_next(handle);
         os_mutex_lock(handle->lock);
         if (handle->is_list) {
             if (handle->url_curr == list_head(&handle->url_list)) {
@@ -405,13 +602,84 @@ static void listplayer_looper_handle(struct message *msg)
     }
 
     case PLAYER_DO_STOP:
+        listplayer_cancel_next(handle);
         liteplayer_stop(handle->player);
         break;
 
     case PLAYER_DO_RESET:
+        listplayer_cancel_next(handle);
         liteplayer_reset(handle->player);
         break;
 
+    case PLAYER_DO_PRELOAD: {
+        const char *url = NULL;
+        os_mutex_lock(handle->lock);
+        if (handle->next_state == LISTPLAYER_NEXT_PREPARING && handle->url_count > 0) {
+            struct listnode *next = handle->url_curr;
+            if (!handle->is_looping) {
+                if (next == list_tail(&handle->url_list))
+                    next = list_head(&handle->url_list);
+                else
+                    next = next->next;
+            }
+            struct url_node *node = listnode_to_item(next, struct url_node, listnode);
+            url = audio_strdup(node->url);
+            if (url != NULL)
+                handle->next_url = next;
+        }
+        os_mutex_unlock(handle->lock);
+        if (url != NULL) {
+            OS_LOGD(TAG, "Preparing next url: %s", url);
+            if (liteplayer_set_data_source(handle->next_player, url) == 0) {
+                // Failure of preparing is reported by next player state callback
+                liteplayer_prepare_async(handle->next_player);
+            } else {
+                os_mutex_lock(handle->lock);
+                if (handle->next_switch) {
+                    struct message *stop = message_obtain(PLAYER_DO_STOP, 0, 0, handle);
+                    if (stop != NULL)
+                        mlooper_post_message(handle->looper, stop);
+                }
+                os_mutex_unlock(handle->lock);
+                listplayer_cancel_next(handle);
+            }
+            audio_free(url);
+        }
+        break;
+    }
+
+    case PLAYER_DO_SWITCH: {
+        liteplayer_handle_t prev = NULL;
+        os_mutex_lock(handle->lock);
+        if (handle->next_state == LISTPLAYER_NEXT_PREPARED && handle->next_url != NULL) {
+            prev = handle->player;
+            handle->player = handle->next_player;
+            handle->next_player = prev;
+            handle->url_curr = handle->next_url;
+            handle->is_paused = false;
+        }
+        handle->next_url = NULL;
+        handle->next_state = LISTPLAYER_NEXT_NONE;
+        handle->next_switch = false;
+        os_mutex_unlock(handle->lock);
+
+        if (prev != NULL) {
+            // Sink is still opened by hold, new player reuses it when starting
+            gapless_sink_hold(handle, false, true);
+            liteplayer_start(handle->player);
+            liteplayer_stop(prev);
+            liteplayer_reset(prev);
+        } else {
+            listplayer_cancel_next(handle);
+            liteplayer_stop(handle->player);
+        }
+        break;
+    }
+
+    case PLAYER_DO_CANCEL_NEXT:
+        listplayer_cancel_next(handle);
+        break;
+
     default:
         break;
     }
@@ -433,6 +701,8 @@ listplayer_handle_t listplayer_create(struct listplayer_cfg *cfg)
         } else {
             handle->cfg.playlist_url_max = 1;
         }
+        if (cfg != NULL)
+            handle->cfg.gapless = cfg->gapless;
 
         list_init(&handle->url_list);
 
@@ -447,6 +717,21 @@ listplayer_handle_t listplayer_create(struct listplayer_cfg *cfg)
         handle->player = liteplayer_create();
         if (handle->player == NULL)
             goto failed;
+        handle->slots[0].owner = handle;
+        handle->slots[0].player = handle->player;
+        liteplayer_register_state_listener(handle->player, listplayer_state_callback, &handle->slots[0]);
+
+        if (handle->cfg.gapless) {
+            handle->sink_lock = os_mutex_create();
+            if (handle->sink_lock == NULL)
+                goto failed;
+            handle->next_player = liteplayer_create();
+            if (handle->next_player == NULL)
+                goto failed;
+            handle->slots[1].owner = handle;
+            handle->slots[1].player = handle->next_player;
+            liteplayer_register_state_listener(handle->next_player, listplayer_state_callback, &handle->slots[1]);
+        }
 
         struct os_thread_attr attr = {
             .name = "ael-listplayer",
@@ -482,6 +767,9 @@ int listplayer_register_source_wrapper(listplayer_handle_t handle, struct source
     os_mutex_unlock(handle->lock);
 
     handle->adapter->add_source_wrapper(handle->adapter, wrapper);
+    if (handle->next_player != NULL &&
+        liteplayer_register_source_wrapper(handle->next_player, wrapper) != 0)
+        return -1;
     return liteplayer_register_source_wrapper(handle->player, wrapper);
 }
 
@@ -499,9 +787,46 @@ int listplayer_register_sink_wrapper(listplayer_handle_t handle, struct sink_wra
     os_mutex_unlock(handle->lock);
 
     handle->adapter->add_sink_wrapper(handle->adapter, wrapper);
+    if (handle->next_player != NULL) {
+        // Both players write to the same sink through this proxy, the last registered one wins
+        struct sink_wrapper gapless = {
+            .priv_data = handle,
+            .name = wrapper->name,
+            .open = gapless_sink_open,
+            .write = gapless_sink_write,
+            .close = gapless_sink_close,
+            .period_hint = gapless_sink_period_hint,
+        };
+        os_mutex_lock(handle->sink_lock);
+        memcpy(&handle->sink_ops, wrapper, sizeof(struct sink_wrapper));
+        os_mutex_unlock(handle->sink_lock);
+        if (liteplayer_register_sink_wrapper(handle->next_player, &gapless) != 0)
+            return -1;
+        return liteplayer_register_sink_wrapper(handle->player, &gapless);
+    }
     return liteplayer_register_sink_wrapper(handle->player, wrapper);
 }
 
+int listplayer_set_sink_format(listplayer_handle_t handle, int samplerate, int channels, int bits)
+{
+    if (handle == NULL)
+        return -1;
+
+    os_mutex_lock(handle->lock);
+    if (handle->state != LITEPLAYER_IDLE) {
+        OS_LOGE(TAG, "Can't set sink format in state=[%d]", handle->state);
+        os_mutex_unlock(handle->lock);
+        return -1;
+    }
+    os_mutex_unlock(handle->lock);
+
+    // Same format for every track, so the gapless sink is never reopened
+    if (handle->next_player != NULL &&
+        liteplayer_set_sink_format(handle->next_player, samplerate, channels, bits) != 0)
+        return -1;
+    return liteplayer_set_sink_format(handle->player, samplerate, channels, bits);
+}
+
 int listplayer_register_state_listener(listplayer_handle_t handle, liteplayer_state_cb listener, void *listener_priv)
 {
     if (handle == NULL)
@@ -566,7 +891,6 @@ int listplayer_set_data_source(listplayer_handle_t handle, const char *url)
     else
         return -1;
 
-    liteplayer_register_state_listener(handle->player, listplayer_state_callback, (void *)handle);
     struct message *msg = message_obtain(PLAYER_DO_SET_SOURCE, 0, 0, handle);
     if (msg != NULL) {
         mlooper_post_message(handle->looper, msg);
@@ -750,6 +1074,12 @@ void listplayer_destroy(listplayer_handle_t handle)
         mlooper_destroy(handle->looper);
     if (handle->player != NULL)
         liteplayer_destroy(handle->player);
+    if (handle->next_player != NULL)
+        liteplayer_destroy(handle->next_player);
+    if (handle->sink_handle != NULL)
+        handle->sink_ops.close(handle->sink_handle);
+    if (handle->sink_lock != NULL)
+        os_mutex_destroy(handle->sink_lock);
     if (handle->adapter != NULL)
         handle->adapter->destory(handle->adapter);
     if (handle->lock != NULL)
@@ -17,8 +17,11 @@
 #include <stdint.h>
 
 #include "osal/os_thread.h"
+#include "osal/os_time.h"
 #include "cutils/ringbuf.h"
 #include "cutils/log_helper.h"
+#include "cutils/workpool.h"
+#include "cutils/bufpool.h"
 #include "esp_adf/audio_element.h"
 #include "esp_adf/audio_event_iface.h"
 #include "esp_adf/audio_common.h"
@@ -26,16 +29,24 @@
 #include "audio_decoder/aac_decoder.h"
 #include "audio_decoder/m4a_decoder.h"
 #include "audio_decoder/wav_decoder.h"
+#include "audio_extractor/wav_extractor.h"
 
 #include "liteplayer_adapter_internal.h"
 #include "liteplayer_adapter.h"
 #include "liteplayer_config.h"
 #include "liteplayer_source.h"
 #include "liteplayer_parser.h"
+#include "liteplayer_converter.h"
+#include "liteplayer_stats.h"
 #include "liteplayer_main.h"
 
 #define TAG "[liteplayer]core"
 
+#define DEFAULT_DECODE_POLL_USEC (100*1000)
+
+// Shared by players created after liteplayer_workpool_init()
+static workpool_handle g_workpool = NULL;
+
 struct liteplayer {
     const char             *url; // TTS   : tts.mp3
                                  // HTTP  : http://..., https://...
@@ -47,15 +58,21 @@ struct liteplayer {
     liteplayer_state_cb     state_listener;
     void                   *state_userdata;
     bool                    state_error;
+    bool                    state_buffering; // LITEPLAYER_BUFFERING reported with errcode 1
+    bool                    state_nearly_completed; // LITEPLAYER_NEARLYCOMPLETED reported, once per track
 
     liteplayer_adapter_handle_t  adapter_handle;
     struct source_wrapper       *source_ops;
     struct sink_wrapper         *sink_ops;
 
     media_parser_handle_t   media_parser_handle;
+    media_parser_cache_handle_t media_parser_cache;
     struct media_codec_info media_codec_info;
 
     audio_element_handle_t  ael_decoder;
+    workpool_handle         workpool; // NULL if decoder, source and parser run in own threads
+    bufpool_handle          bufpool;  // per-track buffers kept across tracks, NULL to free them every track
+    ringbuf_handle          spare_ringbuf; // out_ringbuf of last track, reused by next set_data_source
 
     struct media_source_info media_source_info;
     media_source_handle_t    media_source_handle;
@@ -68,9 +85,24 @@ struct liteplayer {
     int                     sink_bits;
     long long               sink_position;
     bool                    sink_inited;
+    long long               sink_trim_start; // gapless trimming, in bytes of decoder output,
+    long long               sink_trim_end;   // priming before start and padding after end
+    long long               sink_trim_position;
+    char                   *sink_batch_addr; // coalesce pcm into period-aligned writes
+    int                     sink_batch_size;
+    int                     sink_batch_fill;
+    int                     sink_fixed_samplerate; // liteplayer_set_sink_format(), 0 if not fixed
+    int                     sink_fixed_channels;
+    int                     sink_fixed_bits;
+    media_converter_handle_t sink_converter; // decoder format to the fixed sink format
+    struct media_converter_info sink_converter_info;
 
     int                     seek_time;
     long long               seek_offset;
+
+    struct liteplayer_stats stats;
+    os_mutex                stats_lock;
+    unsigned long long      stats_prepare_usec;
 };
 
 static int audio_source_open(audio_element_handle_t self, void *ctx)
@@ -89,9 +121,73 @@ static int audio_source_open(audio_element_handle_t self, void *ctx)
     return AEL_IO_OK;
 }
 
+static void media_player_state_callback(liteplayer_handle_t handle, enum liteplayer_state state, int errcode);
+
+static void audio_source_read_done(liteplayer_handle_t handle)
+{
+    // Same as inputdone event of async source, let listplayer prepare the next track
+    os_mutex_lock(handle->state_lock);
+    OS_LOGD(TAG, "[ %s-source ] Receive inputdone event", handle->source_ops->url_protocol());
+    media_player_state_callback(handle, LITEPLAYER_NEARLYCOMPLETED, 0);
+    os_mutex_unlock(handle->state_lock);
+}
+
+static int audio_source_ops_read(liteplayer_handle_t handle, char *buffer, int size)
+{
+    unsigned long long begin = os_monotonic_usec();
+    int ret = handle->source_ops->read(handle->media_source_info.source_handle, buffer, size);
+    liteplayer_stats_record(handle->stats_lock, &handle->stats.source_read, os_monotonic_usec() - begin, ret);
+    return ret;
+}
+
+static int audio_source_peek(audio_element_handle_t self, const char **buffer, int len, int timeout_ms, void *ctx)
+{
+    liteplayer_handle_t handle = (liteplayer_handle_t)ctx;
+    int bytes_remain = rb_bytes_filled(handle->media_source_info.out_ringbuf);
+    if (bytes_remain > 0) {
+        // Parser saved the data behind reused source handle, rewind to borrow it in place
+        source_handle_t source = handle->media_source_info.source_handle;
+        long long pos = handle->source_ops->content_pos(source) - bytes_remain;
+        if (handle->source_ops->seek(source, (long)pos) != 0) {
+            OS_LOGE(TAG, "Failed to rewind source to %lld", pos);
+            return AEL_IO_FAIL;
+        }
+        rb_reset(handle->media_source_info.out_ringbuf);
+    }
+    unsigned long long begin = os_monotonic_usec();
+    int ret = handle->source_ops->peek(handle->media_source_info.source_handle, buffer, len);
+    liteplayer_stats_record(handle->stats_lock, &handle->stats.source_read, os_monotonic_usec() - begin, ret);
+    if (ret < 0 || ret > len) {
+        OS_LOGE(TAG, "Failed to peek source, ret:%d", ret);
+        return AEL_IO_FAIL;
+    } else if (ret == 0) {
+        audio_source_read_done(handle);
+        return AEL_IO_DONE;
+    }
+    return ret;
+}
+
+static void audio_source_consume(audio_element_handle_t self, int len, void *ctx)
+{
+    liteplayer_handle_t handle = (liteplayer_handle_t)ctx;
+    handle->source_ops->consume(handle->media_source_info.source_handle, len);
+}
+
 static int audio_source_read(audio_element_handle_t self, char *buffer, int len, int timeout_ms, void *ctx)
 {
     liteplayer_handle_t handle = (liteplayer_handle_t)ctx;
+
+    // Copy from source memory directly, source buffer isn't needed
+    if (handle->source_ops->peek != NULL && handle->source_ops->consume != NULL) {
+        const char *data = NULL;
+        int ret = audio_source_peek(self, &data, len, timeout_ms, ctx);
+        if (ret > 0) {
+            memcpy(buffer, data, ret);
+            audio_source_consume(self, ret, ctx);
+        }
+        return ret;
+    }
+
     int bytes_remain = rb_bytes_filled(handle->media_source_info.out_ringbuf);
     if (bytes_remain >= len) {
         rb_read_chunk(handle->media_source_info.out_ringbuf, buffer, len, 0);
@@ -104,13 +200,12 @@ static int audio_source_read(audio_element_handle_t self, char *buffer, int len,
     int bytes_want = len - bytes_remain;
     int bytes_read = 0;
     if (bytes_want < handle->source_buffer_size/2) {
-        bytes_read = handle->source_ops->read(handle->media_source_info.source_handle,
-                                              handle->source_buffer_addr,
-                                              handle->source_buffer_size);
+        bytes_read = audio_source_ops_read(handle, handle->source_buffer_addr, handle->source_buffer_size);
         if (bytes_read < 0 || bytes_read > handle->source_buffer_size) {
             OS_LOGE(TAG, "Failed to read source, ret:%d", bytes_read);
             return AEL_IO_FAIL;
         } else if (bytes_read == 0) {
+            audio_source_read_done(handle);
             return AEL_IO_DONE;
         } else if (bytes_read > bytes_want) {
             memcpy(buffer + bytes_remain, handle->source_buffer_addr, bytes_want);
@@ -124,12 +219,12 @@ static int audio_source_read(audio_element_handle_t self, char *buffer, int len,
             return bytes_read + bytes_remain;
         }
     } else {
-        bytes_read = handle->source_ops->read(handle->media_source_info.source_handle,
-                buffer + bytes_remain, bytes_want);
+        bytes_read = audio_source_ops_read(handle, buffer + bytes_remain, bytes_want);
         if (bytes_read < 0 || bytes_read > bytes_want) {
             OS_LOGE(TAG, "Failed to read source, ret:%d", bytes_read);
             return AEL_IO_FAIL;
         } else if (bytes_read == 0) {
+            audio_source_read_done(handle);
             return AEL_IO_DONE;
         } else {
             return bytes_read + bytes_remain;
@@ -148,6 +243,148 @@ static void audio_source_close(audio_element_handle_t self, void *ctx)
     }
 }
 
+// Format the sink is opened with, sink_position is counted in it
+static void audio_sink_get_format(liteplayer_handle_t handle, int *samplerate, int *channels, int *bits)
+{
+    if (handle->sink_fixed_samplerate > 0) {
+        *samplerate = handle->sink_fixed_samplerate;
+        *channels = handle->sink_fixed_channels;
+        *bits = handle->sink_fixed_bits;
+    } else {
+        *samplerate = handle->sink_samplerate;
+        *channels = handle->sink_channels;
+        *bits = handle->sink_bits;
+    }
+}
+
+static void audio_sink_batch_init(liteplayer_handle_t handle)
+{
+    int period_size = 0, buffer_size = 0;
+    int samplerate, channels, bits;
+    audio_sink_get_format(handle, &samplerate, &channels, &bits);
+    int bytes_per_sample = channels*media_converter_sample_size(bits);
+
+    handle->sink_batch_size = 0;
+    if (handle->sink_ops->period_hint == NULL || bytes_per_sample <= 0 ||
+        handle->sink_ops->period_hint(handle->sink_handle, &period_size, &buffer_size) != 0)
+        return;
+
+    period_size -= period_size % bytes_per_sample;
+    if (buffer_size > 0 && period_size >= buffer_size)
+        period_size = buffer_size/2 - (buffer_size/2) % bytes_per_sample;
+    if (period_size <= 0 || period_size > DEFAULT_SINK_WRITE_BATCH_MAX) {
+        OS_LOGW(TAG, "Ignore sink period hint: period:%d, buffer:%d", period_size, buffer_size);
+        return;
+    }
+
+    bufpool_put(handle->bufpool, handle->sink_batch_addr);
+    handle->sink_batch_addr = bufpool_get(handle->bufpool, period_size);
+    if (handle->sink_batch_addr == NULL) {
+        OS_LOGW(TAG, "Failed to allocate sink batch buffer, write pcm unaligned");
+        return;
+    }
+    OS_LOGD(TAG, "Sink period:%d, buffer:%d", period_size, buffer_size);
+    handle->sink_batch_size = period_size;
+}
+
+static int audio_sink_ops_write(liteplayer_handle_t handle, char *buffer, int size)
+{
+    unsigned long long begin = os_monotonic_usec();
+    int ret = handle->sink_ops->write(handle->sink_handle, buffer, size);
+    unsigned long long end = os_monotonic_usec();
+    liteplayer_stats_record(handle->stats_lock, &handle->stats.sink_write, end - begin, ret);
+    if (ret > 0 && handle->stats.first_audio_msec < 0) {
+        os_mutex_lock(handle->stats_lock);
+        handle->stats.first_audio_msec = (int)((end - handle->stats_prepare_usec)/1000);
+        os_mutex_unlock(handle->stats_lock);
+        OS_LOGD(TAG, "First audio written %d ms after prepare", handle->stats.first_audio_msec);
+    }
+    return ret;
+}
+
+static int audio_sink_batch_flush(liteplayer_handle_t handle)
+{
+    int offset = 0;
+    while (offset < handle->sink_batch_fill) {
+        int ret = audio_sink_ops_write(handle, handle->sink_batch_addr + offset,
+                                       handle->sink_batch_fill - offset);
+        if (ret <= 0) {
+            OS_LOGE(TAG, "Failed to flush pcm, ret:%d", ret);
+            handle->sink_batch_fill = 0;
+            return ESP_FAIL;
+        }
+        offset += ret;
+        handle->sink_position += ret;
+    }
+    handle->sink_batch_fill = 0;
+    return ESP_OK;
+}
+
+// Return bytes consumed, pcm not filling a whole period is kept until next write or close
+static int audio_sink_batch_write(liteplayer_handle_t handle, char *buffer, int len)
+{
+    int period = handle->sink_batch_size;
+    int consumed = 0;
+
+    if (period <= 0) {
+        int ret = audio_sink_ops_write(handle, buffer, len);
+        if (ret > 0)
+            handle->sink_position += ret;
+        return ret;
+    }
+
+    while (consumed < len) {
+        int bytes;
+        if (handle->sink_batch_fill == 0 && len - consumed >= period) {
+            // Write whole periods directly, no copying
+            bytes = (len - consumed)/period*period;
+            int ret = audio_sink_ops_write(handle, buffer + consumed, bytes);
+            if (ret < 0 || ret > bytes)
+                return ret < 0 ? ret : ESP_FAIL;
+            handle->sink_position += ret;
+            consumed += ret;
+            if (ret < bytes)
+                break;
+            continue;
+        }
+
+        bytes = period - handle->sink_batch_fill;
+        if (bytes > len - consumed)
+            bytes = len - consumed;
+        memcpy(handle->sink_batch_addr + handle->sink_batch_fill, buffer + consumed, bytes);
+        handle->sink_batch_fill += bytes;
+        consumed += bytes;
+        if (handle->sink_batch_fill == period && audio_sink_batch_flush(handle) != ESP_OK)
+            return ESP_FAIL;
+    }
+    return consumed;
+}
+
+// (Re)create the converter if decoder format changed since it was created
+static int audio_sink_converter_update(liteplayer_handle_t handle)
+{
+    struct media_converter_info *info = &handle->sink_converter_info;
+    if (handle->sink_fixed_samplerate <= 0)
+        return ESP_OK;
+    if (handle->sink_converter != NULL &&
+        info->in_samplerate == handle->sink_samplerate && info->in_channels == handle->sink_channels &&
+        info->in_bits == handle->sink_bits)
+        return ESP_OK;
+
+    if (handle->sink_converter != NULL) {
+        OS_LOGD(TAG, "Decoder format changed, recreate converter");
+        media_converter_deinit(handle->sink_converter);
+    }
+    info->in_samplerate = handle->sink_samplerate;
+    info->in_channels = handle->sink_channels;
+    info->in_bits = handle->sink_bits;
+    info->out_samplerate = handle->sink_fixed_samplerate;
+    info->out_channels = handle->sink_fixed_channels;
+    info->out_bits = handle->sink_fixed_bits;
+    handle->sink_converter = media_converter_init(info);
+    return handle->sink_converter != NULL ? ESP_OK : ESP_FAIL;
+}
+
 static int audio_sink_open(audio_element_handle_t self, void *ctx)
 {
     liteplayer_handle_t handle = (liteplayer_handle_t)ctx;
@@ -155,21 +392,74 @@ static int audio_sink_open(audio_element_handle_t self, void *ctx)
         OS_LOGV(TAG, "Sink not inited, abort opening");
         return AEL_IO_OK;
     }
-    OS_LOGI(TAG, "Opening sink: rate:%d, channels:%d, bits:%d",
-            handle->sink_samplerate, handle->sink_channels, handle->sink_bits);
+    if (audio_sink_converter_update(handle) != ESP_OK) {
+        OS_LOGE(TAG, "Failed to create converter");
+        return AEL_IO_FAIL;
+    }
+    int samplerate, channels, bits;
+    audio_sink_get_format(handle, &samplerate, &channels, &bits);
+    OS_LOGI(TAG, "Opening sink: rate:%d, channels:%d, bits:%d", samplerate, channels, bits);
     if (handle->sink_handle == NULL) {
-        handle->sink_handle = handle->sink_ops->open(handle->sink_samplerate,
-                                                     handle->sink_channels,
-                                                     handle->sink_bits,
+        handle->sink_handle = handle->sink_ops->open(samplerate, channels, bits,
                                                      handle->sink_ops->priv_data);
         if (handle->sink_handle == NULL) {
             OS_LOGE(TAG, "Failed to open sink");
             return AEL_IO_FAIL;
         }
+        audio_sink_batch_init(handle);
     }
     return AEL_IO_OK;
 }
 
+static void audio_sink_trim_init(liteplayer_handle_t handle, int seek_msec)
+{
+    struct media_codec_info *codec = &handle->media_codec_info;
+    int bytes_per_sample = handle->sink_channels*handle->sink_bits/8;
+
+    handle->sink_trim_start = 0;
+    handle->sink_trim_end = 0;
+    handle->sink_trim_position = 0;
+    if (bytes_per_sample <= 0 || codec->codec_samplerate <= 0 ||
+        (codec->priming_samples <= 0 && codec->valid_samples <= 0))
+        return;
+
+    // Gapless info is counted at codec rate, decoder may output at another rate (SBR)
+    long long priming = (long long)codec->priming_samples*handle->sink_samplerate/codec->codec_samplerate;
+    long long valid = codec->valid_samples*handle->sink_samplerate/codec->codec_samplerate;
+    handle->sink_trim_start = priming*bytes_per_sample;
+    if (valid > 0)
+        handle->sink_trim_end = (priming + valid)*bytes_per_sample;
+    // Decoding restarts from the seek point, which is past the priming samples
+    if (seek_msec > 0)
+        handle->sink_trim_position = handle->sink_trim_start +
+            (long long)seek_msec*handle->sink_samplerate/1000*bytes_per_sample;
+}
+
+static int audio_sink_converted_write(liteplayer_handle_t handle, char *out, int out_len)
+{
+    int offset = 0;
+    while (offset < out_len) {
+        int ret = audio_sink_batch_write(handle, out + offset, out_len - offset);
+        if (ret <= 0)
+            return ESP_FAIL;
+        offset += ret;
+    }
+    return ESP_OK;
+}
+
+// Return len if all pcm is converted and written, resampler state can't be rolled back
+static int audio_sink_convert_write(liteplayer_handle_t handle, char *buffer, int len)
+{
+    char *out = NULL;
+
+    if (audio_sink_converter_update(handle) != ESP_OK)
+        return ESP_FAIL;
+    int out_len = media_converter_process(handle->sink_converter, buffer, len, &out);
+    if (out_len < 0 || audio_sink_converted_write(handle, out, out_len) != ESP_OK)
+        return ESP_FAIL;
+    return len;
+}
+
 static int audio_sink_write(audio_element_handle_t self, char *buffer, int len, int timeout_ms, void *ctx)
 {
     liteplayer_handle_t handle = (liteplayer_handle_t)ctx;
@@ -179,9 +469,32 @@ static int audio_sink_write(audio_element_handle_t self, char *buffer, int len,
             return AEL_IO_FAIL;
     }
 
-    int bytes_written = handle->sink_ops->write(handle->sink_handle, buffer, len);
-    if (bytes_written >= 0 && bytes_written <= len) {
-        handle->sink_position += bytes_written;
+    // Drop encoder priming and padding, report them as written
+    int bytes_skip = 0;
+    int bytes_want = len;
+    if (handle->sink_trim_start > 0 || handle->sink_trim_end > 0) {
+        long long position = handle->sink_trim_position;
+        if (position < handle->sink_trim_start)
+            bytes_skip = (int)(handle->sink_trim_start - position < len ? handle->sink_trim_start - position : len);
+        bytes_want = len - bytes_skip;
+        if (handle->sink_trim_end > 0 && position + bytes_skip + bytes_want > handle->sink_trim_end) {
+            long long bytes_remain = handle->sink_trim_end - position - bytes_skip;
+            bytes_want = bytes_remain > 0 ? (int)bytes_remain : 0;
+        }
+        if (bytes_want == 0) {
+            handle->sink_trim_position += len;
+            return len;
+        }
+    }
+
+    int bytes_written;
+    if (handle->sink_fixed_samplerate > 0)
+        bytes_written = audio_sink_convert_write(handle, buffer + bytes_skip, bytes_want);
+    else
+        bytes_written = audio_sink_batch_write(handle, buffer + bytes_skip, bytes_want);
+    if (bytes_written >= 0 && bytes_written <= bytes_want) {
+        bytes_written = (bytes_written == bytes_want) ? len : bytes_skip + bytes_written;
+        handle->sink_trim_position += bytes_written;
     } else {
         OS_LOGE(TAG, "Failed to write pcm, ret:%d", bytes_written);
         bytes_written = AEL_IO_FAIL;
@@ -194,12 +507,46 @@ static void audio_sink_close(audio_element_handle_t self, void *ctx)
     liteplayer_handle_t handle = (liteplayer_handle_t)ctx;
     if (handle->sink_handle != NULL) {
         OS_LOGI(TAG, "Closing sink");
+        // Decoder is done, the resampler still holds the last few msec
+        if (handle->sink_converter != NULL && audio_element_is_finishing(self)) {
+            char *out = NULL;
+            int out_len = media_converter_flush(handle->sink_converter, &out);
+            if (out_len > 0)
+                audio_sink_converted_write(handle, out, out_len);
+        }
+        if (handle->sink_batch_fill > 0)
+            audio_sink_batch_flush(handle);
         handle->sink_ops->close(handle->sink_handle);
         handle->sink_handle = NULL;
     }
     if (audio_element_get_state(self) != AEL_STATE_PAUSED) {
         handle->sink_position = 0;
         handle->sink_inited = false;
+        if (handle->sink_converter != NULL)
+            media_converter_reset(handle->sink_converter);
+    }
+}
+
+static void audio_decoder_process_stats(audio_element_handle_t el, unsigned long long process_usec, int process_len, void *ctx)
+{
+    liteplayer_handle_t handle = (liteplayer_handle_t)ctx;
+    if (process_len <= 0)
+        return;
+
+    liteplayer_stats_record(handle->stats_lock, &handle->stats.decoder_process, process_usec, process_len);
+    if (handle->source_ops->async_mode) {
+        int size = rb_get_size(handle->media_source_info.out_ringbuf);
+        int filled = rb_bytes_filled(handle->media_source_info.out_ringbuf);
+        int bucket = size > 0 ? (int)((long long)filled*LITEPLAYER_STATS_FILL_BUCKETS/size) : 0;
+        if (bucket >= LITEPLAYER_STATS_FILL_BUCKETS)
+            bucket = LITEPLAYER_STATS_FILL_BUCKETS - 1;
+        os_mutex_lock(handle->stats_lock);
+        if (handle->stats.ringbuf_size == 0 || filled < handle->stats.ringbuf_filled_min)
+            handle->stats.ringbuf_filled_min = filled;
+        handle->stats.ringbuf_size = size;
+        handle->stats.ringbuf_filled = filled;
+        handle->stats.ringbuf_histogram[bucket]++;
+        os_mutex_unlock(handle->stats_lock);
     }
 }
 
@@ -212,6 +559,12 @@ static void media_player_state_callback(liteplayer_handle_t handle, enum litepla
                 handle->state_listener(LITEPLAYER_ERROR, errcode, handle->state_userdata);
         }
     } else {
+        // Sync source may hit EOF more than once (e.g. decoder retries the last read)
+        if (state == LITEPLAYER_NEARLYCOMPLETED) {
+            if (handle->state_nearly_completed)
+                return;
+            handle->state_nearly_completed = true;
+        }
         if (!handle->state_error || state == LITEPLAYER_IDLE || state == LITEPLAYER_STOPPED) {
             if (handle->state_listener)
                 handle->state_listener(state, 0, handle->state_userdata);
@@ -219,6 +572,19 @@ static void media_player_state_callback(liteplayer_handle_t handle, enum litepla
     }
 }
 
+static void media_player_buffering_callback(liteplayer_handle_t handle, bool buffering)
+{
+    if (handle->state_buffering == buffering)
+        return;
+    // Report buffering only while playing, and always report its end
+    if (buffering && handle->state != LITEPLAYER_STARTED)
+        return;
+    handle->state_buffering = buffering;
+    OS_LOGD(TAG, "[ %s-source ] Buffering %s", handle->source_ops->url_protocol(), buffering ? "start" : "end");
+    if (!handle->state_error && handle->state_listener)
+        handle->state_listener(LITEPLAYER_BUFFERING, buffering ? 1 : 0, handle->state_userdata);
+}
+
 static int audio_element_state_callback(audio_element_handle_t el, audio_event_iface_msg_t *msg, void *ctx)
 {
     liteplayer_handle_t handle = (liteplayer_handle_t)ctx;
@@ -230,6 +596,7 @@ static int audio_element_state_callback(audio_element_handle_t el, audio_event_i
 
         if (msg->cmd == AEL_MSG_CMD_REPORT_STATUS) {
             switch (el_status) {
+            case AEL_STATUS_ERROR_OPEN:
             case AEL_STATUS_ERROR_INPUT:
             case AEL_STATUS_ERROR_PROCESS:
             case AEL_STATUS_ERROR_OUTPUT:
@@ -242,6 +609,9 @@ static int audio_element_state_callback(audio_element_handle_t el, audio_event_i
 
             case AEL_STATUS_ERROR_TIMEOUT:
                 if (msg->source == (void *)handle->ael_decoder) {
+                    os_mutex_lock(handle->stats_lock);
+                    handle->stats.underruns++;
+                    os_mutex_unlock(handle->stats_lock);
                     OS_LOGW(TAG, "[ %s-%s ] Receive inputtimeout event, filled/total: %d/%d",
                             handle->source_ops->url_protocol(), audio_element_get_tag(el),
                             rb_bytes_filled(handle->media_source_info.out_ringbuf),
@@ -249,6 +619,17 @@ static int audio_element_state_callback(audio_element_handle_t el, audio_event_i
                 }
                 break;
 
+            case AEL_STATUS_INPUT_BUFFERING:
+                // Underruns are already counted by AEL_STATUS_ERROR_TIMEOUT
+                if (msg->source == (void *)handle->ael_decoder)
+                    media_player_buffering_callback(handle, true);
+                break;
+
+            case AEL_STATUS_INPUT_BUFFERED:
+                if (msg->source == (void *)handle->ael_decoder)
+                    media_player_buffering_callback(handle, false);
+                break;
+
             case AEL_STATUS_STATE_RUNNING:
                 if (msg->source == (void *)handle->ael_decoder) {
                     OS_LOGD(TAG, "[ %s-%s ] Receive started event",
@@ -304,6 +685,8 @@ static int audio_element_state_callback(audio_element_handle_t el, audio_event_i
                 handle->sink_samplerate = info.samplerate;
                 handle->sink_channels = info.channels;
                 handle->sink_bits = info.bits;
+                if (handle->sink_position == 0)
+                    audio_sink_trim_init(handle, handle->seek_time);
             }
         }
     }
@@ -383,14 +766,30 @@ static void main_pipeline_deinit(liteplayer_handle_t handle)
     }
 
     if (handle->media_source_info.out_ringbuf != NULL) {
-        rb_destroy(handle->media_source_info.out_ringbuf);
+        // Source and parser don't touch the ringbuf once stopped, keep it for next track
+        if (handle->bufpool != NULL && handle->spare_ringbuf == NULL)
+            handle->spare_ringbuf = handle->media_source_info.out_ringbuf;
+        else
+            rb_destroy(handle->media_source_info.out_ringbuf);
         handle->media_source_info.out_ringbuf = NULL;
     }
 
     if (handle->source_buffer_addr != NULL) {
-        audio_free(handle->source_buffer_addr);
+        bufpool_put(handle->bufpool, handle->source_buffer_addr);
         handle->source_buffer_addr = NULL;
     }
+
+    if (handle->sink_batch_addr != NULL) {
+        bufpool_put(handle->bufpool, handle->sink_batch_addr);
+        handle->sink_batch_addr = NULL;
+    }
+    handle->sink_batch_size = 0;
+    handle->sink_batch_fill = 0;
+
+    if (handle->sink_converter != NULL) {
+        media_converter_deinit(handle->sink_converter);
+        handle->sink_converter = NULL;
+    }
 }
 
 static int main_pipeline_init(liteplayer_handle_t handle)
@@ -403,6 +802,7 @@ static int main_pipeline_init(liteplayer_handle_t handle)
             mp3_cfg.task_prio            = DEFAULT_MEDIA_DECODER_TASK_PRIO;
             mp3_cfg.task_stack           = DEFAULT_MEDIA_DECODER_TASK_STACKSIZE;
             mp3_cfg.mp3_info             = &(handle->media_codec_info.detail.mp3_info);
+            mp3_cfg.bufpool              = handle->bufpool;
             handle->ael_decoder = mp3_decoder_init(&mp3_cfg);
             break;
         }
@@ -411,6 +811,7 @@ static int main_pipeline_init(liteplayer_handle_t handle)
             aac_cfg.task_prio            = DEFAULT_MEDIA_DECODER_TASK_PRIO;
             aac_cfg.task_stack           = DEFAULT_MEDIA_DECODER_TASK_STACKSIZE;
             aac_cfg.aac_info             = &(handle->media_codec_info.detail.aac_info);
+            aac_cfg.bufpool              = handle->bufpool;
             handle->ael_decoder = aac_decoder_init(&aac_cfg);
             break;
         }
@@ -419,6 +820,7 @@ static int main_pipeline_init(liteplayer_handle_t handle)
             m4a_cfg.task_prio            = DEFAULT_MEDIA_DECODER_TASK_PRIO;
             m4a_cfg.task_stack           = DEFAULT_MEDIA_DECODER_TASK_STACKSIZE;
             m4a_cfg.m4a_info             = &(handle->media_codec_info.detail.m4a_info);
+            m4a_cfg.bufpool              = handle->bufpool;
             handle->ael_decoder = m4a_decoder_init(&m4a_cfg);
             break;
         }
@@ -427,6 +829,7 @@ static int main_pipeline_init(liteplayer_handle_t handle)
             wav_cfg.task_prio            = DEFAULT_MEDIA_DECODER_TASK_PRIO;
             wav_cfg.task_stack           = DEFAULT_MEDIA_DECODER_TASK_STACKSIZE;
             wav_cfg.wav_info             = &(handle->media_codec_info.detail.wav_info);
+            wav_cfg.bufpool              = handle->bufpool;
             handle->ael_decoder = wav_decoder_init(&wav_cfg);
             break;
         }
@@ -458,6 +861,7 @@ static int main_pipeline_init(liteplayer_handle_t handle)
         handle->sink_samplerate = handle->media_codec_info.codec_samplerate;
         handle->sink_channels = handle->media_codec_info.codec_channels;
         handle->sink_bits = handle->media_codec_info.codec_bits;
+        audio_sink_trim_init(handle, handle->seek_time);
         stream_callback_t audio_sink = {
             .open = audio_sink_open,
             .write = audio_sink_write,
@@ -471,26 +875,35 @@ static int main_pipeline_init(liteplayer_handle_t handle)
         OS_LOGD(TAG, "[1.2] Create source element, async mode, ringbuf size: %d", handle->source_ops->buffer_size);
         audio_element_set_input_ringbuf(handle->ael_decoder, handle->media_source_info.out_ringbuf);
         handle->media_source_info.content_pos = handle->media_codec_info.content_pos + handle->seek_offset;
+        handle->media_source_info.bytes_per_sec = handle->media_codec_info.bytes_per_sec;
         handle->media_source_handle =
             media_source_start_async(&handle->media_source_info, media_source_state_callback, handle);
         AUDIO_MEM_CHECK(TAG, handle->media_source_handle, return ESP_FAIL);
     } else {
         OS_LOGD(TAG, "[1.2] Create source element, sync mode, ringbuf size: %d", handle->source_ops->buffer_size);
-        handle->source_buffer_size = handle->source_ops->buffer_size;
-        handle->source_buffer_addr = audio_malloc(handle->source_buffer_size);
-        AUDIO_MEM_CHECK(TAG, handle->source_buffer_addr, return ESP_FAIL);
         stream_callback_t audio_source = {
             .open = audio_source_open,
             .read = audio_source_read,
             .close = audio_source_close,
             .ctx = handle,
         };
+        if (handle->source_ops->peek != NULL && handle->source_ops->consume != NULL) {
+            // Decoders borrow data from source memory in place
+            audio_source.peek = audio_source_peek;
+            audio_source.consume = audio_source_consume;
+        } else {
+            handle->source_buffer_size = handle->source_ops->buffer_size;
+            handle->source_buffer_addr = bufpool_get(handle->bufpool, handle->source_buffer_size);
+            AUDIO_MEM_CHECK(TAG, handle->source_buffer_addr, return ESP_FAIL);
+        }
         audio_element_set_read_cb(handle->ael_decoder, &audio_source);
     }
 
     {
         OS_LOGD(TAG, "[2.0] Register event callback of decoder elements");
         audio_element_set_event_callback(handle->ael_decoder, audio_element_state_callback, handle);
+        audio_element_set_process_stats_callback(handle->ael_decoder, audio_decoder_process_stats, handle);
+        audio_element_set_workpool(handle->ael_decoder, handle->workpool);
     }
 
     {
@@ -502,17 +915,56 @@ static int main_pipeline_init(liteplayer_handle_t handle)
     return ESP_OK;
 }
 
+int liteplayer_workpool_init(int workers)
+{
+    if (g_workpool != NULL)
+        return ESP_OK;
+
+    struct os_thread_attr attr = {
+        .name = "ael-worker",
+        .priority = DEFAULT_WORKPOOL_TASK_PRIO,
+        .stacksize = DEFAULT_WORKPOOL_TASK_STACKSIZE,
+        .joinable = true,
+    };
+    g_workpool = workpool_create(&attr, workers);
+    if (g_workpool == NULL)
+        return ESP_FAIL;
+    OS_LOGI(TAG, "Players run on workpool with %d workers", workpool_worker_count(g_workpool));
+    return ESP_OK;
+}
+
+void liteplayer_workpool_deinit()
+{
+    if (g_workpool != NULL) {
+        workpool_destroy(g_workpool);
+        g_workpool = NULL;
+    }
+}
+
 liteplayer_handle_t liteplayer_create()
 {
     liteplayer_handle_t handle = audio_calloc(1, sizeof(struct liteplayer));
     if (handle != NULL) {
         handle->state = LITEPLAYER_IDLE;
+        handle->workpool = g_workpool;
         handle->io_lock = os_mutex_create();
         handle->state_lock = os_mutex_create();
+        handle->stats_lock = os_mutex_create();
         handle->adapter_handle = liteplayer_adapter_init();
-        if (handle->io_lock == NULL || handle->state_lock == NULL || handle->adapter_handle == NULL) {
+        if (handle->io_lock == NULL || handle->state_lock == NULL || handle->stats_lock == NULL ||
+            handle->adapter_handle == NULL) {
             goto create_fail;
         }
+    #if DEFAULT_LITEPLAYER_BUFPOOL
+        handle->bufpool = bufpool_create();
+        if (handle->bufpool == NULL)
+            OS_LOGW(TAG, "Failed to create buffer pool, allocate buffers every track");
+    #endif
+    #if DEFAULT_MEDIA_PARSER_CACHE_ENTRIES > 0
+        handle->media_parser_cache = media_parser_cache_create(DEFAULT_MEDIA_PARSER_CACHE_ENTRIES);
+        if (handle->media_parser_cache == NULL)
+            OS_LOGW(TAG, "Failed to create media parser cache, always parse header");
+    #endif
     }
     return handle;
 
@@ -521,6 +973,8 @@ create_fail:
         os_mutex_destroy(handle->io_lock);
     if (handle->state_lock != NULL)
         os_mutex_destroy(handle->state_lock);
+    if (handle->stats_lock != NULL)
+        os_mutex_destroy(handle->stats_lock);
     if (handle->adapter_handle != NULL)
         handle->adapter_handle->destory(handle->adapter_handle);
     audio_free(handle);
@@ -559,6 +1013,59 @@ int liteplayer_register_sink_wrapper(liteplayer_handle_t handle, struct sink_wra
     return ret;
 }
 
+int liteplayer_set_sink_format(liteplayer_handle_t handle, int samplerate, int channels, int bits)
+{
+    if (handle == NULL)
+        return ESP_FAIL;
+    if (samplerate > 0 && (channels <= 0 ||
+        (bits != 16 && bits != 24 && bits != 32 && bits != LITEPLAYER_SINK_BITS_FLOAT))) {
+        OS_LOGE(TAG, "Invalid sink format: rate:%d, channels:%d, bits:%d", samplerate, channels, bits);
+        return ESP_FAIL;
+    }
+
+    os_mutex_lock(handle->io_lock);
+    if (handle->state != LITEPLAYER_IDLE) {
+        OS_LOGE(TAG, "Can't set sink format in state=[%d]", handle->state);
+        os_mutex_unlock(handle->io_lock);
+        return ESP_FAIL;
+    }
+    handle->sink_fixed_samplerate = samplerate > 0 ? samplerate : 0;
+    handle->sink_fixed_channels = samplerate > 0 ? channels : 0;
+    handle->sink_fixed_bits = samplerate > 0 ? bits : 0;
+    os_mutex_unlock(handle->io_lock);
+    return ESP_OK;
+}
+
+int liteplayer_reserve_buffers(liteplayer_handle_t handle, int size, int count)
+{
+    if (handle == NULL || size <= 0 || count <= 0)
+        return ESP_FAIL;
+    if (handle->bufpool == NULL) {
+        OS_LOGE(TAG, "Buffer pool is disabled");
+        return ESP_FAIL;
+    }
+
+    if (bufpool_reserve(handle->bufpool, size, count) != 0) {
+        OS_LOGE(TAG, "Failed to reserve %d buffers of %d bytes", count, size);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void liteplayer_trim_buffers(liteplayer_handle_t handle)
+{
+    if (handle == NULL)
+        return;
+
+    os_mutex_lock(handle->io_lock);
+    if (handle->spare_ringbuf != NULL) {
+        rb_destroy(handle->spare_ringbuf);
+        handle->spare_ringbuf = NULL;
+    }
+    bufpool_trim(handle->bufpool);
+    os_mutex_unlock(handle->io_lock);
+}
+
 int liteplayer_register_state_listener(liteplayer_handle_t handle, liteplayer_state_cb listener, void *listener_priv)
 {
     if (handle == NULL || listener == NULL)
@@ -607,12 +1114,35 @@ int liteplayer_set_data_source(liteplayer_handle_t handle, const char *url)
             handle->source_ops->url_protocol(), handle->sink_ops->name());
 
     handle->state_error = false;
+    handle->state_buffering = false;
+    handle->state_nearly_completed = false;
     handle->url = audio_strdup(url);
     AUDIO_MEM_CHECK(TAG, handle->url, goto set_fail);
 
     handle->media_source_info.url = handle->url;
     handle->media_source_info.source_ops = handle->source_ops;
-    handle->media_source_info.out_ringbuf = rb_create(handle->source_ops->buffer_size);
+    handle->media_source_info.read_stats = &handle->stats.source_read;
+    handle->media_source_info.stats_lock = handle->stats_lock;
+    handle->media_source_info.workpool = handle->workpool;
+    handle->media_source_info.bufpool = handle->bufpool;
+    if (handle->spare_ringbuf != NULL) {
+        // May have grown for buffering last track, shrink back to the size of this source
+        rb_reset(handle->spare_ringbuf);
+        // Drop watermark of last track, a sync source never fills it and reader would block
+        rb_set_threshold(handle->spare_ringbuf, 0);
+        if (rb_resize(handle->spare_ringbuf, handle->source_ops->buffer_size) == RB_OK)
+            handle->media_source_info.out_ringbuf = handle->spare_ringbuf;
+        else
+            rb_destroy(handle->spare_ringbuf);
+        handle->spare_ringbuf = NULL;
+    }
+    if (handle->media_source_info.out_ringbuf == NULL) {
+#if DEFAULT_MEDIA_SOURCE_RINGBUF_SPSC
+        handle->media_source_info.out_ringbuf = rb_create_spsc(handle->source_ops->buffer_size);
+#else
+        handle->media_source_info.out_ringbuf = rb_create(handle->source_ops->buffer_size);
+#endif
+    }
     AUDIO_MEM_CHECK(TAG, handle->media_source_info.out_ringbuf, goto set_fail);
 
     {
@@ -638,6 +1168,15 @@ set_fail:
     return ESP_FAIL;
 }
 
+static void liteplayer_stats_reset(liteplayer_handle_t handle)
+{
+    os_mutex_lock(handle->stats_lock);
+    memset(&handle->stats, 0, sizeof(handle->stats));
+    handle->stats.first_audio_msec = -1;
+    handle->stats_prepare_usec = os_monotonic_usec();
+    os_mutex_unlock(handle->stats_lock);
+}
+
 int liteplayer_prepare(liteplayer_handle_t handle)
 {
     if (handle == NULL)
@@ -652,8 +1191,10 @@ int liteplayer_prepare(liteplayer_handle_t handle)
         os_mutex_unlock(handle->io_lock);
         return ESP_FAIL;
     }
+    liteplayer_stats_reset(handle);
 
-    int ret = media_parser_get_codec_info(&handle->media_source_info, &handle->media_codec_info);
+    int ret = media_parser_get_codec_info(&handle->media_source_info, handle->media_parser_cache,
+                                          &handle->media_codec_info);
     if (ret == ESP_OK)
         ret = main_pipeline_init(handle);
 
@@ -682,10 +1223,12 @@ int liteplayer_prepare_async(liteplayer_handle_t handle)
         os_mutex_unlock(handle->io_lock);
         return ESP_FAIL;
     }
+    liteplayer_stats_reset(handle);
 
     int ret = ESP_OK;
     if (handle->source_ops->async_mode) {
         handle->media_parser_handle = media_parser_start_async(&handle->media_source_info,
+                                                               handle->media_parser_cache,
                                                                media_parser_state_callback,
                                                                handle);
         if (handle->media_parser_handle == NULL) {
@@ -696,7 +1239,8 @@ int liteplayer_prepare_async(liteplayer_handle_t handle)
             os_mutex_unlock(handle->state_lock);
         }
     } else {
-        ret = media_parser_get_codec_info(&handle->media_source_info, &handle->media_codec_info);
+        ret = media_parser_get_codec_info(&handle->media_source_info, handle->media_parser_cache,
+                                          &handle->media_codec_info);
         if (ret == ESP_OK)
             ret = main_pipeline_init(handle);
         os_mutex_lock(handle->state_lock);
@@ -740,9 +1284,8 @@ int liteplayer_start(liteplayer_handle_t handle)
         if (handle->ael_decoder == NULL)
             ret = ESP_FAIL;
     }
-    if (ret == ESP_OK)
-        ret = audio_element_resume(handle->ael_decoder, 0, 0);
-
+    // Switch to started before resuming decoder, short media may be finished
+    // before audio_element_resume() returns
     {
         os_mutex_lock(handle->state_lock);
         handle->state = (ret == ESP_OK) ? LITEPLAYER_STARTED : LITEPLAYER_ERROR;
@@ -750,6 +1293,16 @@ int liteplayer_start(liteplayer_handle_t handle)
         os_mutex_unlock(handle->state_lock);
     }
 
+    if (ret == ESP_OK) {
+        ret = audio_element_resume(handle->ael_decoder, 0, 0);
+        if (ret != ESP_OK) {
+            os_mutex_lock(handle->state_lock);
+            handle->state = LITEPLAYER_ERROR;
+            media_player_state_callback(handle, handle->state, ret);
+            os_mutex_unlock(handle->state_lock);
+        }
+    }
+
     os_mutex_unlock(handle->io_lock);
     return ret;
 }
@@ -815,7 +1368,7 @@ int liteplayer_seek(liteplayer_handle_t handle, int msec)
     if (handle == NULL || msec < 0)
         return ESP_FAIL;
 
-    OS_LOGI(TAG, "Seeking player[%s], offset=%d(s)", handle->source_ops->url_protocol(), (int)(msec/1000));
+    OS_LOGI(TAG, "Seeking player[%s], offset=%d(ms)", handle->source_ops->url_protocol(), msec);
 
     int ret = ESP_FAIL;
     bool state_sync = false;
@@ -834,15 +1387,16 @@ int liteplayer_seek(liteplayer_handle_t handle, int msec)
         goto seek_out;
     }
 
-    long long offset = media_parser_get_seek_offset(&handle->media_codec_info, msec);
+    long long offset = media_parser_get_seek_offset(&handle->media_source_info, &handle->media_codec_info, msec);
     if (offset < 0) {
         ret = ESP_OK;
         goto seek_out;
     }
 
-    handle->seek_time = (msec/1000)*1000;
+    handle->seek_time = msec;
     handle->seek_offset = offset;
     handle->sink_position = 0;
+    audio_sink_trim_init(handle, msec);
 
     state_sync = true;
 
@@ -859,6 +1413,8 @@ int liteplayer_seek(liteplayer_handle_t handle, int msec)
         ret = audio_element_pause(handle->ael_decoder);
         if (ret != ESP_OK)
             goto seek_out;
+        if (handle->sink_converter != NULL)
+            media_converter_reset(handle->sink_converter);
 
         if (handle->media_source_handle != NULL) {
             media_source_stop(handle->media_source_handle);
@@ -884,6 +1440,10 @@ int liteplayer_seek(liteplayer_handle_t handle, int msec)
                 .close = audio_source_close,
                 .ctx = handle,
             };
+            if (handle->source_ops->peek != NULL && handle->source_ops->consume != NULL) {
+                audio_source.peek = audio_source_peek;
+                audio_source.consume = audio_source_consume;
+            }
             audio_element_set_read_cb(handle->ael_decoder, &audio_source);
         }
     }
@@ -963,19 +1523,7 @@ int liteplayer_reset(liteplayer_handle_t handle)
         handle->url = NULL;
     }
 
-    if (handle->media_codec_info.codec_type == AUDIO_CODEC_M4A) {
-        if (handle->media_codec_info.detail.m4a_info.stsz_samplesize != NULL)
-            audio_free(handle->media_codec_info.detail.m4a_info.stsz_samplesize);
-        if (handle->media_codec_info.detail.m4a_info.stts_time2sample != NULL)
-            audio_free(handle->media_codec_info.detail.m4a_info.stts_time2sample);
-        if (handle->media_codec_info.detail.m4a_info.stsc_sample2chunk != NULL)
-            audio_free(handle->media_codec_info.detail.m4a_info.stsc_sample2chunk);
-        if (handle->media_codec_info.detail.m4a_info.stco_chunk2offset != NULL)
-            audio_free(handle->media_codec_info.detail.m4a_info.stco_chunk2offset);
-    } else if (handle->media_codec_info.codec_type == AUDIO_CODEC_WAV) {
-        if (handle->media_codec_info.detail.wav_info.header_buff != NULL)
-            audio_free(handle->media_codec_info.detail.wav_info.header_buff);
-    }
+    media_parser_release_codec_info(&handle->media_codec_info);
 
     memset(&handle->media_source_info, 0x0, sizeof(handle->media_source_info));
     memset(&handle->media_codec_info, 0x0, sizeof(handle->media_codec_info));
@@ -1014,9 +1562,8 @@ int liteplayer_get_position(liteplayer_handle_t handle, int *msec)
     if (handle == NULL || msec == NULL)
         return ESP_FAIL;
 
-    int samplerate = handle->sink_samplerate;
-    int channels = handle->sink_channels;
-    int bits = handle->sink_bits;
+    int samplerate, channels, bits;
+    audio_sink_get_format(handle, &samplerate, &channels, &bits);
     long long position = handle->sink_position;
     int seek_time = handle->seek_time;
 
@@ -1025,7 +1572,7 @@ int liteplayer_get_position(liteplayer_handle_t handle, int *msec)
         return ESP_OK;
     }
 
-    int bytes_per_sample = channels * bits / 8;
+    int bytes_per_sample = channels * media_converter_sample_size(bits);
     long long out_samples = position / bytes_per_sample;
     *msec = (int)(out_samples/(samplerate/1000) + seek_time);
     return ESP_OK;
@@ -1043,6 +1590,17 @@ int liteplayer_get_duration(liteplayer_handle_t handle, int *msec)
     return ESP_OK;
 }
 
+int liteplayer_get_stats(liteplayer_handle_t handle, struct liteplayer_stats *stats)
+{
+    if (handle == NULL || stats == NULL)
+        return ESP_FAIL;
+
+    os_mutex_lock(handle->stats_lock);
+    memcpy(stats, &handle->stats, sizeof(struct liteplayer_stats));
+    os_mutex_unlock(handle->stats_lock);
+    return ESP_OK;
+}
+
 void liteplayer_destroy(liteplayer_handle_t handle)
 {
     if (handle == NULL)
@@ -1051,8 +1609,237 @@ void liteplayer_destroy(liteplayer_handle_t handle)
     if (handle->state != LITEPLAYER_IDLE)
         liteplayer_reset(handle);
 
+    if (handle->media_parser_cache != NULL)
+        media_parser_cache_destroy(handle->media_parser_cache);
+    if (handle->spare_ringbuf != NULL)
+        rb_destroy(handle->spare_ringbuf);
+    bufpool_destroy(handle->bufpool);
     handle->adapter_handle->destory(handle->adapter_handle);
     os_mutex_destroy(handle->state_lock);
+    os_mutex_destroy(handle->stats_lock);
     os_mutex_destroy(handle->io_lock);
     audio_free(handle);
 }
+
+struct liteplayer_decode_priv {
+    struct liteplayer_decode_cfg *cfg;
+    struct liteplayer_decode_result *result;
+    FILE                   *wav_file;
+    os_mutex                lock;
+    os_cond                 cond;
+    enum liteplayer_state   state; // LITEPLAYER_COMPLETED, LITEPLAYER_ERROR or LITEPLAYER_STOPPED once done
+};
+
+static void liteplayer_decode_put_le(char *buf, unsigned int value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        buf[i] = (char)((value >> (8*i)) & 0xFF);
+}
+
+static void liteplayer_decode_wav_header(char *header, int samplerate, int channels, int bits, long long datasize)
+{
+    int container = bits == LITEPLAYER_SINK_BITS_FLOAT ? 32 : bits;
+    int block_align = channels*container/8;
+    if (datasize > 0x7FFFFFFF - (long long)sizeof(wav_header_t))
+        datasize = 0x7FFFFFFF - (long long)sizeof(wav_header_t);
+
+    memcpy(header, "RIFF", 4);
+    liteplayer_decode_put_le(header + 4, (unsigned int)(datasize + sizeof(wav_header_t) - 8), 4);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    liteplayer_decode_put_le(header + 16, 16, 4);
+    liteplayer_decode_put_le(header + 20, bits == LITEPLAYER_SINK_BITS_FLOAT ? WAV_FMT_IEEE_FLOAT : WAV_FMT_PCM, 2);
+    liteplayer_decode_put_le(header + 22, channels, 2);
+    liteplayer_decode_put_le(header + 24, samplerate, 4);
+    liteplayer_decode_put_le(header + 28, samplerate*block_align, 4);
+    liteplayer_decode_put_le(header + 32, block_align, 2);
+    liteplayer_decode_put_le(header + 34, container, 2);
+    memcpy(header + 36, "data", 4);
+    liteplayer_decode_put_le(header + 40, (unsigned int)datasize, 4);
+}
+
+static const char *liteplayer_decode_sink_name()
+{
+    return "decode";
+}
+
+static sink_handle_t liteplayer_decode_sink_open(int samplerate, int channels, int bits, void *priv_data)
+{
+    struct liteplayer_decode_priv *priv = (struct liteplayer_decode_priv *)priv_data;
+    struct liteplayer_decode_cfg *cfg = priv->cfg;
+
+    priv->result->samplerate = samplerate;
+    priv->result->channels = channels;
+    priv->result->bits = bits;
+    if (cfg->pcm_write != NULL || cfg->pcm_buffer != NULL || priv->wav_file != NULL)
+        return priv;
+
+    char header[sizeof(wav_header_t)] = {0};
+    if (bits == 24) {
+        OS_LOGE(TAG, "Can't write 24 bits pcm in 4 bytes to wav file");
+        return NULL;
+    }
+    priv->wav_file = fopen(cfg->wav_path, "wb");
+    if (priv->wav_file == NULL) {
+        OS_LOGE(TAG, "Failed to open wav file:%s", cfg->wav_path);
+        return NULL;
+    }
+    // Header is written again with the data size when closing
+    if (fwrite(header, 1, sizeof(header), priv->wav_file) != sizeof(header)) {
+        OS_LOGE(TAG, "Failed to write wav header");
+        fclose(priv->wav_file);
+        priv->wav_file = NULL;
+        return NULL;
+    }
+    return priv;
+}
+
+static int liteplayer_decode_sink_write(sink_handle_t handle, char *buffer, int size)
+{
+    struct liteplayer_decode_priv *priv = (struct liteplayer_decode_priv *)handle;
+    struct liteplayer_decode_cfg *cfg = priv->cfg;
+    struct liteplayer_decode_result *result = priv->result;
+    int ret;
+
+    if (cfg->pcm_write != NULL) {
+        ret = cfg->pcm_write(buffer, size, cfg->pcm_priv);
+    } else if (cfg->pcm_buffer != NULL) {
+        // Fail the write once the buffer is full, decoder stops with an error
+        long long space = cfg->pcm_buffer_size - result->pcm_bytes;
+        ret = size < space ? size : (int)space;
+        if (ret > 0)
+            memcpy(cfg->pcm_buffer + result->pcm_bytes, buffer, ret);
+        if (ret < size) {
+            OS_LOGW(TAG, "Decode buffer is full, stop decoding");
+            result->truncated = true;
+            if (ret <= 0)
+                return ESP_FAIL;
+        }
+    } else {
+        ret = (int)fwrite(buffer, 1, size, priv->wav_file);
+    }
+    if (ret > 0)
+        result->pcm_bytes += ret;
+    return ret;
+}
+
+static void liteplayer_decode_sink_close(sink_handle_t handle)
+{
+    struct liteplayer_decode_priv *priv = (struct liteplayer_decode_priv *)handle;
+    struct liteplayer_decode_result *result = priv->result;
+
+    if (priv->wav_file != NULL) {
+        char header[sizeof(wav_header_t)];
+        liteplayer_decode_wav_header(header, result->samplerate, result->channels, result->bits,
+                                     result->pcm_bytes);
+        fseek(priv->wav_file, 0, SEEK_SET);
+        fwrite(header, 1, sizeof(header), priv->wav_file);
+        fclose(priv->wav_file);
+        priv->wav_file = NULL;
+    }
+}
+
+static int liteplayer_decode_state_callback(enum liteplayer_state state, int errcode, void *priv_data)
+{
+    struct liteplayer_decode_priv *priv = (struct liteplayer_decode_priv *)priv_data;
+    if (state == LITEPLAYER_COMPLETED || state == LITEPLAYER_ERROR || state == LITEPLAYER_STOPPED) {
+        os_mutex_lock(priv->lock);
+        priv->state = state;
+        os_cond_signal(priv->cond);
+        os_mutex_unlock(priv->lock);
+    }
+    return ESP_OK;
+}
+
+int liteplayer_decode(const char *url, struct liteplayer_decode_cfg *cfg, struct liteplayer_decode_result *result)
+{
+    if (url == NULL || cfg == NULL || result == NULL)
+        return ESP_FAIL;
+    if ((cfg->pcm_write == NULL && cfg->pcm_buffer == NULL && cfg->wav_path == NULL) ||
+        (cfg->pcm_buffer != NULL && cfg->pcm_buffer_size <= 0)) {
+        OS_LOGE(TAG, "No output to decode to");
+        return ESP_FAIL;
+    }
+
+    struct liteplayer_decode_priv priv = {
+        .cfg = cfg,
+        .result = result,
+        .state = LITEPLAYER_IDLE,
+    };
+    struct sink_wrapper sink_ops = {
+        .priv_data = &priv,
+        .name = liteplayer_decode_sink_name,
+        .open = liteplayer_decode_sink_open,
+        .write = liteplayer_decode_sink_write,
+        .close = liteplayer_decode_sink_close,
+        .period_hint = NULL,
+    };
+    liteplayer_handle_t handle = NULL;
+    int ret = ESP_FAIL;
+
+    memset(result, 0x0, sizeof(struct liteplayer_decode_result));
+    OS_LOGI(TAG, "Decoding: %s", url);
+
+    priv.lock = os_mutex_create();
+    priv.cond = os_cond_create();
+    handle = liteplayer_create();
+    if (priv.lock == NULL || priv.cond == NULL || handle == NULL)
+        goto decode_out;
+
+    if (cfg->source_wrapper != NULL &&
+        liteplayer_register_source_wrapper(handle, cfg->source_wrapper) != ESP_OK)
+        goto decode_out;
+    if (liteplayer_register_sink_wrapper(handle, &sink_ops) != ESP_OK ||
+        liteplayer_set_sink_format(handle, cfg->samplerate, cfg->channels, cfg->bits) != ESP_OK ||
+        liteplayer_register_state_listener(handle, liteplayer_decode_state_callback, &priv) != ESP_OK ||
+        liteplayer_set_data_source(handle, url) != ESP_OK)
+        goto decode_out;
+
+    // No prepare and start, nobody else drives this player
+    ret = media_parser_get_codec_info(&handle->media_source_info, handle->media_parser_cache,
+                                      &handle->media_codec_info);
+    if (ret == ESP_OK)
+        ret = main_pipeline_init(handle);
+    if (ret != ESP_OK)
+        goto decode_out;
+
+    os_mutex_lock(handle->state_lock);
+    handle->state = LITEPLAYER_STARTED;
+    os_mutex_unlock(handle->state_lock);
+    ret = audio_element_resume(handle->ael_decoder, 0, 0);
+    if (ret != ESP_OK)
+        goto decode_out;
+
+    // Errors are reported before the element stops, a decoder stopped without a
+    // state reported means an error path that isn't mapped, don't wait forever
+    os_mutex_lock(priv.lock);
+    while (priv.state == LITEPLAYER_IDLE) {
+        audio_element_state_t el_state = audio_element_get_state(handle->ael_decoder);
+        if (el_state == AEL_STATE_ERROR || el_state == AEL_STATE_STOPPED) {
+            OS_LOGE(TAG, "Decoder stopped with state:%d", el_state);
+            priv.state = LITEPLAYER_ERROR;
+            break;
+        }
+        os_cond_timedwait(priv.cond, priv.lock, DEFAULT_DECODE_POLL_USEC);
+    }
+    os_mutex_unlock(priv.lock);
+    ret = (priv.state == LITEPLAYER_COMPLETED || result->truncated) ? ESP_OK : ESP_FAIL;
+
+decode_out:
+    if (handle != NULL) {
+        if (handle->ael_decoder != NULL) {
+            audio_element_stop(handle->ael_decoder);
+            audio_element_wait_for_stop_ms(handle->ael_decoder, AUDIO_MAX_DELAY);
+        }
+        liteplayer_destroy(handle);
+    }
+    if (priv.cond != NULL)
+        os_cond_destroy(priv.cond);
+    if (priv.lock != NULL)
+        os_mutex_destroy(priv.lock);
+
+    int bytes_per_sec = result->samplerate*result->channels*media_converter_sample_size(result->bits);
+    if (bytes_per_sec > 0)
+        result->duration_ms = (int)(result->pcm_bytes*1000/bytes_per_sec);
+    OS_LOGI(TAG, "Decoded %s: ret:%d, pcm:%lld bytes, %d ms", url, ret, result->pcm_bytes, result->duration_ms);
+    return ret;
+}
@@ -30,6 +30,8 @@
 #define DEFAULT_MEDIA_PARSER_BUFFER_SIZE    (2048+1)
 #define DEFAULT_MEDIA_PARSER_DISCARD_MAX    (1024*512)
 #define DEFAULT_MEDIA_PARSER_WRITE_TIMEOUT  (200)
+#define DEFAULT_MEDIA_PARSER_SCAN_SIZE      (1024*4)
+#define DEFAULT_MEDIA_PARSER_SCAN_MAX       (1024*512)  // bytes scanned at most from async source
 
 struct media_parser_priv {
     struct media_source_info source;
@@ -38,7 +40,12 @@ struct media_parser_priv {
     int header_size;
     char reuse_buffer[DEFAULT_MEDIA_PARSER_BUFFER_SIZE];
     int reuse_size;
+    char *fetch_buffer; // read-ahead of positional reads, allocated at first use
+    long long fetch_offset;
+    int fetch_size;
+    bool fetch_at_failed; // read_at() failed once, e.g. server ignores ranges, read sequentially
     int ringbuf_size;
+    struct media_parser_cache *cache;
 
     media_parser_state_cb listener;
     void *listener_priv;
@@ -47,8 +54,195 @@ struct media_parser_priv {
     bool stop;
     os_mutex lock; // lock for listener
     os_cond cond;  // wait stop to exit mediaparser thread
+    workpool_job_handle job; // workpool mode
+    bool job_parsed;
 };
 
+struct media_parser_cache_entry {
+    char *url;
+    unsigned long stamp; // last used, the oldest entry is evicted first
+    struct media_codec_info codec;
+};
+
+struct media_parser_cache {
+    os_mutex lock;
+    int refs; // owner and every running async parser
+    int max_entries;
+    unsigned long clock;
+    struct media_parser_cache_entry *entries;
+};
+
+void media_parser_release_codec_info(struct media_codec_info *codec)
+{
+    if (codec == NULL)
+        return;
+
+    if (codec->codec_type == AUDIO_CODEC_M4A) {
+        if (codec->detail.m4a_info.sample_table != NULL)
+            m4a_sample_table_destroy(codec->detail.m4a_info.sample_table);
+        codec->detail.m4a_info.sample_table = NULL;
+    } else if (codec->codec_type == AUDIO_CODEC_MP3) {
+        if (codec->detail.mp3_info.frame_index != NULL)
+            mp3_frame_index_destroy(codec->detail.mp3_info.frame_index);
+        codec->detail.mp3_info.frame_index = NULL;
+    } else if (codec->codec_type == AUDIO_CODEC_AAC) {
+        if (codec->detail.aac_info.frame_index != NULL)
+            aac_frame_index_destroy(codec->detail.aac_info.frame_index);
+        codec->detail.aac_info.frame_index = NULL;
+    } else if (codec->codec_type == AUDIO_CODEC_WAV) {
+        if (codec->detail.wav_info.header_buff != NULL)
+            audio_free(codec->detail.wav_info.header_buff);
+        codec->detail.wav_info.header_buff = NULL;
+    }
+}
+
+// Deep copy codec info, mp3/aac frame index is left out because it's built while decoding
+static int media_parser_dup_codec_info(struct media_codec_info *dst, struct media_codec_info *src)
+{
+    memcpy(dst, src, sizeof(struct media_codec_info));
+
+    if (src->codec_type == AUDIO_CODEC_M4A) {
+        dst->detail.m4a_info.stsz_samplesize_index = 0;
+        if (src->detail.m4a_info.sample_table != NULL) {
+            dst->detail.m4a_info.sample_table = m4a_sample_table_dup(src->detail.m4a_info.sample_table);
+            if (dst->detail.m4a_info.sample_table == NULL)
+                goto dup_fail;
+        }
+    } else if (src->codec_type == AUDIO_CODEC_MP3) {
+        dst->detail.mp3_info.frame_index = NULL;
+    } else if (src->codec_type == AUDIO_CODEC_AAC) {
+        dst->detail.aac_info.frame_index = NULL;
+    } else if (src->codec_type == AUDIO_CODEC_WAV) {
+        if (src->detail.wav_info.header_buff != NULL) {
+            dst->detail.wav_info.header_buff = audio_malloc(src->detail.wav_info.header_size);
+            if (dst->detail.wav_info.header_buff == NULL)
+                goto dup_fail;
+            memcpy(dst->detail.wav_info.header_buff, src->detail.wav_info.header_buff,
+                   src->detail.wav_info.header_size);
+        }
+    }
+    return ESP_OK;
+
+dup_fail:
+    OS_LOGE(TAG, "Failed to allocate memory for codec info copy");
+    memset(dst, 0x0, sizeof(struct media_codec_info));
+    return ESP_FAIL;
+}
+
+media_parser_cache_handle_t media_parser_cache_create(int max_entries)
+{
+    if (max_entries <= 0)
+        return NULL;
+
+    struct media_parser_cache *cache = audio_calloc(1, sizeof(struct media_parser_cache));
+    if (cache == NULL)
+        return NULL;
+    cache->lock = os_mutex_create();
+    cache->entries = audio_calloc(max_entries, sizeof(struct media_parser_cache_entry));
+    if (cache->lock == NULL || cache->entries == NULL) {
+        if (cache->lock != NULL)
+            os_mutex_destroy(cache->lock);
+        if (cache->entries != NULL)
+            audio_free(cache->entries);
+        audio_free(cache);
+        return NULL;
+    }
+    cache->max_entries = max_entries;
+    cache->refs = 1;
+    return cache;
+}
+
+static void media_parser_cache_retain(struct media_parser_cache *cache)
+{
+    os_mutex_lock(cache->lock);
+    cache->refs++;
+    os_mutex_unlock(cache->lock);
+}
+
+void media_parser_cache_destroy(media_parser_cache_handle_t handle)
+{
+    struct media_parser_cache *cache = (struct media_parser_cache *)handle;
+    if (cache == NULL)
+        return;
+
+    os_mutex_lock(cache->lock);
+    int refs = --cache->refs;
+    os_mutex_unlock(cache->lock);
+    if (refs > 0)
+        return;
+
+    for (int i = 0; i < cache->max_entries; i++) {
+        if (cache->entries[i].url != NULL) {
+            audio_free(cache->entries[i].url);
+            media_parser_release_codec_info(&cache->entries[i].codec);
+        }
+    }
+    audio_free(cache->entries);
+    os_mutex_destroy(cache->lock);
+    audio_free(cache);
+}
+
+// Return ESP_OK and a private copy of the codec info if url is cached
+static int media_parser_cache_lookup(struct media_parser_cache *cache, const char *url,
+                                     struct media_codec_info *codec)
+{
+    int ret = ESP_FAIL;
+
+    os_mutex_lock(cache->lock);
+    for (int i = 0; i < cache->max_entries; i++) {
+        struct media_parser_cache_entry *entry = &cache->entries[i];
+        if (entry->url != NULL && strcmp(entry->url, url) == 0) {
+            ret = media_parser_dup_codec_info(codec, &entry->codec);
+            if (ret == ESP_OK)
+                entry->stamp = ++cache->clock;
+            break;
+        }
+    }
+    os_mutex_unlock(cache->lock);
+
+    if (ret == ESP_OK && codec->codec_type == AUDIO_CODEC_MP3)
+        codec->detail.mp3_info.frame_index = mp3_frame_index_create(codec->detail.mp3_info.tag_frame_size);
+    else if (ret == ESP_OK && codec->codec_type == AUDIO_CODEC_AAC)
+        codec->detail.aac_info.frame_index = aac_frame_index_create();
+    return ret;
+}
+
+static void media_parser_cache_store(struct media_parser_cache *cache, const char *url,
+                                     struct media_codec_info *codec)
+{
+    // Nothing to validate a live stream against when it's prepared again
+    if (codec->content_len <= 0 || strstr(url, ".m3u") != NULL)
+        return;
+
+    os_mutex_lock(cache->lock);
+
+    // Replace the entry of the same url, or else the least recently used one
+    struct media_parser_cache_entry *entry = &cache->entries[0];
+    for (int i = 0; i < cache->max_entries; i++) {
+        if (cache->entries[i].url != NULL && strcmp(cache->entries[i].url, url) == 0) {
+            entry = &cache->entries[i];
+            break;
+        }
+        if (entry->url != NULL &&
+            (cache->entries[i].url == NULL || cache->entries[i].stamp < entry->stamp))
+            entry = &cache->entries[i];
+    }
+
+    if (entry->url != NULL) {
+        audio_free(entry->url);
+        entry->url = NULL;
+        media_parser_release_codec_info(&entry->codec);
+    }
+    if (media_parser_dup_codec_info(&entry->codec, codec) == ESP_OK) {
+        entry->url = audio_strdup(url);
+        if (entry->url == NULL)
+            media_parser_release_codec_info(&entry->codec);
+        entry->stamp = ++cache->clock;
+    }
+
+    os_mutex_unlock(cache->lock);
+}
+
 static audio_codec_t get_codec_type(const char *url, char *buf)
 {
     audio_codec_t codec = AUDIO_CODEC_NONE;
@@ -83,11 +277,59 @@ static audio_codec_t get_codec_type(const char *url, char *buf)
     return codec;
 }
 
-static int media_parser_fetch(char *buf, int wanted_size, long offset, void *arg)
+// Positional read, source stays at the end of header, so reuse buffer is kept as header.
+// Extractors walk boxes with many small reads, serve them from a read-ahead block
+static int media_parser_fetch_at(struct media_parser_priv *priv, char *buf, int wanted_size, long long offset)
+{
+    if (offset < 0)
+        return ESP_FAIL;
+    if (offset + wanted_size <= priv->header_size) {
+        memcpy(buf, &priv->header_buffer[offset], wanted_size);
+        return wanted_size;
+    }
+
+    if (priv->fetch_buffer == NULL && wanted_size < DEFAULT_MEDIA_PARSER_FETCH_SIZE)
+        priv->fetch_buffer = audio_malloc(DEFAULT_MEDIA_PARSER_FETCH_SIZE);
+    if (priv->fetch_buffer == NULL || wanted_size >= DEFAULT_MEDIA_PARSER_FETCH_SIZE) {
+        int bytes_read = priv->source.source_ops->read_at(priv->source.source_handle, offset, buf, wanted_size);
+        if (bytes_read < 0)
+            OS_LOGE(TAG, "Failed to read wanted %d bytes at %lld, bytes_read(%d)", wanted_size, offset, bytes_read);
+        return bytes_read;
+    }
+
+    if (offset < priv->fetch_offset || offset + wanted_size > priv->fetch_offset + priv->fetch_size) {
+        priv->fetch_size = priv->source.source_ops->read_at(priv->source.source_handle, offset,
+                priv->fetch_buffer, DEFAULT_MEDIA_PARSER_FETCH_SIZE);
+        if (priv->fetch_size < 0) {
+            OS_LOGE(TAG, "Failed to read %d bytes at %lld, bytes_read(%d)",
+                    DEFAULT_MEDIA_PARSER_FETCH_SIZE, offset, priv->fetch_size);
+            priv->fetch_size = 0;
+            return ESP_FAIL;
+        }
+        priv->fetch_offset = offset;
+    }
+
+    int bytes_avail = (int)(priv->fetch_offset + priv->fetch_size - offset);
+    if (bytes_avail > wanted_size)
+        bytes_avail = wanted_size;
+    memcpy(buf, &priv->fetch_buffer[offset - priv->fetch_offset], bytes_avail);
+    return bytes_avail;
+}
+
+static int media_parser_fetch(char *buf, int wanted_size, long long offset, void *arg)
 {
     struct media_parser_priv *priv = (struct media_parser_priv *)arg;
     int bytes_read = ESP_FAIL;
-    long content_pos = (long)priv->source.source_ops->content_pos(priv->source.source_handle);
+    long long content_pos = priv->source.source_ops->content_pos(priv->source.source_handle);
+
+    if (priv->source.source_ops->read_at != NULL && !priv->fetch_at_failed) {
+        bytes_read = media_parser_fetch_at(priv, buf, wanted_size, offset);
+        if (bytes_read >= 0)
+            return bytes_read;
+        // Source position is untouched by read_at(), the sequential path below still holds
+        OS_LOGW(TAG, "Positional read failed, fall back to sequential read");
+        priv->fetch_at_failed = true;
+    }
 
     if (wanted_size > sizeof(priv->reuse_buffer)) {
         OS_LOGW(TAG, "Extractor wanted %d bytes, bigger than parser buffer size (%d)",
@@ -131,11 +373,11 @@ static int media_parser_fetch(char *buf, int wanted_size, long offset, void *arg
         }
     }
 
-    content_pos = (long)priv->source.source_ops->content_pos(priv->source.source_handle);
+    content_pos = priv->source.source_ops->content_pos(priv->source.source_handle);
     if (content_pos != offset) {
         if ((offset > content_pos) &&
             (offset - content_pos) <= DEFAULT_MEDIA_PARSER_DISCARD_MAX) {
-            int total_discard = offset - content_pos;
+            int total_discard = (int)(offset - content_pos);
             bytes_read = 0;
             OS_LOGD(TAG, "Discarding %d bytes to reach new offset", total_discard);
             while (bytes_read < total_discard) {
@@ -179,15 +421,15 @@ static int media_parser_fetch(char *buf, int wanted_size, long offset, void *arg
         }
 
 fallthrough_seek:
-        OS_LOGD(TAG, "Seeking %ld>>%ld", content_pos, offset);
+        OS_LOGD(TAG, "Seeking %lld>>%lld", content_pos, offset);
         if (priv->source.source_ops->seek(priv->source.source_handle, offset) != 0)
             return ESP_FAIL;
     }
 
 read_want:
-    content_pos = (long)priv->source.source_ops->content_pos(priv->source.source_handle);
+    content_pos = priv->source.source_ops->content_pos(priv->source.source_handle);
     if (content_pos != offset) {
-        OS_LOGW(TAG, "Unexpected offset, seeking: %ld>>%ld", content_pos, offset);
+        OS_LOGW(TAG, "Unexpected offset, seeking: %lld>>%lld", content_pos, offset);
         if (priv->source.source_ops->seek(priv->source.source_handle, offset) != 0)
             return ESP_FAIL;
     }
@@ -216,12 +458,17 @@ static int media_parser_extract(struct media_parser_priv *priv)
 
     if (read_size > priv->ringbuf_size)
         read_size = priv->ringbuf_size;
+    priv->fetch_at_failed = false;
     priv->header_size =
         priv->source.source_ops->read(priv->source.source_handle, priv->header_buffer, read_size);
     if (priv->header_size < 256) {
         OS_LOGE(TAG, "Insufficient bytes read: %d", priv->header_size);
         return ESP_FAIL;
     }
+    if (priv->source.source_ops->read_at != NULL) {
+        memcpy(priv->reuse_buffer, priv->header_buffer, priv->header_size);
+        priv->reuse_size = priv->header_size;
+    }
 
     codec->codec_type = get_codec_type(priv->source.url, priv->header_buffer);
     switch (codec->codec_type) {
@@ -234,6 +481,15 @@ static int media_parser_extract(struct media_parser_priv *priv)
             codec->content_len = priv->source.source_ops->content_len(priv->source.source_handle);
             codec->bytes_per_sec = codec->detail.mp3_info.bit_rate*1000/8;
             codec->duration_ms = (codec->content_len - codec->content_pos)*8/codec->detail.mp3_info.bit_rate;
+            int duration_ms = mp3_get_duration(&(codec->detail.mp3_info));
+            if (duration_ms > 0) {
+                // VBR stream, Xing/VBRI header gives the real duration
+                long stream_bytes = codec->detail.mp3_info.total_bytes > 0 ?
+                        codec->detail.mp3_info.total_bytes : codec->content_len - codec->content_pos;
+                codec->duration_ms = duration_ms;
+                codec->bytes_per_sec = (int)((long long)stream_bytes*1000/duration_ms);
+            }
+            mp3_get_gapless_info(&(codec->detail.mp3_info), &codec->priming_samples, &codec->valid_samples);
             ret = ESP_OK;
         }
         break;
@@ -246,8 +502,10 @@ static int media_parser_extract(struct media_parser_priv *priv)
             codec->codec_bits = 16;
             codec->content_pos = codec->detail.aac_info.frame_start_offset;
             codec->content_len = priv->source.source_ops->content_len(priv->source.source_handle);
-            //codec->bytes_per_sec = codec->detail.aac_info.bit_rate*1000/8;
-            //codec->duration_ms = (codec->content_len - codec->content_pos)*8/codec->detail.aac_info.bit_rate;
+            codec->bytes_per_sec = codec->detail.aac_info.bit_rate/8;
+            codec->duration_ms = aac_get_duration(&(codec->detail.aac_info), codec->content_len - codec->content_pos);
+            if (codec->duration_ms < 0)
+                codec->duration_ms = 0;
             ret = ESP_OK;
         }
         break;
@@ -266,7 +524,14 @@ static int media_parser_extract(struct media_parser_priv *priv)
         #endif
             codec->codec_bits = codec->detail.m4a_info.bits;
             codec->duration_ms =
-                (int)(codec->detail.m4a_info.duration/codec->detail.m4a_info.time_scale*1000);
+                (int)((uint64_t)codec->detail.m4a_info.duration*1000/codec->detail.m4a_info.time_scale);
+            if (codec->detail.m4a_info.valid_samples > 0) {
+                uint32_t time_scale = codec->detail.m4a_info.time_scale;
+                codec->priming_samples =
+                    (int)((uint64_t)codec->detail.m4a_info.priming_samples*codec->codec_samplerate/time_scale);
+                codec->valid_samples =
+                    (long long)(codec->detail.m4a_info.valid_samples*codec->codec_samplerate/time_scale);
+            }
             ret = ESP_OK;
         }
         break;
@@ -292,8 +557,59 @@ static int media_parser_extract(struct media_parser_priv *priv)
     return ret;
 }
 
+static int media_parser_from_cache(struct media_parser_priv *priv)
+{
+    if (media_parser_cache_lookup(priv->cache, priv->source.url, &priv->codec) != ESP_OK)
+        return ESP_FAIL;
+
+    // Open right at the first frame, header before it isn't needed any more
+    priv->source.source_handle = priv->source.source_ops->open(priv->source.url,
+            priv->codec.content_pos, priv->source.source_ops->priv_data);
+    if (priv->source.source_handle == NULL)
+        goto cache_miss;
+
+    long long content_len = priv->source.source_ops->content_len(priv->source.source_handle);
+    long long content_pos = priv->source.source_ops->content_pos(priv->source.source_handle);
+    if (content_len != priv->codec.content_len || content_pos != priv->codec.content_pos) {
+        OS_LOGD(TAG, "Cached media changed, len: %lld>>%lld, pos: %lld>>%lld",
+                priv->codec.content_len, content_len, priv->codec.content_pos, content_pos);
+        priv->source.source_ops->close(priv->source.source_handle);
+        priv->source.source_handle = NULL;
+        goto cache_miss;
+    }
+
+    OS_LOGI(TAG, "MediaInfo(cached): codec_type[%d], samplerate[%d], channels[%d], bits[%d], pos[%lld], len[%lld], duration[%dms]",
+            priv->codec.codec_type, priv->codec.codec_samplerate, priv->codec.codec_channels, priv->codec.codec_bits,
+            priv->codec.content_pos, priv->codec.content_len, priv->codec.duration_ms);
+
+    bool reuse_handle = false;
+    if (priv->lock != NULL)
+        os_mutex_lock(priv->lock);
+    if (!priv->stop) {
+        OS_LOGD(TAG, "Mediasource will reuse source handle, content_pos: %lld", content_pos);
+        rb_reset(priv->source.out_ringbuf);
+        reuse_handle = true;
+    }
+    if (priv->lock != NULL)
+        os_mutex_unlock(priv->lock);
+
+    if (!reuse_handle) {
+        priv->source.source_ops->close(priv->source.source_handle);
+        priv->source.source_handle = NULL;
+    }
+    return ESP_OK;
+
+cache_miss:
+    media_parser_release_codec_info(&priv->codec);
+    memset(&priv->codec, 0x0, sizeof(struct media_codec_info));
+    return ESP_FAIL;
+}
+
 static int media_parser_main(struct media_parser_priv *priv)
 {
+    if (priv->cache != NULL && media_parser_from_cache(priv) == ESP_OK)
+        return ESP_OK;
+
     priv->source.source_handle =
         priv->source.source_ops->open(priv->source.url, 0, priv->source.source_ops->priv_data);
     if (priv->source.source_handle == NULL)
@@ -301,21 +617,36 @@ static int media_parser_main(struct media_parser_priv *priv)
 
     bool reuse_handle = false;
     int ret = media_parser_extract(priv);
+    if (priv->fetch_buffer != NULL) {
+        audio_free(priv->fetch_buffer);
+        priv->fetch_buffer = NULL;
+        priv->fetch_offset = 0;
+        priv->fetch_size = 0;
+    }
     if (ret == ESP_OK) {
-        OS_LOGI(TAG, "MediaInfo: codec_type[%d], samplerate[%d], channels[%d], bits[%d], pos[%ld], len[%ld], duration[%dms]",
+        OS_LOGI(TAG, "MediaInfo: codec_type[%d], samplerate[%d], channels[%d], bits[%d], pos[%lld], len[%lld], duration[%dms]",
                 priv->codec.codec_type, priv->codec.codec_samplerate, priv->codec.codec_channels, priv->codec.codec_bits,
                 priv->codec.content_pos, priv->codec.content_len, priv->codec.duration_ms);
+        if (priv->cache != NULL)
+            media_parser_cache_store(priv->cache, priv->source.url, &priv->codec);
     } else {
         OS_LOGE(TAG, "Failed to parse url:[%s]", priv->source.url);
     }
 
     if (ret == ESP_OK) {
-        long content_pos = (long)priv->source.source_ops->content_pos(priv->source.source_handle);
-        OS_LOGV(TAG, "content_pos=%ld, frame_start_offset=%ld", content_pos, priv->codec.content_pos);
+        long long content_pos = priv->source.source_ops->content_pos(priv->source.source_handle);
+        OS_LOGV(TAG, "content_pos=%lld, frame_start_offset=%lld", content_pos, priv->codec.content_pos);
 
-        if (priv->codec.content_pos > content_pos &&
+        if (priv->codec.content_pos > content_pos && priv->source.source_ops->read_at != NULL &&
+            !priv->fetch_at_failed) {
+            // Random access source, jump to frame_start_offset rather than reading up to it
+            OS_LOGD(TAG, "Seeking %lld>>%lld to reach frame_start_offset", content_pos, priv->codec.content_pos);
+            if (priv->source.source_ops->seek(priv->source.source_handle, priv->codec.content_pos) != 0)
+                goto reuse_out;
+            content_pos = priv->source.source_ops->content_pos(priv->source.source_handle);
+        } else if (priv->codec.content_pos > content_pos &&
             (priv->codec.content_pos - content_pos) <= DEFAULT_MEDIA_PARSER_DISCARD_MAX) {
-            int bytes_discard = priv->codec.content_pos - content_pos;
+            int bytes_discard = (int)(priv->codec.content_pos - content_pos);
             OS_LOGD(TAG, "Try to discard %d bytes to reach frame_start_offset", bytes_discard);
             while (bytes_discard > 0) {
                 priv->reuse_size = priv->source.source_ops->read(priv->source.source_handle,
@@ -325,8 +656,8 @@ static int media_parser_main(struct media_parser_priv *priv)
                 else
                     goto reuse_out;
             }
-            content_pos = (long)priv->source.source_ops->content_pos(priv->source.source_handle);
-            OS_LOGV(TAG, "content_pos=%ld, frame_start_offset=%ld", content_pos, priv->codec.content_pos);
+            content_pos = priv->source.source_ops->content_pos(priv->source.source_handle);
+            OS_LOGV(TAG, "content_pos=%lld, frame_start_offset=%lld", content_pos, priv->codec.content_pos);
         }
 
         // We can reuse the source handle, if:
@@ -339,11 +670,11 @@ static int media_parser_main(struct media_parser_priv *priv)
             os_mutex_lock(priv->lock);
 
         if (!priv->stop) {
-            int bytes_remain = content_pos - priv->codec.content_pos;
+            int bytes_remain = (int)(content_pos - priv->codec.content_pos);
             rb_reset(priv->source.out_ringbuf);
             if (bytes_remain == 0) {
                 // content_pos == frame_start_offset
-                OS_LOGD(TAG, "Mediasource will reuse source handle, content_pos: %ld", content_pos);
+                OS_LOGD(TAG, "Mediasource will reuse source handle, content_pos: %lld", content_pos);
                 reuse_handle = true;
             } else if (rb_get_size(priv->source.out_ringbuf) >= bytes_remain) {
                 // frame_start_offset + bytes_remain == content_pos
@@ -369,7 +700,9 @@ reuse_out:
     return ret;
 }
 
-int media_parser_get_codec_info(struct media_source_info *source, struct media_codec_info *codec)
+int media_parser_get_codec_info(struct media_source_info *source,
+                                media_parser_cache_handle_t cache,
+                                struct media_codec_info *codec)
 {
     if (source == NULL || source->url == NULL || source->out_ringbuf == NULL || codec == NULL)
         return ESP_FAIL;
@@ -379,6 +712,7 @@ int media_parser_get_codec_info(struct media_source_info *source, struct media_c
         return ESP_FAIL;
     memcpy(&priv->source, source, sizeof(struct media_source_info));
     priv->ringbuf_size = rb_get_size(source->out_ringbuf);
+    priv->cache = (struct media_parser_cache *)cache;
 
     bool free_url = false;
     if (strstr(priv->source.url, ".m3u") != NULL) {
@@ -436,27 +770,35 @@ static void media_parser_cleanup(struct media_parser_priv *priv)
         os_cond_destroy(priv->cond);
     if (priv->source.url != NULL)
         audio_free(priv->source.url);
+    if (priv->cache != NULL)
+        media_parser_cache_destroy(priv->cache);
     audio_free(priv);
 }
 
+static void media_parser_notify(struct media_parser_priv *priv, int ret)
+{
+    os_mutex_lock(priv->lock);
+    if (!priv->stop) {
+        // update source handle for media source, we will reuse this handle
+        priv->listener_source->source_handle = priv->source.source_handle;
+        if (priv->listener != NULL) {
+            enum media_parser_state state =
+                (ret == ESP_OK) ? MEDIA_PARSER_SUCCEED : MEDIA_PARSER_FAILED;
+            priv->listener(state, &priv->codec, priv->listener_priv);
+        }
+    }
+    os_mutex_unlock(priv->lock);
+}
+
 static void *media_parser_thread(void *arg)
 {
     struct media_parser_priv *priv = (struct media_parser_priv *)arg;
     int ret = media_parser_get_codec_info2(priv);
 
+    media_parser_notify(priv, ret);
+
     {
         os_mutex_lock(priv->lock);
-
-        if (!priv->stop) {
-            // update source handle for media source, we will reuse this handle
-            priv->listener_source->source_handle = priv->source.source_handle;
-            if (priv->listener != NULL) {
-                enum media_parser_state state =
-                    (ret == ESP_OK) ? MEDIA_PARSER_SUCCEED : MEDIA_PARSER_FAILED;
-                priv->listener(state, &priv->codec, priv->listener_priv);
-            }
-        }
-
         OS_LOGV(TAG, "Waiting stop command");
         while (!priv->stop)
             os_cond_wait(priv->cond, priv->lock);
@@ -469,7 +811,30 @@ static void *media_parser_thread(void *arg)
     return NULL;
 }
 
+// media_parser_thread on a workpool: parse in the first step, then park until stopped
+static long media_parser_job(void *arg)
+{
+    struct media_parser_priv *priv = (struct media_parser_priv *)arg;
+    bool stop;
+
+    if (!priv->job_parsed) {
+        priv->job_parsed = true;
+        media_parser_notify(priv, media_parser_get_codec_info2(priv));
+    }
+
+    os_mutex_lock(priv->lock);
+    stop = priv->stop;
+    os_mutex_unlock(priv->lock);
+    if (!stop)
+        return WORKPOOL_JOB_WAIT;
+
+    media_parser_cleanup(priv);
+    OS_LOGD(TAG, "Media parser job leave");
+    return WORKPOOL_JOB_DONE;
+}
+
 media_parser_handle_t media_parser_start_async(struct media_source_info *source,
+                                               media_parser_cache_handle_t cache,
                                                media_parser_state_cb listener,
                                                void *listener_priv)
 {
@@ -487,6 +852,19 @@ media_parser_handle_t media_parser_start_async(struct media_source_info *source,
     priv->source.url = audio_strdup(source->url);
     if (priv->lock == NULL || priv->cond == NULL || priv->source.url == NULL)
         goto start_failed;
+    // Parser may outlive the player when stopped before finishing
+    if (cache != NULL) {
+        priv->cache = (struct media_parser_cache *)cache;
+        media_parser_cache_retain(priv->cache);
+    }
+
+    if (source->workpool != NULL) {
+        priv->job = workpool_job_create(source->workpool, media_parser_job, priv);
+        if (priv->job == NULL)
+            goto start_failed;
+        workpool_job_wake(priv->job);
+        return priv;
+    }
 
     struct os_thread_attr attr = {
         .name = "ael-parser",
@@ -516,25 +894,136 @@ void media_parser_stop(media_parser_handle_t handle)
         os_mutex_lock(priv->lock);
         priv->stop = true;
         os_cond_signal(priv->cond);
+        // Job frees priv once it sees stop, so wake it before unlock
+        if (priv->job != NULL)
+            workpool_job_wake(priv->job);
         os_mutex_unlock(priv->lock);
     }
 }
 
-long long media_parser_get_seek_offset(struct media_codec_info *codec, int seek_msec)
+// Sequential reader of a private source handle, for scanning frame headers when seeking
+struct media_parser_scan {
+    struct media_source_info *source;
+    source_handle_t source_handle;
+    long long base;          // content_pos of the first frame, fetch offsets are relative to it
+    long long buffer_offset; // offset of buffer[0]
+    int buffer_size;
+    long bytes_read;
+    long bytes_max;     // 0 if unlimited
+    char buffer[DEFAULT_MEDIA_PARSER_SCAN_SIZE];
+};
+
+static int media_parser_scan_read(struct media_parser_scan *scan, char *buf, int size)
+{
+    if (scan->bytes_max > 0 && scan->bytes_read >= scan->bytes_max) {
+        OS_LOGD(TAG, "Scanned %ld bytes, give up", scan->bytes_read);
+        return ESP_FAIL;
+    }
+    int ret = scan->source->source_ops->read(scan->source_handle, buf, size);
+    if (ret > 0)
+        scan->bytes_read += ret;
+    return ret;
+}
+
+static int media_parser_scan_fetch(char *buf, int wanted_size, long long offset, void *arg)
+{
+    struct media_parser_scan *scan = (struct media_parser_scan *)arg;
+    struct source_wrapper *ops = scan->source->source_ops;
+    long long buffer_end = scan->buffer_offset + scan->buffer_size;
+
+    if (wanted_size > (int)sizeof(scan->buffer))
+        wanted_size = sizeof(scan->buffer);
+
+    if (scan->source_handle == NULL) {
+        scan->source_handle = ops->open(scan->source->url, scan->base + offset, ops->priv_data);
+        if (scan->source_handle == NULL)
+            return ESP_FAIL;
+        scan->buffer_offset = offset;
+        scan->buffer_size = 0;
+    } else if (offset < scan->buffer_offset || offset - buffer_end > (long long)sizeof(scan->buffer)) {
+        OS_LOGV(TAG, "Scan seeking %lld>>%lld", buffer_end, offset);
+        if (ops->seek(scan->source_handle, scan->base + offset) != 0)
+            return ESP_FAIL;
+        scan->buffer_offset = offset;
+        scan->buffer_size = 0;
+    }
+
+    while (scan->buffer_offset + scan->buffer_size < offset + wanted_size) {
+        // Drop the bytes before offset, so the gap up to offset is read away
+        if (scan->buffer_offset < offset) {
+            int drop = (int)(offset - scan->buffer_offset);
+            if (drop > scan->buffer_size)
+                drop = scan->buffer_size;
+            scan->buffer_size -= drop;
+            memmove(scan->buffer, &scan->buffer[drop], scan->buffer_size);
+            scan->buffer_offset += drop;
+        }
+        int ret = media_parser_scan_read(scan, &scan->buffer[scan->buffer_size],
+                                         sizeof(scan->buffer) - scan->buffer_size);
+        if (ret <= 0)
+            break;
+        scan->buffer_size += ret;
+    }
+
+    int bytes_avail = (int)(scan->buffer_offset + scan->buffer_size - offset);
+    if (bytes_avail > wanted_size)
+        bytes_avail = wanted_size;
+    if (bytes_avail <= 0)
+        return 0;
+    memcpy(buf, &scan->buffer[offset - scan->buffer_offset], bytes_avail);
+    return bytes_avail;
+}
+
+long long media_parser_get_seek_offset(struct media_source_info *source, struct media_codec_info *codec, int seek_msec)
 {
     if (codec == NULL || seek_msec < 0)
         return -1;
 
     long long offset = -1;
     switch (codec->codec_type) {
-    case AUDIO_CODEC_WAV:
+    case AUDIO_CODEC_WAV: {
+        int block_align = codec->detail.wav_info.blockAlign > 0 ? codec->detail.wav_info.blockAlign : 1;
+        offset = (long long)codec->bytes_per_sec*seek_msec/1000;
+        offset -= offset % block_align;
+        break;
+    }
     case AUDIO_CODEC_MP3: {
-        offset = (codec->bytes_per_sec*(seek_msec/1000));
+        long mp3_offset = 0;
+        long stream_bytes = codec->content_len > 0 ? (long)(codec->content_len - codec->content_pos) : 0;
+        if (mp3_get_seek_offset(seek_msec, &(codec->detail.mp3_info), stream_bytes, &mp3_offset) != 0) {
+            break;
+        }
+        offset = mp3_offset;
+        break;
+    }
+    case AUDIO_CODEC_AAC: {
+        long aac_offset = 0;
+        struct media_parser_scan *scan = NULL;
+        // Scan frame headers from the indexed range, network streams only for a short
+        // distance, aac extractor estimates the offset by bit rate if scanning fails
+        if (source != NULL && source->url != NULL && source->source_ops != NULL) {
+            scan = audio_calloc(1, sizeof(struct media_parser_scan));
+            if (scan != NULL) {
+                scan->source = source;
+                scan->base = codec->content_pos;
+                scan->bytes_max = source->source_ops->async_mode ? DEFAULT_MEDIA_PARSER_SCAN_MAX : 0;
+            }
+        }
+        int ret = aac_get_seek_offset(seek_msec, &(codec->detail.aac_info),
+                                      scan != NULL ? media_parser_scan_fetch : NULL, scan, &aac_offset);
+        if (scan != NULL) {
+            if (scan->source_handle != NULL)
+                source->source_ops->close(scan->source_handle);
+            audio_free(scan);
+        }
+        if (ret != 0)
+            break;
+        offset = aac_offset;
         break;
     }
     case AUDIO_CODEC_M4A: {
-        unsigned int sample_index = 0;
-        unsigned int sample_offset = 0;
+        uint32_t sample_index = 0;
+        uint64_t sample_offset = 0;
         if (m4a_get_seek_offset(seek_msec, &(codec->detail.m4a_info), &sample_index, &sample_offset) != 0) {
             break;
         }
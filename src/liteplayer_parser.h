@@ -36,10 +36,14 @@ struct media_codec_info {
     int                 codec_samplerate;
     int                 codec_channels;
     int                 codec_bits;
-    long                content_pos;
-    long                content_len;
+    long long           content_pos;
+    long long           content_len;
     int                 bytes_per_sec;
     int                 duration_ms;
+    // gapless info in decoder output samples: priming samples to drop at start,
+    // and samples to keep after them (0 if unknown)
+    int                 priming_samples;
+    long long           valid_samples;
     union {
         struct wav_info wav_info;
         struct mp3_info mp3_info;
@@ -54,11 +58,27 @@ typedef void (*media_parser_state_cb)(enum media_parser_state state, struct medi
 
 typedef void *media_parser_handle_t;
 
-int media_parser_get_codec_info(struct media_source_info *source, struct media_codec_info *codec);
+typedef void *media_parser_cache_handle_t;
 
-long long media_parser_get_seek_offset(struct media_codec_info *codec, int seek_msec);
+// Bounded LRU of parsed codec info, keyed by url and content length. Preparing
+// a cached media opens the source at its first frame without parsing header.
+media_parser_cache_handle_t media_parser_cache_create(int max_entries);
+
+void media_parser_cache_destroy(media_parser_cache_handle_t cache);
+
+// Free the tables owned by codec info
+void media_parser_release_codec_info(struct media_codec_info *codec);
+
+int media_parser_get_codec_info(struct media_source_info *source,
+                                media_parser_cache_handle_t cache,
+                                struct media_codec_info *codec);
+
+// Offset relative to content_pos of the frame to decode from. source is used to scan
+// frame headers of streams without seek table, NULL to estimate by bit rate instead
+long long media_parser_get_seek_offset(struct media_source_info *source, struct media_codec_info *codec, int seek_msec);
 
 media_parser_handle_t media_parser_start_async(struct media_source_info *source,
+                                               media_parser_cache_handle_t cache,
                                                media_parser_state_cb listener,
                                                void *listener_priv);
 
@@ -13,9 +13,11 @@
 // limitations under the License.
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "osal/os_thread.h"
+#include "osal/os_time.h"
 #include "cutils/log_helper.h"
 #include "cutils/ringbuf.h"
 #include "cutils/list.h"
@@ -23,13 +25,47 @@
 
 #include "liteplayer_config.h"
 #include "liteplayer_source.h"
+#include "liteplayer_stats.h"
 
 #define TAG "[liteplayer]source"
 
 #define DEFAULT_MEDIA_SOURCE_BUFFER_SIZE ( 1024*8+1 )
+// throughput is sampled once reads took this long, or brought a second of media
+#define DEFAULT_BUFFERING_WINDOW_USEC    ( 250*1000 )
+// an underrun deepens the watermark, each period without one takes a step of it back
+#define DEFAULT_BUFFERING_PENALTY_USEC   ( 30*1000*1000 )
+#define DEFAULT_BUFFERING_SIZE_ALIGN     ( 1024*4 )
 
 #define DEFAULT_M3U_BUFFER_SIZE    ( 1024*16 )
 #define DEFAULT_M3U_FILL_THRESHOLD ( 1024*32 )
+#define DEFAULT_M3U_URL_SIZE       ( 256 )
+#define DEFAULT_M3U_WAIT_MS        ( 100 )
+// pick the highest variant whose bandwidth is under this percentage of the measured one
+#define DEFAULT_M3U_BANDWIDTH_PERCENT ( 80 )
+
+// the segment being played and the ones prefetched
+#define M3U_SLOT_COUNT ( DEFAULT_M3U_PREFETCH_SEGMENTS + 1 )
+
+enum m3u_slot_state {
+    M3U_SLOT_IDLE,
+    M3U_SLOT_QUEUED,   // url assigned, waiting for prefetch thread
+    M3U_SLOT_FETCHING,
+    M3U_SLOT_FETCHED,  // download finished, data may be left in rb
+};
+
+struct media_source_priv;
+
+struct m3u_slot {
+    struct media_source_priv *owner;
+    os_thread tid;
+    ringbuf_handle rb;
+    enum m3u_slot_state state;
+    char *url;
+    long long pos;
+    enum media_source_state result;
+    long long bytes;          // bytes read from source and time spent in connect/read,
+    unsigned long long usec;  // for bandwidth estimation
+};
 
 struct media_source_priv {
     struct media_source_info info;
@@ -41,15 +77,69 @@ struct media_source_priv {
     bool stop;
     os_mutex lock; // lock for rb/listener
     os_cond cond;  // wait stop to exit mediasource thread
+
+    // hls state, owned by m3u source thread
+    struct listnode m3u_variants;      // variant streams if url is a master playlist
+    char *m3u_media_url;               // selected variant
+    long long m3u_next_sequence;       // media sequence of next segment to queue
+    int m3u_target_duration;           // seconds, 0 if not a hls media playlist
+    bool m3u_endlist;
+    unsigned long long m3u_refresh_time; // msec
+    long m3u_bandwidth;                // measured, bits per second
+
+    // segment prefetch, slots are consumed in order from m3u_slot_head
+    struct m3u_slot m3u_slots[M3U_SLOT_COUNT];
+    int m3u_slot_head;
+    int m3u_slot_count;
+    bool m3u_exit;
+    os_mutex m3u_lock; // lock for slots
+    os_cond m3u_cond;  // wake prefetch threads
+
+    // adaptive buffering, owned by media source thread
+    int buffering_rate;                 // bytes/s drained by decoder, 0 if disabled
+    int buffering_min_size;             // ringbuf never shrinks below source_wrapper.buffer_size
+    int buffering_threshold;            // current watermark, bytes
+    int buffering_underruns;            // since source started
+    int buffering_penalty;              // recent underruns, decays over time
+    unsigned long long buffering_penalty_time;
+    bool buffering_reached;
+    bool buffering_blocked;             // ringbuf was full since last read, under priv->lock
+    unsigned long long buffering_read_time; // end of last read
+    long long buffering_window_bytes;
+    unsigned long long buffering_window_usec;
+    long long buffering_throughput;     // bytes/s, moving average
+    long long buffering_jitter;         // moving average of deviation from throughput
+
+    // workpool mode, owned by media source job
+    workpool_job_handle job;
+    char *job_buffer;
+    int job_offset;                     // bytes of job_buffer written to ringbuf
+    int job_remain;                     // bytes of job_buffer left to write
+    bool job_finished;                  // waiting stop command
 };
 
 struct m3u_node {
     const char *url;
+    long long sequence; // media sequence number of segment
+    long bandwidth;     // bits per second of variant stream
     struct listnode listnode;
 };
 
+struct m3u_playlist {
+    struct listnode segments;
+    struct listnode variants;
+    long long media_sequence;
+    int target_duration;
+    bool endlist;
+};
+
 static void media_source_cleanup(struct media_source_priv *priv);
 
+static unsigned long long m3u_now_msec()
+{
+    return os_monotonic_usec() / 1000;
+}
+
 static void m3u_list_clear(struct listnode *list)
 {
     struct listnode *item, *tmp;
@@ -61,7 +151,7 @@ static void m3u_list_clear(struct listnode *list)
     }
 }
 
-static int m3u_list_insert(struct listnode *list, const char *url)
+static int m3u_list_insert(struct listnode *list, const char *url, long long sequence, long bandwidth)
 {
     struct m3u_node *node = audio_malloc(sizeof(struct m3u_node));
     if (node == NULL)
@@ -71,6 +161,8 @@ static int m3u_list_insert(struct listnode *list, const char *url)
         audio_free(node);
         return -1;
     }
+    node->sequence = sequence;
+    node->bandwidth = bandwidth;
     list_add_tail(list, &node->listnode);
     return 0;
 }
@@ -101,20 +193,17 @@ static char *m3u_parser_get_line(char *buffer, int *index, int *remain)
     return NULL;
 }
 
-static int m3u_parser_process_line(struct media_source_priv *priv, char *line)
+static int m3u_parser_resolve_url(const char *base_url, const char *line, char *buf, int buf_size)
 {
-    char temp[256];
-    int ret = -1;
     if (strstr(line, "http") == line) { // full uri
-        ret = m3u_list_insert(&priv->m3u_list, line);
+        snprintf(buf, buf_size, "%s", line);
     } else if (strstr(line, "//") == line) { //schemeless uri
-        if (strstr(priv->info.url, "https") == priv->info.url)
-            snprintf(temp, sizeof(temp), "https:%s", line);
+        if (strstr(base_url, "https") == base_url)
+            snprintf(buf, buf_size, "https:%s", line);
         else
-            snprintf(temp, sizeof(temp), "http:%s", line);
-        ret = m3u_list_insert(&priv->m3u_list, temp);
+            snprintf(buf, buf_size, "http:%s", line);
     } else if (strstr(line, "/") == line) { // Root uri
-        char *dup_url = audio_strdup(priv->info.url);
+        char *dup_url = audio_strdup(base_url);
         if (dup_url == NULL) {
             return -1;
         }
@@ -130,11 +219,10 @@ static int m3u_parser_process_line(struct media_source_priv *priv, char *line)
             return -1;
         }
         path[0] = 0;
-        snprintf(temp, sizeof(temp), "%s%s", dup_url, line);
+        snprintf(buf, buf_size, "%s%s", dup_url, line);
         audio_free(dup_url);
-        ret = m3u_list_insert(&priv->m3u_list, temp);
     } else { // Relative URI
-        char *dup_url = audio_strdup(priv->info.url);
+        char *dup_url = audio_strdup(base_url);
         if (dup_url == NULL) {
             return -1;
         }
@@ -144,171 +232,531 @@ static int m3u_parser_process_line(struct media_source_priv *priv, char *line)
             return -1;
         }
         pos[1] = '\0';
-        snprintf(temp, sizeof(temp), "%s%s", dup_url, line);
+        snprintf(buf, buf_size, "%s%s", dup_url, line);
         audio_free(dup_url);
-        ret = m3u_list_insert(&priv->m3u_list, temp);
     }
-    return ret;
+    return 0;
 }
 
-static int m3u_parser_resolve(struct media_source_priv *priv)
+// BANDWIDTH=<n> of #EXT-X-STREAM-INF, not to be confused with AVERAGE-BANDWIDTH
+static long m3u_parser_get_bandwidth(const char *line)
 {
-    int ret = -1;
-    source_handle_t http = NULL;
-    char *content = audio_malloc(DEFAULT_M3U_BUFFER_SIZE);
-    if (content == NULL)
-        goto resolve_done;
-
-    http = priv->info.source_ops->open(priv->info.url, 0, priv->info.source_ops->priv_data);
-    if (http == NULL) {
-        OS_LOGE(TAG, "Failed to connect m3u url");
-        goto resolve_done;
-    }
-
-    int bytes_read = priv->info.source_ops->read(http, content, DEFAULT_M3U_BUFFER_SIZE);
-    if (bytes_read <= 0) {
-        OS_LOGE(TAG, "Failed to read m3u content");
-        goto resolve_done;
+    const char *attr = strchr(line, ':');
+    while (attr != NULL) {
+        attr++;
+        if (strncmp(attr, "BANDWIDTH=", strlen("BANDWIDTH=")) == 0)
+            return atol(attr + strlen("BANDWIDTH="));
+        attr = strchr(attr, ',');
     }
-    OS_LOGV(TAG, "Succeed to read m3u content:\n%s", content);
+    return 0;
+}
 
-    int index = 0, remain = bytes_read;
+static int m3u_parser_parse(const char *base_url, char *content, int size, struct m3u_playlist *playlist)
+{
+    char url[DEFAULT_M3U_URL_SIZE];
+    int index = 0, remain = size;
+    long long segment_count = 0;
+    long bandwidth = 0;
     char *line = NULL;
     bool is_valid_m3u = false;
     bool is_valid_url = false;
+    bool is_variant = false;
+
     while ((line = m3u_parser_get_line(content, &index, &remain)) != NULL) {
         if (!is_valid_m3u && strcmp(line, "#EXTM3U") == 0) {
             is_valid_m3u = true;
             continue;
         }
-        if (strstr(line, "http") == line) {
-            m3u_parser_process_line(priv, line);
-            is_valid_m3u = true;
-            continue;
-        }
-        if (!is_valid_m3u) {
+        if (!is_valid_m3u && strstr(line, "http") != line) {
             break;
         }
-        if (!is_valid_url && strstr(line, "#EXTINF") == line) {
+        is_valid_m3u = true;
+
+        if (strstr(line, "#EXT-X-TARGETDURATION:") == line) {
+            playlist->target_duration = atoi(line + strlen("#EXT-X-TARGETDURATION:"));
+            continue;
+        } else if (strstr(line, "#EXT-X-MEDIA-SEQUENCE:") == line) {
+            playlist->media_sequence = atoll(line + strlen("#EXT-X-MEDIA-SEQUENCE:"));
+            continue;
+        } else if (strstr(line, "#EXT-X-ENDLIST") == line) {
+            playlist->endlist = true;
+            continue;
+        } else if (!is_valid_url && strstr(line, "#EXTINF") == line) {
             is_valid_url = true;
             continue;
         } else if (!is_valid_url && strstr(line, "#EXT-X-STREAM-INF") == line) {
-            /**
-             * As these are stream URIs we need to fetch thse periodically to keep live streaming.
-             * For now we handle it same as normal uri and exit.
-             */
+            // Variant stream, it's a media playlist to be resolved and refreshed in turn
             is_valid_url = true;
+            is_variant = true;
+            bandwidth = m3u_parser_get_bandwidth(line);
             continue;
-        } else if (strncmp(line, "#", 1) == 0) {
+        } else if (strncmp(line, "#", 1) == 0 || line[0] == '\0') {
             /**
              * Some other playlist field we don't support.
              * Simply treat this as a comment and continue to find next line.
              */
             continue;
         }
-        if (!is_valid_url) {
+        if (!is_valid_url && strstr(line, "http") != line) {
             continue;
         }
+
+        if (m3u_parser_resolve_url(base_url, line, url, sizeof(url)) == 0) {
+            if (is_variant)
+                m3u_list_insert(&playlist->variants, url, 0, bandwidth);
+            else
+                m3u_list_insert(&playlist->segments, url, playlist->media_sequence + segment_count, 0);
+        }
+        if (!is_variant)
+            segment_count++;
         is_valid_url = false;
-        m3u_parser_process_line(priv, line);
+        is_variant = false;
     }
 
-    if (!list_empty(&priv->m3u_list))
-        ret = 0;
+    if (list_empty(&playlist->segments) && list_empty(&playlist->variants))
+        return -1;
 
 #if defined(SYSUTILS_HAVE_VERBOSE_LOG_ENABLED)
     struct listnode *item;
-    int i = 0;
-    list_for_each(item, &priv->m3u_list) {
+    list_for_each(item, &playlist->variants) {
         struct m3u_node *node = listnode_to_item(item, struct m3u_node, listnode);
-        OS_LOGV(TAG, "-->m3ulist: url[%d]=[%s]", i++, node->url);
+        OS_LOGV(TAG, "-->m3ulist: variant[%ld]=[%s]", node->bandwidth, node->url);
+    }
+    list_for_each(item, &playlist->segments) {
+        struct m3u_node *node = listnode_to_item(item, struct m3u_node, listnode);
+        OS_LOGV(TAG, "-->m3ulist: url[%lld]=[%s]", node->sequence, node->url);
     }
 #endif
+    return 0;
+}
 
-resolve_done:
+static void m3u_playlist_clear(struct m3u_playlist *playlist)
+{
+    m3u_list_clear(&playlist->segments);
+    m3u_list_clear(&playlist->variants);
+}
+
+static int m3u_playlist_load(struct source_wrapper *source_ops, const char *url, struct m3u_playlist *playlist)
+{
+    int ret = -1;
+    source_handle_t http = NULL;
+    char *content = NULL;
+
+    memset(playlist, 0x0, sizeof(struct m3u_playlist));
+    list_init(&playlist->segments);
+    list_init(&playlist->variants);
+
+    content = audio_malloc(DEFAULT_M3U_BUFFER_SIZE);
+    if (content == NULL)
+        goto load_done;
+
+    http = source_ops->open(url, 0, source_ops->priv_data);
+    if (http == NULL) {
+        OS_LOGE(TAG, "Failed to connect m3u url");
+        goto load_done;
+    }
+
+    int bytes_read = 0, ret_read = 0;
+    while (bytes_read < DEFAULT_M3U_BUFFER_SIZE - 1) {
+        ret_read = source_ops->read(http, content + bytes_read, DEFAULT_M3U_BUFFER_SIZE - 1 - bytes_read);
+        if (ret_read <= 0)
+            break;
+        bytes_read += ret_read;
+    }
+    if (bytes_read <= 0) {
+        OS_LOGE(TAG, "Failed to read m3u content");
+        goto load_done;
+    }
+    content[bytes_read] = '\0';
+    OS_LOGV(TAG, "Succeed to read m3u content:\n%s", content);
+
+    ret = m3u_parser_parse(url, content, bytes_read, playlist);
+
+load_done:
     if (http != NULL)
-        priv->info.source_ops->close(http);
+        source_ops->close(http);
     if (content != NULL)
         audio_free(content);
     return ret;
 }
 
-static void *m3u_source_thread(void *arg)
+static struct m3u_node *m3u_variant_select(struct listnode *variants, long bandwidth)
 {
-    struct media_source_priv *priv = (struct media_source_priv *)arg;
-    enum media_source_state state = MEDIA_SOURCE_READ_FAILED;
-    source_handle_t http = NULL;
-    char *buffer = NULL;
-    long long pos = priv->info.content_pos;
-    int ret = 0;
+    struct m3u_node *best = NULL, *lowest = NULL;
+    struct listnode *item;
 
-    buffer = audio_malloc(DEFAULT_MEDIA_SOURCE_BUFFER_SIZE);
-    if (buffer == NULL) {
-        OS_LOGE(TAG, "Failed to allocate response buffer");
-        goto thread_exit;
+    if (list_empty(variants))
+        return NULL;
+    // Nothing measured yet, start with the first one as listed by the server
+    if (bandwidth <= 0)
+        return listnode_to_item(list_head(variants), struct m3u_node, listnode);
+
+    bandwidth = bandwidth / 100 * DEFAULT_M3U_BANDWIDTH_PERCENT;
+    list_for_each(item, variants) {
+        struct m3u_node *node = listnode_to_item(item, struct m3u_node, listnode);
+        if (lowest == NULL || node->bandwidth < lowest->bandwidth)
+            lowest = node;
+        if (node->bandwidth <= bandwidth && (best == NULL || node->bandwidth > best->bandwidth))
+            best = node;
     }
+    return best != NULL ? best : lowest;
+}
 
-resolve_m3u:
-    if (priv->stop)
-        goto thread_exit;
-    ret = m3u_parser_resolve(priv);
-    if (ret != 0) {
-        OS_LOGE(TAG, "Failed to parse m3u url");
-        goto thread_exit;
+// Load the media playlist and queue the segments not queued yet, switch variant first
+// if the measured bandwidth asks for another one
+static int m3u_playlist_refresh(struct media_source_priv *priv)
+{
+    struct m3u_playlist playlist;
+    struct listnode *item, *tmp;
+    const char *url = priv->info.url;
+
+    struct m3u_node *variant = m3u_variant_select(&priv->m3u_variants, priv->m3u_bandwidth);
+    if (variant != NULL) {
+        if (priv->m3u_media_url == NULL || strcmp(variant->url, priv->m3u_media_url) != 0) {
+            char *media_url = audio_strdup(variant->url);
+            if (media_url == NULL)
+                return -1;
+            OS_LOGI(TAG, "Select variant: bandwidth=%ld, measured=%ld", variant->bandwidth, priv->m3u_bandwidth);
+            if (priv->m3u_media_url != NULL)
+                audio_free(priv->m3u_media_url);
+            priv->m3u_media_url = media_url;
+            // Segments not downloading yet are taken from the new variant
+            if (!list_empty(&priv->m3u_list)) {
+                struct m3u_node *node = listnode_to_item(list_head(&priv->m3u_list), struct m3u_node, listnode);
+                priv->m3u_next_sequence = node->sequence;
+                m3u_list_clear(&priv->m3u_list);
+            }
+        }
+        url = priv->m3u_media_url;
     }
 
-dequeue_url:
-    if (list_empty(&priv->m3u_list)) {
-        int fill_size = 0;
-        while (!priv->stop) {
-            os_mutex_lock(priv->lock);
-            if (!priv->stop)
-                fill_size = rb_bytes_filled(priv->info.out_ringbuf);
-            else
-                fill_size = 0;
-            os_mutex_unlock(priv->lock);
+    if (m3u_playlist_load(priv->info.source_ops, url, &playlist) != 0) {
+        m3u_playlist_clear(&playlist);
+        return -1;
+    }
+    priv->m3u_refresh_time = m3u_now_msec();
 
-            // waiting decoder to consume the old data in the ringbuf
-            if (fill_size > DEFAULT_M3U_FILL_THRESHOLD)
-                os_thread_sleep_msec(100);
-            else
-                break;
+    if (variant == NULL && list_empty(&playlist.segments)) {
+        // Master playlist, keep the variants then load the selected one
+        list_for_each_safe(item, tmp, &playlist.variants) {
+            list_remove(item);
+            list_add_tail(&priv->m3u_variants, item);
         }
-        OS_LOGV(TAG, "Current m3u list playdone, resolve more");
-        goto resolve_m3u;
+        return m3u_playlist_refresh(priv);
     }
 
-    if (http != NULL) {
-        pos = 0;
-        priv->info.source_ops->close(http);
+    priv->m3u_target_duration = playlist.target_duration;
+    priv->m3u_endlist = playlist.endlist;
+    list_for_each_safe(item, tmp, &playlist.segments) {
+        struct m3u_node *node = listnode_to_item(item, struct m3u_node, listnode);
+        // Live playlist slides, skip the segments queued by last refresh
+        if (playlist.target_duration > 0 && node->sequence < priv->m3u_next_sequence)
+            continue;
+        list_remove(item);
+        list_add_tail(&priv->m3u_list, item);
+        priv->m3u_next_sequence = node->sequence + 1;
     }
+    m3u_playlist_clear(&playlist);
+    return 0;
+}
 
-    struct listnode *front = list_head(&priv->m3u_list);
-    struct m3u_node *node = listnode_to_item(front, struct m3u_node, listnode);
-    http = priv->info.source_ops->open(node->url, pos, priv->info.source_ops->priv_data);
+static bool m3u_playlist_need_refresh(struct media_source_priv *priv)
+{
+    struct m3u_node *variant = m3u_variant_select(&priv->m3u_variants, priv->m3u_bandwidth);
+    if (variant != NULL && strcmp(variant->url, priv->m3u_media_url) != 0)
+        return true;
+    if (priv->m3u_endlist || priv->m3u_target_duration <= 0)
+        return false;
+
+    // Reload live playlist every target duration, or half of it if running out of segments
+    unsigned long long interval = priv->m3u_target_duration * 1000;
+    if (list_empty(&priv->m3u_list))
+        interval /= 2;
+    return m3u_now_msec() - priv->m3u_refresh_time >= interval;
+}
 
-    list_remove(front);
-    audio_free(node->url);
-    audio_free(node);
+static enum media_source_state m3u_prefetch_segment(struct media_source_priv *priv, struct m3u_slot *slot, char *buffer)
+{
+    enum media_source_state state = MEDIA_SOURCE_READ_FAILED;
+    struct source_wrapper *source_ops = priv->info.source_ops;
+    source_handle_t http = NULL;
+    int bytes_read = 0, bytes_written = 0;
+    int ret = 0;
 
+    // Time connect and reads only, blocking on a full slot ring is the
+    // decoder's pace and would pin the estimate to the playback bitrate
+    unsigned long long begin = os_monotonic_usec();
+    http = source_ops->open(slot->url, slot->pos, source_ops->priv_data);
+    slot->usec += os_monotonic_usec() - begin;
     if (http == NULL) {
         OS_LOGE(TAG, "Connect failed, request next url");
-        state = MEDIA_SOURCE_READ_FAILED;
-        goto dequeue_url;
+        return MEDIA_SOURCE_READ_FAILED;
     }
 
-    int bytes_read = 0, bytes_written = 0;
-    while (!priv->stop) {
-        if (http != NULL)
-            bytes_read = priv->info.source_ops->read(http, buffer, DEFAULT_MEDIA_SOURCE_BUFFER_SIZE);
+    while (!priv->m3u_exit) {
+        begin = os_monotonic_usec();
+        bytes_read = source_ops->read(http, buffer, DEFAULT_MEDIA_SOURCE_BUFFER_SIZE);
+        unsigned long long elapsed = os_monotonic_usec() - begin;
+        slot->usec += elapsed;
+        if (priv->info.read_stats != NULL)
+            liteplayer_stats_record(priv->info.stats_lock, priv->info.read_stats, elapsed, bytes_read);
         if (bytes_read < 0) {
             OS_LOGE(TAG, "Read failed, request next url");
             state = MEDIA_SOURCE_READ_FAILED;
-            goto dequeue_url;
+            break;
         } else if (bytes_read == 0) {
             OS_LOGD(TAG, "Read done, request next url");
             state = MEDIA_SOURCE_READ_DONE;
-            goto dequeue_url;
+            break;
+        }
+        slot->bytes += bytes_read;
+
+        bytes_written = 0;
+        while (!priv->m3u_exit && bytes_read > 0) {
+            ret = rb_write(slot->rb, &buffer[bytes_written], bytes_read, DEFAULT_M3U_WAIT_MS);
+            if (ret > 0) {
+                bytes_read -= ret;
+                bytes_written += ret;
+            } else if (ret != RB_TIMEOUT) {
+                state = MEDIA_SOURCE_WRITE_FAILED;
+                goto fetch_done;
+            }
+        }
+    }
+
+fetch_done:
+    source_ops->close(http);
+    return state;
+}
+
+static void *m3u_prefetch_thread(void *arg)
+{
+    struct m3u_slot *slot = (struct m3u_slot *)arg;
+    struct media_source_priv *priv = slot->owner;
+    enum media_source_state result;
+    char *buffer = NULL;
+
+    buffer = bufpool_get(priv->info.bufpool, DEFAULT_MEDIA_SOURCE_BUFFER_SIZE);
+    if (buffer == NULL)
+        OS_LOGE(TAG, "Failed to allocate prefetch buffer");
+
+    os_mutex_lock(priv->m3u_lock);
+    while (!priv->m3u_exit) {
+        if (slot->state != M3U_SLOT_QUEUED) {
+            os_cond_wait(priv->m3u_cond, priv->m3u_lock);
+            continue;
+        }
+        slot->state = M3U_SLOT_FETCHING;
+        slot->bytes = 0;
+        slot->usec = 0;
+        os_mutex_unlock(priv->m3u_lock);
+
+        // bytes/usec are only read by the release after FETCHED is set under lock
+        result = MEDIA_SOURCE_READ_FAILED;
+        if (buffer != NULL)
+            result = m3u_prefetch_segment(priv, slot, buffer);
+
+        os_mutex_lock(priv->m3u_lock);
+        slot->result = result;
+        slot->state = M3U_SLOT_FETCHED;
+        // Reader drains what's left then gets RB_DONE
+        rb_done_write(slot->rb);
+    }
+    os_mutex_unlock(priv->m3u_lock);
+
+    bufpool_put(priv->info.bufpool, buffer);
+    return NULL;
+}
+
+static int m3u_prefetch_init(struct media_source_priv *priv)
+{
+    int i;
+    priv->m3u_lock = os_mutex_create();
+    priv->m3u_cond = os_cond_create();
+    if (priv->m3u_lock == NULL || priv->m3u_cond == NULL)
+        return -1;
+    for (i = 0; i < M3U_SLOT_COUNT; i++) {
+        priv->m3u_slots[i].owner = priv;
+        priv->m3u_slots[i].rb = rb_create(DEFAULT_M3U_SEGMENT_BUFFER_SIZE);
+        if (priv->m3u_slots[i].rb == NULL)
+            return -1;
+    }
+    return 0;
+}
+
+static void m3u_prefetch_deinit(struct media_source_priv *priv)
+{
+    int i;
+    for (i = 0; i < M3U_SLOT_COUNT; i++) {
+        if (priv->m3u_slots[i].rb != NULL)
+            rb_destroy(priv->m3u_slots[i].rb);
+        if (priv->m3u_slots[i].url != NULL)
+            audio_free(priv->m3u_slots[i].url);
+    }
+    if (priv->m3u_lock != NULL)
+        os_mutex_destroy(priv->m3u_lock);
+    if (priv->m3u_cond != NULL)
+        os_cond_destroy(priv->m3u_cond);
+}
+
+static int m3u_prefetch_start(struct media_source_priv *priv)
+{
+    struct os_thread_attr attr = {
+        .name = "ael-m3u-prefetch",
+        .priority = DEFAULT_MEDIA_SOURCE_TASK_PRIO,
+        .stacksize = DEFAULT_MEDIA_SOURCE_TASK_STACKSIZE,
+        .joinable = true,
+    };
+    int i;
+    for (i = 0; i < M3U_SLOT_COUNT; i++) {
+        priv->m3u_slots[i].tid = os_thread_create(&attr, m3u_prefetch_thread, &priv->m3u_slots[i]);
+        if (priv->m3u_slots[i].tid == NULL) {
+            OS_LOGE(TAG, "Failed to create prefetch thread");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void m3u_prefetch_stop(struct media_source_priv *priv)
+{
+    int i;
+    os_mutex_lock(priv->m3u_lock);
+    priv->m3u_exit = true;
+    for (i = 0; i < M3U_SLOT_COUNT; i++)
+        rb_abort(priv->m3u_slots[i].rb);
+    os_cond_broadcast(priv->m3u_cond);
+    os_mutex_unlock(priv->m3u_lock);
+
+    for (i = 0; i < M3U_SLOT_COUNT; i++) {
+        if (priv->m3u_slots[i].tid != NULL) {
+            os_thread_join(priv->m3u_slots[i].tid, NULL);
+            priv->m3u_slots[i].tid = NULL;
+        }
+    }
+}
+
+// Hand queued urls to idle slots, in order of play
+static void m3u_prefetch_schedule(struct media_source_priv *priv, long long *pos)
+{
+    os_mutex_lock(priv->m3u_lock);
+    while (priv->m3u_slot_count < M3U_SLOT_COUNT && !list_empty(&priv->m3u_list)) {
+        struct m3u_slot *slot = &priv->m3u_slots[(priv->m3u_slot_head + priv->m3u_slot_count) % M3U_SLOT_COUNT];
+        struct listnode *front = list_head(&priv->m3u_list);
+        struct m3u_node *node = listnode_to_item(front, struct m3u_node, listnode);
+        list_remove(front);
+        slot->url = (char *)node->url;
+        slot->pos = *pos;
+        slot->state = M3U_SLOT_QUEUED;
+        audio_free(node);
+        *pos = 0;
+        priv->m3u_slot_count++;
+    }
+    os_cond_broadcast(priv->m3u_cond);
+    os_mutex_unlock(priv->m3u_lock);
+}
+
+// Recycle the head slot once it's drained, return the download result
+static enum media_source_state m3u_prefetch_release(struct media_source_priv *priv)
+{
+    struct m3u_slot *slot = &priv->m3u_slots[priv->m3u_slot_head];
+    enum media_source_state result;
+
+    os_mutex_lock(priv->m3u_lock);
+    result = slot->result;
+    if (slot->usec > 0 && slot->bytes > 0) {
+        long bandwidth = (long)(slot->bytes * 8 * 1000000 / slot->usec);
+        if (priv->m3u_bandwidth > 0)
+            priv->m3u_bandwidth = (priv->m3u_bandwidth * 3 + bandwidth) / 4;
+        else
+            priv->m3u_bandwidth = bandwidth;
+    }
+    audio_free(slot->url);
+    slot->url = NULL;
+    slot->state = M3U_SLOT_IDLE;
+    rb_reset(slot->rb);
+    priv->m3u_slot_head = (priv->m3u_slot_head + 1) % M3U_SLOT_COUNT;
+    priv->m3u_slot_count--;
+    os_mutex_unlock(priv->m3u_lock);
+    return result;
+}
+
+static void *m3u_source_thread(void *arg)
+{
+    struct media_source_priv *priv = (struct media_source_priv *)arg;
+    enum media_source_state state = MEDIA_SOURCE_READ_FAILED;
+    char *buffer = NULL;
+    long long pos = priv->info.content_pos;
+    int ret = 0;
+
+    buffer = bufpool_get(priv->info.bufpool, DEFAULT_MEDIA_SOURCE_BUFFER_SIZE);
+    if (buffer == NULL) {
+        OS_LOGE(TAG, "Failed to allocate response buffer");
+        goto thread_exit;
+    }
+
+    ret = m3u_playlist_refresh(priv);
+    if (ret != 0) {
+        OS_LOGE(TAG, "Failed to parse m3u url");
+        goto thread_exit;
+    }
+
+    if (m3u_prefetch_start(priv) != 0)
+        goto thread_exit;
+
+    int bytes_read = 0, bytes_written = 0;
+    while (!priv->stop) {
+        m3u_prefetch_schedule(priv, &pos);
+
+        if (priv->m3u_slot_count == 0) {
+            if (priv->m3u_endlist) {
+                OS_LOGD(TAG, "M3U playlist ended");
+                break;
+            }
+            if (priv->m3u_target_duration > 0) {
+                // Live playlist, wait for new segments
+                if (!m3u_playlist_need_refresh(priv)) {
+                    os_thread_sleep_msec(DEFAULT_M3U_WAIT_MS);
+                    continue;
+                }
+            } else {
+                int fill_size = 0;
+                while (!priv->stop) {
+                    os_mutex_lock(priv->lock);
+                    if (!priv->stop)
+                        fill_size = rb_bytes_filled(priv->info.out_ringbuf);
+                    else
+                        fill_size = 0;
+                    os_mutex_unlock(priv->lock);
+
+                    // waiting decoder to consume the old data in the ringbuf
+                    if (fill_size > DEFAULT_M3U_FILL_THRESHOLD)
+                        os_thread_sleep_msec(100);
+                    else
+                        break;
+                }
+            }
+            OS_LOGV(TAG, "Current m3u list playdone, resolve more");
+            if (m3u_playlist_refresh(priv) != 0) {
+                OS_LOGE(TAG, "Failed to parse m3u url");
+                state = MEDIA_SOURCE_READ_FAILED;
+                goto thread_exit;
+            }
+            continue;
+        }
+
+        if (m3u_playlist_need_refresh(priv) && m3u_playlist_refresh(priv) != 0)
+            OS_LOGW(TAG, "Failed to refresh m3u url, retry later");
+
+        bytes_read = rb_read(priv->m3u_slots[priv->m3u_slot_head].rb,
+                             buffer, DEFAULT_MEDIA_SOURCE_BUFFER_SIZE, DEFAULT_M3U_WAIT_MS);
+        if (bytes_read == RB_TIMEOUT) {
+            continue;
+        } else if (bytes_read <= 0) {
+            if (priv->stop)
+                break;
+            state = m3u_prefetch_release(priv);
+            continue;
         }
 
         bytes_written = 0;
@@ -335,10 +783,8 @@ dequeue_url:
     }
 
 thread_exit:
-    if (http != NULL)
-        priv->info.source_ops->close(http);
-    if (buffer != NULL)
-        audio_free(buffer);
+    m3u_prefetch_stop(priv);
+    bufpool_put(priv->info.bufpool, buffer);
 
     {
         os_mutex_lock(priv->lock);
@@ -369,118 +815,35 @@ int m3u_get_first_url(struct media_source_info *info, char *buf, int buf_size)
     if (info == NULL || info->url == NULL || buf == NULL || buf_size <=0)
         return -1;
 
+    struct m3u_playlist playlist, media;
+    struct listnode *segments = NULL;
     int ret = -1;
-    source_handle_t http = NULL;
-    char *content = audio_malloc(DEFAULT_M3U_BUFFER_SIZE);
-    if (content == NULL)
-        goto resolve_done;
 
-    http = info->source_ops->open(info->url, 0, info->source_ops->priv_data);
-    if (http == NULL) {
-        OS_LOGE(TAG, "Failed to connect m3u url");
-        goto resolve_done;
-    }
+    memset(&media, 0x0, sizeof(media));
+    list_init(&media.segments);
+    list_init(&media.variants);
 
-    int bytes_read = info->source_ops->read(http, content, DEFAULT_M3U_BUFFER_SIZE);
-    if (bytes_read <= 0) {
-        OS_LOGE(TAG, "Failed to read m3u content");
+    if (m3u_playlist_load(info->source_ops, info->url, &playlist) != 0)
         goto resolve_done;
+    segments = &playlist.segments;
+
+    if (list_empty(segments)) {
+        // Master playlist, the first segment of the variant that m3u source starts with
+        struct m3u_node *variant = m3u_variant_select(&playlist.variants, 0);
+        if (m3u_playlist_load(info->source_ops, variant->url, &media) != 0)
+            goto resolve_done;
+        segments = &media.segments;
     }
-    OS_LOGV(TAG, "Succeed to read m3u content:\n%s", content);
 
-    int index = 0, remain = bytes_read;
-    char *line = NULL;
-    char *url_line = NULL;
-    bool is_valid_m3u = false;
-    bool is_valid_url = false;
-    while ((line = m3u_parser_get_line(content, &index, &remain)) != NULL) {
-        if (!is_valid_m3u && strcmp(line, "#EXTM3U") == 0) {
-            is_valid_m3u = true;
-            continue;
-        }
-        if (strstr(line, "http") == line) {
-            url_line = line;
-            break;
-        }
-        if (!is_valid_m3u) {
-            break;
-        }
-        if (!is_valid_url && strstr(line, "#EXTINF") == line) {
-            is_valid_url = true;
-            continue;
-        } else if (!is_valid_url && strstr(line, "#EXT-X-STREAM-INF") == line) {
-            /**
-             * As these are stream URIs we need to fetch thse periodically to keep live streaming.
-             * For now we handle it same as normal uri and exit.
-             */
-            is_valid_url = true;
-            continue;
-        } else if (strncmp(line, "#", 1) == 0) {
-            /**
-             * Some other playlist field we don't support.
-             * Simply treat this as a comment and continue to find next line.
-             */
-            continue;
-        }
-        if (!is_valid_url) {
-            continue;
-        }
-        url_line = line;
-        break;
-    }
-
-    if (url_line != NULL) {
-        if (strstr(url_line, "http") == url_line) { // full uri
-            snprintf(buf, buf_size, "%s", url_line);
-            ret = 0;
-        } else if (strstr(url_line, "//") == url_line) { //schemeless uri
-            if (strstr(info->url, "https") == info->url)
-                snprintf(buf, buf_size, "https:%s", url_line);
-            else
-                snprintf(buf, buf_size, "http:%s", url_line);
-            ret = 0;
-        } else if (strstr(url_line, "/") == url_line) { // Root uri
-            char *dup_url = audio_strdup(info->url);
-            if (dup_url == NULL) {
-                goto resolve_done;
-            }
-            char *host = strstr(dup_url, "//");
-            if (host == NULL) {
-                audio_free(dup_url);
-                goto resolve_done;
-            }
-            host += 2;
-            char *path = strstr(host, "/");
-            if (path == NULL) {
-                audio_free(dup_url);
-                goto resolve_done;
-            }
-            path[0] = 0;
-            snprintf(buf, buf_size, "%s%s", dup_url, url_line);
-            audio_free(dup_url);
-            ret = 0;
-        } else { // Relative URI
-            char *dup_url = audio_strdup(info->url);
-            if (dup_url == NULL) {
-                goto resolve_done;
-            }
-            char *pos = strrchr(dup_url, '/'); // Search for last "/"
-            if (pos == NULL) {
-                audio_free(dup_url);
-                goto resolve_done;
-            }
-            pos[1] = '\0';
-            snprintf(buf, buf_size, "%s%s", dup_url, url_line);
-            audio_free(dup_url);
-            ret = 0;
-        }
+    if (!list_empty(segments)) {
+        struct m3u_node *node = listnode_to_item(list_head(segments), struct m3u_node, listnode);
+        snprintf(buf, buf_size, "%s", node->url);
+        ret = 0;
     }
 
 resolve_done:
-    if (http != NULL)
-        info->source_ops->close(http);
-    if (content != NULL)
-        audio_free(content);
+    m3u_playlist_clear(&playlist);
+    m3u_playlist_clear(&media);
     return ret;
 }
 
@@ -493,91 +856,266 @@ static void media_source_cleanup(struct media_source_priv *priv)
     if (priv->info.url != NULL)
         audio_free(priv->info.url);
     m3u_list_clear(&priv->m3u_list);
+    m3u_list_clear(&priv->m3u_variants);
+    if (priv->m3u_media_url != NULL)
+        audio_free(priv->m3u_media_url);
+    m3u_prefetch_deinit(priv);
     audio_free(priv);
 }
 
+// Watermark in msec of media, from the throughput that holds most of the time (jitter taken off):
+// its surplus over bitrate refills the ringbuf, the thinner the surplus the deeper the buffer
+static int media_source_buffering_msec(struct media_source_priv *priv)
+{
+    long long rate = priv->buffering_rate;
+    long long low = priv->buffering_throughput - 2*priv->buffering_jitter;
+    long long msec;
+
+    if (priv->buffering_throughput == 0 || low >= 2*rate)
+        msec = DEFAULT_MEDIA_SOURCE_BUFFERING_MIN_MS;
+    else if (low > rate)
+        msec = DEFAULT_MEDIA_SOURCE_BUFFERING_MIN_MS*rate/(low - rate);
+    else
+        msec = DEFAULT_MEDIA_SOURCE_BUFFERING_MAX_MS;
+    // Recent underruns raise the bar for rebuffering
+    msec *= priv->buffering_penalty + 1;
+
+    if (msec < DEFAULT_MEDIA_SOURCE_BUFFERING_MIN_MS)
+        msec = DEFAULT_MEDIA_SOURCE_BUFFERING_MIN_MS;
+    else if (msec > DEFAULT_MEDIA_SOURCE_BUFFERING_MAX_MS)
+        msec = DEFAULT_MEDIA_SOURCE_BUFFERING_MAX_MS;
+    return (int)msec;
+}
+
+// Must be called with priv->lock held, ringbuf is sized to twice the watermark
+static void media_source_buffering_apply(struct media_source_priv *priv)
+{
+    ringbuf_handle rb = priv->info.out_ringbuf;
+    int threshold = (int)((long long)media_source_buffering_msec(priv)*priv->buffering_rate/1000);
+    int size = rb_get_size(rb);
+    int target = (threshold*2 + DEFAULT_BUFFERING_SIZE_ALIGN - 1)/DEFAULT_BUFFERING_SIZE_ALIGN*DEFAULT_BUFFERING_SIZE_ALIGN;
+
+    if (target > DEFAULT_MEDIA_SOURCE_BUFFERING_MAX_SIZE)
+        target = DEFAULT_MEDIA_SOURCE_BUFFERING_MAX_SIZE;
+    if (target < priv->buffering_min_size)
+        target = priv->buffering_min_size;
+    // Shrink only if the data fits and it's worth it
+    if (target > size || (target <= size/2 && rb_bytes_filled(rb) <= target)) {
+        if (rb_resize(rb, target) == RB_OK) {
+            OS_LOGD(TAG, "Resize source ringbuf: %d -> %d", size, target);
+            size = target;
+        }
+    }
+
+    if (threshold > size)
+        threshold = size;
+    if (threshold != priv->buffering_threshold) {
+        OS_LOGD(TAG, "Buffering watermark: %d bytes, throughput=%lld(+/-%lld), bitrate=%d, underruns=%d(penalty=%d)",
+                threshold, priv->buffering_throughput, priv->buffering_jitter,
+                priv->buffering_rate, priv->buffering_underruns, priv->buffering_penalty);
+        rb_set_threshold(rb, threshold);
+        priv->buffering_threshold = threshold;
+    }
+}
+
+static void media_source_buffering_init(struct media_source_priv *priv)
+{
+#if DEFAULT_MEDIA_SOURCE_BUFFERING
+    priv->buffering_rate = priv->info.bytes_per_sec > 0 ?
+                           priv->info.bytes_per_sec : DEFAULT_MEDIA_SOURCE_BYTES_PER_SEC;
+    priv->buffering_min_size = priv->info.source_ops->buffer_size;
+    os_mutex_lock(priv->lock);
+    if (!priv->stop)
+        media_source_buffering_apply(priv);
+    os_mutex_unlock(priv->lock);
+#endif
+}
+
+// Account a source read that ran from begin to end, then adjust watermark and ringbuf size if needed
+static void media_source_buffering_update(struct media_source_priv *priv, int bytes,
+                                          unsigned long long begin, unsigned long long end)
+{
+    bool changed = false;
+
+    if (priv->buffering_rate == 0)
+        return;
+
+    // Ringbuf goes away with the player once stopped
+    os_mutex_lock(priv->lock);
+    if (priv->stop) {
+        os_mutex_unlock(priv->lock);
+        return;
+    }
+
+    // Threshold is armed again by decoder once it runs dry
+    bool reached = rb_reach_threshold(priv->info.out_ringbuf);
+    if (priv->buffering_reached && !reached) {
+        priv->buffering_underruns++;
+        priv->buffering_penalty++;
+        priv->buffering_penalty_time = end;
+        OS_LOGW(TAG, "Source underrun, count=%d", priv->buffering_underruns);
+        changed = true;
+    } else if (priv->buffering_penalty > 0 &&
+               end - priv->buffering_penalty_time >= DEFAULT_BUFFERING_PENALTY_USEC) {
+        priv->buffering_penalty--;
+        priv->buffering_penalty_time = end;
+        changed = true;
+    }
+    priv->buffering_reached = reached;
+
+    // Time from one read to the next: data that queued up in the socket while
+    // writing comes back fast, timing read() alone would overrate the link.
+    // A window in which the ringbuf filled up measures the decoder, drop it.
+    unsigned long long usec = end - (priv->buffering_read_time > 0 ? priv->buffering_read_time : begin);
+    priv->buffering_read_time = end;
+    if (priv->buffering_blocked) {
+        priv->buffering_blocked = false;
+        priv->buffering_window_bytes = 0;
+        priv->buffering_window_usec = 0;
+    } else {
+        priv->buffering_window_bytes += bytes;
+        priv->buffering_window_usec += usec;
+    }
+    if (priv->buffering_window_usec >= DEFAULT_BUFFERING_WINDOW_USEC ||
+        priv->buffering_window_bytes >= priv->buffering_rate) {
+        long long sample = priv->buffering_window_bytes*1000000/
+                           (priv->buffering_window_usec > 0 ? priv->buffering_window_usec : 1);
+        if (priv->buffering_throughput == 0) {
+            priv->buffering_throughput = sample;
+        } else {
+            long long deviation = sample - priv->buffering_throughput;
+            priv->buffering_throughput += deviation/4;
+            priv->buffering_jitter += ((deviation >= 0 ? deviation : -deviation) - priv->buffering_jitter)/4;
+        }
+        priv->buffering_window_bytes = 0;
+        priv->buffering_window_usec = 0;
+        changed = true;
+    }
+
+    if (changed)
+        media_source_buffering_apply(priv);
+    os_mutex_unlock(priv->lock);
+}
+
+static int media_source_open(struct media_source_priv *priv)
+{
+    if (priv->info.source_handle == NULL) {
+        priv->info.source_handle = priv->info.source_ops->open(priv->info.url,
+                priv->info.content_pos, priv->info.source_ops->priv_data);
+        if (priv->info.source_handle == NULL)
+            return -1;
+    }
+    media_source_buffering_init(priv);
+    return 0;
+}
+
+// Read next chunk, return bytes read, or 0 with state set if reading is over
+static int media_source_read(struct media_source_priv *priv, char *buffer, enum media_source_state *state)
+{
+    unsigned long long begin = os_monotonic_usec();
+    int bytes_read = priv->info.source_ops->read(priv->info.source_handle, buffer, DEFAULT_MEDIA_SOURCE_BUFFER_SIZE);
+    unsigned long long end = os_monotonic_usec();
+    if (priv->info.read_stats != NULL)
+        liteplayer_stats_record(priv->info.stats_lock, priv->info.read_stats, end - begin, bytes_read);
+    if (bytes_read > 0)
+        media_source_buffering_update(priv, bytes_read, begin, end);
+    if (bytes_read < 0) {
+        OS_LOGE(TAG, "Media source read failed");
+        *state = MEDIA_SOURCE_READ_FAILED;
+        return 0;
+    } else if (bytes_read == 0) {
+        OS_LOGD(TAG, "Media source read done");
+        *state = MEDIA_SOURCE_READ_DONE;
+    }
+    return bytes_read;
+}
+
+// Must be called with priv->lock held, return bytes written, or 0 with state set if writing is over
+static int media_source_write(struct media_source_priv *priv, char *buffer, int size, enum media_source_state *state)
+{
+    if (rb_bytes_available(priv->info.out_ringbuf) < size)
+        priv->buffering_blocked = true;
+    int ret = rb_write(priv->info.out_ringbuf, buffer, size, AUDIO_MAX_DELAY);
+    if (ret > 0)
+        return ret;
+    if (ret == RB_DONE || ret == RB_ABORT || ret == RB_OK) {
+        OS_LOGD(TAG, "Media source write done");
+        *state = MEDIA_SOURCE_WRITE_DONE;
+    } else {
+        OS_LOGD(TAG, "Media source write failed");
+        *state = MEDIA_SOURCE_WRITE_FAILED;
+    }
+    return 0;
+}
+
+// Close source and report the end of source to decoder and listener
+static void media_source_finish(struct media_source_priv *priv, enum media_source_state state)
+{
+    if (priv->info.source_handle != NULL) {
+        priv->info.source_ops->close(priv->info.source_handle);
+        priv->info.source_handle = NULL;
+    }
+
+    os_mutex_lock(priv->lock);
+    if (!priv->stop) {
+        if (state == MEDIA_SOURCE_READ_DONE || state == MEDIA_SOURCE_WRITE_DONE)
+            rb_done_write(priv->info.out_ringbuf);
+        else
+            rb_abort(priv->info.out_ringbuf);
+        if (priv->listener)
+            priv->listener(state, priv->listener_priv);
+    }
+    os_mutex_unlock(priv->lock);
+}
+
 static void *media_source_thread(void *arg)
 {
     struct media_source_priv *priv = (struct media_source_priv *)arg;
     enum media_source_state state = MEDIA_SOURCE_READ_FAILED;
     char *buffer = NULL;
 
-    buffer = audio_malloc(DEFAULT_MEDIA_SOURCE_BUFFER_SIZE);
+    buffer = bufpool_get(priv->info.bufpool, DEFAULT_MEDIA_SOURCE_BUFFER_SIZE);
     if (buffer == NULL) {
         OS_LOGE(TAG, "Failed to allocate response buffer");
         goto thread_exit;
     }
 
-    if (priv->info.source_handle == NULL) {
-        priv->info.source_handle = priv->info.source_ops->open(priv->info.url,
-                priv->info.content_pos, priv->info.source_ops->priv_data);
-        if (priv->info.source_handle == NULL) {
-            state = MEDIA_SOURCE_READ_FAILED;
-            goto thread_exit;
-        }
-    }
+    if (media_source_open(priv) != 0)
+        goto thread_exit;
 
     int bytes_read = 0, bytes_written = 0;
     int ret = 0;
     while (!priv->stop) {
-        bytes_read = priv->info.source_ops->read(priv->info.source_handle, buffer, DEFAULT_MEDIA_SOURCE_BUFFER_SIZE);
-        if (bytes_read < 0) {
-            OS_LOGE(TAG, "Media source read failed");
-            state = MEDIA_SOURCE_READ_FAILED;
-            goto thread_exit;
-        } else if (bytes_read == 0) {
-            OS_LOGD(TAG, "Media source read done");
-            state = MEDIA_SOURCE_READ_DONE;
+        bytes_read = media_source_read(priv, buffer, &state);
+        if (bytes_read == 0)
             goto thread_exit;
-        }
 
         bytes_written = 0;
         do {
+            ret = 0;
             os_mutex_lock(priv->lock);
             if (!priv->stop)
-                ret = rb_write(priv->info.out_ringbuf, &buffer[bytes_written], bytes_read, AUDIO_MAX_DELAY);
+                ret = media_source_write(priv, &buffer[bytes_written], bytes_read, &state);
             os_mutex_unlock(priv->lock);
 
             if (ret > 0) {
                 bytes_read -= ret;
                 bytes_written += ret;
-            } else {
-                if (ret == RB_DONE || ret == RB_ABORT || ret == RB_OK) {
-                    OS_LOGD(TAG, "Media source write done");
-                    state = MEDIA_SOURCE_WRITE_DONE;
-                } else {
-                    OS_LOGD(TAG, "Media source write failed");
-                    state = MEDIA_SOURCE_WRITE_FAILED;
-                }
+            } else if (!priv->stop) {
                 goto thread_exit;
             }
         } while (!priv->stop && bytes_read > 0);
     }
 
 thread_exit:
-    if (priv->info.source_handle != NULL) {
-        priv->info.source_ops->close(priv->info.source_handle);
-        priv->info.source_handle = NULL;
-    }
-    if (buffer != NULL)
-        audio_free(buffer);
+    bufpool_put(priv->info.bufpool, buffer);
+    media_source_finish(priv, state);
 
     {
         os_mutex_lock(priv->lock);
-
-        if (!priv->stop) {
-            if (state == MEDIA_SOURCE_READ_DONE || state == MEDIA_SOURCE_WRITE_DONE)
-                rb_done_write(priv->info.out_ringbuf);
-            else
-                rb_abort(priv->info.out_ringbuf);
-            if (priv->listener)
-                priv->listener(state, priv->listener_priv);
-        }
-
         OS_LOGV(TAG, "Waiting stop command");
         while (!priv->stop)
             os_cond_wait(priv->cond, priv->lock);
-
         os_mutex_unlock(priv->lock);
     }
 
@@ -586,6 +1124,77 @@ thread_exit:
     return NULL;
 }
 
+// media_source_thread on a workpool: one source read or ringbuf write per step, polls
+// a full ringbuf instead of blocking, then parks until stopped
+static long media_source_job(void *arg)
+{
+    struct media_source_priv *priv = (struct media_source_priv *)arg;
+    enum media_source_state state = MEDIA_SOURCE_READ_FAILED;
+    bool stop;
+    int ret = 0;
+
+    os_mutex_lock(priv->lock);
+    stop = priv->stop;
+    os_mutex_unlock(priv->lock);
+
+    if (priv->job_finished || stop) {
+        if (!priv->job_finished) {
+            priv->job_finished = true;
+            media_source_finish(priv, state);
+        }
+        if (!stop)
+            return WORKPOOL_JOB_WAIT;
+        bufpool_put(priv->info.bufpool, priv->job_buffer);
+        media_source_cleanup(priv);
+        OS_LOGD(TAG, "Media source job leave");
+        return WORKPOOL_JOB_DONE;
+    }
+
+    if (priv->job_buffer == NULL) {
+        priv->job_buffer = bufpool_get(priv->info.bufpool, DEFAULT_MEDIA_SOURCE_BUFFER_SIZE);
+        if (priv->job_buffer == NULL) {
+            OS_LOGE(TAG, "Failed to allocate response buffer");
+            goto job_finish;
+        }
+        if (media_source_open(priv) != 0)
+            goto job_finish;
+    }
+
+    if (priv->job_remain == 0) {
+        priv->job_offset = 0;
+        priv->job_remain = media_source_read(priv, priv->job_buffer, &state);
+        if (priv->job_remain == 0)
+            goto job_finish;
+    }
+
+    os_mutex_lock(priv->lock);
+    if (!priv->stop) {
+        int available = rb_bytes_available(priv->info.out_ringbuf);
+        if (available < priv->job_remain)
+            priv->buffering_blocked = true;
+        if (available > 0 || rb_is_done_write(priv->info.out_ringbuf)) {
+            int size = available > 0 && available < priv->job_remain ? available : priv->job_remain;
+            ret = media_source_write(priv, &priv->job_buffer[priv->job_offset], size, &state);
+            if (ret == 0) {
+                os_mutex_unlock(priv->lock);
+                goto job_finish;
+            }
+        }
+    }
+    os_mutex_unlock(priv->lock);
+
+    if (ret == 0)
+        return DEFAULT_MEDIA_SOURCE_JOB_POLL_MS*1000;
+    priv->job_offset += ret;
+    priv->job_remain -= ret;
+    return 0;
+
+job_finish:
+    priv->job_finished = true;
+    media_source_finish(priv, state);
+    return 0;
+}
+
 media_source_handle_t media_source_start_async(struct media_source_info *info,
                                                media_source_state_cb listener,
                                                void *listener_priv)
@@ -604,6 +1213,7 @@ media_source_handle_t media_source_start_async(struct media_source_info *info,
     priv->cond = os_cond_create();
     priv->info.url = audio_strdup(info->url);
     list_init(&priv->m3u_list);
+    list_init(&priv->m3u_variants);
     if (priv->lock == NULL || priv->cond == NULL || priv->info.url == NULL)
         goto start_failed;
 
@@ -621,10 +1231,19 @@ media_source_handle_t media_source_start_async(struct media_source_info *info,
             priv->info.source_handle = NULL;
         }
         rb_reset(priv->info.out_ringbuf);
+        if (m3u_prefetch_init(priv) != 0)
+            goto start_failed;
         id = os_thread_create(&attr, m3u_source_thread, priv);
     } else {
         if (priv->info.source_handle == NULL)
             rb_reset(priv->info.out_ringbuf);
+        if (priv->info.workpool != NULL) {
+            priv->job = workpool_job_create(priv->info.workpool, media_source_job, priv);
+            if (priv->job == NULL)
+                goto start_failed;
+            workpool_job_wake(priv->job);
+            return priv;
+        }
         id = os_thread_create(&attr, media_source_thread, priv);
     }
     if (id == NULL)
@@ -645,11 +1264,21 @@ void media_source_stop(media_source_handle_t handle)
 
     rb_done_read(priv->info.out_ringbuf);
     rb_done_write(priv->info.out_ringbuf);
+    if (priv->m3u_lock != NULL) {
+        // Wake m3u source thread waiting for segment data
+        os_mutex_lock(priv->m3u_lock);
+        for (int i = 0; i < M3U_SLOT_COUNT; i++)
+            rb_abort(priv->m3u_slots[i].rb);
+        os_mutex_unlock(priv->m3u_lock);
+    }
 
     {
         os_mutex_lock(priv->lock);
         priv->stop = true;
         os_cond_signal(priv->cond);
+        // Job frees priv once it sees stop, so wake it before unlock
+        if (priv->job != NULL)
+            workpool_job_wake(priv->job);
         os_mutex_unlock(priv->lock);
     }
 }
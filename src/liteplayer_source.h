@@ -15,7 +15,10 @@
 #ifndef _LITEPLAYER_MEDIASOURCE_H_
 #define _LITEPLAYER_MEDIASOURCE_H_
 
+#include "osal/os_thread.h"
 #include "cutils/ringbuf.h"
+#include "cutils/workpool.h"
+#include "cutils/bufpool.h"
 #include "liteplayer_adapter.h"
 
 #ifdef __cplusplus
@@ -33,12 +36,19 @@ enum media_source_state {
 
 typedef void (*media_source_state_cb)(enum media_source_state state, void *priv);
 
+struct liteplayer_stage_stats;
+
 struct media_source_info {
     const char *url;
     source_handle_t source_handle;
     struct source_wrapper *source_ops;
     long long content_pos;
     ringbuf_handle out_ringbuf;
+    int bytes_per_sec; // codec bitrate for adaptive buffering, 0 if unknown
+    struct liteplayer_stage_stats *read_stats; // optional, recorded with stats_lock held
+    os_mutex stats_lock;
+    workpool_handle workpool; // optional, source and parser run as jobs on it instead of own threads
+    bufpool_handle bufpool;   // optional, read buffers are taken from and returned to it
 };
 
 typedef void *media_source_handle_t;
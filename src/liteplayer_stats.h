@@ -0,0 +1,49 @@
+// Copyright (c) 2019-2022 Qinglong<sysu.zqlong@gmail.com>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _LITEPLAYER_STATS_H_
+#define _LITEPLAYER_STATS_H_
+
+#include "osal/os_thread.h"
+#include "liteplayer_main.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline void liteplayer_stats_record(os_mutex lock, struct liteplayer_stage_stats *stats,
+                                           unsigned long long usec, int bytes)
+{
+    int bucket = 0;
+    while (bucket < LITEPLAYER_STATS_TIME_BUCKETS - 1 && usec >= (64ULL << bucket))
+        bucket++;
+
+    if (lock != NULL)
+        os_mutex_lock(lock);
+    stats->count++;
+    if (bytes > 0)
+        stats->bytes += bytes;
+    stats->total_usec += usec;
+    if (usec > stats->max_usec)
+        stats->max_usec = (unsigned long)usec;
+    stats->histogram[bucket]++;
+    if (lock != NULL)
+        os_mutex_unlock(lock);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _LITEPLAYER_STATS_H_
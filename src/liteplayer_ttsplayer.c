@@ -94,6 +94,13 @@ int ttsplayer_register_sink_wrapper(ttsplayer_handle_t handle, struct sink_wrapp
     return liteplayer_register_sink_wrapper(handle->player, wrapper);
 }
 
+int ttsplayer_set_sink_format(ttsplayer_handle_t handle, int samplerate, int channels, int bits)
+{
+    if (handle == NULL)
+        return -1;
+    return liteplayer_set_sink_format(handle->player, samplerate, channels, bits);
+}
+
 int ttsplayer_register_state_listener(ttsplayer_handle_t handle, liteplayer_state_cb listener, void *listener_priv)
 {
     if (handle == NULL || listener == NULL)
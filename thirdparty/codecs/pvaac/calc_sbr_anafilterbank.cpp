@@ -131,16 +131,19 @@ Copyright (c) ISO/IEC 2002.
 ; FUNCTION CODE
 ----------------------------------------------------------------------------*/
 
-void calc_sbr_anafilterbank_LC(Int32 * Sr,
-                               Int16 * X,
-                               Int32 scratch_mem[][64],
-                               Int32 maxBand)
+#if defined(PV_X86_SIMD)
+void calc_sbr_anafilterbank_window_c(const Int32 * pt_C,
+                                     Int16 * X,
+                                     Int32 * Y)
+#else
+void calc_sbr_anafilterbank_window(const Int32 * pt_C,
+                                   Int16 * X,
+                                   Int32 * Y)
+#endif
 {
-
     Int i;
     Int32   *p_Y_1;
     Int32   *p_Y_2;
-
     Int16 * pt_X_1;
     Int16 * pt_X_2;
     Int32 realAccu1;
@@ -149,101 +152,74 @@ void calc_sbr_anafilterbank_LC(Int32 * Sr,
     Int32 tmp1;
     Int32 tmp2;
 
-
-    const Int32 * pt_C;
-
-    p_Y_1 = scratch_mem[0];
-
-
-    p_Y_2 = p_Y_1 + 63;
-    pt_C   = &sbrDecoderFilterbankCoefficients_an_filt_LC[0];
-
-    pt_X_1 = X;
-
-
-    realAccu1  =  fxp_mul32_by_16(Qfmt27(-0.51075594183097F),   pt_X_1[-192]);
-
-    realAccu1  =  fxp_mac32_by_16(Qfmt27(-0.51075594183097F), -pt_X_1[-128], realAccu1);
-    realAccu1  =  fxp_mac32_by_16(Qfmt27(-0.01876919066980F),  pt_X_1[-256], realAccu1);
-    *(p_Y_1++) =  fxp_mac32_by_16(Qfmt27(-0.01876919066980F), -pt_X_1[ -64], realAccu1);
-
-
-    /* create array Y */
+    p_Y_1 = &Y[1];
+    p_Y_2 = &Y[63];
 
     pt_X_1 = &X[-1];
     pt_X_2 = &X[-319];
 
 
-    for (i = 15; i != 0; i--)
+    for (i = 31; i != 0; i--)
     {
         tmp1 = *(pt_X_1--);
         tmp2 = *(pt_X_2++);
-
         realAccu1  = fxp_mul32_by_16(*(pt_C), tmp1);
         realAccu2  = fxp_mul32_by_16(*(pt_C++), tmp2);
         tmp1 = pt_X_1[ -63];
-        tmp2 = pt_X_2[ +63];
+        tmp2 = pt_X_2[  63];
         realAccu1  = fxp_mac32_by_16(*(pt_C), tmp1, realAccu1);
         realAccu2  = fxp_mac32_by_16(*(pt_C++), tmp2, realAccu2);
         tmp1 = pt_X_1[ -127];
-        tmp2 = pt_X_2[ +127];
+        tmp2 = pt_X_2[  127];
         realAccu1  = fxp_mac32_by_16(*(pt_C), tmp1, realAccu1);
         realAccu2  = fxp_mac32_by_16(*(pt_C++), tmp2, realAccu2);
         tmp1 = pt_X_1[ -191];
-        tmp2 = pt_X_2[ +191];
+        tmp2 = pt_X_2[  191];
         realAccu1  = fxp_mac32_by_16(*(pt_C), tmp1, realAccu1);
         realAccu2  = fxp_mac32_by_16(*(pt_C++), tmp2, realAccu2);
         tmp1 = pt_X_1[ -255];
-        tmp2 = pt_X_2[ +255];
+        tmp2 = pt_X_2[  255];
         *(p_Y_1++) = fxp_mac32_by_16(*(pt_C), tmp1, realAccu1);
         *(p_Y_2--) = fxp_mac32_by_16(*(pt_C++), tmp2, realAccu2);
+    }
+}
 
-        tmp1 = *(pt_X_1--);
-        tmp2 = *(pt_X_2++);
-        realAccu1  = fxp_mul32_by_16(*(pt_C), tmp1);
-        realAccu2  = fxp_mul32_by_16(*(pt_C++), tmp2);
 
-        tmp1 = pt_X_1[ -63];
-        tmp2 = pt_X_2[ +63];
-        realAccu1  = fxp_mac32_by_16(*(pt_C), tmp1, realAccu1);
-        realAccu2  = fxp_mac32_by_16(*(pt_C++), tmp2, realAccu2);
-        tmp1 = pt_X_1[ -127];
-        tmp2 = pt_X_2[ +127];
-        realAccu1  = fxp_mac32_by_16(*(pt_C), tmp1, realAccu1);
-        realAccu2  = fxp_mac32_by_16(*(pt_C++), tmp2, realAccu2);
-        tmp1 = pt_X_1[ -191];
-        tmp2 = pt_X_2[ +191];
-        realAccu1  = fxp_mac32_by_16(*(pt_C), tmp1, realAccu1);
-        realAccu2  = fxp_mac32_by_16(*(pt_C++), tmp2, realAccu2);
-        tmp1 = pt_X_1[ -255];
-        tmp2 = pt_X_2[ +255];
-        *(p_Y_1++) = fxp_mac32_by_16(*(pt_C), tmp1, realAccu1);
-        *(p_Y_2--) = fxp_mac32_by_16(*(pt_C++), tmp2, realAccu2);
 
-    }
+void calc_sbr_anafilterbank_LC(Int32 * Sr,
+                               Int16 * X,
+                               Int32 scratch_mem[][64],
+                               Int32 maxBand)
+{
 
+    Int32   *p_Y_1;
 
-    tmp1 = *(pt_X_1--);
-    tmp2 = *(pt_X_2++);
-    realAccu1  = fxp_mul32_by_16(*(pt_C), tmp1);
-    realAccu2  = fxp_mul32_by_16(*(pt_C++), tmp2);
-
-    tmp1 = pt_X_1[ -63];
-    tmp2 = pt_X_2[ +63];
-    realAccu1  = fxp_mac32_by_16(*(pt_C), tmp1, realAccu1);
-    realAccu2  = fxp_mac32_by_16(*(pt_C++), tmp2, realAccu2);
-    tmp1 = pt_X_1[ -127];
-    tmp2 = pt_X_2[ +127];
-    realAccu1  = fxp_mac32_by_16(*(pt_C), tmp1, realAccu1);
-    realAccu2  = fxp_mac32_by_16(*(pt_C++), tmp2, realAccu2);
-    tmp1 = pt_X_1[ -191];
-    tmp2 = pt_X_2[ +191];
-    realAccu1  = fxp_mac32_by_16(*(pt_C), tmp1, realAccu1);
-    realAccu2  = fxp_mac32_by_16(*(pt_C++), tmp2, realAccu2);
-    tmp1 = pt_X_1[ -255];
-    tmp2 = pt_X_2[ +255];
-    *(p_Y_1++) = fxp_mac32_by_16(*(pt_C), tmp1, realAccu1);
-    *(p_Y_2--) = fxp_mac32_by_16(*(pt_C++), tmp2, realAccu2);
+    Int16 * pt_X_1;
+    Int32 realAccu1;
+    Int32 realAccu2;
+
+
+    const Int32 * pt_C;
+
+    p_Y_1 = scratch_mem[0];
+
+
+    pt_C   = &sbrDecoderFilterbankCoefficients_an_filt_LC[0];
+
+    pt_X_1 = X;
+
+
+    realAccu1  =  fxp_mul32_by_16(Qfmt27(-0.51075594183097F),   pt_X_1[-192]);
+
+    realAccu1  =  fxp_mac32_by_16(Qfmt27(-0.51075594183097F), -pt_X_1[-128], realAccu1);
+    realAccu1  =  fxp_mac32_by_16(Qfmt27(-0.01876919066980F),  pt_X_1[-256], realAccu1);
+    *(p_Y_1++) =  fxp_mac32_by_16(Qfmt27(-0.01876919066980F), -pt_X_1[ -64], realAccu1);
+
+
+    /* create array Y */
+
+    calc_sbr_anafilterbank_window(pt_C, X, scratch_mem[0]);
+    p_Y_1 = scratch_mem[0] + 32;
 
 
     pt_X_1 = X;
@@ -273,27 +249,19 @@ void calc_sbr_anafilterbank(Int32 * Sr,
                             Int32 scratch_mem[][64],
                             Int32   maxBand)
 {
-    Int i;
     Int32   *p_Y_1;
-    Int32   *p_Y_2;
 
 
 
 
     const Int32 * pt_C;
-    Int16 * pt_X_1;
-    Int16 * pt_X_2;
     Int32 realAccu1;
     Int32 realAccu2;
 
-    Int32 tmp1;
-    Int32 tmp2;
-
 
     p_Y_1 = scratch_mem[0];
 
 
-    p_Y_2 = p_Y_1 + 63;
     pt_C   = &sbrDecoderFilterbankCoefficients_an_filt[0];
 
     realAccu1  =  fxp_mul32_by_16(Qfmt27(-0.36115899F),   X[-192]);
@@ -305,33 +273,8 @@ void calc_sbr_anafilterbank(Int32 * Sr,
 
     /* create array Y */
 
-    pt_X_1 = &X[-1];
-    pt_X_2 = &X[-319];
-
-
-    for (i = 31; i != 0; i--)
-    {
-        tmp1 = *(pt_X_1--);
-        tmp2 = *(pt_X_2++);
-        realAccu1  = fxp_mul32_by_16(*(pt_C), tmp1);
-        realAccu2  = fxp_mul32_by_16(*(pt_C++), tmp2);
-        tmp1 = pt_X_1[ -63];
-        tmp2 = pt_X_2[  63];
-        realAccu1  = fxp_mac32_by_16(*(pt_C), tmp1, realAccu1);
-        realAccu2  = fxp_mac32_by_16(*(pt_C++), tmp2, realAccu2);
-        tmp1 = pt_X_1[ -127];
-        tmp2 = pt_X_2[  127];
-        realAccu1  = fxp_mac32_by_16(*(pt_C), tmp1, realAccu1);
-        realAccu2  = fxp_mac32_by_16(*(pt_C++), tmp2, realAccu2);
-        tmp1 = pt_X_1[ -191];
-        tmp2 = pt_X_2[  191];
-        realAccu1  = fxp_mac32_by_16(*(pt_C), tmp1, realAccu1);
-        realAccu2  = fxp_mac32_by_16(*(pt_C++), tmp2, realAccu2);
-        tmp1 = pt_X_1[ -255];
-        tmp2 = pt_X_2[  255];
-        *(p_Y_1++) = fxp_mac32_by_16(*(pt_C), tmp1, realAccu1);
-        *(p_Y_2--) = fxp_mac32_by_16(*(pt_C++), tmp2, realAccu2);
-    }
+    calc_sbr_anafilterbank_window(pt_C, X, scratch_mem[0]);
+    p_Y_1 = scratch_mem[0] + 32;
 
 
     realAccu2  = fxp_mul32_by_16(Qfmt27(0.002620176F), X[ -32]);
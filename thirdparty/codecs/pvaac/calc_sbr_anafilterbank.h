@@ -43,6 +43,7 @@
 ----------------------------------------------------------------------------*/
 
 #include "pv_audio_type_defs.h"
+#include "fxp_mul32_x86.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -100,6 +101,27 @@ extern "C"
                                 Int32 scratch_mem[][64],
                                 Int32 maxBand);
 
+#endif
+
+    /* Y[1..31] and Y[33..63] of the analysis window, shared by both versions */
+    void calc_sbr_anafilterbank_window(const Int32 * pt_C,
+                                       Int16 * X,
+                                       Int32 * Y);
+
+#if defined(PV_X86_SIMD)
+
+    void calc_sbr_anafilterbank_window_c(const Int32 * pt_C,
+                                         Int16 * X,
+                                         Int32 * Y);
+
+    void calc_sbr_anafilterbank_window_sse41(const Int32 * pt_C,
+                                             Int16 * X,
+                                             Int32 * Y);
+
+    void calc_sbr_anafilterbank_window_avx2(const Int32 * pt_C,
+                                            Int16 * X,
+                                            Int32 * Y);
+
 #endif
 
 
@@ -0,0 +1,211 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+
+ Filename: calc_sbr_anafilterbank_x86.cpp
+
+------------------------------------------------------------------------------
+ FUNCTION DESCRIPTION
+
+    x86 versions of calc_sbr_anafilterbank_window(), the window loop of
+    calc_sbr_anafilterbank_LC() and calc_sbr_anafilterbank(), bit-exact
+    with calc_sbr_anafilterbank_window_c().
+
+    Output k (k = 1..31) is
+        Y[k]      = sum_m fxp_mul32_by_16(C[5(k-1) + m], X[-k - 64m])
+        Y[64 - k] = sum_m fxp_mul32_by_16(C[5(k-1) + m], X[-320 + k + 64m])
+    for m = 0..4. Outputs are computed 8 (AVX2) or 4 (SSE4.1) at a time
+    with a transposed copy of the coefficient table, falling back to
+    calc_sbr_anafilterbank_window_c() on CPUs without SSE4.1.
+
+------------------------------------------------------------------------------
+*/
+
+
+/*----------------------------------------------------------------------------
+; INCLUDES
+----------------------------------------------------------------------------*/
+#ifdef LITEPLAYER_CONFIG_AAC_PLUS
+
+#include    "calc_sbr_anafilterbank.h"
+#include    "qmf_filterbank_coeff.h"
+#include    "fxp_mul32.h"
+
+#if defined(PV_X86_SIMD)
+
+/*----------------------------------------------------------------------------
+; DEFINES
+----------------------------------------------------------------------------*/
+#define ANAFIL_TAPS     5
+#define ANAFIL_OUTPUTS  32      /* k = 1..31, and a zero lane for k = 32 */
+
+/*----------------------------------------------------------------------------
+; LOCAL STORE/BUFFER/POINTER DEFINITIONS
+----------------------------------------------------------------------------*/
+typedef void (*anafil_window_func)(const Int32 *pt_C,
+                                   Int16 *X,
+                                   Int32 *Y);
+
+/* C[5*(k-1) + m] stored as [m][k-1] */
+struct sbr_anafil_coef_transposed
+{
+    Int32 coef[ANAFIL_TAPS][ANAFIL_OUTPUTS];
+
+    sbr_anafil_coef_transposed(const Int32 *pt_C)
+    {
+        for (Int32 m = 0; m < ANAFIL_TAPS; m++)
+        {
+            for (Int32 k = 0; k < ANAFIL_OUTPUTS; k++)
+            {
+                coef[m][k] = (k < ANAFIL_OUTPUTS - 1) ? pt_C[k*ANAFIL_TAPS + m] : 0;
+            }
+        }
+    }
+};
+
+static const sbr_anafil_coef_transposed sbrAnafilCoefT_LC(sbrDecoderFilterbankCoefficients_an_filt_LC);
+#ifdef LITEPLAYER_CONFIG_HQ_SBR
+static const sbr_anafil_coef_transposed sbrAnafilCoefT(sbrDecoderFilterbankCoefficients_an_filt);
+#endif
+
+/*----------------------------------------------------------------------------
+; LOCAL FUNCTION DEFINITIONS
+----------------------------------------------------------------------------*/
+
+/* transposed copy of the coefficient table pt_C points to */
+static const Int32 *anafil_coef_transposed(const Int32 *pt_C)
+{
+#ifdef LITEPLAYER_CONFIG_HQ_SBR
+    if (pt_C == sbrDecoderFilterbankCoefficients_an_filt)
+    {
+        return &sbrAnafilCoefT.coef[0][0];
+    }
+#else
+    OSCL_UNUSED_ARG(pt_C);
+#endif
+    return &sbrAnafilCoefT_LC.coef[0][0];
+}
+
+static inline void anafil_window_store(const Int32 *acc1,
+                                       const Int32 *acc2,
+                                       Int32 k0,
+                                       Int32 lanes,
+                                       Int32 *Y)
+{
+    for (Int32 lane = 0; lane < lanes && k0 + lane < ANAFIL_OUTPUTS; lane++)
+    {
+        Y[k0 + lane]      = acc1[lane];
+        Y[64 - k0 - lane] = acc2[lane];
+    }
+}
+
+/*----------------------------------------------------------------------------
+; FUNCTION CODE
+----------------------------------------------------------------------------*/
+
+__attribute__((target("sse4.1")))
+void calc_sbr_anafilterbank_window_sse41(const Int32 * pt_C,
+                                         Int16 * X,
+                                         Int32 * Y)
+{
+    const Int32 *pt_CT = anafil_coef_transposed(pt_C);
+    Int32 acc1[4];
+    Int32 acc2[4];
+
+    for (Int32 k0 = 1; k0 < ANAFIL_OUTPUTS; k0 += 4)
+    {
+        __m128i sum1 = _mm_setzero_si128();
+        __m128i sum2 = _mm_setzero_si128();
+
+        for (Int32 m = 0; m < ANAFIL_TAPS; m++)
+        {
+            __m128i c = _mm_loadu_si128((const __m128i *)&pt_CT[m*ANAFIL_OUTPUTS + k0 - 1]);
+
+            /* lanes k0..k0+3 read X[-k - 64m], descending */
+            __m128i x1 = _mm_loadl_epi64((const __m128i *)&X[-(k0 + 3) - 64*m]);
+            x1 = _mm_cvtepi16_epi32(_mm_shufflelo_epi16(x1, _MM_SHUFFLE(0, 1, 2, 3)));
+            /* and X[-320 + k + 64m], ascending */
+            __m128i x2 = _mm_loadl_epi64((const __m128i *)&X[-320 + k0 + 64*m]);
+            x2 = _mm_cvtepi16_epi32(x2);
+
+            sum1 = _mm_add_epi32(sum1, fxp_mul32_by_16_sse41(c, x1));
+            sum2 = _mm_add_epi32(sum2, fxp_mul32_by_16_sse41(c, x2));
+        }
+
+        _mm_storeu_si128((__m128i *)acc1, sum1);
+        _mm_storeu_si128((__m128i *)acc2, sum2);
+        anafil_window_store(acc1, acc2, k0, 4, Y);
+    }
+}
+
+__attribute__((target("avx2")))
+void calc_sbr_anafilterbank_window_avx2(const Int32 * pt_C,
+                                        Int16 * X,
+                                        Int32 * Y)
+{
+    const __m128i reverse = _mm_setr_epi8(14, 15, 12, 13, 10, 11, 8, 9,
+                                          6, 7, 4, 5, 2, 3, 0, 1);
+    const Int32 *pt_CT = anafil_coef_transposed(pt_C);
+    Int32 acc1[8];
+    Int32 acc2[8];
+
+    for (Int32 k0 = 1; k0 < ANAFIL_OUTPUTS; k0 += 8)
+    {
+        __m256i sum1 = _mm256_setzero_si256();
+        __m256i sum2 = _mm256_setzero_si256();
+
+        for (Int32 m = 0; m < ANAFIL_TAPS; m++)
+        {
+            __m256i c = _mm256_loadu_si256((const __m256i *)&pt_CT[m*ANAFIL_OUTPUTS + k0 - 1]);
+
+            __m128i x1 = _mm_loadu_si128((const __m128i *)&X[-(k0 + 7) - 64*m]);
+            __m128i x2 = _mm_loadu_si128((const __m128i *)&X[-320 + k0 + 64*m]);
+
+            sum1 = _mm256_add_epi32(sum1, fxp_mul32_by_16_avx2(c,
+                                    _mm256_cvtepi16_epi32(_mm_shuffle_epi8(x1, reverse))));
+            sum2 = _mm256_add_epi32(sum2, fxp_mul32_by_16_avx2(c, _mm256_cvtepi16_epi32(x2)));
+        }
+
+        _mm256_storeu_si256((__m256i *)acc1, sum1);
+        _mm256_storeu_si256((__m256i *)acc2, sum2);
+        anafil_window_store(acc1, acc2, k0, 8, Y);
+    }
+}
+
+static anafil_window_func anafil_window_select()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return calc_sbr_anafilterbank_window_avx2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return calc_sbr_anafilterbank_window_sse41;
+    return calc_sbr_anafilterbank_window_c;
+}
+
+static const anafil_window_func anafil_window_impl = anafil_window_select();
+
+void calc_sbr_anafilterbank_window(const Int32 * pt_C,
+                                   Int16 * X,
+                                   Int32 * Y)
+{
+    anafil_window_impl(pt_C, X, Y);
+}
+
+#endif      /* --- PV_X86_SIMD --- */
+
+#endif      /* --- LITEPLAYER_CONFIG_AAC_PLUS --- */
@@ -26,6 +26,7 @@
 ; INCLUDES
 ----------------------------------------------------------------------------*/
 #include "pv_audio_type_defs.h"
+#include "fxp_mul32_x86.h"
 
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -81,6 +82,20 @@ extern "C"
                                 Int16   V[1280],
                                 bool bDownSampleSBR);
 
+#endif
+
+    /* timeSig[2..62] and timeSig[66..126] from V[], the loop shared by both versions */
+    void calc_sbr_synfilterbank_window(Int16 V[1280],
+                                       Int16 * timeSig);
+
+#if defined(PV_X86_SIMD)
+
+    void calc_sbr_synfilterbank_window_c(Int16 V[1280],
+                                         Int16 * timeSig);
+
+    void calc_sbr_synfilterbank_window_sse2(Int16 V[1280],
+                                            Int16 * timeSig);
+
 #endif
 
 #ifdef __cplusplus
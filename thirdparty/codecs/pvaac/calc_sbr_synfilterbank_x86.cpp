@@ -0,0 +1,169 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+
+ Filename: calc_sbr_synfilterbank_x86.cpp
+
+------------------------------------------------------------------------------
+ FUNCTION DESCRIPTION
+
+    SSE2 version of calc_sbr_synfilterbank_window(), the window loop of
+    calc_sbr_synfilterbank_LC() and calc_sbr_synfilterbank(), bit-exact
+    with calc_sbr_synfilterbank_window_c().
+
+    Output n (n = 1..31) is
+        timeSig[2n]       = sat(sum_t V[n + off_t]        * c_t(n))
+        timeSig[128 - 2n] = sat(sum_t V[1280 - n - off_t] * c_t(n))
+    with 10 taps whose 16-bit coefficients are packed in pairs in
+    sbrDecoderFilterbankCoefficients. Every product is an exact 16x16 -> 32
+    multiply, so pmaddwd computes two taps of 4 outputs per instruction.
+    8 outputs are done per step with a transposed coefficient table.
+
+------------------------------------------------------------------------------
+*/
+
+
+/*----------------------------------------------------------------------------
+; INCLUDES
+----------------------------------------------------------------------------*/
+#ifdef LITEPLAYER_CONFIG_AAC_PLUS
+
+#include    "calc_sbr_synfilterbank.h"
+#include    "qmf_filterbank_coeff.h"
+
+#if defined(PV_X86_SIMD)
+
+/*----------------------------------------------------------------------------
+; DEFINES
+----------------------------------------------------------------------------*/
+#define SYNFIL_PAIRS    5
+#define SYNFIL_OUTPUTS  32      /* n = 1..31, and a zero lane for n = 32 */
+
+/*----------------------------------------------------------------------------
+; LOCAL STORE/BUFFER/POINTER DEFINITIONS
+----------------------------------------------------------------------------*/
+
+/* tap offsets of each coefficient pair, top and bottom half */
+static const Int32 synfil_offset[SYNFIL_PAIRS][2] =
+{
+    {   0,  192 },
+    { 256,  448 },
+    { 512,  704 },
+    { 768,  960 },
+    {1024, 1216 }
+};
+
+/*
+ * sbrDecoderFilterbankCoefficients[5*(n-1) + pair] stored as [pair][n-1],
+ * with the two halves swapped so the top coefficient is in the low half,
+ * matching the (V[top], V[bottom]) order of the interleaved samples.
+ */
+struct sbr_synfil_coef_transposed
+{
+    Int32 coef[SYNFIL_PAIRS][SYNFIL_OUTPUTS];
+
+    sbr_synfil_coef_transposed()
+    {
+        for (Int32 pair = 0; pair < SYNFIL_PAIRS; pair++)
+        {
+            for (Int32 n = 0; n < SYNFIL_OUTPUTS; n++)
+            {
+                UInt32 c = (n < SYNFIL_OUTPUTS - 1) ?
+                           (UInt32)sbrDecoderFilterbankCoefficients[n*SYNFIL_PAIRS + pair] : 0;
+                coef[pair][n] = (Int32)((c >> 16) | (c << 16));
+            }
+        }
+    }
+};
+
+static const sbr_synfil_coef_transposed sbrSynfilCoefT;
+
+/*----------------------------------------------------------------------------
+; LOCAL FUNCTION DEFINITIONS
+----------------------------------------------------------------------------*/
+
+/* a -= a >> 2; a >>= N; then saturate to 16 bits, as saturate2() */
+static inline __m128i synfil_scale(__m128i a)
+{
+    a = _mm_sub_epi32(a, _mm_srai_epi32(a, 2));
+    return _mm_srai_epi32(a, N);
+}
+
+/*----------------------------------------------------------------------------
+; FUNCTION CODE
+----------------------------------------------------------------------------*/
+
+void calc_sbr_synfilterbank_window_sse2(Int16 V[1280],
+                                        Int16 * timeSig)
+{
+    const __m128i round = _mm_set1_epi32(ROUND_SYNFIL);
+    Int16 out1[8];
+    Int16 out2[8];
+
+    for (Int32 n0 = 1; n0 < SYNFIL_OUTPUTS; n0 += 8)
+    {
+        const Int32 *pt_C = &sbrSynfilCoefT.coef[0][n0 - 1];
+        __m128i acc1_lo = round;
+        __m128i acc1_hi = round;
+        __m128i acc2_lo = round;
+        __m128i acc2_hi = round;
+
+        for (Int32 pair = 0; pair < SYNFIL_PAIRS; pair++)
+        {
+            Int32 off_t = synfil_offset[pair][0];
+            Int32 off_b = synfil_offset[pair][1];
+
+            __m128i c_lo = _mm_loadu_si128((const __m128i *)&pt_C[pair*SYNFIL_OUTPUTS]);
+            __m128i c_hi = _mm_loadu_si128((const __m128i *)&pt_C[pair*SYNFIL_OUTPUTS + 4]);
+
+            /* lanes n0..n0+7 read V[n + off], ascending */
+            __m128i v_t = _mm_loadu_si128((const __m128i *)&V[n0 + off_t]);
+            __m128i v_b = _mm_loadu_si128((const __m128i *)&V[n0 + off_b]);
+            acc1_lo = fxp_mac_16_by_16_pair_sse2(_mm_unpacklo_epi16(v_t, v_b), c_lo, acc1_lo);
+            acc1_hi = fxp_mac_16_by_16_pair_sse2(_mm_unpackhi_epi16(v_t, v_b), c_hi, acc1_hi);
+
+            /* and V[1280 - n - off], descending */
+            v_t = pv_reverse_epi16(_mm_loadu_si128((const __m128i *)&V[1280 - 7 - n0 - off_t]));
+            v_b = pv_reverse_epi16(_mm_loadu_si128((const __m128i *)&V[1280 - 7 - n0 - off_b]));
+            acc2_lo = fxp_mac_16_by_16_pair_sse2(_mm_unpacklo_epi16(v_t, v_b), c_lo, acc2_lo);
+            acc2_hi = fxp_mac_16_by_16_pair_sse2(_mm_unpackhi_epi16(v_t, v_b), c_hi, acc2_hi);
+        }
+
+        _mm_storeu_si128((__m128i *)out1,
+                         _mm_packs_epi32(synfil_scale(acc1_lo), synfil_scale(acc1_hi)));
+        _mm_storeu_si128((__m128i *)out2,
+                         _mm_packs_epi32(synfil_scale(acc2_lo), synfil_scale(acc2_hi)));
+
+        for (Int32 lane = 0; lane < 8 && n0 + lane < SYNFIL_OUTPUTS; lane++)
+        {
+            timeSig[2*(n0 + lane)]       = out1[lane];
+            timeSig[128 - 2*(n0 + lane)] = out2[lane];
+        }
+    }
+}
+
+/* SSE2 is part of x86-64, no runtime check needed */
+void calc_sbr_synfilterbank_window(Int16 V[1280],
+                                   Int16 * timeSig)
+{
+    calc_sbr_synfilterbank_window_sse2(V, timeSig);
+}
+
+#endif      /* --- PV_X86_SIMD --- */
+
+#endif      /* --- LITEPLAYER_CONFIG_AAC_PLUS --- */
@@ -46,6 +46,7 @@
 ; INCLUDES
 ----------------------------------------------------------------------------*/
 #include "pv_audio_type_defs.h"
+#include "fxp_mul32_x86.h"
 
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -100,6 +101,71 @@ extern "C"
         Int32      Data[],
         Int32      *peak_value);
 
+    /*
+     * Butterflies j = 1..n2-1 of a pass, the ones with twiddle factors,
+     * n1 = 4*n2 points per butterfly group. pw points to the three twiddles
+     * of j = 1 of that pass.
+     */
+    void fft_rx4_long_twiddled(
+        Int32      Data[],
+        const Int32 *pw,
+        Int        n1,
+        Int        n2);
+
+    void fft_rx4_short_twiddled(
+        Int32      Data[],
+        const Int32 *pw,
+        Int        n1,
+        Int        n2,
+        Int        shift,
+        Int        exp);
+
+#if defined(PV_X86_SIMD)
+
+    void fft_rx4_long_twiddled_c(
+        Int32      Data[],
+        const Int32 *pw,
+        Int        n1,
+        Int        n2);
+
+    void fft_rx4_short_twiddled_c(
+        Int32      Data[],
+        const Int32 *pw,
+        Int        n1,
+        Int        n2,
+        Int        shift,
+        Int        exp);
+
+    void fft_rx4_long_twiddled_sse41(
+        Int32      Data[],
+        const Int32 *pw,
+        Int        n1,
+        Int        n2);
+
+    void fft_rx4_short_twiddled_sse41(
+        Int32      Data[],
+        const Int32 *pw,
+        Int        n1,
+        Int        n2,
+        Int        shift,
+        Int        exp);
+
+    void fft_rx4_long_twiddled_avx2(
+        Int32      Data[],
+        const Int32 *pw,
+        Int        n1,
+        Int        n2);
+
+    void fft_rx4_short_twiddled_avx2(
+        Int32      Data[],
+        const Int32 *pw,
+        Int        n1,
+        Int        n2,
+        Int        shift,
+        Int        exp);
+
+#endif
+
 #ifdef __cplusplus
 }
 #endif
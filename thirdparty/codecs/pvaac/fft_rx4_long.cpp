@@ -189,16 +189,17 @@
 ; FUNCTION CODE
 ----------------------------------------------------------------------------*/
 
-
-void fft_rx4_long(
+#if defined(PV_X86_SIMD)
+void fft_rx4_long_twiddled_c(
+#else
+void fft_rx4_long_twiddled(
+#endif
     Int32      Data[],
-    Int32      *peak_value)
-
+    const Int32 *pw,
+    Int        n1,
+    Int        n2)
 {
-    Int     n1;
-    Int     n2;
     Int     j;
-    Int     k;
     Int     i;
 
     Int32   t1;
@@ -218,12 +219,104 @@ void fft_rx4_long(
     Int32   temp2;
     Int32   temp3;
     Int32   temp4;
-    Int32   max;
 
     Int32   exp_jw1;
     Int32   exp_jw2;
     Int32   exp_jw3;
 
+    for (j = 1; j < n2; j++)
+    {
+
+        exp_jw1 = (*pw++);
+        exp_jw2 = (*pw++);
+        exp_jw3 = (*pw++);
+
+
+        for (i = j; i < FFT_RX4_LONG; i += n1)
+        {
+            pData1 = &Data[ i<<1];
+            pData2 = pData1 + n1;
+
+            temp1   = *pData1;
+            temp2   = *pData2++;
+
+            r1      = temp1 + temp2;
+            r2      = temp1 - temp2;
+
+            pData3 = pData1 + (n1 >> 1);
+            pData4 = pData3 + n1;
+            temp3   = *pData3++;
+            temp4   = *pData4++;
+
+            r3      = temp3 + temp4;
+            r4      = temp3 - temp4;
+
+            *(pData1++) = (r1 + r3);
+            r1          = (r1 - r3) << 1;
+
+            temp2   = *pData2;
+            temp1   = *pData1;
+
+            s1      = temp1 + temp2;
+            s2      = temp1 - temp2;
+            s3      = (s2 + r4) << 1;
+            s2      = (s2 - r4) << 1;
+
+            temp3   = *pData3;
+            temp4   = *pData4;
+
+            t1      = temp3 + temp4;
+            t2      = temp3 - temp4;
+
+            *pData1  = (s1 + t1);
+            s1       = (s1 - t1) << 1;
+
+            *pData2--  = cmplx_mul32_by_16(s1, -r1, exp_jw2);
+            r3      = (r2 - t2) << 1;
+            *pData2    = cmplx_mul32_by_16(r1,  s1, exp_jw2);
+
+            r2      = (r2 + t2) << 1;
+
+            *pData3--  = cmplx_mul32_by_16(s2, -r2, exp_jw1);
+            *pData3    = cmplx_mul32_by_16(r2,  s2, exp_jw1);
+
+            *pData4--  = cmplx_mul32_by_16(s3, -r3, exp_jw3);
+            *pData4    = cmplx_mul32_by_16(r3,  s3, exp_jw3);
+
+        }  /* i */
+
+    }  /*  j */
+
+}
+
+
+
+void fft_rx4_long(
+    Int32      Data[],
+    Int32      *peak_value)
+
+{
+    Int     n1;
+    Int     n2;
+    Int     k;
+    Int     i;
+
+    Int32   t1;
+    Int32   t2;
+    Int32   r1;
+    Int32   r2;
+    Int32   s1;
+    Int32   s2;
+    Int32   s3;
+    Int32   *pData1;
+    Int32   *pData2;
+    Int32   *pData3;
+    Int32   *pData4;
+    Int32   temp1;
+    Int32   temp2;
+    Int32   temp3;
+    Int32   temp4;
+    Int32   max;
 
 
     const Int32  *pw = W_256rx4;
@@ -282,68 +375,8 @@ void fft_rx4_long(
 
 
 
-        for (j = 1; j < n2; j++)
-        {
-
-            exp_jw1 = (*pw++);
-            exp_jw2 = (*pw++);
-            exp_jw3 = (*pw++);
-
-
-            for (i = j; i < FFT_RX4_LONG; i += n1)
-            {
-                pData1 = &Data[ i<<1];
-                pData2 = pData1 + n1;
-
-                temp1   = *pData1;
-                temp2   = *pData2++;
-
-                r1      = temp1 + temp2;
-                r2      = temp1 - temp2;
-
-                pData3 = pData1 + (n1 >> 1);
-                pData4 = pData3 + n1;
-                temp3   = *pData3++;
-                temp4   = *pData4++;
-
-                r3      = temp3 + temp4;
-                r4      = temp3 - temp4;
-
-                *(pData1++) = (r1 + r3);
-                r1          = (r1 - r3) << 1;
-
-                temp2   = *pData2;
-                temp1   = *pData1;
-
-                s1      = temp1 + temp2;
-                s2      = temp1 - temp2;
-                s3      = (s2 + r4) << 1;
-                s2      = (s2 - r4) << 1;
-
-                temp3   = *pData3;
-                temp4   = *pData4;
-
-                t1      = temp3 + temp4;
-                t2      = temp3 - temp4;
-
-                *pData1  = (s1 + t1);
-                s1       = (s1 - t1) << 1;
-
-                *pData2--  = cmplx_mul32_by_16(s1, -r1, exp_jw2);
-                r3      = (r2 - t2) << 1;
-                *pData2    = cmplx_mul32_by_16(r1,  s1, exp_jw2);
-
-                r2      = (r2 + t2) << 1;
-
-                *pData3--  = cmplx_mul32_by_16(s2, -r2, exp_jw1);
-                *pData3    = cmplx_mul32_by_16(r2,  s2, exp_jw1);
-
-                *pData4--  = cmplx_mul32_by_16(s3, -r3, exp_jw3);
-                *pData4    = cmplx_mul32_by_16(r3,  s3, exp_jw3);
-
-            }  /* i */
-
-        }  /*  j */
+        fft_rx4_long_twiddled(Data, pw, n1, n2);
+        pw += 3 * (n2 - 1);
 
     } /* k */
 
@@ -188,6 +188,119 @@
 ; FUNCTION CODE
 ----------------------------------------------------------------------------*/
 
+#if defined(PV_X86_SIMD)
+void fft_rx4_short_twiddled_c(
+#else
+void fft_rx4_short_twiddled(
+#endif
+    Int32      Data[],
+    const Int32 *pw,
+    Int        n1,
+    Int        n2,
+    Int        shift,
+    Int        exp)
+{
+    Int     n3 = n1 >> 1;
+    Int     j;
+    Int     i;
+    Int32   exp_jw1;
+    Int32   exp_jw2;
+    Int32   exp_jw3;
+
+
+    Int32   t1;
+    Int32   t2;
+    Int32   r1;
+    Int32   r2;
+    Int32   r3;
+    Int32   s1;
+    Int32   s2;
+    Int32   s3;
+
+    Int32   *pData1;
+    Int32   *pData2;
+    Int32   *pData3;
+    Int32   *pData4;
+    Int32   temp1;
+    Int32   temp2;
+    Int32   temp3;
+    Int32   temp4;
+
+    for (j = 1; j < n2; j++)
+    {
+        exp_jw1 = *pw++;
+        exp_jw2 = *pw++;
+        exp_jw3 = *pw++;
+
+
+        for (i = j; i < FFT_RX4_SHORT; i += n1)
+        {
+            pData1 = &Data[ i<<1];
+            pData3 = pData1 + n3;
+            pData2 = pData1 + n1;
+            pData4 = pData3 + n1;
+
+            temp1   = *(pData1);
+            temp2   = *(pData2++);
+            temp1   >>= shift;
+            temp2   >>= shift;
+
+            r1      = temp1 + temp2;
+            r2      = temp1 - temp2;
+            temp3   = *(pData3++);
+            temp4   = *(pData4++);
+            temp3   >>= shift;
+            temp4   >>= shift;
+
+            t1      = temp3 + temp4;
+            t2      = temp3 - temp4;
+
+            *(pData1++) = (r1 + t1) >> exp;
+            r1          = (r1 - t1) >> exp;
+
+            temp1   = *pData1;
+            temp2   = *pData2;
+            temp1   >>= shift;
+            temp2   >>= shift;
+
+            s1      = temp1 + temp2;
+            s2      = temp1 - temp2;
+
+            s3      = (s2 + t2) >> exp;
+            s2      = (s2 - t2) >> exp;
+
+            temp3   = *pData3;
+            temp4   = *pData4 ;
+            temp3   >>= shift;
+            temp4   >>= shift;
+
+            t1      = temp3 + temp4;
+            t2      = temp3 - temp4;
+
+            *pData1  = (s1 + t1) >> exp;
+            s1       = (s1 - t1) >> exp;
+
+
+            *pData2--  = cmplx_mul32_by_16(s1, -r1, exp_jw2) << 1;
+            *pData2    = cmplx_mul32_by_16(r1,  s1, exp_jw2) << 1;
+
+            r3       = ((r2 - t2) >> exp);
+            r2       = ((r2 + t2) >> exp);
+
+            *pData3--  = cmplx_mul32_by_16(s2, -r2, exp_jw1) << 1;
+            *pData3    = cmplx_mul32_by_16(r2,  s2, exp_jw1) << 1;
+
+            *pData4--  = cmplx_mul32_by_16(s3, -r3, exp_jw3) << 1;
+            *pData4    = cmplx_mul32_by_16(r3,  s3, exp_jw3) << 1;
+
+        }  /* i */
+
+    }  /*  j */
+
+}
+
+
+
 Int fft_rx4_short(
     Int32      Data[],
     Int32      *peak_value)
@@ -196,19 +309,14 @@ Int fft_rx4_short(
     Int     n1;
     Int     n2;
     Int     n3;
-    Int     j;
     Int     k;
     Int     i;
-    Int32   exp_jw1;
-    Int32   exp_jw2;
-    Int32   exp_jw3;
 
 
     Int32   t1;
     Int32   t2;
     Int32   r1;
     Int32   r2;
-    Int32   r3;
     Int32   s1;
     Int32   s2;
     Int32   s3;
@@ -310,76 +418,8 @@ Int fft_rx4_short(
 
         }  /* i */
 
-        for (j = 1; j < n2; j++)
-        {
-            exp_jw1 = *pw++;
-            exp_jw2 = *pw++;
-            exp_jw3 = *pw++;
-
-
-            for (i = j; i < FFT_RX4_SHORT; i += n1)
-            {
-                pData1 = &Data[ i<<1];
-                pData3 = pData1 + n3;
-                pData2 = pData1 + n1;
-                pData4 = pData3 + n1;
-
-                temp1   = *(pData1);
-                temp2   = *(pData2++);
-                temp1   >>= shift;
-                temp2   >>= shift;
-
-                r1      = temp1 + temp2;
-                r2      = temp1 - temp2;
-                temp3   = *(pData3++);
-                temp4   = *(pData4++);
-                temp3   >>= shift;
-                temp4   >>= shift;
-
-                t1      = temp3 + temp4;
-                t2      = temp3 - temp4;
-
-                *(pData1++) = (r1 + t1) >> exp;
-                r1          = (r1 - t1) >> exp;
-
-                temp1   = *pData1;
-                temp2   = *pData2;
-                temp1   >>= shift;
-                temp2   >>= shift;
-
-                s1      = temp1 + temp2;
-                s2      = temp1 - temp2;
-
-                s3      = (s2 + t2) >> exp;
-                s2      = (s2 - t2) >> exp;
-
-                temp3   = *pData3;
-                temp4   = *pData4 ;
-                temp3   >>= shift;
-                temp4   >>= shift;
-
-                t1      = temp3 + temp4;
-                t2      = temp3 - temp4;
-
-                *pData1  = (s1 + t1) >> exp;
-                s1       = (s1 - t1) >> exp;
-
-
-                *pData2--  = cmplx_mul32_by_16(s1, -r1, exp_jw2) << 1;
-                *pData2    = cmplx_mul32_by_16(r1,  s1, exp_jw2) << 1;
-
-                r3       = ((r2 - t2) >> exp);
-                r2       = ((r2 + t2) >> exp);
-
-                *pData3--  = cmplx_mul32_by_16(s2, -r2, exp_jw1) << 1;
-                *pData3    = cmplx_mul32_by_16(r2,  s2, exp_jw1) << 1;
-
-                *pData4--  = cmplx_mul32_by_16(s3, -r3, exp_jw3) << 1;
-                *pData4    = cmplx_mul32_by_16(r3,  s3, exp_jw3) << 1;
-
-            }  /* i */
-
-        }  /*  j */
+        fft_rx4_short_twiddled(Data, pw, n1, n2, shift, exp);
+        pw += 3 * (n2 - 1);
 
         /*
          *  this will reset exp and shift to zero for the second pass of the
@@ -0,0 +1,400 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+
+ Filename: fft_rx4_x86.cpp
+
+------------------------------------------------------------------------------
+ FUNCTION DESCRIPTION
+
+    x86 versions of fft_rx4_long_twiddled() and fft_rx4_short_twiddled(),
+    bit-exact with the C versions.
+
+    Butterfly j of a group reads the complexes j, j + n1/4, j + n1/2 and
+    j + 3n1/4 of the group, so butterflies j..j+L-1 read L consecutive
+    complexes from each quarter and are computed together on interleaved
+    (re, im) lanes; L is 2 with SSE4.1 and 4 with AVX2. With
+        A + B = (r1, s1),  A - B = (r2, s2),
+        C + D = (t1, u1),  C - D = (t2, u2),  rot(re, im) = (im, -re)
+    the outputs are
+        A' = (A + B) + (C + D)
+        B' = rot_w2((A + B) - (C + D))
+        C' = rot_w1((A - B) + rot(C - D))
+        D' = rot_w3((A - B) - rot(C - D))
+    where rot_w(x) = cmplx_mul32_by_16(x.re, x.im, w) +
+    j cmplx_mul32_by_16(x.im, -x.re, w), with the scaling of each version
+    around it. Remaining butterflies of a pass run through the C version.
+
+------------------------------------------------------------------------------
+*/
+
+
+/*----------------------------------------------------------------------------
+; INCLUDES
+----------------------------------------------------------------------------*/
+#include "pv_audio_type_defs.h"
+#include "fft_rx4.h"
+#include "fxp_mul32.h"
+
+#if defined(PV_X86_SIMD)
+
+/*----------------------------------------------------------------------------
+; LOCAL STORE/BUFFER/POINTER DEFINITIONS
+----------------------------------------------------------------------------*/
+typedef void (*fft_rx4_long_twiddled_func)(Int32 Data[],
+        const Int32 *pw,
+        Int n1,
+        Int n2);
+
+typedef void (*fft_rx4_short_twiddled_func)(Int32 Data[],
+        const Int32 *pw,
+        Int n1,
+        Int n2,
+        Int shift,
+        Int exp);
+
+/*----------------------------------------------------------------------------
+; LOCAL FUNCTION DEFINITIONS
+----------------------------------------------------------------------------*/
+
+/* three twiddles of L consecutive butterflies, regrouped per twiddle */
+static inline void fft_rx4_twiddles(const Int32 *pw, Int L, Int32 w[3][4])
+{
+    for (Int l = 0; l < L; l++)
+    {
+        w[0][l] = pw[3*l];
+        w[1][l] = pw[3*l + 1];
+        w[2][l] = pw[3*l + 2];
+    }
+}
+
+/* (re, im) -> (im, -re) */
+__attribute__((target("sse4.1")))
+static inline __m128i rot_sse41(__m128i x)
+{
+    const __m128i neg_im = _mm_set_epi32(-1, 0, -1, 0);
+    x = _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_sub_epi32(_mm_xor_si128(x, neg_im), neg_im);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i rot_avx2(__m256i x)
+{
+    const __m256i neg_im = _mm256_set_epi32(-1, 0, -1, 0, -1, 0, -1, 0);
+    x = _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm256_sub_epi32(_mm256_xor_si256(x, neg_im), neg_im);
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i rot_w_sse41(__m128i x, const __m128i *w)
+{
+    return cmplx_mul32_by_16_sse41(x, rot_sse41(x), w[0], w[1]);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i rot_w_avx2(__m256i x, const __m256i *w)
+{
+    return cmplx_mul32_by_16_avx2(x, rot_avx2(x), w[0], w[1]);
+}
+
+/*
+ * Butterflies j0 .. n2-1 through the C version: with Data and pw moved to
+ * butterfly j0 - 1, its butterfly 1 is butterfly j0 of the pass.
+ */
+static void fft_rx4_long_tail(Int32 Data[], const Int32 *pw, Int n1, Int n2, Int j0)
+{
+    if (j0 < n2)
+    {
+        fft_rx4_long_twiddled_c(&Data[(j0 - 1) << 1], pw + 3*(j0 - 1), n1, n2 - j0 + 1);
+    }
+}
+
+static void fft_rx4_short_tail(Int32 Data[], const Int32 *pw, Int n1, Int n2, Int j0,
+                               Int shift, Int exp)
+{
+    if (j0 < n2)
+    {
+        fft_rx4_short_twiddled_c(&Data[(j0 - 1) << 1], pw + 3*(j0 - 1), n1, n2 - j0 + 1,
+                                 shift, exp);
+    }
+}
+
+/*----------------------------------------------------------------------------
+; FUNCTION CODE
+----------------------------------------------------------------------------*/
+
+__attribute__((target("sse4.1")))
+void fft_rx4_long_twiddled_sse41(
+    Int32      Data[],
+    const Int32 *pw,
+    Int        n1,
+    Int        n2)
+{
+    Int j0;
+
+    for (j0 = 1; j0 + 2 <= n2; j0 += 2)
+    {
+        Int32   w[3][4];
+        __m128i w1[2], w2[2], w3[2];
+
+        fft_rx4_twiddles(pw + 3*(j0 - 1), 2, w);
+        cmplx_twiddle_sse2(w[0], &w1[0], &w1[1]);
+        cmplx_twiddle_sse2(w[1], &w2[0], &w2[1]);
+        cmplx_twiddle_sse2(w[2], &w3[0], &w3[1]);
+
+        for (Int i = j0; i < FFT_RX4_LONG; i += n1)
+        {
+            Int32 *pData1 = &Data[i<<1];
+            Int32 *pData3 = pData1 + (n1 >> 1);
+            Int32 *pData2 = pData1 + n1;
+            Int32 *pData4 = pData3 + n1;
+
+            __m128i a = _mm_loadu_si128((const __m128i *)pData1);
+            __m128i b = _mm_loadu_si128((const __m128i *)pData2);
+            __m128i c = _mm_loadu_si128((const __m128i *)pData3);
+            __m128i d = _mm_loadu_si128((const __m128i *)pData4);
+
+            __m128i sum_ab  = _mm_add_epi32(a, b);
+            __m128i diff_ab = _mm_sub_epi32(a, b);
+            __m128i sum_cd  = _mm_add_epi32(c, d);
+            __m128i rot_cd  = rot_sse41(_mm_sub_epi32(c, d));
+
+            __m128i x2 = _mm_slli_epi32(_mm_sub_epi32(sum_ab, sum_cd), 1);
+            __m128i x1 = _mm_slli_epi32(_mm_add_epi32(diff_ab, rot_cd), 1);
+            __m128i x3 = _mm_slli_epi32(_mm_sub_epi32(diff_ab, rot_cd), 1);
+
+            _mm_storeu_si128((__m128i *)pData1, _mm_add_epi32(sum_ab, sum_cd));
+            _mm_storeu_si128((__m128i *)pData2, rot_w_sse41(x2, w2));
+            _mm_storeu_si128((__m128i *)pData3, rot_w_sse41(x1, w1));
+            _mm_storeu_si128((__m128i *)pData4, rot_w_sse41(x3, w3));
+        }
+    }
+
+    fft_rx4_long_tail(Data, pw, n1, n2, j0);
+}
+
+__attribute__((target("avx2")))
+void fft_rx4_long_twiddled_avx2(
+    Int32      Data[],
+    const Int32 *pw,
+    Int        n1,
+    Int        n2)
+{
+    Int j0;
+
+    for (j0 = 1; j0 + 4 <= n2; j0 += 4)
+    {
+        Int32   w[3][4];
+        __m256i w1[2], w2[2], w3[2];
+
+        fft_rx4_twiddles(pw + 3*(j0 - 1), 4, w);
+        cmplx_twiddle_avx2(w[0], &w1[0], &w1[1]);
+        cmplx_twiddle_avx2(w[1], &w2[0], &w2[1]);
+        cmplx_twiddle_avx2(w[2], &w3[0], &w3[1]);
+
+        for (Int i = j0; i < FFT_RX4_LONG; i += n1)
+        {
+            Int32 *pData1 = &Data[i<<1];
+            Int32 *pData3 = pData1 + (n1 >> 1);
+            Int32 *pData2 = pData1 + n1;
+            Int32 *pData4 = pData3 + n1;
+
+            __m256i a = _mm256_loadu_si256((const __m256i *)pData1);
+            __m256i b = _mm256_loadu_si256((const __m256i *)pData2);
+            __m256i c = _mm256_loadu_si256((const __m256i *)pData3);
+            __m256i d = _mm256_loadu_si256((const __m256i *)pData4);
+
+            __m256i sum_ab  = _mm256_add_epi32(a, b);
+            __m256i diff_ab = _mm256_sub_epi32(a, b);
+            __m256i sum_cd  = _mm256_add_epi32(c, d);
+            __m256i rot_cd  = rot_avx2(_mm256_sub_epi32(c, d));
+
+            __m256i x2 = _mm256_slli_epi32(_mm256_sub_epi32(sum_ab, sum_cd), 1);
+            __m256i x1 = _mm256_slli_epi32(_mm256_add_epi32(diff_ab, rot_cd), 1);
+            __m256i x3 = _mm256_slli_epi32(_mm256_sub_epi32(diff_ab, rot_cd), 1);
+
+            _mm256_storeu_si256((__m256i *)pData1, _mm256_add_epi32(sum_ab, sum_cd));
+            _mm256_storeu_si256((__m256i *)pData2, rot_w_avx2(x2, w2));
+            _mm256_storeu_si256((__m256i *)pData3, rot_w_avx2(x1, w1));
+            _mm256_storeu_si256((__m256i *)pData4, rot_w_avx2(x3, w3));
+        }
+    }
+
+    fft_rx4_long_tail(Data, pw, n1, n2, j0);
+}
+
+__attribute__((target("sse4.1")))
+void fft_rx4_short_twiddled_sse41(
+    Int32      Data[],
+    const Int32 *pw,
+    Int        n1,
+    Int        n2,
+    Int        shift,
+    Int        exp)
+{
+    const __m128i count_in  = _mm_cvtsi32_si128(shift);
+    const __m128i count_out = _mm_cvtsi32_si128(exp);
+    Int j0 = 1;
+
+    /* the C version shifts by a negative exp on its first pass of small inputs */
+    if (exp < 0)
+    {
+        j0 = n2;
+    }
+
+    for (; j0 + 2 <= n2; j0 += 2)
+    {
+        Int32   w[3][4];
+        __m128i w1[2], w2[2], w3[2];
+
+        fft_rx4_twiddles(pw + 3*(j0 - 1), 2, w);
+        cmplx_twiddle_sse2(w[0], &w1[0], &w1[1]);
+        cmplx_twiddle_sse2(w[1], &w2[0], &w2[1]);
+        cmplx_twiddle_sse2(w[2], &w3[0], &w3[1]);
+
+        for (Int i = j0; i < FFT_RX4_SHORT; i += n1)
+        {
+            Int32 *pData1 = &Data[i<<1];
+            Int32 *pData3 = pData1 + (n1 >> 1);
+            Int32 *pData2 = pData1 + n1;
+            Int32 *pData4 = pData3 + n1;
+
+            __m128i a = _mm_sra_epi32(_mm_loadu_si128((const __m128i *)pData1), count_in);
+            __m128i b = _mm_sra_epi32(_mm_loadu_si128((const __m128i *)pData2), count_in);
+            __m128i c = _mm_sra_epi32(_mm_loadu_si128((const __m128i *)pData3), count_in);
+            __m128i d = _mm_sra_epi32(_mm_loadu_si128((const __m128i *)pData4), count_in);
+
+            __m128i sum_ab  = _mm_add_epi32(a, b);
+            __m128i diff_ab = _mm_sub_epi32(a, b);
+            __m128i sum_cd  = _mm_add_epi32(c, d);
+            __m128i rot_cd  = rot_sse41(_mm_sub_epi32(c, d));
+
+            __m128i x2 = _mm_sra_epi32(_mm_sub_epi32(sum_ab, sum_cd), count_out);
+            __m128i x1 = _mm_sra_epi32(_mm_add_epi32(diff_ab, rot_cd), count_out);
+            __m128i x3 = _mm_sra_epi32(_mm_sub_epi32(diff_ab, rot_cd), count_out);
+
+            _mm_storeu_si128((__m128i *)pData1, _mm_sra_epi32(_mm_add_epi32(sum_ab, sum_cd), count_out));
+            _mm_storeu_si128((__m128i *)pData2, _mm_slli_epi32(rot_w_sse41(x2, w2), 1));
+            _mm_storeu_si128((__m128i *)pData3, _mm_slli_epi32(rot_w_sse41(x1, w1), 1));
+            _mm_storeu_si128((__m128i *)pData4, _mm_slli_epi32(rot_w_sse41(x3, w3), 1));
+        }
+    }
+
+    fft_rx4_short_tail(Data, pw, n1, n2, j0, shift, exp);
+}
+
+__attribute__((target("avx2")))
+void fft_rx4_short_twiddled_avx2(
+    Int32      Data[],
+    const Int32 *pw,
+    Int        n1,
+    Int        n2,
+    Int        shift,
+    Int        exp)
+{
+    const __m128i count_in  = _mm_cvtsi32_si128(shift);
+    const __m128i count_out = _mm_cvtsi32_si128(exp);
+    Int j0 = 1;
+
+    if (exp < 0)
+    {
+        j0 = n2;
+    }
+
+    for (; j0 + 4 <= n2; j0 += 4)
+    {
+        Int32   w[3][4];
+        __m256i w1[2], w2[2], w3[2];
+
+        fft_rx4_twiddles(pw + 3*(j0 - 1), 4, w);
+        cmplx_twiddle_avx2(w[0], &w1[0], &w1[1]);
+        cmplx_twiddle_avx2(w[1], &w2[0], &w2[1]);
+        cmplx_twiddle_avx2(w[2], &w3[0], &w3[1]);
+
+        for (Int i = j0; i < FFT_RX4_SHORT; i += n1)
+        {
+            Int32 *pData1 = &Data[i<<1];
+            Int32 *pData3 = pData1 + (n1 >> 1);
+            Int32 *pData2 = pData1 + n1;
+            Int32 *pData4 = pData3 + n1;
+
+            __m256i a = _mm256_sra_epi32(_mm256_loadu_si256((const __m256i *)pData1), count_in);
+            __m256i b = _mm256_sra_epi32(_mm256_loadu_si256((const __m256i *)pData2), count_in);
+            __m256i c = _mm256_sra_epi32(_mm256_loadu_si256((const __m256i *)pData3), count_in);
+            __m256i d = _mm256_sra_epi32(_mm256_loadu_si256((const __m256i *)pData4), count_in);
+
+            __m256i sum_ab  = _mm256_add_epi32(a, b);
+            __m256i diff_ab = _mm256_sub_epi32(a, b);
+            __m256i sum_cd  = _mm256_add_epi32(c, d);
+            __m256i rot_cd  = rot_avx2(_mm256_sub_epi32(c, d));
+
+            __m256i x2 = _mm256_sra_epi32(_mm256_sub_epi32(sum_ab, sum_cd), count_out);
+            __m256i x1 = _mm256_sra_epi32(_mm256_add_epi32(diff_ab, rot_cd), count_out);
+            __m256i x3 = _mm256_sra_epi32(_mm256_sub_epi32(diff_ab, rot_cd), count_out);
+
+            _mm256_storeu_si256((__m256i *)pData1, _mm256_sra_epi32(_mm256_add_epi32(sum_ab, sum_cd), count_out));
+            _mm256_storeu_si256((__m256i *)pData2, _mm256_slli_epi32(rot_w_avx2(x2, w2), 1));
+            _mm256_storeu_si256((__m256i *)pData3, _mm256_slli_epi32(rot_w_avx2(x1, w1), 1));
+            _mm256_storeu_si256((__m256i *)pData4, _mm256_slli_epi32(rot_w_avx2(x3, w3), 1));
+        }
+    }
+
+    fft_rx4_short_tail(Data, pw, n1, n2, j0, shift, exp);
+}
+
+static int fft_rx4_isa()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return 2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return 1;
+    return 0;
+}
+
+static const int fft_rx4_x86_isa = fft_rx4_isa();
+
+static const fft_rx4_long_twiddled_func fft_rx4_long_twiddled_impl =
+    (fft_rx4_x86_isa == 2) ? fft_rx4_long_twiddled_avx2 :
+    (fft_rx4_x86_isa == 1) ? fft_rx4_long_twiddled_sse41 : fft_rx4_long_twiddled_c;
+
+static const fft_rx4_short_twiddled_func fft_rx4_short_twiddled_impl =
+    (fft_rx4_x86_isa == 2) ? fft_rx4_short_twiddled_avx2 :
+    (fft_rx4_x86_isa == 1) ? fft_rx4_short_twiddled_sse41 : fft_rx4_short_twiddled_c;
+
+void fft_rx4_long_twiddled(
+    Int32      Data[],
+    const Int32 *pw,
+    Int        n1,
+    Int        n2)
+{
+    fft_rx4_long_twiddled_impl(Data, pw, n1, n2);
+}
+
+void fft_rx4_short_twiddled(
+    Int32      Data[],
+    const Int32 *pw,
+    Int        n1,
+    Int        n2,
+    Int        shift,
+    Int        exp)
+{
+    fft_rx4_short_twiddled_impl(Data, pw, n1, n2, shift, exp);
+}
+
+#endif      /* --- PV_X86_SIMD --- */
@@ -65,6 +65,9 @@
 
 #include "fxp_mul32_c_equivalent.h"
 
+/* lane-wise versions of the primitives, for the x86 SIMD kernels */
+#include "fxp_mul32_x86.h"
+
 #endif
 
 
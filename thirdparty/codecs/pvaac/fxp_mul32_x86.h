@@ -0,0 +1,235 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+
+ Pathname: ./c/include/fxp_mul32_x86.h
+
+------------------------------------------------------------------------------
+ INCLUDE DESCRIPTION
+
+    x86 backend of fxp_mul32.h: lane-wise versions of the fxp_mul32
+    primitives, for kernels that process several independent outputs at
+    once. Every lane gives exactly the value of the scalar primitive in
+    fxp_mul32_c_equivalent.h, which stays the scalar backend: on x86 each
+    scalar primitive is already a single 64-bit multiply.
+
+    The primitives are named after the scalar one with the instruction
+    set appended, fxp_mul32_Q31() -> fxp_mul32_Q31_sse41() (4 lanes) and
+    fxp_mul32_Q31_avx2() (8 lanes). Complex twiddles packed as in
+    cmplx_mul32_by_16() are expanded once with cmplx_twiddle_*() and then
+    applied to interleaved (re, im) lanes.
+
+    SSE2 is always there on x86-64; the SSE4.1 and AVX2 helpers are
+    compiled with target attributes and must only be called after a
+    runtime check (__builtin_cpu_supports).
+
+    Define PV_X86_SIMD_DISABLE to build the portable C code only.
+
+------------------------------------------------------------------------------
+*/
+
+#ifndef FXP_MUL32_X86_H
+#define FXP_MUL32_X86_H
+
+#if !defined(PV_X86_SIMD_DISABLE) && defined(__GNUC__) && \
+    (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define PV_X86_SIMD
+#endif
+
+#if defined(PV_X86_SIMD)
+
+#include <emmintrin.h>
+#include <immintrin.h>
+
+#include "pv_audio_type_defs.h"
+
+/* 8 x Int16 in reverse order */
+static inline __m128i pv_reverse_epi16(__m128i a)
+{
+    a = _mm_shufflelo_epi16(a, _MM_SHUFFLE(0, 1, 2, 3));
+    a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(0, 1, 2, 3));
+    return _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+/*
+ * fxp_mac_16_by_16_bt(x0, c, acc) + fxp_mac_16_by_16_bb(x1, c, acc) for 4
+ * lanes: x01 holds (x0, x1) pairs and c has its halves swapped, i.e.
+ * top coefficient in the low 16 bits.
+ */
+static inline __m128i fxp_mac_16_by_16_pair_sse2(__m128i x01, __m128i c, __m128i acc)
+{
+    return _mm_add_epi32(acc, _mm_madd_epi16(x01, c));
+}
+
+/*----------------------------------------------------------------------------
+; SSE4.1
+----------------------------------------------------------------------------*/
+
+/* bits n..n+31 of the 64-bit products a*b, for 4 lanes */
+template<int n>
+__attribute__((target("sse4.1")))
+static inline __m128i fxp_mul32_shr_sse41(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epi32(a, b);
+    __m128i odd  = _mm_mul_epi32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_blend_epi16(_mm_srli_epi64(even, n), _mm_slli_epi64(odd, 32 - n), 0xCC);
+}
+
+/* fxp_mul32_Q31(a, b), i.e. (a*b) >> 32 */
+__attribute__((target("sse4.1")))
+static inline __m128i fxp_mul32_Q31_sse41(__m128i a, __m128i b)
+{
+    return fxp_mul32_shr_sse41<32>(a, b);
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i fxp_mac32_Q31_sse41(__m128i L_add, __m128i a, __m128i b)
+{
+    return _mm_add_epi32(L_add, fxp_mul32_shr_sse41<32>(a, b));
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i fxp_msu32_Q31_sse41(__m128i L_sub, __m128i a, __m128i b)
+{
+    return _mm_sub_epi32(L_sub, fxp_mul32_shr_sse41<32>(a, b));
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i fxp_mul32_Q30_sse41(__m128i a, __m128i b)
+{
+    return fxp_mul32_shr_sse41<30>(a, b);
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i fxp_mul32_Q29_sse41(__m128i a, __m128i b)
+{
+    return fxp_mul32_shr_sse41<29>(a, b);
+}
+
+/* fxp_mul32_by_16(a, b) for 4 lanes, b sign-extended to 32 bits */
+__attribute__((target("sse4.1")))
+static inline __m128i fxp_mul32_by_16_sse41(__m128i a, __m128i b)
+{
+    return fxp_mul32_shr_sse41<16>(a, b);
+}
+
+/* fxp_mac32_by_16(a, b, L_add), b sign-extended to 32 bits */
+__attribute__((target("sse4.1")))
+static inline __m128i fxp_mac32_by_16_sse41(__m128i a, __m128i b, __m128i L_add)
+{
+    return _mm_add_epi32(L_add, fxp_mul32_shr_sse41<16>(a, b));
+}
+
+/*
+ * Twiddles w[0], w[1] packed as for cmplx_mul32_by_16() (cos in the top,
+ * sin in the bottom 16 bits), expanded to one value per (re, im) lane.
+ */
+static inline void cmplx_twiddle_sse2(const Int32 *w, __m128i *cos_jw, __m128i *sin_jw)
+{
+    __m128i jw = _mm_loadl_epi64((const __m128i *)w);
+    jw = _mm_unpacklo_epi32(jw, jw);
+    *cos_jw = _mm_srai_epi32(jw, 16);
+    *sin_jw = _mm_srai_epi32(_mm_slli_epi32(jw, 16), 16);
+}
+
+/* cmplx_mul32_by_16(x, y, exp_jw) for 4 lanes, on expanded twiddles */
+__attribute__((target("sse4.1")))
+static inline __m128i cmplx_mul32_by_16_sse41(__m128i x, __m128i y, __m128i cos_jw, __m128i sin_jw)
+{
+    return _mm_add_epi32(fxp_mul32_shr_sse41<16>(x, cos_jw),
+                         fxp_mul32_shr_sse41<16>(y, sin_jw));
+}
+
+/*----------------------------------------------------------------------------
+; AVX2
+----------------------------------------------------------------------------*/
+
+/* bits n..n+31 of the 64-bit products a*b, for 8 lanes */
+template<int n>
+__attribute__((target("avx2")))
+static inline __m256i fxp_mul32_shr_avx2(__m256i a, __m256i b)
+{
+    __m256i even = _mm256_mul_epi32(a, b);
+    __m256i odd  = _mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+    return _mm256_blend_epi32(_mm256_srli_epi64(even, n), _mm256_slli_epi64(odd, 32 - n), 0xAA);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i fxp_mul32_Q31_avx2(__m256i a, __m256i b)
+{
+    return fxp_mul32_shr_avx2<32>(a, b);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i fxp_mac32_Q31_avx2(__m256i L_add, __m256i a, __m256i b)
+{
+    return _mm256_add_epi32(L_add, fxp_mul32_shr_avx2<32>(a, b));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i fxp_msu32_Q31_avx2(__m256i L_sub, __m256i a, __m256i b)
+{
+    return _mm256_sub_epi32(L_sub, fxp_mul32_shr_avx2<32>(a, b));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i fxp_mul32_Q30_avx2(__m256i a, __m256i b)
+{
+    return fxp_mul32_shr_avx2<30>(a, b);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i fxp_mul32_Q29_avx2(__m256i a, __m256i b)
+{
+    return fxp_mul32_shr_avx2<29>(a, b);
+}
+
+/* fxp_mul32_by_16(a, b) for 8 lanes, b sign-extended to 32 bits */
+__attribute__((target("avx2")))
+static inline __m256i fxp_mul32_by_16_avx2(__m256i a, __m256i b)
+{
+    return fxp_mul32_shr_avx2<16>(a, b);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i fxp_mac32_by_16_avx2(__m256i a, __m256i b, __m256i L_add)
+{
+    return _mm256_add_epi32(L_add, fxp_mul32_shr_avx2<16>(a, b));
+}
+
+/* twiddles w[0..3], expanded to one value per (re, im) lane */
+__attribute__((target("avx2")))
+static inline void cmplx_twiddle_avx2(const Int32 *w, __m256i *cos_jw, __m256i *sin_jw)
+{
+    const __m256i dup = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+    __m256i jw = _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)w));
+    jw = _mm256_permutevar8x32_epi32(jw, dup);
+    *cos_jw = _mm256_srai_epi32(jw, 16);
+    *sin_jw = _mm256_srai_epi32(_mm256_slli_epi32(jw, 16), 16);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i cmplx_mul32_by_16_avx2(__m256i x, __m256i y, __m256i cos_jw, __m256i sin_jw)
+{
+    return _mm256_add_epi32(fxp_mul32_shr_avx2<16>(x, cos_jw),
+                            fxp_mul32_shr_avx2<16>(y, sin_jw));
+}
+
+#endif /* PV_X86_SIMD */
+
+#endif /* FXP_MUL32_X86_H */
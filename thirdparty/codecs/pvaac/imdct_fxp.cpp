@@ -266,17 +266,20 @@
 ----------------------------------------------------------------------------*/
 
 
-Int imdct_fxp(Int32   data_quant[],
-              Int32   freq_2_time_buffer[],
-              const   Int     n,
-              Int     Q_format,
-              Int32   max)
+#if defined(PV_X86_SIMD)
+Int32 imdct_fxp_pre_rotation_c(Int32   data_quant[],
+                               const   Int32 *p_rotate,
+                               const   Int     n,
+                               Int     shift1)
+#else
+Int32 imdct_fxp_pre_rotation(Int32   data_quant[],
+                             const   Int32 *p_rotate,
+                             const   Int     n,
+                             Int     shift1)
+#endif
 {
-
     Int32     exp_jw;
-    Int     shift = 0;
 
-    const   Int32 *p_rotate;
     const   Int32 *p_rotate_2;
 
     Int32   *p_data_1;
@@ -285,160 +288,179 @@ Int imdct_fxp(Int32   data_quant[],
     Int32   temp_re32;
     Int32   temp_im32;
 
-    Int     shift1 = 0;
     Int32   temp1;
     Int32   temp2;
+    Int32   max = 0;
 
     Int     k;
     Int     n_2   = n >> 1;
     Int     n_4   = n >> 2;
 
+    /*
+     *   p_data_1                                        p_data_2
+     *       |                                            |
+     *       RIRIRIRIRIRIRIRIRIRIRIRIRIRIRI....RIRIRIRIRIRI
+     *        |                                          |
+     *
+     */
 
+    p_data_1 =  data_quant;             /* uses first  half of buffer */
+    p_data_2 = &data_quant[n_2 - 1];    /* uses second half of buffer */
 
-    if (max != 0)
+    p_rotate_2 = &p_rotate[n_4-1];
+
+    if (shift1 >= 0)
     {
+        temp_re32 =   *(p_data_1++) << shift1;
+        temp_im32 =   *(p_data_2--) << shift1;
 
-        switch (n)
+        for (k = n_4 >> 1; k != 0; k--)
         {
-            case SHORT_WINDOW_TYPE:
-                p_rotate = exp_rotation_N_256;
-                shift = 21;           /* log2(n)-1 + 14 acomodates 2/N factor */
-                break;
+            /*
+             *  Real and Imag parts have been swaped to use FFT as IFFT
+             */
+            /*
+             * cos_n + j*sin_n == exp(j(2pi/N)(k+1/8))
+             */
+            exp_jw = *p_rotate++;
 
-            case LONG_WINDOW_TYPE:
-                p_rotate = exp_rotation_N_2048;
-                shift = 24;           /* log2(n)-1 +14 acomodates 2/N factor */
-                break;
+            temp1      =  cmplx_mul32_by_16(temp_im32, -temp_re32, exp_jw);
+            temp2      = -cmplx_mul32_by_16(temp_re32,  temp_im32, exp_jw);
 
-            default:
-                /*
-                 * There is no defined behavior for a non supported frame
-                 * size. By returning a fixed scaling factor, the input will
-                 * scaled down and the will be heard as a low level noise
-                 */
-                return(ERROR_IN_FRAME_SIZE);
+            temp_im32 =   *(p_data_1--) << shift1;
+            temp_re32 =   *(p_data_2--) << shift1;
+            *(p_data_1++) = temp1;
+            *(p_data_1++) = temp2;
+            max         |= (temp1 >> 31) ^ temp1;
+            max         |= (temp2 >> 31) ^ temp2;
 
-        }
 
-        /*
-         *   p_data_1                                        p_data_2
-         *       |                                            |
-         *       RIRIRIRIRIRIRIRIRIRIRIRIRIRIRI....RIRIRIRIRIRI
-         *        |                                          |
-         *
-         */
+            /*
+             *  Real and Imag parts have been swaped to use FFT as IFFT
+             */
 
-        p_data_1 =  data_quant;             /* uses first  half of buffer */
-        p_data_2 = &data_quant[n_2 - 1];    /* uses second half of buffer */
+            /*
+             * cos_n + j*sin_n == exp(j(2pi/N)(k+1/8))
+             */
 
-        p_rotate_2 = &p_rotate[n_4-1];
+            exp_jw = *p_rotate_2--;
 
-        shift1 = pv_normalize(max) - 1;     /* -1 to leave room for addition */
-        Q_format -= (16 - shift1);
-        max = 0;
+            temp1      =  cmplx_mul32_by_16(temp_im32, -temp_re32, exp_jw);
+            temp2      = -cmplx_mul32_by_16(temp_re32,  temp_im32, exp_jw);
 
 
-        if (shift1 >= 0)
-        {
             temp_re32 =   *(p_data_1++) << shift1;
             temp_im32 =   *(p_data_2--) << shift1;
 
-            for (k = n_4 >> 1; k != 0; k--)
-            {
-                /*
-                 *  Real and Imag parts have been swaped to use FFT as IFFT
-                 */
-                /*
-                 * cos_n + j*sin_n == exp(j(2pi/N)(k+1/8))
-                 */
-                exp_jw = *p_rotate++;
-
-                temp1      =  cmplx_mul32_by_16(temp_im32, -temp_re32, exp_jw);
-                temp2      = -cmplx_mul32_by_16(temp_re32,  temp_im32, exp_jw);
+            *(p_data_2 + 2) = temp1;
+            *(p_data_2 + 3) = temp2;
+            max         |= (temp1 >> 31) ^ temp1;
+            max         |= (temp2 >> 31) ^ temp2;
 
-                temp_im32 =   *(p_data_1--) << shift1;
-                temp_re32 =   *(p_data_2--) << shift1;
-                *(p_data_1++) = temp1;
-                *(p_data_1++) = temp2;
-                max         |= (temp1 >> 31) ^ temp1;
-                max         |= (temp2 >> 31) ^ temp2;
+        }
+    }
+    else
+    {
+        temp_re32 =   *(p_data_1++) >> 1;
+        temp_im32 =   *(p_data_2--) >> 1;
 
+        for (k = n_4 >> 1; k != 0; k--)
+        {
+            /*
+             *  Real and Imag parts have been swaped to use FFT as IFFT
+             */
+            /*
+             * cos_n + j*sin_n == exp(j(2pi/N)(k+1/8))
+             */
+            exp_jw = *p_rotate++;
 
-                /*
-                 *  Real and Imag parts have been swaped to use FFT as IFFT
-                 */
+            temp1      =  cmplx_mul32_by_16(temp_im32, -temp_re32, exp_jw);
+            temp2      = -cmplx_mul32_by_16(temp_re32,  temp_im32, exp_jw);
 
-                /*
-                 * cos_n + j*sin_n == exp(j(2pi/N)(k+1/8))
-                 */
+            temp_im32 =   *(p_data_1--) >> 1;
+            temp_re32 =   *(p_data_2--) >> 1;
+            *(p_data_1++) = temp1;
+            *(p_data_1++) = temp2;
 
-                exp_jw = *p_rotate_2--;
+            max         |= (temp1 >> 31) ^ temp1;
+            max         |= (temp2 >> 31) ^ temp2;
 
-                temp1      =  cmplx_mul32_by_16(temp_im32, -temp_re32, exp_jw);
-                temp2      = -cmplx_mul32_by_16(temp_re32,  temp_im32, exp_jw);
 
+            /*
+             *  Real and Imag parts have been swaped to use FFT as IFFT
+             */
 
-                temp_re32 =   *(p_data_1++) << shift1;
-                temp_im32 =   *(p_data_2--) << shift1;
+            /*
+             * cos_n + j*sin_n == exp(j(2pi/N)(k+1/8))
+             */
+            exp_jw = *p_rotate_2--;
 
-                *(p_data_2 + 2) = temp1;
-                *(p_data_2 + 3) = temp2;
-                max         |= (temp1 >> 31) ^ temp1;
-                max         |= (temp2 >> 31) ^ temp2;
+            temp1      =  cmplx_mul32_by_16(temp_im32, -temp_re32, exp_jw);
+            temp2      = -cmplx_mul32_by_16(temp_re32,  temp_im32, exp_jw);
 
-            }
-        }
-        else
-        {
             temp_re32 =   *(p_data_1++) >> 1;
             temp_im32 =   *(p_data_2--) >> 1;
 
-            for (k = n_4 >> 1; k != 0; k--)
-            {
-                /*
-                 *  Real and Imag parts have been swaped to use FFT as IFFT
-                 */
-                /*
-                 * cos_n + j*sin_n == exp(j(2pi/N)(k+1/8))
-                 */
-                exp_jw = *p_rotate++;
+            *(p_data_2 + 3) = temp2;
+            *(p_data_2 + 2) = temp1;
 
-                temp1      =  cmplx_mul32_by_16(temp_im32, -temp_re32, exp_jw);
-                temp2      = -cmplx_mul32_by_16(temp_re32,  temp_im32, exp_jw);
+            max         |= (temp1 >> 31) ^ temp1;
+            max         |= (temp2 >> 31) ^ temp2;
 
-                temp_im32 =   *(p_data_1--) >> 1;
-                temp_re32 =   *(p_data_2--) >> 1;
-                *(p_data_1++) = temp1;
-                *(p_data_1++) = temp2;
+        }
+    }
 
-                max         |= (temp1 >> 31) ^ temp1;
-                max         |= (temp2 >> 31) ^ temp2;
+    return (max);
 
+}
 
-                /*
-                 *  Real and Imag parts have been swaped to use FFT as IFFT
-                 */
 
-                /*
-                 * cos_n + j*sin_n == exp(j(2pi/N)(k+1/8))
-                 */
-                exp_jw = *p_rotate_2--;
 
-                temp1      =  cmplx_mul32_by_16(temp_im32, -temp_re32, exp_jw);
-                temp2      = -cmplx_mul32_by_16(temp_re32,  temp_im32, exp_jw);
+Int imdct_fxp(Int32   data_quant[],
+              Int32   freq_2_time_buffer[],
+              const   Int     n,
+              Int     Q_format,
+              Int32   max)
+{
+
+    Int     shift = 0;
+
+    const   Int32 *p_rotate;
+
+    Int     shift1 = 0;
 
-                temp_re32 =   *(p_data_1++) >> 1;
-                temp_im32 =   *(p_data_2--) >> 1;
 
-                *(p_data_2 + 3) = temp2;
-                *(p_data_2 + 2) = temp1;
 
-                max         |= (temp1 >> 31) ^ temp1;
-                max         |= (temp2 >> 31) ^ temp2;
+    if (max != 0)
+    {
+
+        switch (n)
+        {
+            case SHORT_WINDOW_TYPE:
+                p_rotate = exp_rotation_N_256;
+                shift = 21;           /* log2(n)-1 + 14 acomodates 2/N factor */
+                break;
+
+            case LONG_WINDOW_TYPE:
+                p_rotate = exp_rotation_N_2048;
+                shift = 24;           /* log2(n)-1 +14 acomodates 2/N factor */
+                break;
+
+            default:
+                /*
+                 * There is no defined behavior for a non supported frame
+                 * size. By returning a fixed scaling factor, the input will
+                 * scaled down and the will be heard as a low level noise
+                 */
+                return(ERROR_IN_FRAME_SIZE);
 
-            }
         }
 
+        shift1 = pv_normalize(max) - 1;     /* -1 to leave room for addition */
+        Q_format -= (16 - shift1);
+
+        max = imdct_fxp_pre_rotation(data_quant, p_rotate, n, shift1);
+
 
         if (n != SHORT_WINDOW_TYPE)
         {
@@ -50,6 +50,8 @@
 #ifndef IMDCT_FXP_H
 #define IMDCT_FXP_H
 
+#include "fxp_mul32_x86.h"
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -111,6 +113,43 @@ extern "C"
         Int32   max
     );
 
+    /*
+     * Pre-rotation of imdct_fxp(), in place on data_quant[0..n/2-1] with
+     * inputs scaled by shift1 (>> 1 when negative). Returns the OR of
+     * (x >> 31) ^ x over the outputs.
+     */
+    Int32 imdct_fxp_pre_rotation(
+        Int32   data_quant[],
+        const   Int32 *p_rotate,
+        const   Int     n,
+        Int     shift1
+    );
+
+#if defined(PV_X86_SIMD)
+
+    Int32 imdct_fxp_pre_rotation_c(
+        Int32   data_quant[],
+        const   Int32 *p_rotate,
+        const   Int     n,
+        Int     shift1
+    );
+
+    Int32 imdct_fxp_pre_rotation_sse41(
+        Int32   data_quant[],
+        const   Int32 *p_rotate,
+        const   Int     n,
+        Int     shift1
+    );
+
+    Int32 imdct_fxp_pre_rotation_avx2(
+        Int32   data_quant[],
+        const   Int32 *p_rotate,
+        const   Int     n,
+        Int     shift1
+    );
+
+#endif
+
 
 #ifdef __cplusplus
 }
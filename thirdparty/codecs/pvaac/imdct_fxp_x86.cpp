@@ -0,0 +1,225 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+
+ Filename: imdct_fxp_x86.cpp
+
+------------------------------------------------------------------------------
+ FUNCTION DESCRIPTION
+
+    x86 versions of imdct_fxp_pre_rotation(), bit-exact with
+    imdct_fxp_pre_rotation_c().
+
+    Complex k of the pre-rotation takes its real part from data_quant[2k]
+    and its imaginary part from data_quant[n/2 - 1 - 2k], and is written
+    back to data_quant[2k], data_quant[2k + 1]. A block of complexes at the
+    front of the buffer is therefore done together with the mirrored block
+    at the back, whose odd slots it reads: both are loaded, rebuilt as
+    (re, im) lanes with a blend of one with the pair-reversed other,
+    rotated with the lane-wise cmplx_mul32_by_16() and stored back. 2 + 2
+    complexes are done per step with SSE4.1, 4 + 4 with AVX2.
+
+------------------------------------------------------------------------------
+*/
+
+
+/*----------------------------------------------------------------------------
+; INCLUDES
+----------------------------------------------------------------------------*/
+#include "pv_audio_type_defs.h"
+#include "imdct_fxp.h"
+#include "fxp_mul32.h"
+
+#if defined(PV_X86_SIMD)
+
+/*----------------------------------------------------------------------------
+; LOCAL STORE/BUFFER/POINTER DEFINITIONS
+----------------------------------------------------------------------------*/
+typedef Int32(*pre_rotation_func)(Int32 data_quant[],
+                                  const Int32 *p_rotate,
+                                  const Int n,
+                                  Int shift1);
+
+/*----------------------------------------------------------------------------
+; LOCAL FUNCTION DEFINITIONS
+----------------------------------------------------------------------------*/
+
+/*
+ * (re, im) -> (cmplx_mul32_by_16(im, -re, w), -cmplx_mul32_by_16(re, im, w))
+ * for every complex of x
+ */
+__attribute__((target("sse4.1")))
+static inline __m128i pre_rotate_sse41(__m128i x, __m128i cos_jw, __m128i sin_jw)
+{
+    const __m128i neg_re = _mm_set_epi32(0, -1, 0, -1);
+    const __m128i neg_im = _mm_set_epi32(-1, 0, -1, 0);
+
+    __m128i swapped = _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128i negated = _mm_sub_epi32(_mm_xor_si128(x, neg_re), neg_re);
+    __m128i y = cmplx_mul32_by_16_sse41(swapped, negated, cos_jw, sin_jw);
+
+    return _mm_sub_epi32(_mm_xor_si128(y, neg_im), neg_im);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i pre_rotate_avx2(__m256i x, __m256i cos_jw, __m256i sin_jw)
+{
+    const __m256i neg_re = _mm256_set_epi32(0, -1, 0, -1, 0, -1, 0, -1);
+    const __m256i neg_im = _mm256_set_epi32(-1, 0, -1, 0, -1, 0, -1, 0);
+
+    __m256i swapped = _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1));
+    __m256i negated = _mm256_sub_epi32(_mm256_xor_si256(x, neg_re), neg_re);
+    __m256i y = cmplx_mul32_by_16_avx2(swapped, negated, cos_jw, sin_jw);
+
+    return _mm256_sub_epi32(_mm256_xor_si256(y, neg_im), neg_im);
+}
+
+/* (x >> 31) ^ x, as the max tracking of the C version */
+__attribute__((target("sse4.1")))
+static inline __m128i peak_bits_sse41(__m128i x)
+{
+    return _mm_xor_si128(_mm_srai_epi32(x, 31), x);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i peak_bits_avx2(__m256i x)
+{
+    return _mm256_xor_si256(_mm256_srai_epi32(x, 31), x);
+}
+
+/*----------------------------------------------------------------------------
+; FUNCTION CODE
+----------------------------------------------------------------------------*/
+
+__attribute__((target("sse4.1")))
+Int32 imdct_fxp_pre_rotation_sse41(Int32   data_quant[],
+                                   const   Int32 *p_rotate,
+                                   const   Int     n,
+                                   Int     shift1)
+{
+    /* << shift1, or >> 1 when shift1 is negative */
+    const __m128i shift_l = _mm_cvtsi32_si128((shift1 >= 0) ? shift1 : 0);
+    const __m128i shift_r = _mm_cvtsi32_si128((shift1 >= 0) ? 0 : 1);
+    Int     n_2   = n >> 1;
+    Int     n_4   = n >> 2;
+    __m128i max = _mm_setzero_si128();
+    Int32   max_lanes[4];
+
+    for (Int k = 0; k < (n_4 >> 1); k += 2)
+    {
+        Int32 *p_front = &data_quant[2*k];
+        Int32 *p_back  = &data_quant[n_2 - 2*k - 4];
+        __m128i cos_front, sin_front;
+        __m128i cos_back, sin_back;
+
+        __m128i front = _mm_loadu_si128((const __m128i *)p_front);
+        __m128i back  = _mm_loadu_si128((const __m128i *)p_back);
+        front = _mm_sra_epi32(_mm_sll_epi32(front, shift_l), shift_r);
+        back  = _mm_sra_epi32(_mm_sll_epi32(back,  shift_l), shift_r);
+
+        /* real parts from the even slots, imaginary parts from the other end */
+        __m128i x_front = _mm_blend_epi16(front, _mm_shuffle_epi32(back,  _MM_SHUFFLE(1, 0, 3, 2)), 0xCC);
+        __m128i x_back  = _mm_blend_epi16(back,  _mm_shuffle_epi32(front, _MM_SHUFFLE(1, 0, 3, 2)), 0xCC);
+
+        cmplx_twiddle_sse2(&p_rotate[k], &cos_front, &sin_front);
+        cmplx_twiddle_sse2(&p_rotate[n_4 - k - 2], &cos_back, &sin_back);
+
+        x_front = pre_rotate_sse41(x_front, cos_front, sin_front);
+        x_back  = pre_rotate_sse41(x_back,  cos_back,  sin_back);
+
+        _mm_storeu_si128((__m128i *)p_front, x_front);
+        _mm_storeu_si128((__m128i *)p_back,  x_back);
+        max = _mm_or_si128(max, _mm_or_si128(peak_bits_sse41(x_front), peak_bits_sse41(x_back)));
+    }
+
+    _mm_storeu_si128((__m128i *)max_lanes, max);
+
+    return (max_lanes[0] | max_lanes[1] | max_lanes[2] | max_lanes[3]);
+}
+
+__attribute__((target("avx2")))
+Int32 imdct_fxp_pre_rotation_avx2(Int32   data_quant[],
+                                  const   Int32 *p_rotate,
+                                  const   Int     n,
+                                  Int     shift1)
+{
+    const __m256i reverse_pairs = _mm256_setr_epi32(6, 7, 4, 5, 2, 3, 0, 1);
+    const __m128i shift_l = _mm_cvtsi32_si128((shift1 >= 0) ? shift1 : 0);
+    const __m128i shift_r = _mm_cvtsi32_si128((shift1 >= 0) ? 0 : 1);
+    Int     n_2   = n >> 1;
+    Int     n_4   = n >> 2;
+    __m256i max = _mm256_setzero_si256();
+    Int32   max_lanes[8];
+    Int32   peak = 0;
+
+    for (Int k = 0; k < (n_4 >> 1); k += 4)
+    {
+        Int32 *p_front = &data_quant[2*k];
+        Int32 *p_back  = &data_quant[n_2 - 2*k - 8];
+        __m256i cos_front, sin_front;
+        __m256i cos_back, sin_back;
+
+        __m256i front = _mm256_loadu_si256((const __m256i *)p_front);
+        __m256i back  = _mm256_loadu_si256((const __m256i *)p_back);
+        front = _mm256_sra_epi32(_mm256_sll_epi32(front, shift_l), shift_r);
+        back  = _mm256_sra_epi32(_mm256_sll_epi32(back,  shift_l), shift_r);
+
+        __m256i x_front = _mm256_blend_epi32(front, _mm256_permutevar8x32_epi32(back,  reverse_pairs), 0xAA);
+        __m256i x_back  = _mm256_blend_epi32(back,  _mm256_permutevar8x32_epi32(front, reverse_pairs), 0xAA);
+
+        cmplx_twiddle_avx2(&p_rotate[k], &cos_front, &sin_front);
+        cmplx_twiddle_avx2(&p_rotate[n_4 - k - 4], &cos_back, &sin_back);
+
+        x_front = pre_rotate_avx2(x_front, cos_front, sin_front);
+        x_back  = pre_rotate_avx2(x_back,  cos_back,  sin_back);
+
+        _mm256_storeu_si256((__m256i *)p_front, x_front);
+        _mm256_storeu_si256((__m256i *)p_back,  x_back);
+        max = _mm256_or_si256(max, _mm256_or_si256(peak_bits_avx2(x_front), peak_bits_avx2(x_back)));
+    }
+
+    _mm256_storeu_si256((__m256i *)max_lanes, max);
+    for (Int i = 0; i < 8; i++)
+    {
+        peak |= max_lanes[i];
+    }
+
+    return (peak);
+}
+
+static pre_rotation_func pre_rotation_select()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return imdct_fxp_pre_rotation_avx2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return imdct_fxp_pre_rotation_sse41;
+    return imdct_fxp_pre_rotation_c;
+}
+
+static const pre_rotation_func pre_rotation_impl = pre_rotation_select();
+
+Int32 imdct_fxp_pre_rotation(Int32   data_quant[],
+                             const   Int32 *p_rotate,
+                             const   Int     n,
+                             Int     shift1)
+{
+    return pre_rotation_impl(data_quant, p_rotate, n, shift1);
+}
+
+#endif      /* --- PV_X86_SIMD --- */
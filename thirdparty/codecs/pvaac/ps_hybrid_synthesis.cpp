@@ -146,11 +146,19 @@ Copyright (c) ISO/IEC 2003.
 /*----------------------------------------------------------------------------
 ; FUNCTION CODE
 ----------------------------------------------------------------------------*/
+#if defined(PV_X86_SIMD)
+void ps_hybrid_synthesis_c(const Int32 *mHybridReal,
+                           const Int32 *mHybridImag,
+                           Int32 *mQmfReal,
+                           Int32 *mQmfImag,
+                           HYBRID *hHybrid)
+#else
 void ps_hybrid_synthesis(const Int32 *mHybridReal,
                          const Int32 *mHybridImag,
                          Int32 *mQmfReal,
                          Int32 *mQmfImag,
                          HYBRID *hHybrid)
+#endif
 {
     Int32  k;
     Int32  band;
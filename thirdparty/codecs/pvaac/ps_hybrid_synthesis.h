@@ -44,6 +44,7 @@
 ----------------------------------------------------------------------------*/
 #include "pv_audio_type_defs.h"
 #include "s_hybrid.h"
+#include "fxp_mul32_x86.h"
 
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -87,6 +88,22 @@ extern "C"
     Int32 *mQmfImag,
     HYBRID *hHybrid);
 
+#if defined(PV_X86_SIMD)
+
+    void ps_hybrid_synthesis_c(const Int32 *mHybridReal,
+    const Int32 *mHybridImag,
+    Int32 *mQmfReal,
+    Int32 *mQmfImag,
+    HYBRID *hHybrid);
+
+    void ps_hybrid_synthesis_sse2(const Int32 *mHybridReal,
+    const Int32 *mHybridImag,
+    Int32 *mQmfReal,
+    Int32 *mQmfImag,
+    HYBRID *hHybrid);
+
+#endif
+
 #ifdef __cplusplus
 }
 #endif
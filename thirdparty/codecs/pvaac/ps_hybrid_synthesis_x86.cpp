@@ -0,0 +1,106 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+
+ Filename: ps_hybrid_synthesis_x86.cpp
+
+------------------------------------------------------------------------------
+ FUNCTION DESCRIPTION
+
+    SSE2 version of ps_hybrid_synthesis(), bit-exact with
+    ps_hybrid_synthesis_c().
+
+    Each QMF band sums 2, 4 or 6 consecutive hybrid bands, real and
+    imaginary part apart. Two real and two imaginary samples are added per
+    step in one register, the four partial sums folded at the end of the
+    band; the additions wrap like the C ones, so the order does not matter.
+
+------------------------------------------------------------------------------
+*/
+
+
+/*----------------------------------------------------------------------------
+; INCLUDES
+----------------------------------------------------------------------------*/
+
+#ifdef LITEPLAYER_CONFIG_AAC_PLUS
+
+#ifdef LITEPLAYER_CONFIG_PARAMETRICSTEREO
+
+#include "s_hybrid.h"
+#include "ps_hybrid_synthesis.h"
+
+#if defined(PV_X86_SIMD)
+
+/*----------------------------------------------------------------------------
+; DEFINES
+----------------------------------------------------------------------------*/
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+/*----------------------------------------------------------------------------
+; FUNCTION CODE
+----------------------------------------------------------------------------*/
+
+void ps_hybrid_synthesis_sse2(const Int32 *mHybridReal,
+                              const Int32 *mHybridImag,
+                              Int32 *mQmfReal,
+                              Int32 *mQmfImag,
+                              HYBRID *hHybrid)
+{
+    const Int32 *ptr_mHybrid_Re = mHybridReal;
+    const Int32 *ptr_mHybrid_Im = mHybridImag;
+
+    for (Int32 band = 0; band < hHybrid->nQmfBands; band++)
+    {
+        HYBRID_RES hybridRes = (HYBRID_RES)(min(hHybrid->pResolution[band], 6) - 2);
+        __m128i acc = _mm_setzero_si128();
+
+        for (Int32 k = (hybridRes >> 1) + 1; k != 0; k--)    /*  hybridRes = { 2,4,6 }  */
+        {
+            __m128i re = _mm_loadl_epi64((const __m128i *)ptr_mHybrid_Re);
+            __m128i im = _mm_loadl_epi64((const __m128i *)ptr_mHybrid_Im);
+            acc = _mm_add_epi32(acc, _mm_unpacklo_epi64(re, im));
+            ptr_mHybrid_Re += 2;
+            ptr_mHybrid_Im += 2;
+        }
+
+        /* (re0 + re1, -, im0 + im1, -) */
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        mQmfReal[band] = _mm_cvtsi128_si32(acc);
+        mQmfImag[band] = _mm_cvtsi128_si32(_mm_unpackhi_epi64(acc, acc));
+    }
+}
+
+/* SSE2 is part of x86-64, no runtime check needed */
+void ps_hybrid_synthesis(const Int32 *mHybridReal,
+                         const Int32 *mHybridImag,
+                         Int32 *mQmfReal,
+                         Int32 *mQmfImag,
+                         HYBRID *hHybrid)
+{
+    ps_hybrid_synthesis_sse2(mHybridReal, mHybridImag, mQmfReal, mQmfImag, hHybrid);
+}
+
+#endif      /* --- PV_X86_SIMD --- */
+
+#endif
+
+#endif
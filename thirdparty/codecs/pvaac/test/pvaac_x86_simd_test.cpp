@@ -0,0 +1,303 @@
+/*
+ * Checks that the x86 SSE2/SSE4.1/AVX2 kernels of the decoder are bit-exact
+ * with their C versions, on random input.
+ *
+ * Build with test/CMakeLists.txt, run without arguments; returns 0 when
+ * every kernel matches.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "imdct_fxp.h"
+#include "fft_rx4.h"
+#include "qmf_filterbank_coeff.h"
+#include "calc_sbr_anafilterbank.h"
+#include "calc_sbr_synfilterbank.h"
+#include "s_hybrid.h"
+#include "ps_hybrid_synthesis.h"
+
+#if defined(PV_X86_SIMD)
+
+#define ITERATIONS      200
+
+#define SBR_X_LEN       320
+#define SBR_Y_LEN       64
+#define SBR_V_LEN       1280
+#define SBR_TIME_LEN    128
+#define PS_MAX_BANDS    10
+#define PS_HYBRID_LEN   (PS_MAX_BANDS * 6)
+
+enum {
+    IMPL_SSE2 = 0,
+    IMPL_SSE41,
+    IMPL_AVX2,
+    IMPL_COUNT,
+};
+
+static const char *impl_name[IMPL_COUNT] = { "sse2", "sse41", "avx2" };
+
+static bool impl_enabled[IMPL_COUNT];
+static int failures = 0;
+
+static UInt32 rand_state = 0x12345678;
+
+static Int32 rand_int32(int bits)
+{
+    rand_state = rand_state * 1664525 + 1013904223;
+    Int32 v = (Int32)((rand_state >> 1) & ((bits >= 31) ? 0x7FFFFFFF : ((1 << bits) - 1)));
+    return (rand_state & 0x80) ? -v : v;
+}
+
+static void rand_fill(Int32 *buf, int len, int bits)
+{
+    for (int i = 0; i < len; i++)
+        buf[i] = rand_int32(bits);
+}
+
+static void rand_fill16(Int16 *buf, int len)
+{
+    for (int i = 0; i < len; i++)
+        buf[i] = (Int16)rand_int32(16);
+}
+
+/* random magnitude per iteration, so both small and near full scale input is seen */
+static int rand_bits(int min, int max)
+{
+    rand_state = rand_state * 1664525 + 1013904223;
+    return min + (int)((rand_state >> 16) % (UInt32)(max - min + 1));
+}
+
+/* full range twiddles: cos in the top 16 bits, sin in the bottom 16 */
+static void rand_twiddles(Int32 *buf, int len)
+{
+    for (int i = 0; i < len; i++) {
+        rand_state = rand_state * 1664525 + 1013904223;
+        buf[i] = (Int32)rand_state;
+    }
+}
+
+static void report(const char *kernel, int impl, int param, bool ok)
+{
+    if (!ok) {
+        printf("FAIL: %s_%s, param %d\n", kernel, impl_name[impl], param);
+        failures++;
+    }
+}
+
+static void test_imdct_fxp_pre_rotation()
+{
+    typedef Int32 (*func)(Int32 *, const Int32 *, const Int, Int);
+    const func simd[IMPL_COUNT] = {
+        NULL, imdct_fxp_pre_rotation_sse41, imdct_fxp_pre_rotation_avx2
+    };
+    static const Int sizes[2] = { SHORT_WINDOW_TYPE, LONG_WINDOW_TYPE };
+    static Int32 src[LONG_WINDOW_TYPE / 2], ref[LONG_WINDOW_TYPE / 2], out[LONG_WINDOW_TYPE / 2];
+    static Int32 rotate[LONG_WINDOW_TYPE / 4];
+
+    for (int it = 0; it < ITERATIONS; it++) {
+        for (int s = 0; s < 2; s++) {
+            Int n = sizes[s];
+            int bits = rand_bits(8, 31);
+            /* as imdct_fxp(): shift1 = pv_normalize(max) - 1 */
+            Int shift1 = 30 - bits;
+            rand_fill(src, n / 2, bits);
+            rand_twiddles(rotate, n / 4);
+            memcpy(ref, src, sizeof(Int32) * (n / 2));
+            Int32 max_ref = imdct_fxp_pre_rotation_c(ref, rotate, n, shift1);
+            for (int impl = 0; impl < IMPL_COUNT; impl++) {
+                if (!impl_enabled[impl] || simd[impl] == NULL)
+                    continue;
+                memcpy(out, src, sizeof(Int32) * (n / 2));
+                Int32 max_out = simd[impl](out, rotate, n, shift1);
+                report("imdct_fxp_pre_rotation", impl, n * 100 + shift1,
+                       max_ref == max_out &&
+                       memcmp(ref, out, sizeof(Int32) * (n / 2)) == 0);
+            }
+        }
+    }
+}
+
+static void test_fft_rx4_long_twiddled()
+{
+    typedef void (*func)(Int32 *, const Int32 *, Int, Int);
+    const func simd[IMPL_COUNT] = {
+        NULL, fft_rx4_long_twiddled_sse41, fft_rx4_long_twiddled_avx2
+    };
+    Int32 src[2 * FFT_RX4_LONG], ref[2 * FFT_RX4_LONG], out[2 * FFT_RX4_LONG];
+    Int32 pw[3 * ONE_FOURTH_FFT_RX4_LONG];
+
+    for (int it = 0; it < ITERATIONS; it++) {
+        rand_fill(src, 2 * FFT_RX4_LONG, rand_bits(8, 28));
+        rand_twiddles(pw, 3 * ONE_FOURTH_FFT_RX4_LONG);
+        for (Int n1 = FFT_RX4_LONG; n1 > 4; n1 >>= 2) {
+            Int n2 = n1 >> 2;
+            memcpy(ref, src, sizeof(src));
+            fft_rx4_long_twiddled_c(ref, pw, n1, n2);
+            for (int impl = 0; impl < IMPL_COUNT; impl++) {
+                if (!impl_enabled[impl] || simd[impl] == NULL)
+                    continue;
+                memcpy(out, src, sizeof(src));
+                simd[impl](out, pw, n1, n2);
+                report("fft_rx4_long_twiddled", impl, n1,
+                       memcmp(ref, out, sizeof(ref)) == 0);
+            }
+        }
+    }
+}
+
+static void test_fft_rx4_short_twiddled()
+{
+    typedef void (*func)(Int32 *, const Int32 *, Int, Int, Int, Int);
+    const func simd[IMPL_COUNT] = {
+        NULL, fft_rx4_short_twiddled_sse41, fft_rx4_short_twiddled_avx2
+    };
+    Int32 src[2 * FFT_RX4_SHORT], ref[2 * FFT_RX4_SHORT], out[2 * FFT_RX4_SHORT];
+    Int32 pw[3 * ONE_FOURTH_FFT_RX4_SHORT];
+
+    for (int it = 0; it < ITERATIONS; it++) {
+        rand_fill(src, 2 * FFT_RX4_SHORT, rand_bits(8, 28));
+        rand_twiddles(pw, 3 * ONE_FOURTH_FFT_RX4_SHORT);
+        for (Int n1 = FFT_RX4_SHORT; n1 > 4; n1 >>= 2) {
+            Int n2 = n1 >> 2;
+            /* first pass shifts the input down by 2, the next ones don't */
+            Int shift = (n1 == FFT_RX4_SHORT) ? 2 : 0;
+            for (Int exp = 0; exp <= 3; exp++) {
+                memcpy(ref, src, sizeof(src));
+                fft_rx4_short_twiddled_c(ref, pw, n1, n2, shift, exp);
+                for (int impl = 0; impl < IMPL_COUNT; impl++) {
+                    if (!impl_enabled[impl] || simd[impl] == NULL)
+                        continue;
+                    memcpy(out, src, sizeof(src));
+                    simd[impl](out, pw, n1, n2, shift, exp);
+                    report("fft_rx4_short_twiddled", impl, n1 * 10 + exp,
+                           memcmp(ref, out, sizeof(ref)) == 0);
+                }
+            }
+        }
+    }
+}
+
+static void test_sbr_anafilterbank_window()
+{
+    typedef void (*func)(const Int32 *, Int16 *, Int32 *);
+    const func simd[IMPL_COUNT] = {
+        NULL, calc_sbr_anafilterbank_window_sse41, calc_sbr_anafilterbank_window_avx2
+    };
+    /* the low complexity and the high quality prototype filter */
+    const Int32 *coef[2] = {
+        sbrDecoderFilterbankCoefficients_an_filt_LC, sbrDecoderFilterbankCoefficients_an_filt
+    };
+    Int16 x[SBR_X_LEN];
+    Int32 ref[SBR_Y_LEN], out[SBR_Y_LEN];
+
+    for (int it = 0; it < ITERATIONS; it++) {
+        rand_fill16(x, SBR_X_LEN);
+        for (int c = 0; c < 2; c++) {
+            memset(ref, 0x5a, sizeof(ref));
+            calc_sbr_anafilterbank_window_c(coef[c], &x[SBR_X_LEN], ref);
+            for (int impl = 0; impl < IMPL_COUNT; impl++) {
+                if (!impl_enabled[impl] || simd[impl] == NULL)
+                    continue;
+                memset(out, 0x5a, sizeof(out));
+                simd[impl](coef[c], &x[SBR_X_LEN], out);
+                report("calc_sbr_anafilterbank_window", impl, c,
+                       memcmp(ref, out, sizeof(ref)) == 0);
+            }
+        }
+    }
+}
+
+static void test_sbr_synfilterbank_window()
+{
+    typedef void (*func)(Int16 *, Int16 *);
+    const func simd[IMPL_COUNT] = {
+        calc_sbr_synfilterbank_window_sse2, NULL, NULL
+    };
+    Int16 v[SBR_V_LEN];
+    Int16 ref[SBR_TIME_LEN], out[SBR_TIME_LEN];
+
+    for (int it = 0; it < ITERATIONS; it++) {
+        rand_fill16(v, SBR_V_LEN);
+        memset(ref, 0x5a, sizeof(ref));
+        calc_sbr_synfilterbank_window_c(v, ref);
+        for (int impl = 0; impl < IMPL_COUNT; impl++) {
+            if (!impl_enabled[impl] || simd[impl] == NULL)
+                continue;
+            memset(out, 0x5a, sizeof(out));
+            simd[impl](v, out);
+            report("calc_sbr_synfilterbank_window", impl, it,
+                   memcmp(ref, out, sizeof(ref)) == 0);
+        }
+    }
+}
+
+static void test_ps_hybrid_synthesis()
+{
+    static const Int32 resolutions[3] = { HYBRID_2_REAL, HYBRID_4_CPLX, HYBRID_8_CPLX };
+    Int32 resolution[PS_MAX_BANDS];
+    Int32 re[PS_HYBRID_LEN], im[PS_HYBRID_LEN];
+    Int32 ref_re[PS_MAX_BANDS], ref_im[PS_MAX_BANDS];
+    Int32 out_re[PS_MAX_BANDS], out_im[PS_MAX_BANDS];
+    HYBRID hybrid;
+
+    memset(&hybrid, 0, sizeof(hybrid));
+    hybrid.pResolution = resolution;
+
+    for (int it = 0; it < ITERATIONS; it++) {
+        int bits = rand_bits(8, 31);
+        rand_fill(re, PS_HYBRID_LEN, bits);
+        rand_fill(im, PS_HYBRID_LEN, bits);
+        hybrid.nQmfBands = rand_bits(1, PS_MAX_BANDS);
+        for (int band = 0; band < PS_MAX_BANDS; band++)
+            resolution[band] = resolutions[rand_bits(0, 2)];
+
+        memset(ref_re, 0x5a, sizeof(ref_re));
+        memset(ref_im, 0x5a, sizeof(ref_im));
+        ps_hybrid_synthesis_c(re, im, ref_re, ref_im, &hybrid);
+        if (impl_enabled[IMPL_SSE2]) {
+            memset(out_re, 0x5a, sizeof(out_re));
+            memset(out_im, 0x5a, sizeof(out_im));
+            ps_hybrid_synthesis_sse2(re, im, out_re, out_im, &hybrid);
+            report("ps_hybrid_synthesis", IMPL_SSE2, hybrid.nQmfBands,
+                   memcmp(ref_re, out_re, sizeof(ref_re)) == 0 &&
+                   memcmp(ref_im, out_im, sizeof(ref_im)) == 0);
+        }
+    }
+}
+
+int main()
+{
+    __builtin_cpu_init();
+    impl_enabled[IMPL_SSE2] = true;
+    impl_enabled[IMPL_SSE41] = __builtin_cpu_supports("sse4.1");
+    impl_enabled[IMPL_AVX2] = __builtin_cpu_supports("avx2");
+    for (int impl = 0; impl < IMPL_COUNT; impl++) {
+        if (!impl_enabled[impl])
+            printf("%s not supported by this cpu, not tested\n", impl_name[impl]);
+    }
+
+    test_imdct_fxp_pre_rotation();
+    test_fft_rx4_long_twiddled();
+    test_fft_rx4_short_twiddled();
+    test_sbr_anafilterbank_window();
+    test_sbr_synfilterbank_window();
+    test_ps_hybrid_synthesis();
+
+    if (failures != 0) {
+        printf("%d mismatches\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
+
+#else
+
+int main()
+{
+    printf("PV_X86_SIMD is not enabled, nothing to test\n");
+    return 0;
+}
+
+#endif // PV_X86_SIMD
@@ -159,16 +159,8 @@ void pvmp3_alias_reduction(int32 *input_buffer,         /* Ptr to spec values of
                            int32  *used_freq_lines,
                            mp3Header *info)
 {
-    int32 *ptr1;
-    int32 *ptr2;
-    int32 *ptr3;
-    int32 *ptr4;
-    const int32 *ptr_csi;
-    const int32 *ptr_csa;
     int32  sblim;
 
-    int32 i, j;
-
     *used_freq_lines = fxp_mul32_Q32(*used_freq_lines << 16, (int32)(0x7FFFFFFF / (float)18 - 1.0f)) >> 15;
 
 
@@ -194,6 +186,24 @@ void pvmp3_alias_reduction(int32 *input_buffer,         /* Ptr to spec values of
 
     }
 
+    pvmp3_alias_butterflies(input_buffer, sblim);
+}
+
+
+#if defined(PV_X86_SIMD)
+void pvmp3_alias_butterflies_c(int32 *input_buffer, int32 sblim)
+#else
+void pvmp3_alias_butterflies(int32 *input_buffer, int32 sblim)
+#endif
+{
+    int32 *ptr1;
+    int32 *ptr2;
+    int32 *ptr3;
+    int32 *ptr4;
+    const int32 *ptr_csi;
+    const int32 *ptr_csa;
+
+    int32 i, j;
 
     ptr3 = &input_buffer[17];
     ptr4 = &input_buffer[18];
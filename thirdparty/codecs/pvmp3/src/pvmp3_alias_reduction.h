@@ -46,6 +46,7 @@
 ----------------------------------------------------------------------------*/
 #include "pvmp3_dec_defs.h"
 #include "pvmp3_audio_type_defs.h"
+#include "pvmp3_x86_simd.h"
 
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -83,6 +84,17 @@ extern "C"
     int32 *used_freq_lines,
     mp3Header *info);
 
+    /* the butterflies between sub-bands 0..sblim, in place */
+    void pvmp3_alias_butterflies(int32 *input_buffer, int32 sblim);
+
+#if defined(PV_X86_SIMD)
+    void pvmp3_alias_butterflies_c(int32 *input_buffer, int32 sblim);
+
+    void pvmp3_alias_butterflies_sse2(int32 *input_buffer, int32 sblim);
+
+    void pvmp3_alias_butterflies_avx2(int32 *input_buffer, int32 sblim);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
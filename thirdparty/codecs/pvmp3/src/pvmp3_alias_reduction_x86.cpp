@@ -0,0 +1,154 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+------------------------------------------------------------------------------
+
+   PacketVideo Corp.
+   MP3 Decoder Library
+
+   Filename: pvmp3_alias_reduction_x86.cpp
+
+------------------------------------------------------------------------------
+ FUNCTION DESCRIPTION
+
+    x86 version of pvmp3_alias_butterflies(), bit-exact with the C version.
+    The 8 butterflies between two sub-bands are independent, so they are
+    computed together, one lane per butterfly: lower sub-band samples are
+    loaded as they are, upper sub-band samples reversed. SSE2 needs two
+    vectors per side, AVX2 one.
+
+------------------------------------------------------------------------------
+*/
+
+#include "pvmp3_alias_reduction.h"
+
+#if defined(PV_X86_SIMD)
+/*----------------------------------------------------------------------------
+; INCLUDES
+----------------------------------------------------------------------------*/
+#include "pvmp3_x86_simd_ops.h"
+#include "pv_mp3dec_fxd_op.h"
+
+/*----------------------------------------------------------------------------
+; DEFINES
+----------------------------------------------------------------------------*/
+#define NUM_BUTTERFLIES 8
+
+#define Q31_fmt(a)    (int32(double(0x7FFFFFFF)*(a)))
+
+/*----------------------------------------------------------------------------
+; LOCAL STORE/BUFFER/POINTER DEFINITIONS
+----------------------------------------------------------------------------*/
+typedef void (*alias_butterflies_func)(int32 *input_buffer, int32 sblim);
+
+/* Same as c_signal and c_alias of pvmp3_alias_reduction.cpp */
+static const int32 c_signal_x86[ NUM_BUTTERFLIES ] =
+{
+    Q31_fmt(0.85749292571254f), Q31_fmt(0.88174199731771f),
+    Q31_fmt(0.94962864910273f), Q31_fmt(0.98331459249179f),
+    Q31_fmt(0.99551781606759f), Q31_fmt(0.99916055817815f),
+    Q31_fmt(0.99989919524445f), Q31_fmt(0.99999315507028f)
+};
+
+static const int32 c_alias_x86[ NUM_BUTTERFLIES ] =
+{
+    Q31_fmt(-0.51449575542753f), Q31_fmt(-0.47173196856497f),
+    Q31_fmt(-0.31337745420390f), Q31_fmt(-0.18191319961098f),
+    Q31_fmt(-0.09457419252642f), Q31_fmt(-0.04096558288530f),
+    Q31_fmt(-0.01419856857247f), Q31_fmt(-0.00369997467376f)
+};
+
+/*----------------------------------------------------------------------------
+; FUNCTION CODE
+----------------------------------------------------------------------------*/
+
+void pvmp3_alias_butterflies_sse2(int32 *input_buffer, int32 sblim)
+{
+    const __m128i csi0 = _mm_loadu_si128((const __m128i *)&c_signal_x86[0]);
+    const __m128i csi1 = _mm_loadu_si128((const __m128i *)&c_signal_x86[4]);
+    const __m128i csa0 = _mm_loadu_si128((const __m128i *)&c_alias_x86[0]);
+    const __m128i csa1 = _mm_loadu_si128((const __m128i *)&c_alias_x86[4]);
+
+    for (int32 sb = 0; sb < sblim; sb++)
+    {
+        /* butterfly k: upper[7 - k] with lower[k] */
+        int32 *upper = &input_buffer[sb*FILTERBANK_BANDS + FILTERBANK_BANDS - NUM_BUTTERFLIES];
+        int32 *lower = &input_buffer[(sb + 1)*FILTERBANK_BANDS];
+
+        __m128i x0 = _mm_loadu_si128((const __m128i *)&upper[4]);
+        __m128i x1 = _mm_loadu_si128((const __m128i *)&upper[0]);
+        __m128i y0 = _mm_loadu_si128((const __m128i *)&lower[0]);
+        __m128i y1 = _mm_loadu_si128((const __m128i *)&lower[4]);
+        x0 = pv_shl<1>(_mm_shuffle_epi32(x0, _MM_SHUFFLE(0, 1, 2, 3)));
+        x1 = pv_shl<1>(_mm_shuffle_epi32(x1, _MM_SHUFFLE(0, 1, 2, 3)));
+        y0 = pv_shl<1>(y0);
+        y1 = pv_shl<1>(y1);
+
+        __m128i u0 = pv_msb(pv_mul<32>(x0, csi0), y0, csa0);
+        __m128i u1 = pv_msb(pv_mul<32>(x1, csi1), y1, csa1);
+        __m128i l0 = pv_mac(pv_mul<32>(y0, csi0), x0, csa0);
+        __m128i l1 = pv_mac(pv_mul<32>(y1, csi1), x1, csa1);
+
+        _mm_storeu_si128((__m128i *)&upper[4], _mm_shuffle_epi32(u0, _MM_SHUFFLE(0, 1, 2, 3)));
+        _mm_storeu_si128((__m128i *)&upper[0], _mm_shuffle_epi32(u1, _MM_SHUFFLE(0, 1, 2, 3)));
+        _mm_storeu_si128((__m128i *)&lower[0], l0);
+        _mm_storeu_si128((__m128i *)&lower[4], l1);
+    }
+}
+
+__attribute__((target("avx2")))
+void pvmp3_alias_butterflies_avx2(int32 *input_buffer, int32 sblim)
+{
+    const __m256i reverse = _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i csi = _mm256_loadu_si256((const __m256i *)c_signal_x86);
+    const __m256i csa = _mm256_loadu_si256((const __m256i *)c_alias_x86);
+
+    for (int32 sb = 0; sb < sblim; sb++)
+    {
+        int32 *upper = &input_buffer[sb*FILTERBANK_BANDS + FILTERBANK_BANDS - NUM_BUTTERFLIES];
+        int32 *lower = &input_buffer[(sb + 1)*FILTERBANK_BANDS];
+
+        __m256i x = _mm256_loadu_si256((const __m256i *)upper);
+        __m256i y = _mm256_loadu_si256((const __m256i *)lower);
+        x = pv_shl<1>(_mm256_permutevar8x32_epi32(x, reverse));
+        y = pv_shl<1>(y);
+
+        __m256i u = pv_msb(pv_mul<32>(x, csi), y, csa);
+        __m256i l = pv_mac(pv_mul<32>(y, csi), x, csa);
+
+        _mm256_storeu_si256((__m256i *)upper, _mm256_permutevar8x32_epi32(u, reverse));
+        _mm256_storeu_si256((__m256i *)lower, l);
+    }
+}
+
+static alias_butterflies_func alias_butterflies_select()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return pvmp3_alias_butterflies_avx2;
+    return pvmp3_alias_butterflies_sse2;
+}
+
+static const alias_butterflies_func alias_butterflies_impl = alias_butterflies_select();
+
+void pvmp3_alias_butterflies(int32 *input_buffer, int32 sblim)
+{
+    alias_butterflies_impl(input_buffer, sblim);
+}
+
+#endif // PV_X86_SIMD
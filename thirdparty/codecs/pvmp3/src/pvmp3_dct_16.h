@@ -46,6 +46,7 @@
 ; INCLUDES
 ----------------------------------------------------------------------------*/
 #include "pvmp3_audio_type_defs.h"
+#include "pvmp3_x86_simd.h"
 
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -84,6 +85,17 @@ extern "C"
 
     void pvmp3_split(int32 *vect);
 
+    /* split, dct_16 of both halves and merge of consecutive blocks of 32 samples */
+    void pvmp3_dct_32_blocks(int32 vec[], int32 blocks);
+
+#if defined(PV_X86_SIMD)
+    void pvmp3_dct_32_blocks_c(int32 vec[], int32 blocks);
+
+    void pvmp3_dct_32_blocks_sse2(int32 vec[], int32 blocks);
+
+    void pvmp3_dct_32_blocks_avx2(int32 vec[], int32 blocks);
+#endif
+
 
 #ifdef __cplusplus
 }
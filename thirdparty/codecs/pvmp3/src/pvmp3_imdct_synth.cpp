@@ -57,6 +57,10 @@
     The number of windowed samples is 12 for short blocks, and 36 for long
     blocks
 
+    Every band is transformed on its own, so the long blocks of all bands
+    sharing a window, and the three short blocks of a band, are handed to
+    pvmp3_mdct_18_bands() and pvmp3_mdct_6_blocks() together
+
 Windowing
 
     Depending on window_switching_flag[gr][ch], block_type[gr][ch] and
@@ -213,6 +217,32 @@ const int32 short_win[12] =
 ; FUNCTION CODE
 ----------------------------------------------------------------------------*/
 
+#if defined(PV_X86_SIMD)
+void pvmp3_mdct_18_bands_c(int32 vec[], int32 *history, const int32 *window, int32 bands)
+#else
+void pvmp3_mdct_18_bands(int32 vec[], int32 *history, const int32 *window, int32 bands)
+#endif
+{
+    for (int32 band = 0; band < bands; band++)
+    {
+        pvmp3_mdct_18(&vec[band*FILTERBANK_BANDS], &history[band*FILTERBANK_BANDS], window);
+    }
+}
+
+
+#if defined(PV_X86_SIMD)
+void pvmp3_mdct_6_blocks_c(int32 vec[], int32 *overlap, int32 blocks)
+#else
+void pvmp3_mdct_6_blocks(int32 vec[], int32 *overlap, int32 blocks)
+#endif
+{
+    for (int32 block = 0; block < blocks; block++)
+    {
+        pvmp3_mdct_6(&vec[block*6], &overlap[block*6]);
+    }
+}
+
+
 void pvmp3_imdct_synth(int32  in[SUBBANDS_NUMBER*FILTERBANK_BANDS],
                        int32  overlap[SUBBANDS_NUMBER*FILTERBANK_BANDS],
                        uint32 blk_type,
@@ -235,6 +265,40 @@ void pvmp3_imdct_synth(int32  in[SUBBANDS_NUMBER*FILTERBANK_BANDS],
      *  long transforms
      */
 
+    int32 long_bands = (blk_type == LONG) ? bands2process : mx_band;
+    const int32 *window = NULL;
+
+    if (long_bands > bands2process)
+    {
+        long_bands = bands2process;
+    }
+    if (long_bands > 0)
+    {
+        pvmp3_mdct_18_bands(in, overlap, normal_win, long_bands);
+    }
+    else
+    {
+        long_bands = 0;
+    }
+
+    switch (blk_type)
+    {
+        case START:
+            window = start_win;
+            break;
+        case STOP:
+            window = stop_win;
+            break;
+    }
+
+    if (window != NULL && long_bands < bands2process)
+    {
+        pvmp3_mdct_18_bands(in      + (long_bands * FILTERBANK_BANDS),
+                            overlap + (long_bands * FILTERBANK_BANDS),
+                            window,
+                            bands2process - long_bands);
+    }
+
 
     for (band = 0; band < bands2process; band++)
     {
@@ -246,20 +310,10 @@ void pvmp3_imdct_synth(int32  in[SUBBANDS_NUMBER*FILTERBANK_BANDS],
         switch (current_blk_type)
         {
             case LONG:
-
-                pvmp3_mdct_18(out, history, normal_win);
-
-                break;
-
             case START:
-
-                pvmp3_mdct_18(out, history, start_win);
-
-                break;
-
             case STOP:
 
-                pvmp3_mdct_18(out, history, stop_win);
+                /* transformed above */
 
                 break;
 
@@ -275,9 +329,7 @@ void pvmp3_imdct_synth(int32  in[SUBBANDS_NUMBER*FILTERBANK_BANDS],
                     Scratch_mem[12 +i] = out[(i*3) + 2];
                 }
 
-                pvmp3_mdct_6(&Scratch_mem[ 0], &tmp_prev_ovr[ 0]);
-                pvmp3_mdct_6(&Scratch_mem[ 6], &tmp_prev_ovr[ 6]);
-                pvmp3_mdct_6(&Scratch_mem[12], &tmp_prev_ovr[12]);
+                pvmp3_mdct_6_blocks(Scratch_mem, tmp_prev_ovr, 3);
 
                 for (i = 0; i < 6; i++)
                 {
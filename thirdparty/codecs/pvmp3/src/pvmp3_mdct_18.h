@@ -49,6 +49,7 @@
 ; INCLUDES
 ----------------------------------------------------------------------------*/
 #include "pvmp3_audio_type_defs.h"
+#include "pvmp3_x86_simd.h"
 
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -91,6 +92,17 @@ extern "C"
 
     void pvmp3_mdct_18(int32 vec[], int32 *history, const int32 *window);
 
+    /* pvmp3_mdct_18() of consecutive sub-bands sharing the same window */
+    void pvmp3_mdct_18_bands(int32 vec[], int32 *history, const int32 *window, int32 bands);
+
+#if defined(PV_X86_SIMD)
+    void pvmp3_mdct_18_bands_c(int32 vec[], int32 *history, const int32 *window, int32 bands);
+
+    void pvmp3_mdct_18_bands_sse2(int32 vec[], int32 *history, const int32 *window, int32 bands);
+
+    void pvmp3_mdct_18_bands_avx2(int32 vec[], int32 *history, const int32 *window, int32 bands);
+#endif
+
     void pvmp3_dct_9(int32 vec[]);
 
     void pvmp3_mdct_6(int32 vec[], int32 *overlap);
@@ -49,6 +49,7 @@
 ; INCLUDES
 ----------------------------------------------------------------------------*/
 #include "pvmp3_audio_type_defs.h"
+#include "pvmp3_x86_simd.h"
 
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -92,6 +93,17 @@ extern "C"
 
     void pvmp3_mdct_6(int32 vec[], int32 *overlap);
 
+    /* pvmp3_mdct_6() of consecutive blocks of 6 samples and their overlap */
+    void pvmp3_mdct_6_blocks(int32 vec[], int32 *overlap, int32 blocks);
+
+#if defined(PV_X86_SIMD)
+    void pvmp3_mdct_6_blocks_c(int32 vec[], int32 *overlap, int32 blocks);
+
+    void pvmp3_mdct_6_blocks_sse2(int32 vec[], int32 *overlap, int32 blocks);
+
+    void pvmp3_mdct_6_blocks_avx2(int32 vec[], int32 *overlap, int32 blocks);
+#endif
+
     void pvmp3_dct_6(int32 vec[]);
 
 #ifdef __cplusplus
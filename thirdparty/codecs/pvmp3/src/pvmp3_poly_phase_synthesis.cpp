@@ -119,6 +119,26 @@
 ; FUNCTION CODE
 ----------------------------------------------------------------------------*/
 
+#if defined(PV_X86_SIMD)
+void pvmp3_dct_32_blocks_c(int32 vec[], int32 blocks)
+#else
+void pvmp3_dct_32_blocks(int32 vec[], int32 blocks)
+#endif
+{
+    for (int32 block = 0; block < blocks; block++)
+    {
+        int32 *inData = &vec[block*SUBBANDS_NUMBER];
+
+        pvmp3_split(&inData[16]);
+
+        pvmp3_dct_16(&inData[16], 0);
+        pvmp3_dct_16(inData, 1);     // Even terms
+
+        pvmp3_merge_in_place_N32(inData);
+    }
+}
+
+
 void pvmp3_poly_phase_synthesis(tmp3dec_chan   *pChVars,
                                 int32          numChannels,
                                 e_equalization equalizerType,
@@ -135,20 +155,17 @@ void pvmp3_poly_phase_synthesis(tmp3dec_chan   *pChVars,
     int16 * ptr_out = outPcm;
 
 
-    for (int32  band = 0; band < FILTERBANK_BANDS; band += 2)
-    {
-        int32 *inData  = &pChVars->circ_buffer[544 - (band<<5)];
-
-        /*
-         *   DCT 32
-         */
+    /*
+     *   DCT 32 of all the time slots first, each one only touches its own
+     *   32 samples and the window only reads slots already transformed
+     */
 
-        pvmp3_split(&inData[16]);
+    pvmp3_dct_32_blocks(pChVars->circ_buffer, FILTERBANK_BANDS);
 
-        pvmp3_dct_16(&inData[16], 0);
-        pvmp3_dct_16(inData, 1);     // Even terms
 
-        pvmp3_merge_in_place_N32(inData);
+    for (int32  band = 0; band < FILTERBANK_BANDS; band += 2)
+    {
+        int32 *inData  = &pChVars->circ_buffer[544 - (band<<5)];
 
         pvmp3_polyphase_filter_window(inData,
                                       ptr_out,
@@ -156,17 +173,6 @@ void pvmp3_poly_phase_synthesis(tmp3dec_chan   *pChVars,
 
         inData  -= SUBBANDS_NUMBER;
 
-        /*
-         *   DCT 32
-         */
-
-        pvmp3_split(&inData[16]);
-
-        pvmp3_dct_16(&inData[16], 0);
-        pvmp3_dct_16(inData, 1);     // Even terms
-
-        pvmp3_merge_in_place_N32(inData);
-
         pvmp3_polyphase_filter_window(inData,
                                       ptr_out + (numChannels << 5),
                                       numChannels);
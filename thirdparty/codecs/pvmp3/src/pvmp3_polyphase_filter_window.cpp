@@ -112,9 +112,15 @@ Input
 ; FUNCTION CODE
 ----------------------------------------------------------------------------*/
 
+#if defined(PV_X86_SIMD)
+void pvmp3_polyphase_filter_window_c(int32 *synth_buffer,
+                                     int16 *outPcm,
+                                     int32 numChannels)
+#else
 void pvmp3_polyphase_filter_window(int32 *synth_buffer,
                                    int16 *outPcm,
                                    int32 numChannels)
+#endif
 {
     int32 sum1;
     int32 sum2;
@@ -47,6 +47,7 @@
 
 #include "pvmp3_audio_type_defs.h"
 #include "s_tmp3dec_chan.h"
+#include "pvmp3_x86_simd.h"
 
 /*----------------------------------------------------------------------------
 ; MACROS
@@ -59,6 +60,7 @@
 ----------------------------------------------------------------------------*/
 #define MAX_16BITS_INT  0x7FFF
 
+
 /*----------------------------------------------------------------------------
 ; EXTERNAL VARIABLES REFERENCES
 ; Declare variables used in this module but defined elsewhere
@@ -122,6 +124,20 @@ extern "C"
                                        int16 *outPcm,
                                        int32 numChannels);
 
+#if defined(PV_X86_SIMD)
+    void pvmp3_polyphase_filter_window_c(int32 *synth_buffer,
+                                         int16 *outPcm,
+                                         int32 numChannels);
+
+    void pvmp3_polyphase_filter_window_sse2(int32 *synth_buffer,
+                                            int16 *outPcm,
+                                            int32 numChannels);
+
+    void pvmp3_polyphase_filter_window_avx2(int32 *synth_buffer,
+                                            int16 *outPcm,
+                                            int32 numChannels);
+#endif
+
 
 #ifdef __cplusplus
 }
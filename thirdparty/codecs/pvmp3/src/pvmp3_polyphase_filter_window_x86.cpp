@@ -0,0 +1,258 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+------------------------------------------------------------------------------
+
+   PacketVideo Corp.
+   MP3 Decoder Library
+
+   Filename: pvmp3_polyphase_filter_window_x86.cpp
+
+------------------------------------------------------------------------------
+ FUNCTION DESCRIPTION
+
+    x86 version of pvmp3_polyphase_filter_window(), bit-exact with the C
+    version. Outputs 1..15 of both halves are computed 4 (SSE2) or 8 (AVX2)
+    at a time, one lane per j, with a transposed copy of pqmfSynthWin so
+    that the coefficients of adjacent lanes are contiguous. Every product
+    is truncated to its high 32 bits before accumulating, exactly like
+    fxp_mac32_Q32, so the order of accumulation doesn't change the result.
+
+    AVX2 is used when the CPU supports it, otherwise SSE2, which is always
+    available on x86-64. Both are exported for test/pvmp3_x86_simd_test.cpp.
+
+------------------------------------------------------------------------------
+*/
+
+#include "pvmp3_polyphase_filter_window.h"
+
+#if defined(PV_X86_SIMD)
+/*----------------------------------------------------------------------------
+; INCLUDES
+----------------------------------------------------------------------------*/
+#include "pvmp3_x86_simd_ops.h"
+#include "pv_mp3dec_fxd_op.h"
+#include "pvmp3_dec_defs.h"
+#include "pvmp3_tables.h"
+
+/*----------------------------------------------------------------------------
+; DEFINES
+----------------------------------------------------------------------------*/
+#define WINDOW_TAPS   16
+#define WINDOW_LANES  16    /* j = 1..15, and a zero lane for j = 16 */
+
+/*----------------------------------------------------------------------------
+; LOCAL STORE/BUFFER/POINTER DEFINITIONS
+----------------------------------------------------------------------------*/
+typedef void (*polyphase_filter_window_func)(int32 *synth_buffer,
+        int16 *outPcm,
+        int32 numChannels);
+
+/* pqmfSynthWin[(j-1)*16 + tap] stored as [tap][j-1] */
+struct pqmf_synth_win_transposed
+{
+    int32 coef[WINDOW_TAPS][WINDOW_LANES];
+
+    pqmf_synth_win_transposed()
+    {
+        for (int32 tap = 0; tap < WINDOW_TAPS; tap++)
+        {
+            for (int32 lane = 0; lane < WINDOW_LANES; lane++)
+            {
+                coef[tap][lane] = (lane < SUBBANDS_NUMBER / 2 - 1) ?
+                                  pqmfSynthWin[lane*WINDOW_TAPS + tap] : 0;
+            }
+        }
+    }
+};
+
+static const pqmf_synth_win_transposed pqmfSynthWinT;
+
+/*----------------------------------------------------------------------------
+; LOCAL FUNCTION DEFINITIONS
+----------------------------------------------------------------------------*/
+
+/* j = 0 and j = 16, the same as the tail of the C version */
+static void polyphase_filter_window_edges(int32 *synth_buffer,
+        int16 *outPcm,
+        int32 numChannels)
+{
+    const int32 *winPtr = &pqmfSynthWin[(SUBBANDS_NUMBER/2 - 1) * WINDOW_TAPS];
+    int32 sum1 = 0x00000020;
+    int32 sum2 = 0x00000020;
+
+    for (int32 i = 16; i < HAN_SIZE + 16; i += (SUBBANDS_NUMBER << 2))
+    {
+        int32 *pt_synth = &synth_buffer[i];
+        int32 temp1 = pt_synth[ 0                ];
+        int32 temp2 = pt_synth[ SUBBANDS_NUMBER  ];
+        int32 temp3 = pt_synth[ SUBBANDS_NUMBER/2];
+
+        sum1 = fxp_mac32_Q32(sum1, temp1, winPtr[0]) ;
+        sum1 = fxp_mac32_Q32(sum1, temp2, winPtr[1]) ;
+        sum2 = fxp_mac32_Q32(sum2, temp3, winPtr[2]) ;
+
+        temp1 = pt_synth[ SUBBANDS_NUMBER<<1 ];
+        temp2 = pt_synth[ 3*SUBBANDS_NUMBER  ];
+        temp3 = pt_synth[ SUBBANDS_NUMBER*5/2];
+
+        sum1 = fxp_mac32_Q32(sum1, temp1, winPtr[3]) ;
+        sum1 = fxp_mac32_Q32(sum1, temp2, winPtr[4]) ;
+        sum2 = fxp_mac32_Q32(sum2, temp3, winPtr[5]) ;
+
+        winPtr += 6;
+    }
+
+    outPcm[0] = saturate16(sum1 >> 6);
+    outPcm[(SUBBANDS_NUMBER/2)<<(numChannels-1)] = saturate16(sum2 >> 6);
+}
+
+/* Scatter saturated outputs of lanes j0..j0+n-1, skipping j = 16 */
+static inline void polyphase_filter_window_store(const int32 *sum1,
+        const int32 *sum2,
+        int32 j0,
+        int32 n,
+        int16 *outPcm,
+        int32 numChannels)
+{
+    for (int32 lane = 0; lane < n && j0 + lane < SUBBANDS_NUMBER / 2; lane++)
+    {
+        int32 k = (j0 + lane) << (numChannels - 1);
+        outPcm[k] = saturate16(sum1[lane] >> 6);
+        outPcm[(numChannels<<5) - k] = saturate16(sum2[lane] >> 6);
+    }
+}
+
+/*----------------------------------------------------------------------------
+; FUNCTION CODE
+----------------------------------------------------------------------------*/
+
+void pvmp3_polyphase_filter_window_sse2(int32 *synth_buffer,
+        int16 *outPcm,
+        int32 numChannels)
+{
+    int32 out1[4], out2[4];
+
+    for (int32 j0 = 1; j0 < SUBBANDS_NUMBER / 2; j0 += 4)
+    {
+        /* lane l: pt_1 = &synth_buffer[16 + j0 + l], pt_2 = &synth_buffer[16 - j0 - l] */
+        const int32 *pt_1 = &synth_buffer[16 + j0];
+        const int32 *pt_2 = &synth_buffer[16 - j0 - 3];
+        const int32 *win = &pqmfSynthWinT.coef[0][j0 - 1];
+        __m128i sum1 = _mm_set1_epi32(0x00000020);
+        __m128i sum2 = _mm_set1_epi32(0x00000020);
+
+        for (int32 q = 0; q < 4; q++)
+        {
+            __m128i temp1 = _mm_loadu_si128((const __m128i *)&pt_1[SUBBANDS_NUMBER*(2*q)]);
+            __m128i temp4 = _mm_loadu_si128((const __m128i *)&pt_1[SUBBANDS_NUMBER*(14 - 2*q)]);
+            __m128i temp3 = _mm_loadu_si128((const __m128i *)&pt_2[SUBBANDS_NUMBER*(15 - 2*q)]);
+            __m128i temp2 = _mm_loadu_si128((const __m128i *)&pt_2[SUBBANDS_NUMBER*(2*q + 1)]);
+            temp3 = _mm_shuffle_epi32(temp3, _MM_SHUFFLE(0, 1, 2, 3));
+            temp2 = _mm_shuffle_epi32(temp2, _MM_SHUFFLE(0, 1, 2, 3));
+
+            __m128i w0 = _mm_loadu_si128((const __m128i *)&win[(4*q + 0)*WINDOW_LANES]);
+            __m128i w1 = _mm_loadu_si128((const __m128i *)&win[(4*q + 1)*WINDOW_LANES]);
+            __m128i w2 = _mm_loadu_si128((const __m128i *)&win[(4*q + 2)*WINDOW_LANES]);
+            __m128i w3 = _mm_loadu_si128((const __m128i *)&win[(4*q + 3)*WINDOW_LANES]);
+
+            sum1 = _mm_add_epi32(sum1, pv_mul<32>(temp1, w0));
+            sum2 = _mm_add_epi32(sum2, pv_mul<32>(temp3, w0));
+            sum2 = _mm_add_epi32(sum2, pv_mul<32>(temp1, w1));
+            sum1 = _mm_sub_epi32(sum1, pv_mul<32>(temp3, w1));
+            sum1 = _mm_add_epi32(sum1, pv_mul<32>(temp2, w2));
+            sum2 = _mm_sub_epi32(sum2, pv_mul<32>(temp4, w2));
+            sum2 = _mm_add_epi32(sum2, pv_mul<32>(temp2, w3));
+            sum1 = _mm_add_epi32(sum1, pv_mul<32>(temp4, w3));
+        }
+
+        _mm_storeu_si128((__m128i *)out1, sum1);
+        _mm_storeu_si128((__m128i *)out2, sum2);
+        polyphase_filter_window_store(out1, out2, j0, 4, outPcm, numChannels);
+    }
+
+    polyphase_filter_window_edges(synth_buffer, outPcm, numChannels);
+}
+
+__attribute__((target("avx2")))
+void pvmp3_polyphase_filter_window_avx2(int32 *synth_buffer,
+        int16 *outPcm,
+        int32 numChannels)
+{
+    const __m256i reverse = _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    int32 out1[8], out2[8];
+
+    for (int32 j0 = 1; j0 < SUBBANDS_NUMBER / 2; j0 += 8)
+    {
+        const int32 *pt_1 = &synth_buffer[16 + j0];
+        const int32 *pt_2 = &synth_buffer[16 - j0 - 7];
+        const int32 *win = &pqmfSynthWinT.coef[0][j0 - 1];
+        __m256i sum1 = _mm256_set1_epi32(0x00000020);
+        __m256i sum2 = _mm256_set1_epi32(0x00000020);
+
+        for (int32 q = 0; q < 4; q++)
+        {
+            __m256i temp1 = _mm256_loadu_si256((const __m256i *)&pt_1[SUBBANDS_NUMBER*(2*q)]);
+            __m256i temp4 = _mm256_loadu_si256((const __m256i *)&pt_1[SUBBANDS_NUMBER*(14 - 2*q)]);
+            __m256i temp3 = _mm256_loadu_si256((const __m256i *)&pt_2[SUBBANDS_NUMBER*(15 - 2*q)]);
+            __m256i temp2 = _mm256_loadu_si256((const __m256i *)&pt_2[SUBBANDS_NUMBER*(2*q + 1)]);
+            temp3 = _mm256_permutevar8x32_epi32(temp3, reverse);
+            temp2 = _mm256_permutevar8x32_epi32(temp2, reverse);
+
+            __m256i w0 = _mm256_loadu_si256((const __m256i *)&win[(4*q + 0)*WINDOW_LANES]);
+            __m256i w1 = _mm256_loadu_si256((const __m256i *)&win[(4*q + 1)*WINDOW_LANES]);
+            __m256i w2 = _mm256_loadu_si256((const __m256i *)&win[(4*q + 2)*WINDOW_LANES]);
+            __m256i w3 = _mm256_loadu_si256((const __m256i *)&win[(4*q + 3)*WINDOW_LANES]);
+
+            sum1 = _mm256_add_epi32(sum1, pv_mul<32>(temp1, w0));
+            sum2 = _mm256_add_epi32(sum2, pv_mul<32>(temp3, w0));
+            sum2 = _mm256_add_epi32(sum2, pv_mul<32>(temp1, w1));
+            sum1 = _mm256_sub_epi32(sum1, pv_mul<32>(temp3, w1));
+            sum1 = _mm256_add_epi32(sum1, pv_mul<32>(temp2, w2));
+            sum2 = _mm256_sub_epi32(sum2, pv_mul<32>(temp4, w2));
+            sum2 = _mm256_add_epi32(sum2, pv_mul<32>(temp2, w3));
+            sum1 = _mm256_add_epi32(sum1, pv_mul<32>(temp4, w3));
+        }
+
+        _mm256_storeu_si256((__m256i *)out1, sum1);
+        _mm256_storeu_si256((__m256i *)out2, sum2);
+        polyphase_filter_window_store(out1, out2, j0, 8, outPcm, numChannels);
+    }
+
+    polyphase_filter_window_edges(synth_buffer, outPcm, numChannels);
+}
+
+static polyphase_filter_window_func polyphase_filter_window_select()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return pvmp3_polyphase_filter_window_avx2;
+    return pvmp3_polyphase_filter_window_sse2;
+}
+
+static const polyphase_filter_window_func polyphase_filter_window_impl =
+    polyphase_filter_window_select();
+
+void pvmp3_polyphase_filter_window(int32 *synth_buffer,
+                                   int16 *outPcm,
+                                   int32 numChannels)
+{
+    polyphase_filter_window_impl(synth_buffer, outPcm, numChannels);
+}
+
+#endif // PV_X86_SIMD
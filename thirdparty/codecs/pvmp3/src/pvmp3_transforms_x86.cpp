@@ -0,0 +1,215 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+------------------------------------------------------------------------------
+
+   PacketVideo Corp.
+   MP3 Decoder Library
+
+   Filename: pvmp3_transforms_x86.cpp
+
+------------------------------------------------------------------------------
+ FUNCTION DESCRIPTION
+
+    x86 versions of pvmp3_mdct_18_bands(), pvmp3_mdct_6_blocks() and
+    pvmp3_dct_32_blocks(), bit-exact with the C versions.
+
+    The transforms are short butterfly networks with little parallelism
+    inside one block, but the blocks of a granule are independent: the
+    long IMDCT of every sub-band, the 3 short IMDCTs of a sub-band and the
+    DCT32 of every time slot. So each lane works on its own block, 4 blocks
+    at a time with SSE2 or 8 with AVX2, transposed in and out of the lanes.
+
+    The kernels are in pvmp3_transforms_x86_impl.h, compiled once for SSE2
+    and once for AVX2. AVX2 is used when the CPU supports it.
+
+------------------------------------------------------------------------------
+*/
+
+#include "pvmp3_mdct_18.h"
+#include "pvmp3_mdct_6.h"
+#include "pvmp3_dct_16.h"
+
+#if defined(PV_X86_SIMD)
+/*----------------------------------------------------------------------------
+; INCLUDES
+----------------------------------------------------------------------------*/
+#include "pvmp3_x86_simd_ops.h"
+#include "pv_mp3dec_fxd_op.h"
+#include "pvmp3_dec_defs.h"
+
+/*----------------------------------------------------------------------------
+; DEFINES
+----------------------------------------------------------------------------*/
+
+/* pvmp3_dct_9.cpp */
+#define Qfmt31(a)   (int32)((a)*(0x7FFFFFFF))
+
+#define cos_pi_9      Qfmt31( 0.93969262078591f)
+#define cos_2pi_9     Qfmt31( 0.76604444311898f)
+#define cos_4pi_9     Qfmt31( 0.17364817766693f)
+#define cos_5pi_9     Qfmt31(-0.17364817766693f)
+#define cos_7pi_9     Qfmt31(-0.76604444311898f)
+#define cos_8pi_9     Qfmt31(-0.93969262078591f)
+#define cos_pi_6_q31  Qfmt31( 0.86602540378444f)
+#define cos_5pi_6     Qfmt31(-0.86602540378444f)
+#define cos_5pi_18    Qfmt31( 0.64278760968654f)
+#define cos_7pi_18    Qfmt31( 0.34202014332567f)
+#define cos_11pi_18   Qfmt31(-0.34202014332567f)
+#define cos_13pi_18   Qfmt31(-0.64278760968654f)
+#define cos_17pi_18   Qfmt31(-0.98480775301221f)
+
+/* pvmp3_dct_6.cpp */
+#define Qfmt30(a)   (Int32)((a)*((Int32)1<<30) + ((a)>=0?0.5F:-0.5F))
+
+#define cos_pi_6_q30  Qfmt30(  0.86602540378444f)
+#define cos_7_pi_12   Qfmt30( -0.25881904510252f)
+#define cos_3_pi_12   Qfmt30(  0.70710678118655f)
+#define cos_11_pi_12  Qfmt30( -0.96592582628907f)
+
+/* pvmp3_mdct_6.cpp */
+#define Qfmt29(a)   (int32)((a)*((int32)1<<29) + ((a)>=0?0.5F:-0.5F))
+
+/*----------------------------------------------------------------------------
+; LOCAL STORE/BUFFER/POINTER DEFINITIONS
+----------------------------------------------------------------------------*/
+typedef void (*mdct_18_bands_func)(int32 vec[], int32 *history, const int32 *window, int32 bands);
+typedef void (*mdct_6_blocks_func)(int32 vec[], int32 *history, int32 blocks);
+typedef void (*dct_32_blocks_func)(int32 vec[], int32 blocks);
+
+/* Same as the tables of pvmp3_mdct_18.cpp, pvmp3_mdct_6.cpp and pvmp3_dct_16.cpp */
+static const int32 cosTerms_dct18_x86[9] =
+{
+    Qfmt(0.50190991877167f),   Qfmt(0.51763809020504f),   Qfmt(0.55168895948125f),
+    Qfmt(0.61038729438073f),   Qfmt(0.70710678118655f),   Qfmt(0.87172339781055f),
+    Qfmt(1.18310079157625f),   Qfmt(1.93185165257814f),   Qfmt(5.73685662283493f)
+};
+
+static const int32 cosTerms_1_ov_cos_phi_x86[18] =
+{
+    Qfmt1(0.50047634258166f),  Qfmt1(0.50431448029008f),  Qfmt1(0.51213975715725f),
+    Qfmt1(0.52426456257041f),  Qfmt1(0.54119610014620f),  Qfmt1(0.56369097343317f),
+    Qfmt1(0.59284452371708f),  Qfmt1(0.63023620700513f),  Qfmt1(0.67817085245463f),
+    Qfmt2(0.74009361646113f),  Qfmt2(0.82133981585229f),  Qfmt2(0.93057949835179f),
+    Qfmt2(1.08284028510010f),  Qfmt2(1.30656296487638f),  Qfmt2(1.66275476171152f),
+    Qfmt2(2.31011315767265f),  Qfmt2(3.83064878777019f),  Qfmt2(11.46279281302667f)
+};
+
+static const int32 cosTerms_1_ov_cos_phi_N6_x86[6] =
+{
+    Qfmt29(0.50431448029008f),   Qfmt29(0.54119610014620f),
+    Qfmt29(0.63023620700513f),   Qfmt29(0.82133981585229f),
+    Qfmt29(1.30656296487638f),   Qfmt29(3.83064878777019f)
+};
+
+/* the Q27 entries use Qfmt() of pvmp3_dct_16.cpp, which is Qfmt2() here */
+static const int32 CosTable_dct32_x86[16] =
+{
+    Qfmt_31(0.50060299823520F) ,  Qfmt_31(0.50547095989754F) ,
+    Qfmt_31(0.51544730992262F) ,  Qfmt_31(0.53104259108978F) ,
+    Qfmt_31(0.55310389603444F) ,  Qfmt_31(0.58293496820613F) ,
+    Qfmt_31(0.62250412303566F) ,  Qfmt_31(0.67480834145501F) ,
+    Qfmt_31(0.74453627100230F) ,  Qfmt_31(0.83934964541553F) ,
+    Qfmt2(0.97256823786196F) ,  Qfmt2(1.16943993343288F) ,
+    Qfmt2(1.48416461631417F) ,  Qfmt2(2.05778100995341F) ,
+    Qfmt2(3.40760841846872F) ,  Qfmt2(10.19000812354803F)
+};
+
+/* padding for the lanes past the last block */
+static const int32 zero_block[SUBBANDS_NUMBER] = { 0 };
+
+/*----------------------------------------------------------------------------
+; SSE2
+----------------------------------------------------------------------------*/
+#define PV_VEC          __m128i
+#define PV_LANES        4
+#define PV_SIMD(f)      f##_sse2
+#define PV_SET1(x)      _mm_set1_epi32(x)
+#define PV_LOAD(p)      _mm_loadu_si128((const __m128i *)(p))
+#define PV_STORE(p, v)  _mm_storeu_si128((__m128i *)(p), v)
+
+#include "pvmp3_transforms_x86_impl.h"
+
+#undef PV_VEC
+#undef PV_LANES
+#undef PV_SIMD
+#undef PV_SET1
+#undef PV_LOAD
+#undef PV_STORE
+
+/*----------------------------------------------------------------------------
+; AVX2
+----------------------------------------------------------------------------*/
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+#define PV_VEC          __m256i
+#define PV_LANES        8
+#define PV_SIMD(f)      f##_avx2
+#define PV_SET1(x)      _mm256_set1_epi32(x)
+#define PV_LOAD(p)      _mm256_loadu_si256((const __m256i *)(p))
+#define PV_STORE(p, v)  _mm256_storeu_si256((__m256i *)(p), v)
+
+#include "pvmp3_transforms_x86_impl.h"
+
+#undef PV_VEC
+#undef PV_LANES
+#undef PV_SIMD
+#undef PV_SET1
+#undef PV_LOAD
+#undef PV_STORE
+
+#pragma GCC pop_options
+
+/*----------------------------------------------------------------------------
+; FUNCTION CODE
+----------------------------------------------------------------------------*/
+
+static bool transforms_use_avx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+static const bool transforms_avx2 = transforms_use_avx2();
+
+static const mdct_18_bands_func mdct_18_bands_impl =
+    transforms_avx2 ? pvmp3_mdct_18_bands_avx2 : pvmp3_mdct_18_bands_sse2;
+
+static const mdct_6_blocks_func mdct_6_blocks_impl =
+    transforms_avx2 ? pvmp3_mdct_6_blocks_avx2 : pvmp3_mdct_6_blocks_sse2;
+
+static const dct_32_blocks_func dct_32_blocks_impl =
+    transforms_avx2 ? pvmp3_dct_32_blocks_avx2 : pvmp3_dct_32_blocks_sse2;
+
+void pvmp3_mdct_18_bands(int32 vec[], int32 *history, const int32 *window, int32 bands)
+{
+    mdct_18_bands_impl(vec, history, window, bands);
+}
+
+void pvmp3_mdct_6_blocks(int32 vec[], int32 *history, int32 blocks)
+{
+    mdct_6_blocks_impl(vec, history, blocks);
+}
+
+void pvmp3_dct_32_blocks(int32 vec[], int32 blocks)
+{
+    dct_32_blocks_impl(vec, blocks);
+}
+
+#endif // PV_X86_SIMD
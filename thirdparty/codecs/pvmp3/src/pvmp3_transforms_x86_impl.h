@@ -0,0 +1,581 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+------------------------------------------------------------------------------
+   PacketVideo Corp.
+   MP3 Decoder Library
+
+   Filename: pvmp3_transforms_x86_impl.h
+
+------------------------------------------------------------------------------
+ INCLUDE DESCRIPTION
+
+ Body of the x86 transforms, included by pvmp3_transforms_x86.cpp once per
+ instruction set (no include guard on purpose) with:
+
+    PV_VEC        vector type, one int32 lane per block
+    PV_LANES      number of lanes of PV_VEC
+    PV_SIMD(f)    name of f for this instruction set
+    PV_SET1(x)    broadcast x to all lanes
+    PV_LOAD(p)    load PV_LANES samples from p
+    PV_STORE(p,v) store v to p
+
+ Each transform is the statement by statement image of its C version, with
+ vectors in place of samples, so every lane computes exactly what the C
+ version computes for its block.
+
+------------------------------------------------------------------------------
+*/
+
+/*----------------------------------------------------------------------------
+; LOCAL FUNCTION DEFINITIONS
+----------------------------------------------------------------------------*/
+
+/* v[e] lane l = src[l*len + e], lanes l >= n are zero */
+static inline void PV_SIMD(gather)(PV_VEC v[], const int32 *src, int32 len, int32 n)
+{
+    const int32 *row[PV_LANES];
+    int32 e = 0;
+
+    for (int32 l = 0; l < PV_LANES; l++)
+    {
+        row[l] = (l < n) ? &src[l*len] : zero_block;
+    }
+
+    for (; e + PV_LANES <= len; e += PV_LANES)
+    {
+        PV_VEC r[PV_LANES];
+        for (int32 l = 0; l < PV_LANES; l++)
+        {
+            r[l] = PV_LOAD(&row[l][e]);
+        }
+        pv_transpose(r);
+        for (int32 l = 0; l < PV_LANES; l++)
+        {
+            v[e + l] = r[l];
+        }
+    }
+
+    for (; e < len; e++)
+    {
+        int32 lane[PV_LANES];
+        for (int32 l = 0; l < PV_LANES; l++)
+        {
+            lane[l] = row[l][e];
+        }
+        v[e] = PV_LOAD(lane);
+    }
+}
+
+/* dst[l*len + e] = v[e] lane l, for lanes l < n */
+static inline void PV_SIMD(scatter)(int32 *dst, const PV_VEC v[], int32 len, int32 n)
+{
+    int32 e = 0;
+
+    for (; e + PV_LANES <= len; e += PV_LANES)
+    {
+        PV_VEC r[PV_LANES];
+        for (int32 l = 0; l < PV_LANES; l++)
+        {
+            r[l] = v[e + l];
+        }
+        pv_transpose(r);
+        for (int32 l = 0; l < PV_LANES && l < n; l++)
+        {
+            PV_STORE(&dst[l*len + e], r[l]);
+        }
+    }
+
+    for (; e < len; e++)
+    {
+        int32 lane[PV_LANES];
+        PV_STORE(lane, v[e]);
+        for (int32 l = 0; l < PV_LANES && l < n; l++)
+        {
+            dst[l*len + e] = lane[l];
+        }
+    }
+}
+
+/* pvmp3_dct_9() */
+static inline void PV_SIMD(dct_9)(PV_VEC vec[])
+{
+    PV_VEC tmp0 = pv_add(vec[8], vec[0]);
+    PV_VEC tmp8 = pv_sub(vec[8], vec[0]);
+    PV_VEC tmp1 = pv_add(vec[7], vec[1]);
+    PV_VEC tmp7 = pv_sub(vec[7], vec[1]);
+    PV_VEC tmp2 = pv_add(vec[6], vec[2]);
+    PV_VEC tmp6 = pv_sub(vec[6], vec[2]);
+    PV_VEC tmp3 = pv_add(vec[5], vec[3]);
+    PV_VEC tmp5 = pv_sub(vec[5], vec[3]);
+    PV_VEC even = pv_add(pv_add(tmp0, tmp2), tmp3);
+    PV_VEC odd  = pv_add(tmp1, vec[4]);
+
+    vec[0]  = pv_add(even, odd);
+    vec[6]  = pv_sub(pv_sar<1>(even), odd);
+    vec[2]  = pv_sub(pv_sar<1>(tmp1), vec[4]);
+    vec[4]  = pv_neg(vec[2]);
+    vec[8]  = pv_neg(vec[2]);
+
+    tmp0 = pv_shl<1>(tmp0);
+    tmp2 = pv_shl<1>(tmp2);
+    tmp3 = pv_shl<1>(tmp3);
+    vec[4]  = pv_mac(vec[4], tmp0, PV_SET1(cos_2pi_9));
+    vec[8]  = pv_mac(vec[8], tmp0, PV_SET1(cos_4pi_9));
+    vec[2]  = pv_mac(vec[2], tmp0, PV_SET1(cos_pi_9));
+    vec[2]  = pv_mac(vec[2], tmp2, PV_SET1(cos_5pi_9));
+    vec[4]  = pv_mac(vec[4], tmp2, PV_SET1(cos_8pi_9));
+    vec[8]  = pv_mac(vec[8], tmp2, PV_SET1(cos_2pi_9));
+    vec[8]  = pv_mac(vec[8], tmp3, PV_SET1(cos_8pi_9));
+    vec[4]  = pv_mac(vec[4], tmp3, PV_SET1(cos_4pi_9));
+    vec[2]  = pv_mac(vec[2], tmp3, PV_SET1(cos_7pi_9));
+
+    PV_VEC tmp568 = pv_shl<1>(pv_sub(pv_add(tmp5, tmp6), tmp8));
+    tmp5 = pv_shl<1>(tmp5);
+    tmp6 = pv_shl<1>(tmp6);
+    tmp7 = pv_shl<1>(tmp7);
+    tmp8 = pv_shl<1>(tmp8);
+    vec[1]  = pv_mul<32>(tmp5, PV_SET1(cos_11pi_18));
+    vec[1]  = pv_mac(vec[1], tmp6, PV_SET1(cos_13pi_18));
+    vec[1]  = pv_mac(vec[1], tmp7, PV_SET1(cos_5pi_6));
+    vec[1]  = pv_mac(vec[1], tmp8, PV_SET1(cos_17pi_18));
+    vec[3]  = pv_mul<32>(tmp568, PV_SET1(cos_pi_6_q31));
+    vec[5]  = pv_mul<32>(tmp5, PV_SET1(cos_17pi_18));
+    vec[5]  = pv_mac(vec[5], tmp6, PV_SET1(cos_7pi_18));
+    vec[5]  = pv_mac(vec[5], tmp7, PV_SET1(cos_pi_6_q31));
+    vec[5]  = pv_mac(vec[5], tmp8, PV_SET1(cos_13pi_18));
+    vec[7]  = pv_mul<32>(tmp5, PV_SET1(cos_5pi_18));
+    vec[7]  = pv_mac(vec[7], tmp6, PV_SET1(cos_17pi_18));
+    vec[7]  = pv_mac(vec[7], tmp7, PV_SET1(cos_pi_6_q31));
+    vec[7]  = pv_mac(vec[7], tmp8, PV_SET1(cos_11pi_18));
+}
+
+/* pvmp3_mdct_18() */
+static inline void PV_SIMD(mdct_18)(PV_VEC vec[], PV_VEC history[], const int32 *window)
+{
+    PV_VEC tmp, tmp1, tmp2, tmp3, tmp4;
+    int32 i;
+
+    for (i = 0; i < 9; i++)
+    {
+        tmp  = pv_mul<32>(pv_shl<1>(vec[i]), PV_SET1(cosTerms_1_ov_cos_phi_x86[i]));
+        tmp1 = pv_mul<27>(vec[17 - i], PV_SET1(cosTerms_1_ov_cos_phi_x86[17 - i]));
+        vec[i]      = pv_add(tmp, tmp1);
+        vec[17 - i] = pv_mul<28>(pv_sub(tmp, tmp1), PV_SET1(cosTerms_dct18_x86[i]));
+    }
+
+    PV_SIMD(dct_9)(vec);         // Even terms
+    PV_SIMD(dct_9)(&vec[9]);     // Odd  terms
+
+    tmp3     = vec[16];
+    vec[16]  = vec[ 8];
+    tmp4     = vec[14];
+    vec[14]  = vec[ 7];
+    tmp      = vec[12];
+    vec[12]  = vec[ 6];
+    tmp2     = vec[10];
+    vec[10]  = vec[ 5];
+    vec[ 8]  = vec[ 4];
+    vec[ 6]  = vec[ 3];
+    vec[ 4]  = vec[ 2];
+    vec[ 2]  = vec[ 1];
+    vec[ 1]  = pv_sub(vec[ 9], tmp2);
+    vec[ 3]  = pv_sub(vec[11], tmp2);
+    vec[ 5]  = pv_sub(vec[11], tmp);
+    vec[ 7]  = pv_sub(vec[13], tmp);
+    vec[ 9]  = pv_sub(vec[13], tmp4);
+    vec[11]  = pv_sub(vec[15], tmp4);
+    vec[13]  = pv_sub(vec[15], tmp3);
+    vec[15]  = pv_sub(vec[17], tmp3);
+
+    /* overlap and add */
+
+    tmp2 = vec[0];
+    tmp3 = vec[9];
+
+    for (i = 0; i < 6; i++)
+    {
+        tmp  = history[ i];
+        tmp4 = vec[i+10];
+        vec[i+10] = pv_add(tmp3, tmp4);
+        tmp1 = vec[i+1];
+        vec[ i] = pv_mac(tmp, vec[i+10], PV_SET1(window[ i]));
+        tmp3 = tmp4;
+        history[i  ] = pv_neg(pv_add(tmp2, tmp1));
+        tmp2 = tmp1;
+    }
+
+    tmp  = history[ 6];
+    tmp4 = vec[16];
+    vec[16] = pv_add(tmp3, tmp4);
+    tmp1 = vec[7];
+    vec[ 6] = pv_mac(tmp, pv_shl<1>(vec[16]), PV_SET1(window[ 6]));
+    tmp  = history[ 7];
+    history[6] = pv_neg(pv_add(tmp2, tmp1));
+    history[7] = pv_neg(pv_add(tmp1, vec[8]));
+
+    tmp1    = history[ 8];
+    tmp4    = pv_add(vec[17], tmp4);
+    vec[ 7] = pv_mac(tmp, pv_shl<1>(tmp4), PV_SET1(window[ 7]));
+    history[8] = pv_neg(pv_add(vec[8], vec[9]));
+    vec[ 8] = pv_mac(tmp1, pv_shl<1>(vec[17]), PV_SET1(window[ 8]));
+
+    tmp  = history[9];
+    tmp1 = history[17];
+    tmp2 = history[16];
+    vec[ 9] = pv_mac(tmp,  pv_shl<1>(vec[17]), PV_SET1(window[ 9]));
+
+    vec[17] = pv_mac(tmp1, pv_shl<1>(vec[10]), PV_SET1(window[17]));
+    vec[10] = pv_neg(vec[16]);
+    vec[16] = pv_mac(tmp2, pv_shl<1>(vec[11]), PV_SET1(window[16]));
+    tmp1 = history[15];
+    tmp2 = history[14];
+    vec[11] = pv_neg(vec[15]);
+    vec[15] = pv_mac(tmp1, pv_shl<1>(vec[12]), PV_SET1(window[15]));
+    vec[12] = pv_neg(vec[14]);
+    vec[14] = pv_mac(tmp2, pv_shl<1>(vec[13]), PV_SET1(window[14]));
+
+    tmp  = history[13];
+    tmp1 = history[12];
+    tmp2 = history[11];
+    tmp3 = history[10];
+    vec[13] = pv_mac(tmp,  pv_shl<1>(vec[12]), PV_SET1(window[13]));
+    vec[12] = pv_mac(tmp1, pv_shl<1>(vec[11]), PV_SET1(window[12]));
+    vec[11] = pv_mac(tmp2, pv_shl<1>(vec[10]), PV_SET1(window[11]));
+    vec[10] = pv_mac(tmp3, pv_shl<1>(tmp4),    PV_SET1(window[10]));
+
+    /* next iteration overlap, history[k] and history[17-k] both come from history[8-k] */
+
+    PV_VEC overlap[9];
+    for (i = 0; i < 9; i++)
+    {
+        overlap[i] = pv_shl<1>(history[i]);
+    }
+    for (i = 0; i < 9; i++)
+    {
+        history[    i] = pv_mul<32>(overlap[8 - i], PV_SET1(window[18 + i]));
+        history[9 + i] = pv_mul<32>(overlap[i],     PV_SET1(window[27 + i]));
+    }
+}
+
+/* pvmp3_dct_6() */
+static inline void PV_SIMD(dct_6)(PV_VEC vec[])
+{
+    PV_VEC tmp0 = pv_add(vec[5], vec[0]);
+    PV_VEC tmp5 = pv_sub(vec[5], vec[0]);
+    PV_VEC tmp1 = pv_add(vec[4], vec[1]);
+    PV_VEC tmp4 = pv_sub(vec[4], vec[1]);
+    PV_VEC tmp2 = pv_add(vec[3], vec[2]);
+    PV_VEC tmp3 = pv_sub(vec[3], vec[2]);
+
+    vec[0]  = pv_add(tmp0, tmp2);
+    vec[2]  = pv_mul<30>(pv_sub(tmp0, tmp2), PV_SET1(cos_pi_6_q30));
+    vec[4]  = pv_sub(pv_sar<1>(vec[0]), tmp1);
+    vec[0]  = pv_add(vec[0], tmp1);
+
+    tmp0    = pv_mul<30>(tmp3, PV_SET1(cos_7_pi_12));
+    tmp0    = pv_add(tmp0, pv_mul<30>(tmp4, PV_SET1(-cos_3_pi_12)));
+    vec[1]  = pv_add(tmp0, pv_mul<30>(tmp5, PV_SET1(cos_11_pi_12)));
+
+    vec[3]  = pv_mul<30>(pv_sub(pv_add(tmp3, tmp4), tmp5), PV_SET1(cos_3_pi_12));
+    tmp0    = pv_mul<30>(tmp3, PV_SET1(cos_11_pi_12));
+    tmp0    = pv_add(tmp0, pv_mul<30>(tmp4, PV_SET1(cos_3_pi_12)));
+    vec[5]  = pv_add(tmp0, pv_mul<30>(tmp5, PV_SET1(cos_7_pi_12)));
+}
+
+/* pvmp3_mdct_6() */
+static inline void PV_SIMD(mdct_6)(PV_VEC vec[], PV_VEC history[])
+{
+    PV_VEC tmp;
+
+    for (int32 i = 0; i < 6; i++)
+    {
+        vec[i] = pv_mul<29>(vec[i], PV_SET1(cosTerms_1_ov_cos_phi_N6_x86[i]));
+    }
+
+    PV_SIMD(dct_6)(vec);    // Even terms
+
+    tmp = pv_neg(pv_add(vec[0], vec[1]));
+    history[3] = tmp;
+    history[2] = tmp;
+    tmp = pv_neg(pv_add(vec[1], vec[2]));
+    vec[0] = pv_add(vec[3], vec[4]);
+    vec[1] = pv_add(vec[4], vec[5]);
+    history[4] = tmp;
+    history[1] = tmp;
+    tmp = pv_neg(pv_add(vec[2], vec[3]));
+    vec[4] = pv_neg(vec[1]);
+    history[5] = tmp;
+    history[0] = tmp;
+
+    vec[2] = vec[5];
+    vec[3] = pv_neg(vec[5]);
+    vec[5] = pv_neg(vec[0]);
+}
+
+/* pvmp3_dct_16() */
+static inline void PV_SIMD(dct_16)(PV_VEC vec[], int32 flag)
+{
+    PV_VEC tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
+    PV_VEC tmp_o0, tmp_o1, tmp_o2, tmp_o3, tmp_o4, tmp_o5, tmp_o6, tmp_o7;
+    PV_VEC itmp_e0, itmp_e1, itmp_e2;
+
+    /*  split input vector */
+
+    tmp_o0 = pv_mul<32>(pv_sub(vec[ 0], vec[15]), PV_SET1(Qfmt_31(0.50241928618816F)));
+    tmp0   = pv_add(vec[ 0], vec[15]);
+
+    tmp_o7 = pv_mul<32>(pv_shl<3>(pv_sub(vec[ 7], vec[ 8])), PV_SET1(Qfmt_31(0.63764357733614F)));
+    tmp7   = pv_add(vec[ 7], vec[ 8]);
+
+    itmp_e0 = pv_mul<32>(pv_sub(tmp0, tmp7), PV_SET1(Qfmt_31(0.50979557910416F)));
+    tmp7    = pv_add(tmp0, tmp7);
+
+    tmp_o1 = pv_mul<32>(pv_sub(vec[ 1], vec[14]), PV_SET1(Qfmt_31(0.52249861493969F)));
+    tmp1   = pv_add(vec[ 1], vec[14]);
+
+    tmp_o6 = pv_mul<32>(pv_shl<1>(pv_sub(vec[ 6], vec[ 9])), PV_SET1(Qfmt_31(0.86122354911916F)));
+    tmp6   = pv_add(vec[ 6], vec[ 9]);
+
+    itmp_e1 = pv_add(tmp1, tmp6);
+    tmp6    = pv_mul<32>(pv_sub(tmp1, tmp6), PV_SET1(Qfmt_31(0.60134488693505F)));
+
+    tmp_o2 = pv_mul<32>(pv_sub(vec[ 2], vec[13]), PV_SET1(Qfmt_31(0.56694403481636F)));
+    tmp2   = pv_add(vec[ 2], vec[13]);
+    tmp_o5 = pv_mul<32>(pv_shl<1>(pv_sub(vec[ 5], vec[10])), PV_SET1(Qfmt_31(0.53033884299517F)));
+    tmp5   = pv_add(vec[ 5], vec[10]);
+
+    itmp_e2 = pv_add(tmp2, tmp5);
+    tmp5    = pv_mul<32>(pv_sub(tmp2, tmp5), PV_SET1(Qfmt_31(0.89997622313642F)));
+
+    tmp_o3 = pv_mul<32>(pv_sub(vec[ 3], vec[12]), PV_SET1(Qfmt_31(0.64682178335999F)));
+    tmp3   = pv_add(vec[ 3], vec[12]);
+    tmp_o4 = pv_mul<32>(pv_sub(vec[ 4], vec[11]), PV_SET1(Qfmt_31(0.78815462345125F)));
+    tmp4   = pv_add(vec[ 4], vec[11]);
+
+    tmp1   = pv_add(tmp3, tmp4);
+    tmp4   = pv_mul<32>(pv_shl<2>(pv_sub(tmp3, tmp4)), PV_SET1(Qfmt_31(0.64072886193538F)));
+
+    /*  split even part of tmp_e */
+
+    tmp0 = pv_add(tmp7, tmp1);
+    tmp1 = pv_mul<32>(pv_sub(tmp7, tmp1), PV_SET1(Qfmt_31(0.54119610014620F)));
+
+    tmp3 = pv_mul<32>(pv_shl<1>(pv_sub(itmp_e1, itmp_e2)), PV_SET1(Qfmt_31(0.65328148243819F)));
+    tmp7 = pv_add(itmp_e1, itmp_e2);
+
+    vec[ 0]  = pv_sar<1>(pv_add(tmp0, tmp7));
+    vec[ 8]  = pv_mul<32>(pv_sub(tmp0, tmp7), PV_SET1(Qfmt_31(0.70710678118655F)));
+    tmp0     = pv_mul<32>(pv_shl<1>(pv_sub(tmp1, tmp3)), PV_SET1(Qfmt_31(0.70710678118655F)));
+    vec[ 4]  = pv_add(pv_add(tmp1, tmp3), tmp0);
+    vec[12]  = tmp0;
+
+    /*  split odd part of tmp_e */
+
+    tmp1 = pv_mul<32>(pv_shl<1>(pv_sub(itmp_e0, tmp4)), PV_SET1(Qfmt_31(0.54119610014620F)));
+    tmp7 = pv_add(itmp_e0, tmp4);
+
+    tmp3 = pv_mul<32>(pv_shl<2>(pv_sub(tmp6, tmp5)), PV_SET1(Qfmt_31(0.65328148243819F)));
+    tmp6 = pv_add(tmp6, tmp5);
+
+    tmp4 = pv_mul<32>(pv_shl<1>(pv_sub(tmp7, tmp6)), PV_SET1(Qfmt_31(0.70710678118655F)));
+    tmp6 = pv_add(tmp6, tmp7);
+    tmp7 = pv_mul<32>(pv_shl<1>(pv_sub(tmp1, tmp3)), PV_SET1(Qfmt_31(0.70710678118655F)));
+
+    tmp1     = pv_add(tmp1, pv_add(tmp3, tmp7));
+    vec[ 2]  = pv_add(tmp1, tmp6);
+    vec[ 6]  = pv_add(tmp1, tmp4);
+    vec[10]  = pv_add(tmp7, tmp4);
+    vec[14]  = tmp7;
+
+    // dct8;
+
+    tmp1 = pv_mul<32>(pv_shl<1>(pv_sub(tmp_o0, tmp_o7)), PV_SET1(Qfmt_31(0.50979557910416F)));
+    tmp7 = pv_add(tmp_o0, tmp_o7);
+
+    tmp6   = pv_add(tmp_o1, tmp_o6);
+    tmp_o1 = pv_mul<32>(pv_shl<1>(pv_sub(tmp_o1, tmp_o6)), PV_SET1(Qfmt_31(0.60134488693505F)));
+
+    tmp5   = pv_add(tmp_o2, tmp_o5);
+    tmp_o5 = pv_mul<32>(pv_shl<1>(pv_sub(tmp_o2, tmp_o5)), PV_SET1(Qfmt_31(0.89997622313642F)));
+
+    tmp0 = pv_mul<32>(pv_shl<3>(pv_sub(tmp_o3, tmp_o4)), PV_SET1(Qfmt_31(0.6407288619354F)));
+    tmp4 = pv_add(tmp_o3, tmp_o4);
+
+    if (!flag)
+    {
+        tmp7   = pv_neg(tmp7);
+        tmp1   = pv_neg(tmp1);
+        tmp6   = pv_neg(tmp6);
+        tmp_o1 = pv_neg(tmp_o1);
+        tmp5   = pv_neg(tmp5);
+        tmp_o5 = pv_neg(tmp_o5);
+        tmp4   = pv_neg(tmp4);
+        tmp0   = pv_neg(tmp0);
+    }
+
+    tmp2     = pv_mul<32>(pv_shl<1>(pv_sub(tmp1, tmp0)), PV_SET1(Qfmt_31(0.54119610014620F)));
+    tmp0     = pv_add(tmp0, tmp1);
+    tmp1     = pv_mul<32>(pv_shl<1>(pv_sub(tmp7, tmp4)), PV_SET1(Qfmt_31(0.54119610014620F)));
+    tmp7     = pv_add(tmp7, tmp4);
+    tmp4     = pv_mul<32>(pv_shl<2>(pv_sub(tmp6, tmp5)), PV_SET1(Qfmt_31(0.65328148243819F)));
+    tmp6     = pv_add(tmp6, tmp5);
+    tmp5     = pv_mul<32>(pv_shl<2>(pv_sub(tmp_o1, tmp_o5)), PV_SET1(Qfmt_31(0.65328148243819F)));
+    tmp_o1   = pv_add(tmp_o1, tmp_o5);
+
+    vec[13]  = pv_mul<32>(pv_shl<1>(pv_sub(tmp1, tmp4)), PV_SET1(Qfmt_31(0.70710678118655F)));
+    vec[ 5]  = pv_add(pv_add(tmp1, tmp4), vec[13]);
+
+    vec[ 9]  = pv_mul<32>(pv_shl<1>(pv_sub(tmp7, tmp6)), PV_SET1(Qfmt_31(0.70710678118655F)));
+    vec[ 1]  = pv_add(tmp7, tmp6);
+
+    tmp4     = pv_mul<32>(pv_shl<1>(pv_sub(tmp0, tmp_o1)), PV_SET1(Qfmt_31(0.70710678118655F)));
+    tmp0     = pv_add(tmp0, tmp_o1);
+    tmp6     = pv_mul<32>(pv_shl<1>(pv_sub(tmp2, tmp5)), PV_SET1(Qfmt_31(0.70710678118655F)));
+    tmp2     = pv_add(tmp2, pv_add(tmp5, tmp6));
+    tmp0     = pv_add(tmp0, tmp2);
+
+    vec[ 1]  = pv_add(vec[ 1], tmp0);
+    vec[ 3]  = pv_add(tmp0, vec[ 5]);
+    tmp2     = pv_add(tmp2, tmp4);
+    vec[ 5]  = pv_add(tmp2, vec[ 5]);
+    vec[ 7]  = pv_add(tmp2, vec[ 9]);
+    tmp4     = pv_add(tmp4, tmp6);
+    vec[ 9]  = pv_add(tmp4, vec[ 9]);
+    vec[11]  = pv_add(tmp4, vec[13]);
+    vec[13]  = pv_add(tmp6, vec[13]);
+    vec[15]  = tmp6;
+}
+
+/* pvmp3_split() of vec[16..31] into vec[0..15] */
+static inline void PV_SIMD(split)(PV_VEC vec[])
+{
+    for (int32 k = 0; k < 16; k++)
+    {
+        PV_VEC tmp2 = vec[16 + k];
+        PV_VEC tmp1 = vec[15 - k];
+        PV_VEC cosx = PV_SET1(CosTable_dct32_x86[15 - k]);
+        vec[15 - k] = pv_add(tmp1, tmp2);
+        if (k < 6)
+        {
+            vec[16 + k] = pv_mul<27>(pv_sub(tmp1, tmp2), cosx);
+        }
+        else
+        {
+            vec[16 + k] = pv_mul<32>(pv_shl<1>(pv_sub(tmp1, tmp2)), cosx);
+        }
+    }
+}
+
+/* pvmp3_merge_in_place_N32() */
+static inline void PV_SIMD(merge_in_place_N32)(PV_VEC vec[])
+{
+    PV_VEC temp0, temp1, temp2, temp3;
+
+    temp0   = vec[14];
+    vec[14] = vec[ 7];
+    temp1   = vec[12];
+    vec[12] = vec[ 6];
+    temp2   = vec[10];
+    vec[10] = vec[ 5];
+    temp3   = vec[ 8];
+    vec[ 8] = vec[ 4];
+    vec[ 6] = vec[ 3];
+    vec[ 4] = vec[ 2];
+    vec[ 2] = vec[ 1];
+
+    vec[ 1] = pv_add(vec[16], vec[17]);
+    vec[16] = temp3;
+    vec[ 3] = pv_add(vec[18], vec[17]);
+    vec[ 5] = pv_add(vec[19], vec[18]);
+    vec[18] = vec[9];
+
+    vec[ 7] = pv_add(vec[20], vec[19]);
+    vec[ 9] = pv_add(vec[21], vec[20]);
+    vec[20] = temp2;
+    temp2   = vec[13];
+    temp3   = vec[11];
+    vec[11] = pv_add(vec[22], vec[21]);
+    vec[13] = pv_add(vec[23], vec[22]);
+    vec[22] = temp3;
+    temp3   = vec[15];
+
+    vec[15] = pv_add(vec[24], vec[23]);
+    vec[17] = pv_add(vec[25], vec[24]);
+    vec[19] = pv_add(vec[26], vec[25]);
+    vec[21] = pv_add(vec[27], vec[26]);
+    vec[23] = pv_add(vec[28], vec[27]);
+    vec[24] = temp1;
+    vec[25] = pv_add(vec[29], vec[28]);
+    vec[26] = temp2;
+    vec[27] = pv_add(vec[30], vec[29]);
+    vec[28] = temp0;
+    vec[29] = pv_add(vec[30], vec[31]);
+    vec[30] = temp3;
+}
+
+/*----------------------------------------------------------------------------
+; FUNCTION CODE
+----------------------------------------------------------------------------*/
+
+void PV_SIMD(pvmp3_mdct_18_bands)(int32 vec[], int32 *history, const int32 *window, int32 bands)
+{
+    for (int32 band = 0; band < bands; band += PV_LANES)
+    {
+        int32 n = (bands - band < PV_LANES) ? bands - band : PV_LANES;
+        PV_VEC v[FILTERBANK_BANDS];
+        PV_VEC h[FILTERBANK_BANDS];
+
+        PV_SIMD(gather)(v, &vec[band*FILTERBANK_BANDS], FILTERBANK_BANDS, n);
+        PV_SIMD(gather)(h, &history[band*FILTERBANK_BANDS], FILTERBANK_BANDS, n);
+        PV_SIMD(mdct_18)(v, h, window);
+        PV_SIMD(scatter)(&vec[band*FILTERBANK_BANDS], v, FILTERBANK_BANDS, n);
+        PV_SIMD(scatter)(&history[band*FILTERBANK_BANDS], h, FILTERBANK_BANDS, n);
+    }
+}
+
+void PV_SIMD(pvmp3_mdct_6_blocks)(int32 vec[], int32 *history, int32 blocks)
+{
+    for (int32 block = 0; block < blocks; block += PV_LANES)
+    {
+        int32 n = (blocks - block < PV_LANES) ? blocks - block : PV_LANES;
+        PV_VEC v[6];
+        PV_VEC h[6];
+
+        PV_SIMD(gather)(v, &vec[block*6], 6, n);
+        PV_SIMD(mdct_6)(v, h);
+        PV_SIMD(scatter)(&vec[block*6], v, 6, n);
+        PV_SIMD(scatter)(&history[block*6], h, 6, n);
+    }
+}
+
+void PV_SIMD(pvmp3_dct_32_blocks)(int32 vec[], int32 blocks)
+{
+    for (int32 block = 0; block < blocks; block += PV_LANES)
+    {
+        int32 n = (blocks - block < PV_LANES) ? blocks - block : PV_LANES;
+        PV_VEC v[SUBBANDS_NUMBER];
+
+        PV_SIMD(gather)(v, &vec[block*SUBBANDS_NUMBER], SUBBANDS_NUMBER, n);
+        PV_SIMD(split)(v);
+        PV_SIMD(dct_16)(&v[16], 0);
+        PV_SIMD(dct_16)(v, 1);     // Even terms
+        PV_SIMD(merge_in_place_N32)(v);
+        PV_SIMD(scatter)(&vec[block*SUBBANDS_NUMBER], v, SUBBANDS_NUMBER, n);
+    }
+}
@@ -0,0 +1,210 @@
+/* ------------------------------------------------------------------
+ * Copyright (C) 1998-2009 PacketVideo
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ * -------------------------------------------------------------------
+ */
+/*
+------------------------------------------------------------------------------
+   PacketVideo Corp.
+   MP3 Decoder Library
+
+   Filename: pvmp3_x86_simd_ops.h
+
+------------------------------------------------------------------------------
+ INCLUDE DESCRIPTION
+
+ Lane-wise int32 operations shared by the x86 kernels, overloaded for
+ __m128i (SSE2) and __m256i (AVX2) so that the same kernel source can be
+ compiled for both. pv_mul<n> returns bits n..n+31 of the signed 64-bit
+ product, i.e. the same value as fxp_mul32_Qn() of the C version.
+
+ Only included by the *_x86.cpp files.
+
+------------------------------------------------------------------------------
+*/
+
+/*----------------------------------------------------------------------------
+; CONTINUE ONLY IF NOT ALREADY DEFINED
+----------------------------------------------------------------------------*/
+#ifndef PVMP3_X86_SIMD_OPS_H
+#define PVMP3_X86_SIMD_OPS_H
+
+/*----------------------------------------------------------------------------
+; INCLUDES
+----------------------------------------------------------------------------*/
+#include "pvmp3_x86_simd.h"
+
+#if defined(PV_X86_SIMD)
+#include <emmintrin.h>
+#include <immintrin.h>
+
+/*----------------------------------------------------------------------------
+; SSE2
+----------------------------------------------------------------------------*/
+static inline __m128i pv_add(__m128i a, __m128i b)
+{
+    return _mm_add_epi32(a, b);
+}
+
+static inline __m128i pv_sub(__m128i a, __m128i b)
+{
+    return _mm_sub_epi32(a, b);
+}
+
+static inline __m128i pv_neg(__m128i a)
+{
+    return _mm_sub_epi32(_mm_setzero_si128(), a);
+}
+
+template<int n>
+static inline __m128i pv_shl(__m128i a)
+{
+    return _mm_slli_epi32(a, n);
+}
+
+template<int n>
+static inline __m128i pv_sar(__m128i a)
+{
+    return _mm_srai_epi32(a, n);
+}
+
+/* SSE2 only has the unsigned 32x32 multiply, the high word is fixed up for the signs */
+template<int n>
+static inline __m128i pv_mul(__m128i a, __m128i b)
+{
+    const __m128i odd_mask = _mm_set_epi32(-1, 0, -1, 0);
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd  = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    __m128i hi   = _mm_or_si128(_mm_srli_epi64(even, 32), _mm_and_si128(odd, odd_mask));
+    __m128i fix  = _mm_add_epi32(_mm_and_si128(_mm_srai_epi32(a, 31), b),
+                                 _mm_and_si128(_mm_srai_epi32(b, 31), a));
+    hi = _mm_sub_epi32(hi, fix);
+    if (n == 32)
+    {
+        return hi;
+    }
+    __m128i lo = _mm_or_si128(_mm_andnot_si128(odd_mask, even), _mm_slli_epi64(odd, 32));
+    return _mm_or_si128(_mm_srli_epi32(lo, n), _mm_slli_epi32(hi, 32 - n));
+}
+
+static inline __m128i pv_mac(__m128i L_add, __m128i a, __m128i b)
+{
+    return _mm_add_epi32(L_add, pv_mul<32>(a, b));
+}
+
+static inline __m128i pv_msb(__m128i L_sub, __m128i a, __m128i b)
+{
+    return _mm_sub_epi32(L_sub, pv_mul<32>(a, b));
+}
+
+/* 4x4 transpose, rows of 4 samples to one vector per sample and back */
+static inline void pv_transpose(__m128i r[4])
+{
+    __m128i t0 = _mm_unpacklo_epi32(r[0], r[1]);
+    __m128i t1 = _mm_unpacklo_epi32(r[2], r[3]);
+    __m128i t2 = _mm_unpackhi_epi32(r[0], r[1]);
+    __m128i t3 = _mm_unpackhi_epi32(r[2], r[3]);
+    r[0] = _mm_unpacklo_epi64(t0, t1);
+    r[1] = _mm_unpackhi_epi64(t0, t1);
+    r[2] = _mm_unpacklo_epi64(t2, t3);
+    r[3] = _mm_unpackhi_epi64(t2, t3);
+}
+
+/*----------------------------------------------------------------------------
+; AVX2
+----------------------------------------------------------------------------*/
+__attribute__((target("avx2")))
+static inline __m256i pv_add(__m256i a, __m256i b)
+{
+    return _mm256_add_epi32(a, b);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i pv_sub(__m256i a, __m256i b)
+{
+    return _mm256_sub_epi32(a, b);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i pv_neg(__m256i a)
+{
+    return _mm256_sub_epi32(_mm256_setzero_si256(), a);
+}
+
+template<int n>
+__attribute__((target("avx2")))
+static inline __m256i pv_shl(__m256i a)
+{
+    return _mm256_slli_epi32(a, n);
+}
+
+template<int n>
+__attribute__((target("avx2")))
+static inline __m256i pv_sar(__m256i a)
+{
+    return _mm256_srai_epi32(a, n);
+}
+
+template<int n>
+__attribute__((target("avx2")))
+static inline __m256i pv_mul(__m256i a, __m256i b)
+{
+    __m256i even = _mm256_mul_epi32(a, b);
+    __m256i odd  = _mm256_mul_epi32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+    return _mm256_blend_epi32(_mm256_srli_epi64(even, n), _mm256_slli_epi64(odd, 32 - n), 0xAA);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i pv_mac(__m256i L_add, __m256i a, __m256i b)
+{
+    return _mm256_add_epi32(L_add, pv_mul<32>(a, b));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i pv_msb(__m256i L_sub, __m256i a, __m256i b)
+{
+    return _mm256_sub_epi32(L_sub, pv_mul<32>(a, b));
+}
+
+/* 8x8 transpose */
+__attribute__((target("avx2")))
+static inline void pv_transpose(__m256i r[8])
+{
+    __m256i t[8], u[8];
+    for (int i = 0; i < 8; i += 2)
+    {
+        t[i]     = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+        t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+    }
+    for (int i = 0; i < 8; i += 4)
+    {
+        u[i]     = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+        u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+        u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+        u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        r[i]     = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+        r[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+    }
+}
+
+#endif // PV_X86_SIMD
+
+/*----------------------------------------------------------------------------
+; END
+----------------------------------------------------------------------------*/
+#endif
@@ -0,0 +1,242 @@
+/*
+ * Checks that the x86 SSE2/AVX2 kernels of the decoder are bit-exact with
+ * their C versions, on random input.
+ *
+ * Build with test/CMakeLists.txt, run without arguments; returns 0 when
+ * every kernel matches.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pvmp3_polyphase_filter_window.h"
+#include "pvmp3_alias_reduction.h"
+#include "pvmp3_mdct_18.h"
+#include "pvmp3_mdct_6.h"
+#include "pvmp3_dct_16.h"
+
+#if defined(PV_X86_SIMD)
+
+#define ITERATIONS      200
+
+#define CIRC_BUFFER_LEN (480 + 576)
+#define GRANULE_LEN     576
+#define OVERLAP_LEN     576
+#define PCM_LEN         64
+
+enum {
+    IMPL_SSE2 = 0,
+    IMPL_AVX2,
+    IMPL_COUNT,
+};
+
+static const char *impl_name[IMPL_COUNT] = { "sse2", "avx2" };
+
+static bool impl_enabled[IMPL_COUNT];
+static int failures = 0;
+
+static uint32 rand_state = 0x12345678;
+
+static int32 rand_int32(int bits)
+{
+    rand_state = rand_state * 1664525 + 1013904223;
+    int32 v = (int32)(rand_state >> 8) & ((1 << bits) - 1);
+    return (rand_state & 0x80) ? -v : v;
+}
+
+static void rand_fill(int32 *buf, int len, int bits)
+{
+    for (int i = 0; i < len; i++)
+        buf[i] = rand_int32(bits);
+}
+
+/* random magnitude per iteration, so both small and near full scale input is seen */
+static int rand_bits(int min, int max)
+{
+    rand_state = rand_state * 1664525 + 1013904223;
+    return min + (int)((rand_state >> 16) % (uint32)(max - min + 1));
+}
+
+static void report(const char *kernel, int impl, int param, bool ok)
+{
+    if (!ok) {
+        printf("FAIL: %s_%s, param %d\n", kernel, impl_name[impl], param);
+        failures++;
+    }
+}
+
+static void test_polyphase_filter_window()
+{
+    typedef void (*func)(int32 *, int16 *, int32);
+    const func simd[IMPL_COUNT] = {
+        pvmp3_polyphase_filter_window_sse2, pvmp3_polyphase_filter_window_avx2
+    };
+    static int32 synth[CIRC_BUFFER_LEN];
+    int16 ref[PCM_LEN], out[PCM_LEN];
+
+    for (int it = 0; it < ITERATIONS; it++) {
+        rand_fill(synth, CIRC_BUFFER_LEN, rand_bits(8, 26));
+        for (int32 channels = 1; channels <= 2; channels++) {
+            for (int band = 0; band < 18; band += 17) {
+                int32 *in = &synth[544 - (band << 5)];
+                memset(ref, 0x5a, sizeof(ref));
+                pvmp3_polyphase_filter_window_c(in, ref, channels);
+                for (int impl = 0; impl < IMPL_COUNT; impl++) {
+                    if (!impl_enabled[impl])
+                        continue;
+                    memset(out, 0x5a, sizeof(out));
+                    simd[impl](in, out, channels);
+                    report("pvmp3_polyphase_filter_window", impl, channels,
+                           memcmp(ref, out, sizeof(ref)) == 0);
+                }
+            }
+        }
+    }
+}
+
+static void test_alias_butterflies()
+{
+    typedef void (*func)(int32 *, int32);
+    const func simd[IMPL_COUNT] = {
+        pvmp3_alias_butterflies_sse2, pvmp3_alias_butterflies_avx2
+    };
+    int32 src[GRANULE_LEN], ref[GRANULE_LEN], out[GRANULE_LEN];
+
+    for (int it = 0; it < ITERATIONS; it++) {
+        rand_fill(src, GRANULE_LEN, rand_bits(8, 28));
+        for (int32 sblim = 0; sblim < SUBBANDS_NUMBER; sblim++) {
+            memcpy(ref, src, sizeof(src));
+            pvmp3_alias_butterflies_c(ref, sblim);
+            for (int impl = 0; impl < IMPL_COUNT; impl++) {
+                if (!impl_enabled[impl])
+                    continue;
+                memcpy(out, src, sizeof(src));
+                simd[impl](out, sblim);
+                report("pvmp3_alias_butterflies", impl, sblim,
+                       memcmp(ref, out, sizeof(ref)) == 0);
+            }
+        }
+    }
+}
+
+static void test_mdct_18_bands()
+{
+    typedef void (*func)(int32 *, int32 *, const int32 *, int32);
+    const func simd[IMPL_COUNT] = {
+        pvmp3_mdct_18_bands_sse2, pvmp3_mdct_18_bands_avx2
+    };
+    int32 src[GRANULE_LEN], ref[GRANULE_LEN], out[GRANULE_LEN];
+    int32 hsrc[OVERLAP_LEN], href[OVERLAP_LEN], hout[OVERLAP_LEN];
+    int32 window[36];
+
+    for (int it = 0; it < ITERATIONS; it++) {
+        int bits = rand_bits(8, 24);
+        rand_fill(src, GRANULE_LEN, bits);
+        rand_fill(hsrc, OVERLAP_LEN, bits);
+        rand_fill(window, 36, 31);
+        for (int32 bands = 0; bands <= SUBBANDS_NUMBER; bands++) {
+            memcpy(ref, src, sizeof(src));
+            memcpy(href, hsrc, sizeof(hsrc));
+            pvmp3_mdct_18_bands_c(ref, href, window, bands);
+            for (int impl = 0; impl < IMPL_COUNT; impl++) {
+                if (!impl_enabled[impl])
+                    continue;
+                memcpy(out, src, sizeof(src));
+                memcpy(hout, hsrc, sizeof(hsrc));
+                simd[impl](out, hout, window, bands);
+                report("pvmp3_mdct_18_bands", impl, bands,
+                       memcmp(ref, out, sizeof(ref)) == 0 &&
+                       memcmp(href, hout, sizeof(href)) == 0);
+            }
+        }
+    }
+}
+
+static void test_mdct_6_blocks()
+{
+    typedef void (*func)(int32 *, int32 *, int32);
+    const func simd[IMPL_COUNT] = {
+        pvmp3_mdct_6_blocks_sse2, pvmp3_mdct_6_blocks_avx2
+    };
+    /* blocks of 6 inputs, 12 outputs each */
+    int32 src[GRANULE_LEN], ref[GRANULE_LEN], out[GRANULE_LEN];
+    int32 osrc[OVERLAP_LEN], oref[OVERLAP_LEN], oout[OVERLAP_LEN];
+
+    for (int it = 0; it < ITERATIONS; it++) {
+        int bits = rand_bits(8, 24);
+        rand_fill(src, GRANULE_LEN, bits);
+        rand_fill(osrc, OVERLAP_LEN, bits);
+        for (int32 blocks = 0; blocks <= 12; blocks++) {
+            memcpy(ref, src, sizeof(src));
+            memcpy(oref, osrc, sizeof(osrc));
+            pvmp3_mdct_6_blocks_c(ref, oref, blocks);
+            for (int impl = 0; impl < IMPL_COUNT; impl++) {
+                if (!impl_enabled[impl])
+                    continue;
+                memcpy(out, src, sizeof(src));
+                memcpy(oout, osrc, sizeof(osrc));
+                simd[impl](out, oout, blocks);
+                report("pvmp3_mdct_6_blocks", impl, blocks,
+                       memcmp(ref, out, sizeof(ref)) == 0 &&
+                       memcmp(oref, oout, sizeof(oref)) == 0);
+            }
+        }
+    }
+}
+
+static void test_dct_32_blocks()
+{
+    typedef void (*func)(int32 *, int32);
+    const func simd[IMPL_COUNT] = {
+        pvmp3_dct_32_blocks_sse2, pvmp3_dct_32_blocks_avx2
+    };
+    int32 src[GRANULE_LEN], ref[GRANULE_LEN], out[GRANULE_LEN];
+
+    for (int it = 0; it < ITERATIONS; it++) {
+        rand_fill(src, GRANULE_LEN, rand_bits(8, 24));
+        for (int32 blocks = 0; blocks <= FILTERBANK_BANDS; blocks++) {
+            memcpy(ref, src, sizeof(src));
+            pvmp3_dct_32_blocks_c(ref, blocks);
+            for (int impl = 0; impl < IMPL_COUNT; impl++) {
+                if (!impl_enabled[impl])
+                    continue;
+                memcpy(out, src, sizeof(src));
+                simd[impl](out, blocks);
+                report("pvmp3_dct_32_blocks", impl, blocks,
+                       memcmp(ref, out, sizeof(ref)) == 0);
+            }
+        }
+    }
+}
+
+int main()
+{
+    __builtin_cpu_init();
+    impl_enabled[IMPL_SSE2] = true;
+    impl_enabled[IMPL_AVX2] = __builtin_cpu_supports("avx2");
+    if (!impl_enabled[IMPL_AVX2])
+        printf("avx2 not supported by this cpu, testing sse2 only\n");
+
+    test_polyphase_filter_window();
+    test_alias_butterflies();
+    test_mdct_18_bands();
+    test_mdct_6_blocks();
+    test_dct_32_blocks();
+
+    if (failures != 0) {
+        printf("%d mismatches\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
+
+#else
+
+int main()
+{
+    printf("PV_X86_SIMD is not enabled, nothing to test\n");
+    return 0;
+}
+
+#endif // PV_X86_SIMD
@@ -17,6 +17,8 @@ LOCAL_SRC_FILES := \
     ${TOP_DIR}/source/cutils/ringbuf.c \
     ${TOP_DIR}/source/cutils/lockfree_ringbuf.c \
     ${TOP_DIR}/source/cutils/swtimer.c \
+    ${TOP_DIR}/source/cutils/workpool.c \
+    ${TOP_DIR}/source/cutils/bufpool.c \
     ${TOP_DIR}/source/cipher/sha2.c \
     ${TOP_DIR}/source/cipher/hmac_sha2.c \
     ${TOP_DIR}/source/cipher/md5.c \
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2018-2022 Qinglong<sysu.zqlong@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SYSUTILS_BUFPOOL_H__
+#define __SYSUTILS_BUFPOOL_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "cutil_namespace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  Pool of heap blocks that are released and requested again and again,
+ *  e.g. buffers of every track played by a player. A released block stays
+ *  in the pool and serves the next request of a similar size, so the heap
+ *  isn't fragmented by the churn. Idle blocks are freed only by
+ *  bufpool_trim() and bufpool_destroy().
+ *
+ *  A NULL pool is valid for all calls and falls back to plain malloc/free,
+ *  as long as the same pool is passed to bufpool_get() and bufpool_put().
+ */
+typedef struct bufpool *bufpool_handle;
+
+bufpool_handle bufpool_create();
+// bufpool_destroy:
+//   Idle blocks are freed at once, blocks still in use are freed when put back
+void bufpool_destroy(bufpool_handle pool);
+
+// bufpool_reserve:
+//   Allocate count idle blocks of size bytes ahead of time
+int bufpool_reserve(bufpool_handle pool, int size, int count);
+// bufpool_get:
+//   Smallest idle block that fits and isn't more than twice the size, or a new one.
+//   Content of the block is undefined
+void *bufpool_get(bufpool_handle pool, int size);
+// bufpool_put:
+//   Return block to the pool, NULL is ignored
+void bufpool_put(bufpool_handle pool, void *buf);
+// bufpool_trim:
+//   Free all idle blocks
+void bufpool_trim(bufpool_handle pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SYSUTILS_BUFPOOL_H__ */
@@ -66,6 +66,7 @@
 
 // ringbuf.h
 #define rb_create                      SYSUTILS_CUTILS_NAMESPACE(rb_create)
+#define rb_create_spsc                 SYSUTILS_CUTILS_NAMESPACE(rb_create_spsc)
 #define rb_destroy                     SYSUTILS_CUTILS_NAMESPACE(rb_destroy)
 #define rb_abort                       SYSUTILS_CUTILS_NAMESPACE(rb_abort)
 #define rb_reset                       SYSUTILS_CUTILS_NAMESPACE(rb_reset)
@@ -82,6 +83,7 @@
 #define rb_set_threshold               SYSUTILS_CUTILS_NAMESPACE(rb_set_threshold)
 #define rb_get_threshold               SYSUTILS_CUTILS_NAMESPACE(rb_get_threshold)
 #define rb_reach_threshold             SYSUTILS_CUTILS_NAMESPACE(rb_reach_threshold)
+#define rb_resize                      SYSUTILS_CUTILS_NAMESPACE(rb_resize)
 #define rb_is_full                     SYSUTILS_CUTILS_NAMESPACE(rb_is_full)
 #define rb_is_done_write               SYSUTILS_CUTILS_NAMESPACE(rb_is_done_write)
 
@@ -92,4 +94,19 @@
 #define swtimer_is_active              SYSUTILS_CUTILS_NAMESPACE(swtimer_is_active)
 #define swtimer_destroy                SYSUTILS_CUTILS_NAMESPACE(swtimer_destroy)
 
+// workpool.h
+#define workpool_create                SYSUTILS_CUTILS_NAMESPACE(workpool_create)
+#define workpool_destroy               SYSUTILS_CUTILS_NAMESPACE(workpool_destroy)
+#define workpool_worker_count          SYSUTILS_CUTILS_NAMESPACE(workpool_worker_count)
+#define workpool_job_create            SYSUTILS_CUTILS_NAMESPACE(workpool_job_create)
+#define workpool_job_wake              SYSUTILS_CUTILS_NAMESPACE(workpool_job_wake)
+
+// bufpool.h
+#define bufpool_create                 SYSUTILS_CUTILS_NAMESPACE(bufpool_create)
+#define bufpool_destroy                SYSUTILS_CUTILS_NAMESPACE(bufpool_destroy)
+#define bufpool_reserve                SYSUTILS_CUTILS_NAMESPACE(bufpool_reserve)
+#define bufpool_get                    SYSUTILS_CUTILS_NAMESPACE(bufpool_get)
+#define bufpool_put                    SYSUTILS_CUTILS_NAMESPACE(bufpool_put)
+#define bufpool_trim                   SYSUTILS_CUTILS_NAMESPACE(bufpool_trim)
+
 #endif /* __SYSUTILS_CUTILS_NAMESPACE_H__ */
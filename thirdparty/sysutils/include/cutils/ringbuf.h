@@ -53,6 +53,23 @@ typedef struct ringbuf *ringbuf_handle;
  */
 ringbuf_handle rb_create(int size);
 
+/**
+ * @brief      Create single-producer/single-consumer ringbuffer
+ *
+ *             Same semantics as rb_create(), but requests that can be served
+ *             right away (enough data to read, enough space to write) skip the
+ *             mutex and only touch an atomic fill counter. The lock is taken
+ *             only to block on empty/full and to wake a blocked peer.
+ *             Only one thread may read and only one thread may write at a time,
+ *             and rb_reset() must not race with rb_read*()/rb_write*().
+ *             Falls back to rb_create() when C11 atomics are not available.
+ *
+ * @param[in]  size   Size of ringbuffer
+ *
+ * @return     ringbuf_handle
+ */
+ringbuf_handle rb_create_spsc(int size);
+
 /**
  * @brief      Cleanup and free all memory created by ringbuf_handle
  *
@@ -175,7 +192,13 @@ void rb_unblock_reader(ringbuf_handle rb);
 /**
  * @brief      Set reader threshold
  *
- * @param[in]  rb    The Ringbuffer handle
+ *             Reader blocks until `threshold` bytes are filled, after rb_reset()
+ *             and again whenever it runs out of data, so a threshold above 0
+ *             works as a rebuffering watermark. It is considered reached anyway
+ *             once the ringbuffer is full or writing is done.
+ *
+ * @param[in]  rb         The Ringbuffer handle
+ * @param[in]  threshold  Bytes to fill, clipped to the size of ringbuffer
  */
 void rb_set_threshold(ringbuf_handle rb, int threshold);
 
@@ -193,6 +216,18 @@ int rb_get_threshold(ringbuf_handle rb);
  */
 bool rb_reach_threshold(ringbuf_handle rb);
 
+/**
+ * @brief      Resize ringbuffer, keeping the data filled
+ *
+ *             For rb_create_spsc() ringbuffers, it must be called by the writer.
+ *
+ * @param[in]  rb    The Ringbuffer handle
+ * @param[in]  size  New size of ringbuffer, not less than bytes filled
+ *
+ * @return     RB_OK on success, RB_FAIL if out of memory or size is too small
+ */
+int rb_resize(ringbuf_handle rb, int size);
+
 bool rb_is_full(ringbuf_handle rb);
 
 bool rb_is_done_write(ringbuf_handle rb);
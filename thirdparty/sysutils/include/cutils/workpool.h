@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2018-2022 Qinglong<sysu.zqlong@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SYSUTILS_WORKPOOL_H__
+#define __SYSUTILS_WORKPOOL_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "osal/os_thread.h"
+#include "cutil_namespace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ *  Fixed-size pool of worker threads running cooperative jobs.
+ *  Every worker owns a queue, a job yielded by a worker is queued back to
+ *  the same worker, and an idle worker steals from the others' queues.
+ *
+ *  A job runs one step per call and must not block for long, the return
+ *  value tells what to do next:
+ *    WORKPOOL_JOB_DONE:  job is finished and freed by the pool
+ *    WORKPOOL_JOB_WAIT:  park the job until workpool_job_wake()
+ *    0:                  queue the job again at once
+ *    usec > 0:           park the job for usec or until workpool_job_wake()
+ */
+#define WORKPOOL_JOB_DONE   (-1L)
+#define WORKPOOL_JOB_WAIT   (-2L)
+
+typedef struct workpool *workpool_handle;
+typedef struct workpool_job *workpool_job_handle;
+typedef long (*workpool_job_cb)(void *arg);
+
+// workpool_create:
+//   workers <= 0 means one worker per online cpu core, attr->name is used
+//   as prefix of worker name, stacksize must fit the deepest job
+workpool_handle workpool_create(struct os_thread_attr *attr, int workers);
+// workpool_destroy:
+//   All jobs should be done before, jobs still pending are dropped
+void workpool_destroy(workpool_handle pool);
+
+int workpool_worker_count(workpool_handle pool);
+
+// workpool_job_create:
+//   Job is parked after created, call workpool_job_wake() to run it
+workpool_job_handle workpool_job_create(workpool_handle pool, workpool_job_cb run, void *arg);
+// workpool_job_wake:
+//   Queue a parked job, or run it again right after the running step.
+//   Never call it after the job returned WORKPOOL_JOB_DONE
+int workpool_job_wake(workpool_job_handle job);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SYSUTILS_WORKPOOL_H__ */
@@ -99,6 +99,7 @@ typedef struct {
     int client_cert_len;            /**< Client certification lenght, client_cert buffer size. */
     int client_pk_len;              /**< Client private key lenght, client_pk buffer size. */
     void *ssl;                      /**< Ssl content. */
+    void *session;                  /**< Ssl session to resume on connect, see #httpclient_get_session. */
 //#endif
 } httpclient_t;
 
@@ -295,6 +296,30 @@ int httpclient_get_response_header_value(char *header_buf, char *name, int *val_
  */
 void httpclient_set_custom_header(httpclient_t *client, char *header);
 
+/**
+ * @brief            This function checks if an idle connection is still usable, i.e. the peer
+ *                   has neither closed it nor sent anything unsolicited. It never blocks.
+ * @param[in]        client is a pointer to the #httpclient_t.
+ * @return           true, if a new request can be sent on the connection.
+ */
+bool httpclient_is_alive(httpclient_t *client);
+
+/**
+ * @brief            This function copies the TLS session of an established https connection, so
+ *                   that a later connection to the same server can resume it and skip the full
+ *                   handshake: set it to #httpclient_t.session before #httpclient_connect.
+ * @param[in]        client is a pointer to the #httpclient_t.
+ * @return           The session, NULL for http or if https is not supported.
+ *                   Release it with #httpclient_free_session.
+ */
+void *httpclient_get_session(httpclient_t *client);
+
+/**
+ * @brief            This function releases a session got by #httpclient_get_session.
+ * @param[in]        session is the session, can be NULL.
+ */
+void httpclient_free_session(void *session);
+
 /**
 * @}
 */
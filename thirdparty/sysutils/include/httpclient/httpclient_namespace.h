@@ -39,5 +39,8 @@
 #define httpclient_get_response_code           SYSUTILS_HTTPCLIENT_NAMESPACE(httpclient_get_response_code)
 #define httpclient_get_response_header_value   SYSUTILS_HTTPCLIENT_NAMESPACE(httpclient_get_response_header_value)
 #define httpclient_set_custom_header           SYSUTILS_HTTPCLIENT_NAMESPACE(httpclient_set_custom_header)
+#define httpclient_is_alive                    SYSUTILS_HTTPCLIENT_NAMESPACE(httpclient_is_alive)
+#define httpclient_get_session                 SYSUTILS_HTTPCLIENT_NAMESPACE(httpclient_get_session)
+#define httpclient_free_session                SYSUTILS_HTTPCLIENT_NAMESPACE(httpclient_free_session)
 
 #endif /* __SYSUTILS_HTTPCLIENT_NAMESPACE_H__ */
@@ -49,6 +49,8 @@ struct os_thread_attr {
 os_thread os_thread_create(struct os_thread_attr *attr, void *(*cb)(void *arg), void *arg);
 os_thread os_thread_self();
 unsigned long os_thread_default_stacksize();
+// Number of online cpu cores, at least 1
+int os_thread_cpu_count();
 int os_thread_join(os_thread thread, void **retval);
 int os_thread_detach(os_thread thread);
 
@@ -49,6 +49,7 @@
 #define os_thread_create               SYSUTILS_OSAL_NAMESPACE(os_thread_create)
 #define os_thread_self                 SYSUTILS_OSAL_NAMESPACE(os_thread_self)
 #define os_thread_default_stacksize    SYSUTILS_OSAL_NAMESPACE(os_thread_default_stacksize)
+#define os_thread_cpu_count            SYSUTILS_OSAL_NAMESPACE(os_thread_cpu_count)
 #define os_thread_join                 SYSUTILS_OSAL_NAMESPACE(os_thread_join)
 #define os_thread_detach               SYSUTILS_OSAL_NAMESPACE(os_thread_detach)
 #define os_mutex_create                SYSUTILS_OSAL_NAMESPACE(os_mutex_create)
@@ -167,6 +167,15 @@ unsigned long os_thread_default_stacksize()
     return (unsigned long)stacksize;
 }
 
+int os_thread_cpu_count()
+{
+#if defined(OS_FREERTOS_ESP32) && !defined(CONFIG_FREERTOS_UNICORE)
+    return 2;
+#else
+    return 1;
+#endif
+}
+
 int os_thread_join(os_thread thread, void **retval)
 {
     return pthread_join((pthread_t)thread, retval);
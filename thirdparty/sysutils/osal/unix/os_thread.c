@@ -129,6 +129,12 @@ unsigned long os_thread_default_stacksize()
     return (unsigned long)stacksize;
 }
 
+int os_thread_cpu_count()
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
 int os_thread_join(os_thread thread, void **retval)
 {
     return pthread_join((pthread_t)thread, retval);
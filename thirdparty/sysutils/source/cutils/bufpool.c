@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2018-2022 Qinglong<sysu.zqlong@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "osal/os_thread.h"
+#include "cutils/memory_helper.h"
+#include "cutils/log_helper.h"
+#include "cutils/list.h"
+#include "cutils/bufpool.h"
+
+#define LOG_TAG "bufpool"
+
+// Header in front of every block, padded to keep the data aligned
+struct bufpool_block {
+    struct listnode listnode; // in idle_list while idle
+    int size;
+};
+
+#define BUFPOOL_HEADER_SIZE  ((sizeof(struct bufpool_block) + 15) & ~15)
+
+struct bufpool {
+    os_mutex lock;
+    struct listnode idle_list; // sorted by size
+    int idle_count;
+    int used_count;
+    bool destroyed;            // freed once the last used block is put back
+};
+
+static inline void *bufpool_block_data(struct bufpool_block *block)
+{
+    return (char *)block + BUFPOOL_HEADER_SIZE;
+}
+
+static inline struct bufpool_block *bufpool_data_block(void *buf)
+{
+    return (struct bufpool_block *)((char *)buf - BUFPOOL_HEADER_SIZE);
+}
+
+static struct bufpool_block *bufpool_block_alloc(int size)
+{
+    struct bufpool_block *block = OS_MALLOC(BUFPOOL_HEADER_SIZE + size);
+    if (block == NULL)
+        return NULL;
+    block->size = size;
+    list_init(&block->listnode);
+    return block;
+}
+
+// Must be called with pool->lock held
+static void bufpool_add_idle(struct bufpool *pool, struct bufpool_block *block)
+{
+    struct bufpool_block *temp;
+    struct listnode *item;
+
+    pool->idle_count++;
+    list_for_each(item, &pool->idle_list) {
+        temp = listnode_to_item(item, struct bufpool_block, listnode);
+        if (temp->size >= block->size) {
+            list_add_before(&temp->listnode, &block->listnode);
+            return;
+        }
+    }
+    list_add_tail(&pool->idle_list, &block->listnode);
+}
+
+// Must be called with pool->lock held
+static void bufpool_free_idle(struct bufpool *pool)
+{
+    struct bufpool_block *block;
+    struct listnode *item, *tmp;
+
+    list_for_each_safe(item, tmp, &pool->idle_list) {
+        block = listnode_to_item(item, struct bufpool_block, listnode);
+        list_remove(item);
+        OS_FREE(block);
+    }
+    pool->idle_count = 0;
+}
+
+static void bufpool_free(struct bufpool *pool)
+{
+    if (pool->lock != NULL)
+        os_mutex_destroy(pool->lock);
+    OS_FREE(pool);
+}
+
+bufpool_handle bufpool_create()
+{
+    struct bufpool *pool = OS_CALLOC(1, sizeof(struct bufpool));
+    if (pool == NULL) {
+        OS_LOGE(LOG_TAG, "Failed to allocate pool");
+        return NULL;
+    }
+
+    pool->lock = os_mutex_create();
+    if (pool->lock == NULL) {
+        OS_LOGE(LOG_TAG, "Failed to create lock");
+        bufpool_free(pool);
+        return NULL;
+    }
+
+    list_init(&pool->idle_list);
+    return pool;
+}
+
+void bufpool_destroy(bufpool_handle pool)
+{
+    int used_count;
+
+    if (pool == NULL)
+        return;
+
+    os_mutex_lock(pool->lock);
+    bufpool_free_idle(pool);
+    used_count = pool->used_count;
+    pool->destroyed = true;
+    os_mutex_unlock(pool->lock);
+
+    if (used_count > 0)
+        OS_LOGD(LOG_TAG, "Destroy pool with %d blocks in use", used_count);
+    else
+        bufpool_free(pool);
+}
+
+int bufpool_reserve(bufpool_handle pool, int size, int count)
+{
+    struct bufpool_block *block;
+
+    if (pool == NULL || size <= 0)
+        return -1;
+
+    for (int i = 0; i < count; i++) {
+        block = bufpool_block_alloc(size);
+        if (block == NULL) {
+            OS_LOGE(LOG_TAG, "Failed to reserve block %d/%d of %d bytes", i, count, size);
+            return -1;
+        }
+        os_mutex_lock(pool->lock);
+        bufpool_add_idle(pool, block);
+        os_mutex_unlock(pool->lock);
+    }
+    return 0;
+}
+
+void *bufpool_get(bufpool_handle pool, int size)
+{
+    struct bufpool_block *block = NULL, *temp;
+    struct listnode *item;
+
+    if (size <= 0)
+        return NULL;
+    if (pool == NULL)
+        return OS_MALLOC(size);
+
+    os_mutex_lock(pool->lock);
+    list_for_each(item, &pool->idle_list) {
+        temp = listnode_to_item(item, struct bufpool_block, listnode);
+        if (temp->size >= size) {
+            // Don't tie up a much bigger block for a small request
+            if (temp->size / 2 <= size) {
+                block = temp;
+                list_remove(&block->listnode);
+                pool->idle_count--;
+            }
+            break;
+        }
+    }
+    pool->used_count++;
+    os_mutex_unlock(pool->lock);
+
+    if (block == NULL) {
+        block = bufpool_block_alloc(size);
+        if (block == NULL) {
+            os_mutex_lock(pool->lock);
+            pool->used_count--;
+            os_mutex_unlock(pool->lock);
+            return NULL;
+        }
+        OS_LOGV(LOG_TAG, "New block of %d bytes", size);
+    }
+    return bufpool_block_data(block);
+}
+
+void bufpool_put(bufpool_handle pool, void *buf)
+{
+    struct bufpool_block *block;
+    bool destroyed, last;
+
+    if (buf == NULL)
+        return;
+    if (pool == NULL) {
+        OS_FREE(buf);
+        return;
+    }
+
+    block = bufpool_data_block(buf);
+    os_mutex_lock(pool->lock);
+    pool->used_count--;
+    destroyed = pool->destroyed;
+    last = destroyed && pool->used_count == 0;
+    if (!destroyed)
+        bufpool_add_idle(pool, block);
+    os_mutex_unlock(pool->lock);
+
+    if (destroyed)
+        OS_FREE(block);
+    if (last)
+        bufpool_free(pool);
+}
+
+void bufpool_trim(bufpool_handle pool)
+{
+    if (pool == NULL)
+        return;
+
+    os_mutex_lock(pool->lock);
+    bufpool_free_idle(pool);
+    os_mutex_unlock(pool->lock);
+}
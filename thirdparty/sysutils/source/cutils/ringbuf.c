@@ -34,11 +34,32 @@
 
 #define LOG_TAG "ringbuf"
 
+#if !defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+#define RB_SPSC_SUPPORTED           1
+#define ATOMIC_DECLARE(obj)         atomic_int obj
+#define ATOMIC_INIT(obj, val)       atomic_init(&(obj), val)
+#define ATOMIC_LOAD(obj)            atomic_load(&(obj))
+#define ATOMIC_STORE(obj, val)      atomic_store(&(obj), val)
+#define ATOMIC_FETCH_ADD(obj, val)  atomic_fetch_add(&(obj), val)
+#define ATOMIC_FETCH_SUB(obj, val)  atomic_fetch_sub(&(obj), val)
+#else
+// Without atomics, rb_create_spsc() falls back to the locked ringbuffer,
+// fill_cnt is then only touched with rb->lock held.
+#define RB_SPSC_SUPPORTED           0
+#define ATOMIC_DECLARE(obj)         int obj
+#define ATOMIC_INIT(obj, val)       obj = val
+#define ATOMIC_LOAD(obj)            obj
+#define ATOMIC_STORE(obj, val)      obj = val
+#define ATOMIC_FETCH_ADD(obj, val)  obj += val
+#define ATOMIC_FETCH_SUB(obj, val)  obj -= val
+#endif
+
 struct ringbuf {
     char *p_o;                   /**< Original pointer */
     char *volatile p_r;          /**< Read pointer */
     char *volatile p_w;          /**< Write pointer */
-    int  fill_cnt;               /**< Number of filled slots */
+    ATOMIC_DECLARE(fill_cnt);    /**< Number of filled slots */
     int  threshold_cnt;          /**< Number of threshold slots */
     int  size;                   /**< Buffer size */
     os_cond can_read;
@@ -48,10 +69,15 @@ struct ringbuf {
     bool abort_write;
     bool is_done_write;          /**< To signal that we are done writing */
     bool unblock_reader_flag;    /**< To unblock instantly from rb_read */
-    bool is_reach_threshold;
+    volatile bool is_reach_threshold;
+    bool spsc;                   /**< Single-producer/single-consumer, see rb_create_spsc() */
+    ATOMIC_DECLARE(reader_waiting); /**< Reader is (about to be) blocked on can_read */
+    ATOMIC_DECLARE(writer_waiting); /**< Writer is (about to be) blocked on can_write */
+    ATOMIC_DECLARE(reader_busy); /**< Reader is on the lock-free path, see rb_resize() */
+    ATOMIC_DECLARE(resizing);    /**< Lock-free reads are held off, see rb_resize() */
 };
 
-ringbuf_handle rb_create(int size)
+static ringbuf_handle rb_create_internal(int size, bool spsc)
 {
     ringbuf_handle rb;
     char *buf = NULL;
@@ -75,9 +101,25 @@ ringbuf_handle rb_create(int size)
     rb->unblock_reader_flag = false;
     rb->abort_read = false;
     rb->abort_write = false;
+    rb->spsc = spsc && RB_SPSC_SUPPORTED;
+    ATOMIC_INIT(rb->fill_cnt, 0);
+    ATOMIC_INIT(rb->reader_waiting, 0);
+    ATOMIC_INIT(rb->writer_waiting, 0);
+    ATOMIC_INIT(rb->reader_busy, 0);
+    ATOMIC_INIT(rb->resizing, 0);
     return rb;
 }
 
+ringbuf_handle rb_create(int size)
+{
+    return rb_create_internal(size, false);
+}
+
+ringbuf_handle rb_create_spsc(int size)
+{
+    return rb_create_internal(size, true);
+}
+
 void rb_destroy(ringbuf_handle rb)
 {
     if (rb == NULL)
@@ -97,37 +139,186 @@ void rb_reset(ringbuf_handle rb)
 {
     os_mutex_lock(rb->lock);
     rb->p_r = rb->p_w = rb->p_o;
-    rb->fill_cnt = 0;
+    ATOMIC_STORE(rb->fill_cnt, 0);
     rb->is_done_write = false;
     rb->unblock_reader_flag = false;
     rb->abort_read = false;
     rb->abort_write = false;
+    rb->is_reach_threshold = false;
     os_cond_signal(rb->can_write);
     os_mutex_unlock(rb->lock);
 }
 
 int rb_bytes_available(ringbuf_handle rb)
 {
-    return (rb->size - rb->fill_cnt);
+    return (rb->size - ATOMIC_LOAD(rb->fill_cnt));
 }
 
 int rb_bytes_filled(ringbuf_handle rb)
 {
-    return rb->fill_cnt;
+    return ATOMIC_LOAD(rb->fill_cnt);
+}
+
+static void rb_copy_out(ringbuf_handle rb, char *buf, int len)
+{
+    if ((rb->p_r + len) > (rb->p_o + rb->size)) {
+        int rlen1 = rb->p_o + rb->size - rb->p_r;
+        int rlen2 = len - rlen1;
+        memcpy(buf, rb->p_r, rlen1);
+        memcpy(buf + rlen1, rb->p_o, rlen2);
+        rb->p_r = rb->p_o + rlen2;
+    } else {
+        memcpy(buf, rb->p_r, len);
+        rb->p_r = rb->p_r + len;
+    }
+}
+
+static void rb_copy_in(ringbuf_handle rb, char *buf, int len)
+{
+    if ((rb->p_w + len) > (rb->p_o + rb->size)) {
+        int wlen1 = rb->p_o + rb->size - rb->p_w;
+        int wlen2 = len - wlen1;
+        memcpy(rb->p_w, buf, wlen1);
+        memcpy(rb->p_o, buf + wlen1, wlen2);
+        rb->p_w = rb->p_o + wlen2;
+    } else {
+        memcpy(rb->p_w, buf, len);
+        rb->p_w = rb->p_w + len;
+    }
+}
+
+/*
+ * Consume/produce bookkeeping. Threshold is raised before fill_cnt is
+ * published, so a spsc reader which observes the new fill_cnt also
+ * observes the threshold state that goes with it.
+ */
+static void rb_consumed(ringbuf_handle rb, int len)
+{
+    ATOMIC_FETCH_SUB(rb->fill_cnt, len);
+}
+
+static void rb_produced(ringbuf_handle rb, int len)
+{
+    if (!rb->is_reach_threshold && ATOMIC_LOAD(rb->fill_cnt) + len >= rb->threshold_cnt)
+        rb->is_reach_threshold = true;
+    ATOMIC_FETCH_ADD(rb->fill_cnt, len);
+}
+
+/*
+ * Reader is about to block on a starved ringbuffer, with rb->lock held.
+ * Wait for the threshold to be filled again rather than resuming on the
+ * first bytes written, a no-op with the default threshold of 0.
+ */
+static void rb_starved(ringbuf_handle rb)
+{
+    if (rb->threshold_cnt > 0 && ATOMIC_LOAD(rb->fill_cnt) < rb->threshold_cnt)
+        rb->is_reach_threshold = false;
+}
+
+/*
+ * Block on cond with rb->lock held. In spsc mode the peer updates fill_cnt
+ * without the lock, so announce the waiter first and re-check fill_cnt
+ * against the value the caller decided on: either the peer sees the flag
+ * and signals under the lock, or we see its update and don't sleep.
+ */
+static int rb_wait(ringbuf_handle rb, bool reader, int filled, unsigned int timeout_ms)
+{
+    os_cond cond = reader ? rb->can_read : rb->can_write;
+    int ret;
+
+#if RB_SPSC_SUPPORTED
+    if (rb->spsc) {
+        if (reader)
+            ATOMIC_STORE(rb->reader_waiting, 1);
+        else
+            ATOMIC_STORE(rb->writer_waiting, 1);
+        if (ATOMIC_LOAD(rb->fill_cnt) != filled) {
+            ret = 0;
+            goto wait_out;
+        }
+    }
+#endif
+
+    if (timeout_ms == 0)
+        ret = os_cond_wait(cond, rb->lock);
+    else
+        ret = os_cond_timedwait(cond, rb->lock, timeout_ms*1000);
+
+#if RB_SPSC_SUPPORTED
+wait_out:
+    if (rb->spsc) {
+        if (reader)
+            ATOMIC_STORE(rb->reader_waiting, 0);
+        else
+            ATOMIC_STORE(rb->writer_waiting, 0);
+    }
+#endif
+    return ret;
+}
+
+#if RB_SPSC_SUPPORTED
+// Lock-free path for spsc ringbuffers, return true if the whole request was served
+static bool rb_try_read_spsc(ringbuf_handle rb, char *buf, int len)
+{
+    if (!rb->spsc || len <= 0)
+        return false;
+    ATOMIC_STORE(rb->reader_busy, 1);
+    if (ATOMIC_LOAD(rb->resizing) || ATOMIC_LOAD(rb->fill_cnt) < len || !rb->is_reach_threshold) {
+        ATOMIC_STORE(rb->reader_busy, 0);
+        return false;
+    }
+
+    rb_copy_out(rb, buf, len);
+    rb_consumed(rb, len);
+    ATOMIC_STORE(rb->reader_busy, 0);
+
+    if (ATOMIC_LOAD(rb->writer_waiting)) {
+        os_mutex_lock(rb->lock);
+        os_cond_signal(rb->can_write);
+        os_mutex_unlock(rb->lock);
+    }
+    return true;
+}
+
+static bool rb_try_write_spsc(ringbuf_handle rb, char *buf, int len)
+{
+    if (!rb->spsc || len <= 0)
+        return false;
+    if (rb->size - ATOMIC_LOAD(rb->fill_cnt) < len)
+        return false;
+
+    rb_copy_in(rb, buf, len);
+    rb_produced(rb, len);
+
+    if (rb->is_reach_threshold && ATOMIC_LOAD(rb->reader_waiting)) {
+        os_mutex_lock(rb->lock);
+        os_cond_signal(rb->can_read);
+        os_mutex_unlock(rb->lock);
+    }
+    return true;
 }
+#else
+#define rb_try_read_spsc(rb, buf, len)  false
+#define rb_try_write_spsc(rb, buf, len) false
+#endif
 
 int rb_read(ringbuf_handle rb, char *buf, int buf_len, unsigned int timeout_ms)
 {
     int read_size = 0;
     int total_read_size = 0;
     int ret_val = 0;
+    int filled;
+
+    if (rb_try_read_spsc(rb, buf, buf_len))
+        return buf_len;
 
     //take buffer lock
     os_mutex_lock(rb->lock);
 
     while (buf_len > 0) {
-        if (rb->fill_cnt < buf_len) {
-            read_size = rb->fill_cnt;
+        filled = ATOMIC_LOAD(rb->fill_cnt);
+        if (filled < buf_len) {
+            read_size = filled;
             /**
              * When non-multiple of 4(word size) bytes are written to I2S, there is noise.
              * Below is the kind of workaround to read only in multiple of 4. Avoids noise when rb is read in small chunks.
@@ -155,12 +346,10 @@ int rb_read(ringbuf_handle rb, char *buf, int buf_len, unsigned int timeout_ms)
                 ret_val = RB_TIMEOUT;
                 goto read_err;
             }
+            rb_starved(rb);
             os_cond_signal(rb->can_write);
             //wait till some data available to read
-            if (timeout_ms == 0)
-                ret_val = os_cond_wait(rb->can_read, rb->lock);
-            else
-                ret_val = os_cond_timedwait(rb->can_read, rb->lock, timeout_ms*1000);
+            ret_val = rb_wait(rb, true, filled, timeout_ms);
             if (ret_val != 0) {
                 ret_val = RB_TIMEOUT;
                 goto read_err;
@@ -168,19 +357,10 @@ int rb_read(ringbuf_handle rb, char *buf, int buf_len, unsigned int timeout_ms)
             continue;
         }
 
-        if ((rb->p_r + read_size) > (rb->p_o + rb->size)) {
-            int rlen1 = rb->p_o + rb->size - rb->p_r;
-            int rlen2 = read_size - rlen1;
-            memcpy(buf, rb->p_r, rlen1);
-            memcpy(buf + rlen1, rb->p_o, rlen2);
-            rb->p_r = rb->p_o + rlen2;
-        } else {
-            memcpy(buf, rb->p_r, read_size);
-            rb->p_r = rb->p_r + read_size;
-        }
+        rb_copy_out(rb, buf, read_size);
 
         buf_len -= read_size;
-        rb->fill_cnt -= read_size;
+        rb_consumed(rb, read_size);
         total_read_size += read_size;
         buf += read_size;
     }
@@ -201,12 +381,17 @@ int rb_write(ringbuf_handle rb, char *buf, int buf_len, unsigned int timeout_ms)
     int write_size = 0;
     int total_write_size = 0;
     int ret_val = 0;
+    int filled;
+
+    if (rb_try_write_spsc(rb, buf, buf_len))
+        return buf_len;
 
     //take buffer lock
     os_mutex_lock(rb->lock);
 
     while (buf_len > 0) {
-        write_size = rb_bytes_available(rb);
+        filled = ATOMIC_LOAD(rb->fill_cnt);
+        write_size = rb->size - filled;
         if (buf_len < write_size) {
             write_size = buf_len;
         }
@@ -222,12 +407,11 @@ int rb_write(ringbuf_handle rb, char *buf, int buf_len, unsigned int timeout_ms)
                 rb->is_reach_threshold = true;
                 goto write_err;
             }
+            // Full is as far as the reader can wait for
+            rb->is_reach_threshold = true;
             os_cond_signal(rb->can_read);
             //wait till we have some empty space to write
-            if (timeout_ms == 0)
-                ret_val = os_cond_wait(rb->can_write, rb->lock);
-            else
-                ret_val = os_cond_timedwait(rb->can_write, rb->lock, timeout_ms*1000);
+            ret_val = rb_wait(rb, false, filled, timeout_ms);
             if (ret_val != 0) {
                 ret_val = RB_TIMEOUT;
                 goto write_err;
@@ -235,24 +419,12 @@ int rb_write(ringbuf_handle rb, char *buf, int buf_len, unsigned int timeout_ms)
             continue;
         }
 
-        if ((rb->p_w + write_size) > (rb->p_o + rb->size)) {
-            int wlen1 = rb->p_o + rb->size - rb->p_w;
-            int wlen2 = write_size - wlen1;
-            memcpy(rb->p_w, buf, wlen1);
-            memcpy(rb->p_o, buf + wlen1, wlen2);
-            rb->p_w = rb->p_o + wlen2;
-        } else {
-            memcpy(rb->p_w, buf, write_size);
-            rb->p_w = rb->p_w + write_size;
-        }
+        rb_copy_in(rb, buf, write_size);
 
         buf_len -= write_size;
-        rb->fill_cnt += write_size;
+        rb_produced(rb, write_size);
         total_write_size += write_size;
         buf += write_size;
-
-        if (!rb->is_reach_threshold && rb->fill_cnt >= rb->threshold_cnt)
-            rb->is_reach_threshold = true;
     }
 
 write_err:
@@ -271,14 +443,19 @@ int rb_read_chunk(ringbuf_handle rb, char *buf, int size, unsigned int timeout_m
     int read_size = size;
     int total_read_size = 0;
     int ret_val = 0;
+    int filled;
+
+    if (rb_try_read_spsc(rb, buf, size))
+        return size;
 
     //take buffer lock
     os_mutex_lock(rb->lock);
 
 wait_filled:
-    if (rb->fill_cnt < size) {
+    filled = ATOMIC_LOAD(rb->fill_cnt);
+    if (filled < size) {
         if (rb->is_done_write)
-            read_size = rb->fill_cnt;
+            read_size = filled;
         else
             read_size = 0;
     } else {
@@ -303,12 +480,10 @@ wait_filled:
             ret_val = RB_FAIL;
             goto read_done;
         }
+        rb_starved(rb);
         os_cond_signal(rb->can_write);
         //wait till some data available to read
-        if (timeout_ms == 0)
-            ret_val = os_cond_wait(rb->can_read, rb->lock);
-        else
-            ret_val = os_cond_timedwait(rb->can_read, rb->lock, timeout_ms*1000);
+        ret_val = rb_wait(rb, true, filled, timeout_ms);
         if (ret_val != 0) {
             ret_val = RB_TIMEOUT;
             goto read_done;
@@ -316,17 +491,8 @@ wait_filled:
         goto wait_filled;
     }
 
-    if ((rb->p_r + read_size) > (rb->p_o + rb->size)) {
-        int rlen1 = rb->p_o + rb->size - rb->p_r;
-        int rlen2 = read_size - rlen1;
-        memcpy(buf, rb->p_r, rlen1);
-        memcpy(buf + rlen1, rb->p_o, rlen2);
-        rb->p_r = rb->p_o + rlen2;
-    } else {
-        memcpy(buf, rb->p_r, read_size);
-        rb->p_r = rb->p_r + read_size;
-    }
-    rb->fill_cnt -= read_size;
+    rb_copy_out(rb, buf, read_size);
+    rb_consumed(rb, read_size);
     total_read_size += read_size;
 
 read_done:
@@ -345,14 +511,19 @@ int rb_write_chunk(ringbuf_handle rb, char *buf, int size, unsigned int timeout_
     int write_size = 0;
     int total_write_size = 0;
     int ret_val = 0;
+    int filled;
+
+    if (rb_try_write_spsc(rb, buf, size))
+        return size;
 
     //take buffer lock
     os_mutex_lock(rb->lock);
 
 wait_available:
-    if (rb_bytes_available(rb) < size) {
+    filled = ATOMIC_LOAD(rb->fill_cnt);
+    if (rb->size - filled < size) {
         if (rb->is_done_write)
-            write_size = rb_bytes_available(rb);
+            write_size = rb->size - filled;
         else
             write_size = 0;
     } else {
@@ -375,12 +546,10 @@ wait_available:
             rb->is_reach_threshold = true;
             goto write_done;
         }
+        rb->is_reach_threshold = true;
         os_cond_signal(rb->can_read);
         //wait till we have some empty space to write
-        if (timeout_ms == 0)
-            ret_val = os_cond_wait(rb->can_write, rb->lock);
-        else
-            ret_val = os_cond_timedwait(rb->can_write, rb->lock, timeout_ms*1000);
+        ret_val = rb_wait(rb, false, filled, timeout_ms);
         if (ret_val != 0) {
             ret_val = RB_TIMEOUT;
             goto write_done;
@@ -388,22 +557,10 @@ wait_available:
         goto wait_available;
     }
 
-    if ((rb->p_w + write_size) > (rb->p_o + rb->size)) {
-        int wlen1 = rb->p_o + rb->size - rb->p_w;
-        int wlen2 = write_size - wlen1;
-        memcpy(rb->p_w, buf, wlen1);
-        memcpy(rb->p_o, buf + wlen1, wlen2);
-        rb->p_w = rb->p_o + wlen2;
-    } else {
-        memcpy(rb->p_w, buf, write_size);
-        rb->p_w = rb->p_w + write_size;
-    }
-    rb->fill_cnt += write_size;
+    rb_copy_in(rb, buf, write_size);
+    rb_produced(rb, write_size);
     total_write_size += write_size;
 
-    if (!rb->is_reach_threshold && rb->fill_cnt >= rb->threshold_cnt)
-        rb->is_reach_threshold = true;
-
 write_done:
     if (rb->is_reach_threshold && total_write_size > 0) {
         os_cond_signal(rb->can_read);
@@ -439,13 +596,15 @@ void rb_abort(ringbuf_handle rb)
 
 bool rb_is_full(ringbuf_handle rb)
 {
-    return (rb->size == rb->fill_cnt);
+    return (rb->size == ATOMIC_LOAD(rb->fill_cnt));
 }
 
 void rb_done_write(ringbuf_handle rb)
 {
     os_mutex_lock(rb->lock);
     rb->is_done_write = true;
+    // Nothing more is coming, let the reader drain what's below the threshold
+    rb->is_reach_threshold = true;
     os_cond_signal(rb->can_read);
     os_mutex_unlock(rb->lock);
 }
@@ -480,6 +639,11 @@ void rb_set_threshold(ringbuf_handle rb, int threshold)
 {
     os_mutex_lock(rb->lock);
     rb->threshold_cnt = threshold <= rb->size ? threshold : rb->size;
+    if (!rb->is_reach_threshold && ATOMIC_LOAD(rb->fill_cnt) >= rb->threshold_cnt &&
+        ATOMIC_LOAD(rb->fill_cnt) > 0) {
+        rb->is_reach_threshold = true;
+        os_cond_signal(rb->can_read);
+    }
     os_mutex_unlock(rb->lock);
 }
 
@@ -492,3 +656,52 @@ bool rb_reach_threshold(ringbuf_handle rb)
 {
     return rb->is_reach_threshold;
 }
+
+int rb_resize(ringbuf_handle rb, int size)
+{
+    if (size <= 0)
+        return RB_FAIL;
+    if (size == rb->size)
+        return RB_OK;
+
+    char *buf = OS_MALLOC(size);
+    if (buf == NULL)
+        return RB_FAIL;
+
+    os_mutex_lock(rb->lock);
+
+    int filled = ATOMIC_LOAD(rb->fill_cnt);
+    if (filled > size) {
+        os_mutex_unlock(rb->lock);
+        OS_FREE(buf);
+        return RB_FAIL;
+    }
+
+#if RB_SPSC_SUPPORTED
+    // Hold off lock-free reads, and wait for the one in flight to finish
+    if (rb->spsc) {
+        ATOMIC_STORE(rb->resizing, 1);
+        while (ATOMIC_LOAD(rb->reader_busy))
+            os_thread_sleep_usec(100);
+        filled = ATOMIC_LOAD(rb->fill_cnt);
+    }
+#endif
+
+    char *old = rb->p_o;
+    rb_copy_out(rb, buf, filled);
+    rb->p_o = rb->p_r = buf;
+    rb->p_w = filled < size ? buf + filled : buf;
+    rb->size = size;
+    if (rb->threshold_cnt > size)
+        rb->threshold_cnt = size;
+
+#if RB_SPSC_SUPPORTED
+    if (rb->spsc)
+        ATOMIC_STORE(rb->resizing, 0);
+#endif
+
+    os_cond_signal(rb->can_write);
+    os_mutex_unlock(rb->lock);
+    OS_FREE(old);
+    return RB_OK;
+}
@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) 2018-2022 Qinglong<sysu.zqlong@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "osal/os_thread.h"
+#include "osal/os_time.h"
+#include "cutils/memory_helper.h"
+#include "cutils/log_helper.h"
+#include "cutils/list.h"
+#include "cutils/workpool.h"
+
+#define LOG_TAG "workpool"
+
+enum workpool_job_state {
+    WORKPOOL_JOB_IDLE,
+    WORKPOOL_JOB_QUEUED,
+    WORKPOOL_JOB_SLEEPING,
+    WORKPOOL_JOB_RUNNING,
+};
+
+struct workpool_job {
+    struct workpool *pool;
+    workpool_job_cb run;
+    void *arg;
+    enum workpool_job_state state;
+    bool woken;              // woken while running, queue again after this step
+    unsigned long long when; // wakeup time if sleeping
+    struct listnode listnode; // in a worker queue or the sleep list
+    struct listnode poolnode; // in the pool job list until done
+};
+
+struct workpool_worker {
+    struct workpool *pool;
+    os_thread thread_id;
+    char thread_name[32];
+    struct listnode job_list;
+};
+
+struct workpool {
+    os_mutex lock;
+    os_cond cond;
+    struct workpool_worker *workers;
+    int worker_count;
+    int job_count;        // created and not done
+    struct listnode job_list;   // created and not done, freed when destroy
+    unsigned int next;    // worker for jobs woken outside the pool
+    struct listnode sleep_list; // sorted by when
+    bool exit;
+};
+
+// Must be called with pool->lock held
+static void workpool_queue_job(struct workpool *pool, struct workpool_job *job, int worker)
+{
+    job->state = WORKPOOL_JOB_QUEUED;
+    list_add_tail(&pool->workers[worker].job_list, &job->listnode);
+    os_cond_signal(pool->cond);
+}
+
+// Must be called with pool->lock held
+static void workpool_sleep_job(struct workpool *pool, struct workpool_job *job, unsigned long long when)
+{
+    struct workpool_job *temp;
+    struct listnode *item;
+
+    job->state = WORKPOOL_JOB_SLEEPING;
+    job->when = when;
+    list_for_each_reverse(item, &pool->sleep_list) {
+        temp = listnode_to_item(item, struct workpool_job, listnode);
+        if (when >= temp->when) {
+            list_add_after(&temp->listnode, &job->listnode);
+            return;
+        }
+    }
+    list_add_head(&pool->sleep_list, &job->listnode);
+    // Earliest wakeup changed, let an idle worker wait for it
+    os_cond_signal(pool->cond);
+}
+
+// Must be called with pool->lock held. Own queue first in FIFO order, then
+// steal the latest job of other workers, which is the least likely to be
+// picked up soon by its owner
+static struct workpool_job *workpool_take_job(struct workpool *pool, int worker)
+{
+    struct listnode *item = NULL;
+
+    if (!list_empty(&pool->workers[worker].job_list)) {
+        item = list_head(&pool->workers[worker].job_list);
+    } else {
+        for (int i = 1; i < pool->worker_count; i++) {
+            struct workpool_worker *victim = &pool->workers[(worker + i) % pool->worker_count];
+            if (!list_empty(&victim->job_list)) {
+                item = list_tail(&victim->job_list);
+                break;
+            }
+        }
+    }
+    if (item == NULL)
+        return NULL;
+    list_remove(item);
+    return listnode_to_item(item, struct workpool_job, listnode);
+}
+
+static void *workpool_thread_entry(void *arg)
+{
+    struct workpool_worker *worker = (struct workpool_worker *)arg;
+    struct workpool *pool = worker->pool;
+    int index = worker - pool->workers;
+    struct workpool_job *job;
+    unsigned long long now;
+    long ret;
+
+    OS_LOGD(LOG_TAG, "[%s]: Entry worker thread", worker->thread_name);
+
+    os_mutex_lock(pool->lock);
+
+    while (!pool->exit) {
+        now = os_monotonic_usec();
+        while (!list_empty(&pool->sleep_list)) {
+            job = listnode_to_item(list_head(&pool->sleep_list), struct workpool_job, listnode);
+            if (job->when > now)
+                break;
+            list_remove(&job->listnode);
+            workpool_queue_job(pool, job, index);
+        }
+
+        job = workpool_take_job(pool, index);
+        if (job == NULL) {
+            if (!list_empty(&pool->sleep_list)) {
+                job = listnode_to_item(list_head(&pool->sleep_list), struct workpool_job, listnode);
+                os_cond_timedwait(pool->cond, pool->lock, (unsigned long)(job->when - now));
+            } else {
+                os_cond_wait(pool->cond, pool->lock);
+            }
+            continue;
+        }
+
+        job->state = WORKPOOL_JOB_RUNNING;
+        job->woken = false;
+        os_mutex_unlock(pool->lock);
+
+        ret = job->run(job->arg);
+
+        os_mutex_lock(pool->lock);
+        if (ret == WORKPOOL_JOB_DONE) {
+            pool->job_count--;
+            list_remove(&job->poolnode);
+            OS_FREE(job);
+        } else if (job->woken || ret == 0) {
+            workpool_queue_job(pool, job, index);
+        } else if (ret == WORKPOOL_JOB_WAIT) {
+            job->state = WORKPOOL_JOB_IDLE;
+        } else {
+            workpool_sleep_job(pool, job, os_monotonic_usec() + ret);
+        }
+    }
+
+    os_mutex_unlock(pool->lock);
+
+    OS_LOGD(LOG_TAG, "[%s]: Leave worker thread", worker->thread_name);
+    return NULL;
+}
+
+workpool_handle workpool_create(struct os_thread_attr *attr, int workers)
+{
+    struct workpool *pool = OS_CALLOC(1, sizeof(struct workpool));
+    if (pool == NULL) {
+        OS_LOGE(LOG_TAG, "Failed to allocate pool");
+        return NULL;
+    }
+
+    if (workers <= 0)
+        workers = os_thread_cpu_count();
+    list_init(&pool->job_list);
+
+    pool->lock = os_mutex_create();
+    if (pool->lock == NULL) {
+        OS_LOGE(LOG_TAG, "Failed to create lock");
+        goto fail_create;
+    }
+
+    pool->cond = os_cond_create();
+    if (pool->cond == NULL) {
+        OS_LOGE(LOG_TAG, "Failed to create cond");
+        goto fail_create;
+    }
+
+    pool->workers = OS_CALLOC(workers, sizeof(struct workpool_worker));
+    if (pool->workers == NULL) {
+        OS_LOGE(LOG_TAG, "Failed to allocate workers");
+        goto fail_create;
+    }
+
+    list_init(&pool->sleep_list);
+    pool->worker_count = workers;
+    for (int i = 0; i < workers; i++) {
+        pool->workers[i].pool = pool;
+        list_init(&pool->workers[i].job_list);
+    }
+
+    struct os_thread_attr thread_attr = {
+        .name = NULL,
+        .priority = attr != NULL ? attr->priority : OS_THREAD_PRIO_NORMAL,
+        .stacksize = (attr != NULL && attr->stacksize > 0) ? attr->stacksize : os_thread_default_stacksize(),
+        .joinable = true, // force joinable, wait exit when workpool_destroy
+    };
+    for (int i = 0; i < workers; i++) {
+        struct workpool_worker *worker = &pool->workers[i];
+        snprintf(worker->thread_name, sizeof(worker->thread_name), "%s-%d",
+                 (attr != NULL && attr->name != NULL) ? attr->name : "workpool", i);
+        thread_attr.name = worker->thread_name;
+        worker->thread_id = os_thread_create(&thread_attr, workpool_thread_entry, worker);
+        if (worker->thread_id == NULL) {
+            OS_LOGE(LOG_TAG, "[%s]: Failed to run worker thread", worker->thread_name);
+            goto fail_create;
+        }
+    }
+
+    OS_LOGD(LOG_TAG, "Created pool with %d workers", pool->worker_count);
+    return pool;
+
+fail_create:
+    workpool_destroy(pool);
+    return NULL;
+}
+
+void workpool_destroy(workpool_handle pool)
+{
+    struct workpool_job *job;
+    struct listnode *item, *tmp;
+
+    if (pool == NULL)
+        return;
+
+    if (pool->lock != NULL) {
+        os_mutex_lock(pool->lock);
+        pool->exit = true;
+        if (pool->cond != NULL)
+            os_cond_broadcast(pool->cond);
+        os_mutex_unlock(pool->lock);
+    }
+
+    for (int i = 0; pool->workers != NULL && i < pool->worker_count; i++) {
+        if (pool->workers[i].thread_id != NULL)
+            os_thread_join(pool->workers[i].thread_id, NULL);
+    }
+
+    if (pool->job_count > 0)
+        OS_LOGW(LOG_TAG, "Destroy pool with %d jobs not done", pool->job_count);
+    // Queued, sleeping and parked jobs alike, workers are gone
+    list_for_each_safe(item, tmp, &pool->job_list) {
+        job = listnode_to_item(item, struct workpool_job, poolnode);
+        list_remove(item);
+        OS_FREE(job);
+    }
+
+    if (pool->workers != NULL)
+        OS_FREE(pool->workers);
+    if (pool->cond != NULL)
+        os_cond_destroy(pool->cond);
+    if (pool->lock != NULL)
+        os_mutex_destroy(pool->lock);
+    OS_FREE(pool);
+}
+
+int workpool_worker_count(workpool_handle pool)
+{
+    return pool->worker_count;
+}
+
+workpool_job_handle workpool_job_create(workpool_handle pool, workpool_job_cb run, void *arg)
+{
+    struct workpool_job *job = OS_CALLOC(1, sizeof(struct workpool_job));
+    if (job == NULL) {
+        OS_LOGE(LOG_TAG, "Failed to allocate job");
+        return NULL;
+    }
+
+    job->pool = pool;
+    job->run = run;
+    job->arg = arg;
+    job->state = WORKPOOL_JOB_IDLE;
+    list_init(&job->listnode);
+
+    os_mutex_lock(pool->lock);
+    list_add_tail(&pool->job_list, &job->poolnode);
+    pool->job_count++;
+    os_mutex_unlock(pool->lock);
+    return job;
+}
+
+int workpool_job_wake(workpool_job_handle job)
+{
+    struct workpool *pool = job->pool;
+
+    os_mutex_lock(pool->lock);
+
+    switch (job->state) {
+    case WORKPOOL_JOB_SLEEPING:
+        list_remove(&job->listnode);
+        // fall through
+    case WORKPOOL_JOB_IDLE:
+        workpool_queue_job(pool, job, pool->next++ % pool->worker_count);
+        break;
+    case WORKPOOL_JOB_RUNNING:
+        job->woken = true;
+        break;
+    default:
+        break;
+    }
+
+    os_mutex_unlock(pool->lock);
+    return 0;
+}
@@ -20,6 +20,7 @@
 
 #include <stdint.h>
 #include <string.h>
+#include <errno.h>
 #include "osal/os_thread.h"
 #include "cutils/memory_helper.h"
 #include "cutils/log_helper.h"
@@ -414,6 +415,13 @@ static int httpclient_ssl_conn(httpclient_t *client, char *host)
         goto ssl_conn_exit;
     }
 
+    /* Resume the session of a previous connection if any, the server may refuse it
+     * and fall back to a full handshake */
+    if (client->session != NULL) {
+        if ((value = mbedtls_ssl_set_session(&ssl->ssl_ctx, (mbedtls_ssl_session *)client->session)) != 0)
+            WARN("mbedtls_ssl_set_session failed: %d", value);
+    }
+
     mbedtls_ssl_set_bio(&ssl->ssl_ctx, &ssl->net_ctx, mbedtls_net_send, mbedtls_net_recv, NULL);
 
     /* Handshake */
@@ -463,6 +471,7 @@ static void httpclient_ssl_close(httpclient_t *client)
     mbedtls_ctr_drbg_free(&ssl->ctr_drbg);
     mbedtls_entropy_free(&ssl->entropy);
     OS_FREE(ssl);
+    client->ssl = NULL;
 }
 #endif
 
@@ -1261,3 +1270,65 @@ void httpclient_set_custom_header(httpclient_t *client, char *header)
 {
     client->header = header ;
 }
+
+bool httpclient_is_alive(httpclient_t *client)
+{
+    char buf[1];
+    int ret;
+
+    if (client->socket < 0)
+        return false;
+
+#ifdef SYSUTILS_HAVE_MBEDTLS_ENABLED
+    if (client->is_https) {
+        httpclient_ssl_t *ssl = (httpclient_ssl_t *)client->ssl;
+        if (ssl == NULL || mbedtls_ssl_get_bytes_avail(&ssl->ssl_ctx) > 0)
+            return false;
+    }
+#endif
+
+    /* Idle connection must have nothing to read: EOF means closed by peer, and any
+     * data (including a TLS close_notify alert) means it can't carry a new request */
+    ret = recv(client->socket, buf, sizeof(buf), MSG_PEEK | MSG_DONTWAIT);
+    if (ret == 0)
+        return false;
+    if (ret < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    return false;
+}
+
+void *httpclient_get_session(httpclient_t *client)
+{
+#ifdef SYSUTILS_HAVE_MBEDTLS_ENABLED
+    httpclient_ssl_t *ssl = (httpclient_ssl_t *)client->ssl;
+    mbedtls_ssl_session *session;
+    int ret;
+
+    if (!client->is_https || ssl == NULL)
+        return NULL;
+
+    session = OS_MALLOC(sizeof(mbedtls_ssl_session));
+    if (session == NULL)
+        return NULL;
+    mbedtls_ssl_session_init(session);
+    if ((ret = mbedtls_ssl_get_session(&ssl->ssl_ctx, session)) != 0) {
+        WARN("mbedtls_ssl_get_session failed: %d", ret);
+        mbedtls_ssl_session_free(session);
+        OS_FREE(session);
+        return NULL;
+    }
+    return session;
+#else
+    return NULL;
+#endif
+}
+
+void httpclient_free_session(void *session)
+{
+#ifdef SYSUTILS_HAVE_MBEDTLS_ENABLED
+    if (session != NULL) {
+        mbedtls_ssl_session_free((mbedtls_ssl_session *)session);
+        OS_FREE(session);
+    }
+#endif
+}
@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <string.h>
+#include "osal/os_thread.h"
+#include "cutils/memory_helper.h"
+#include "cutils/log_helper.h"
+#include "cutils/bufpool.h"
+
+#define LOG_TAG "bufpool_test"
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            OS_LOGE(LOG_TAG, "Check failed at line %d: %s", __LINE__, #cond); \
+            return -1; \
+        } \
+    } while (0)
+
+// A put block serves the next request of up to its size and down to half
+// of it, the smallest idle block that fits is taken first
+static int test_size_class()
+{
+    void *small, *big, *p, *q;
+    bufpool_handle pool = bufpool_create();
+    CHECK(pool != NULL);
+
+    small = bufpool_get(pool, 1024);
+    big = bufpool_get(pool, 4096);
+    CHECK(small != NULL && big != NULL && small != big);
+    memset(small, 0xa5, 1024);
+    memset(big, 0x5a, 4096);
+    bufpool_put(pool, big);
+    bufpool_put(pool, small);
+
+    // Smallest fit, whatever order the blocks were put back in
+    p = bufpool_get(pool, 1000);
+    CHECK(p == small);
+    q = bufpool_get(pool, 2048);
+    CHECK(q == big);
+    bufpool_put(pool, p);
+    bufpool_put(pool, q);
+
+    // Exactly half still fits
+    p = bufpool_get(pool, 512);
+    CHECK(p == small);
+    bufpool_put(pool, p);
+
+    // Less than half, don't tie up the 1024 block
+    p = bufpool_get(pool, 511);
+    CHECK(p != NULL && p != small && p != big);
+    memset(p, 0x0, 511);
+    // Bigger than any idle block
+    q = bufpool_get(pool, 8192);
+    CHECK(q != NULL && q != small && q != big);
+    memset(q, 0x0, 8192);
+    bufpool_put(pool, p);
+    bufpool_put(pool, q);
+
+    // Invalid sizes
+    CHECK(bufpool_get(pool, 0) == NULL);
+    CHECK(bufpool_get(pool, -1) == NULL);
+    bufpool_put(pool, NULL);
+
+    bufpool_destroy(pool);
+    return 0;
+}
+
+// Reserved blocks are handed out as if they were put back before, trim
+// leaves the pool empty but usable
+static int test_reserve_trim()
+{
+    void *buf[3], *p;
+    bufpool_handle pool = bufpool_create();
+    CHECK(pool != NULL);
+
+    CHECK(bufpool_reserve(pool, 2048, 3) == 0);
+    CHECK(bufpool_reserve(pool, 0, 1) != 0);
+    CHECK(bufpool_reserve(NULL, 2048, 1) != 0);
+
+    for (int i = 0; i < 3; i++) {
+        buf[i] = bufpool_get(pool, 2048);
+        CHECK(buf[i] != NULL);
+        memset(buf[i], i, 2048);
+        for (int j = 0; j < i; j++)
+            CHECK(buf[i] != buf[j]);
+    }
+    for (int i = 0; i < 3; i++)
+        bufpool_put(pool, buf[i]);
+
+    p = bufpool_get(pool, 1500);
+    CHECK(p == buf[0] || p == buf[1] || p == buf[2]);
+    bufpool_trim(pool);
+    bufpool_trim(pool);
+
+    // Block in use when trimmed goes back to the pool as usual
+    bufpool_put(pool, p);
+    CHECK(bufpool_get(pool, 1500) == p);
+    bufpool_put(pool, p);
+
+    bufpool_destroy(pool);
+    return 0;
+}
+
+// Blocks in use when the pool is destroyed stay valid, and the pool is
+// freed along with the last of them
+static int test_put_after_destroy()
+{
+    void *p, *q;
+    bufpool_handle pool = bufpool_create();
+    CHECK(pool != NULL);
+
+    CHECK(bufpool_reserve(pool, 256, 2) == 0);
+    p = bufpool_get(pool, 256);
+    q = bufpool_get(pool, 4096);
+    CHECK(p != NULL && q != NULL);
+
+    bufpool_destroy(pool);
+    memset(p, 0x11, 256);
+    memset(q, 0x22, 4096);
+    bufpool_put(pool, p);
+    bufpool_put(pool, q);
+    return 0;
+}
+
+// NULL pool falls back to malloc/free
+static int test_null_pool()
+{
+    void *p = bufpool_get(NULL, 128);
+    CHECK(p != NULL);
+    memset(p, 0x0, 128);
+    bufpool_put(NULL, p);
+    bufpool_trim(NULL);
+    bufpool_destroy(NULL);
+    return 0;
+}
+
+int main()
+{
+    int ret = 0;
+
+    if (test_size_class() != 0) {
+        OS_LOGE(LOG_TAG, "test_size_class failed");
+        ret = -1;
+    }
+    if (test_reserve_trim() != 0) {
+        OS_LOGE(LOG_TAG, "test_reserve_trim failed");
+        ret = -1;
+    }
+    if (test_put_after_destroy() != 0) {
+        OS_LOGE(LOG_TAG, "test_put_after_destroy failed");
+        ret = -1;
+    }
+    if (test_null_pool() != 0) {
+        OS_LOGE(LOG_TAG, "test_null_pool failed");
+        ret = -1;
+    }
+
+    // Idle blocks, blocks put after destroy and the pools are all freed
+    OS_MEMORY_DUMP();
+
+    OS_LOGI(LOG_TAG, "bufpool test %s", ret == 0 ? "passed" : "failed");
+    return ret == 0 ? 0 : 1;
+}
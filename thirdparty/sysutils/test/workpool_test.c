@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <string.h>
+#include "osal/os_thread.h"
+#include "osal/os_time.h"
+#include "cutils/memory_helper.h"
+#include "cutils/log_helper.h"
+#include "cutils/workpool.h"
+
+#define LOG_TAG "workpool_test"
+
+#define WAIT_TIMEOUT_USEC   (2000 * 1000)
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            OS_LOGE(LOG_TAG, "Check failed at line %d: %s", __LINE__, #cond); \
+            return -1; \
+        } \
+    } while (0)
+
+struct test_job {
+    workpool_job_handle job;
+    char tag;
+    int steps;
+    int limit;               // steps before done, 0 means never done
+    long ret;                // returned by steps before limit
+    bool block;              // block the first step until released
+    bool released;
+    unsigned long long time[2];
+};
+
+static os_mutex g_lock = NULL;
+static os_cond g_cond = NULL;
+static char g_order[32];
+static int g_order_len = 0;
+
+static long test_job_run(void *arg)
+{
+    struct test_job *test = (struct test_job *)arg;
+    long ret;
+
+    os_mutex_lock(g_lock);
+    if (test->steps < 2)
+        test->time[test->steps] = os_monotonic_usec();
+    test->steps++;
+    if (g_order_len < (int)sizeof(g_order) - 1)
+        g_order[g_order_len++] = test->tag;
+    os_cond_broadcast(g_cond);
+    if (test->block && test->steps == 1) {
+        while (!test->released)
+            os_cond_wait(g_cond, g_lock);
+    }
+    ret = (test->limit > 0 && test->steps >= test->limit) ? WORKPOOL_JOB_DONE : test->ret;
+    os_mutex_unlock(g_lock);
+    return ret;
+}
+
+static int test_job_wait_steps(struct test_job *test, int steps)
+{
+    unsigned long long deadline = os_monotonic_usec() + WAIT_TIMEOUT_USEC;
+    unsigned long long now;
+    int ret;
+
+    os_mutex_lock(g_lock);
+    while (test->steps < steps) {
+        now = os_monotonic_usec();
+        if (now >= deadline)
+            break;
+        os_cond_timedwait(g_cond, g_lock, (unsigned long)(deadline - now));
+    }
+    ret = test->steps;
+    os_mutex_unlock(g_lock);
+    return ret;
+}
+
+static void test_job_release(struct test_job *test)
+{
+    os_mutex_lock(g_lock);
+    test->released = true;
+    os_cond_broadcast(g_cond);
+    os_mutex_unlock(g_lock);
+}
+
+// Yielded jobs go to the tail of the queue, two of them take turns
+static int test_yield()
+{
+    struct test_job gate = { .tag = 'g', .limit = 1, .block = true, };
+    struct test_job a = { .tag = 'a', .limit = 5, .ret = 0, };
+    struct test_job b = { .tag = 'b', .limit = 5, .ret = 0, };
+    struct os_thread_attr attr = { .name = "yield", };
+    workpool_handle pool = workpool_create(&attr, 1);
+    CHECK(pool != NULL);
+
+    g_order_len = 0;
+    memset(g_order, 0x0, sizeof(g_order));
+
+    // Hold the only worker, so a and b are both queued before any step
+    gate.job = workpool_job_create(pool, test_job_run, &gate);
+    a.job = workpool_job_create(pool, test_job_run, &a);
+    b.job = workpool_job_create(pool, test_job_run, &b);
+    workpool_job_wake(gate.job);
+    CHECK(test_job_wait_steps(&gate, 1) == 1);
+    workpool_job_wake(a.job);
+    workpool_job_wake(b.job);
+    test_job_release(&gate);
+
+    CHECK(test_job_wait_steps(&a, 5) == 5);
+    CHECK(test_job_wait_steps(&b, 5) == 5);
+    OS_LOGI(LOG_TAG, "yield order: %s", g_order);
+    CHECK(strcmp(g_order, "gababababab") == 0);
+
+    workpool_destroy(pool);
+    return 0;
+}
+
+// A sleeping job runs again after its timeout, or at once when woken
+static int test_sleep()
+{
+    struct test_job timeout = { .tag = 't', .limit = 2, .ret = 50 * 1000, };
+    struct test_job woken = { .tag = 'w', .limit = 2, .ret = 10 * 1000 * 1000, };
+    unsigned long long elapsed;
+    workpool_handle pool = workpool_create(NULL, 2);
+    CHECK(pool != NULL);
+
+    timeout.job = workpool_job_create(pool, test_job_run, &timeout);
+    woken.job = workpool_job_create(pool, test_job_run, &woken);
+    workpool_job_wake(timeout.job);
+    workpool_job_wake(woken.job);
+
+    CHECK(test_job_wait_steps(&timeout, 2) == 2);
+    elapsed = timeout.time[1] - timeout.time[0];
+    OS_LOGI(LOG_TAG, "sleep 50000 usec, elapsed %llu usec", elapsed);
+    CHECK(elapsed >= 50 * 1000 && elapsed < 50 * 1000 + WAIT_TIMEOUT_USEC);
+
+    CHECK(test_job_wait_steps(&woken, 1) == 1);
+    os_thread_sleep_msec(20);
+    workpool_job_wake(woken.job);
+    CHECK(test_job_wait_steps(&woken, 2) == 2);
+    elapsed = woken.time[1] - woken.time[0];
+    OS_LOGI(LOG_TAG, "sleep 10000000 usec, woken after %llu usec", elapsed);
+    CHECK(elapsed < WAIT_TIMEOUT_USEC);
+
+    workpool_destroy(pool);
+    return 0;
+}
+
+// A job woken while running is queued again even if it returned WAIT
+static int test_wake_running()
+{
+    struct test_job test = { .tag = 'r', .limit = 2, .ret = WORKPOOL_JOB_WAIT, .block = true, };
+    workpool_handle pool = workpool_create(NULL, 1);
+    CHECK(pool != NULL);
+
+    test.job = workpool_job_create(pool, test_job_run, &test);
+    workpool_job_wake(test.job);
+    CHECK(test_job_wait_steps(&test, 1) == 1);
+    workpool_job_wake(test.job);
+    test_job_release(&test);
+    CHECK(test_job_wait_steps(&test, 2) == 2);
+
+    workpool_destroy(pool);
+    return 0;
+}
+
+// Done jobs are freed by the pool, destroy drops queued, sleeping and
+// parked jobs without waiting for them
+static int test_destroy_pending()
+{
+    struct test_job done = { .tag = 'd', .limit = 1, };
+    struct test_job yielding = { .tag = 'y', .limit = 0, .ret = 0, };
+    struct test_job sleeping = { .tag = 's', .limit = 0, .ret = 10 * 1000 * 1000, };
+    struct test_job parked = { .tag = 'p', .limit = 0, .ret = WORKPOOL_JOB_WAIT, };
+    struct test_job idle = { .tag = 'i', };
+    unsigned long long begin;
+    workpool_handle pool = workpool_create(NULL, 2);
+    CHECK(pool != NULL);
+
+    done.job = workpool_job_create(pool, test_job_run, &done);
+    yielding.job = workpool_job_create(pool, test_job_run, &yielding);
+    sleeping.job = workpool_job_create(pool, test_job_run, &sleeping);
+    parked.job = workpool_job_create(pool, test_job_run, &parked);
+    idle.job = workpool_job_create(pool, test_job_run, &idle);
+    workpool_job_wake(done.job);
+    workpool_job_wake(yielding.job);
+    workpool_job_wake(sleeping.job);
+    workpool_job_wake(parked.job);
+
+    CHECK(test_job_wait_steps(&done, 1) == 1);
+    CHECK(test_job_wait_steps(&yielding, 10) >= 10);
+    CHECK(test_job_wait_steps(&sleeping, 1) == 1);
+    CHECK(test_job_wait_steps(&parked, 1) == 1);
+
+    begin = os_monotonic_usec();
+    workpool_destroy(pool);
+    OS_LOGI(LOG_TAG, "destroy with pending jobs in %llu usec", os_monotonic_usec() - begin);
+    CHECK(os_monotonic_usec() - begin < WAIT_TIMEOUT_USEC);
+    CHECK(done.steps == 1 && sleeping.steps == 1 && parked.steps == 1 && idle.steps == 0);
+    return 0;
+}
+
+int main()
+{
+    int ret = 0;
+
+    g_lock = os_mutex_create();
+    g_cond = os_cond_create();
+
+    if (test_yield() != 0) {
+        OS_LOGE(LOG_TAG, "test_yield failed");
+        ret = -1;
+    }
+    if (test_sleep() != 0) {
+        OS_LOGE(LOG_TAG, "test_sleep failed");
+        ret = -1;
+    }
+    if (test_wake_running() != 0) {
+        OS_LOGE(LOG_TAG, "test_wake_running failed");
+        ret = -1;
+    }
+    if (test_destroy_pending() != 0) {
+        OS_LOGE(LOG_TAG, "test_destroy_pending failed");
+        ret = -1;
+    }
+
+    os_cond_destroy(g_cond);
+    os_mutex_destroy(g_lock);
+
+    // All jobs are freed by now, nothing of workpool should be left
+    OS_MEMORY_DUMP();
+
+    OS_LOGI(LOG_TAG, "workpool test %s", ret == 0 ? "passed" : "failed");
+    return ret == 0 ? 0 : 1;
+}